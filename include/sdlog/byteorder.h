@@ -0,0 +1,156 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SDLOG_BYTEORDER_H
+#define SDLOG_BYTEORDER_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <sdlog/decls.h>
+
+/**
+ * @file byteorder.h
+ * @brief Inline helpers to store and load values in little-endian byte order
+ *
+ * These functions are used by the code generated from compile-time message
+ * format definitions and by streams with on-disk headers. On hosts that are
+ * known to be little-endian they boil down to a single unaligned store or
+ * load; elsewhere they fall back to byte shifts.
+ */
+
+__BEGIN_DECLS
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SDLOG_HOST_IS_LITTLE_ENDIAN 1
+#else
+#define SDLOG_HOST_IS_LITTLE_ENDIAN 0
+#endif
+
+/**
+ * @brief Stores an unsigned 16-bit integer in little-endian byte order.
+ */
+static inline void sdlog_store_u16_le(uint8_t* dest, uint16_t value)
+{
+#if SDLOG_HOST_IS_LITTLE_ENDIAN
+    memcpy(dest, &value, sizeof(value));
+#else
+    dest[0] = (uint8_t)(value >> 0);
+    dest[1] = (uint8_t)(value >> 8);
+#endif
+}
+
+/**
+ * @brief Stores an unsigned 32-bit integer in little-endian byte order.
+ */
+static inline void sdlog_store_u32_le(uint8_t* dest, uint32_t value)
+{
+#if SDLOG_HOST_IS_LITTLE_ENDIAN
+    memcpy(dest, &value, sizeof(value));
+#else
+    dest[0] = (uint8_t)(value >> 0);
+    dest[1] = (uint8_t)(value >> 8);
+    dest[2] = (uint8_t)(value >> 16);
+    dest[3] = (uint8_t)(value >> 24);
+#endif
+}
+
+/**
+ * @brief Stores an unsigned 64-bit integer in little-endian byte order.
+ */
+static inline void sdlog_store_u64_le(uint8_t* dest, uint64_t value)
+{
+#if SDLOG_HOST_IS_LITTLE_ENDIAN
+    memcpy(dest, &value, sizeof(value));
+#else
+    sdlog_store_u32_le(dest, (uint32_t)value);
+    sdlog_store_u32_le(dest + 4, (uint32_t)(value >> 32));
+#endif
+}
+
+/**
+ * @brief Stores an IEEE single-precision float in little-endian byte order.
+ */
+static inline void sdlog_store_f32_le(uint8_t* dest, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    sdlog_store_u32_le(dest, bits);
+}
+
+/**
+ * @brief Stores an IEEE double-precision float in little-endian byte order.
+ */
+static inline void sdlog_store_f64_le(uint8_t* dest, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    sdlog_store_u64_le(dest, bits);
+}
+
+/**
+ * @brief Loads an unsigned 16-bit integer stored in little-endian byte order.
+ */
+static inline uint16_t sdlog_load_u16_le(const uint8_t* src)
+{
+#if SDLOG_HOST_IS_LITTLE_ENDIAN
+    uint16_t value;
+    memcpy(&value, src, sizeof(value));
+    return value;
+#else
+    return (uint16_t)(src[0] | (src[1] << 8));
+#endif
+}
+
+/**
+ * @brief Loads an unsigned 32-bit integer stored in little-endian byte order.
+ */
+static inline uint32_t sdlog_load_u32_le(const uint8_t* src)
+{
+#if SDLOG_HOST_IS_LITTLE_ENDIAN
+    uint32_t value;
+    memcpy(&value, src, sizeof(value));
+    return value;
+#else
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+#endif
+}
+
+/**
+ * @brief Loads an unsigned 64-bit integer stored in little-endian byte order.
+ */
+static inline uint64_t sdlog_load_u64_le(const uint8_t* src)
+{
+#if SDLOG_HOST_IS_LITTLE_ENDIAN
+    uint64_t value;
+    memcpy(&value, src, sizeof(value));
+    return value;
+#else
+    return (uint64_t)sdlog_load_u32_le(src) | ((uint64_t)sdlog_load_u32_le(src + 4) << 32);
+#endif
+}
+
+__END_DECLS
+
+#endif
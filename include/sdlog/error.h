@@ -51,6 +51,7 @@ typedef enum {
     SDLOG_EIO,            /**< Generic I/O error */
     SDLOG_UNIMPLEMENTED,  /**< Unimplemented function call */
     SDLOG_EOF,            /**< End of file */
+    SDLOG_EPARSE,         /**< Malformed log */
 } sdlog_error_t;
 // clang-format on
 
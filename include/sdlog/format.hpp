@@ -0,0 +1,307 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SDLOG_FORMAT_HPP
+#define SDLOG_FORMAT_HPP
+
+/**
+ * @file format.hpp
+ * @brief Header-only C++ API for message formats with compile-time column types
+ *
+ * This header requires C++17. The \ref sdlog::Format template that takes the
+ * message type as a string literal template argument additionally requires
+ * C++20; in C++17 mode only \ref sdlog::BasicFormat is available.
+ *
+ * The column types of a format are template arguments, so the size of a record
+ * and the offset of each column are known at compile time, the arguments of
+ * \c encode() and \c write() are type-checked by the compiler and floats are
+ * stored without the promotion to \c double that variadic functions imply.
+ */
+
+#if !defined(__cplusplus) || __cplusplus < 201703L
+#error "sdlog/format.hpp requires C++17 or later"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <sdlog/byteorder.h>
+#include <sdlog/model.h>
+#include <sdlog/writer.h>
+
+namespace sdlog {
+
+/**
+ * @brief Exception thrown when a \c libsdlog call made by the C++ API fails.
+ */
+class error : public std::runtime_error {
+public:
+    explicit error(sdlog_error_t code)
+        : std::runtime_error(sdlog_error_to_string(code))
+        , code_(code)
+    {
+    }
+
+    /** Returns the \c libsdlog error code that triggered the exception */
+    sdlog_error_t code() const noexcept { return code_; }
+
+private:
+    sdlog_error_t code_;
+};
+
+/**
+ * @brief Compile-time properties of a column type code.
+ *
+ * Specializations define the C++ type of the values stored in the column, the
+ * encoded size of the column and a function that stores a value. There is no
+ * specialization for unsupported type codes, so using one of them in a
+ * \ref BasicFormat is a compile-time error.
+ */
+template <char Type>
+struct column_traits;
+
+namespace detail {
+
+template <typename T, std::size_t Size>
+struct integer_column {
+    using type = T;
+    static constexpr std::size_t size = Size;
+
+    static void store(uint8_t* dest, type value) noexcept
+    {
+        if constexpr (Size == 1) {
+            *dest = static_cast<uint8_t>(value);
+        } else if constexpr (Size == 2) {
+            sdlog_store_u16_le(dest, static_cast<uint16_t>(value));
+        } else if constexpr (Size == 4) {
+            sdlog_store_u32_le(dest, static_cast<uint32_t>(value));
+        } else {
+            sdlog_store_u64_le(dest, static_cast<uint64_t>(value));
+        }
+    }
+};
+
+template <std::size_t Size>
+struct string_column {
+    using type = const char*;
+    static constexpr std::size_t size = Size;
+
+    static void store(uint8_t* dest, type value) noexcept
+    {
+        std::strncpy(reinterpret_cast<char*>(dest), value, Size);
+    }
+};
+
+} // namespace detail
+
+// clang-format off
+template <> struct column_traits<'b'> : detail::integer_column<int8_t, 1> { };
+template <> struct column_traits<'B'> : detail::integer_column<uint8_t, 1> { };
+template <> struct column_traits<'M'> : detail::integer_column<uint8_t, 1> { };
+template <> struct column_traits<'c'> : detail::integer_column<int16_t, 2> { };
+template <> struct column_traits<'C'> : detail::integer_column<uint16_t, 2> { };
+template <> struct column_traits<'h'> : detail::integer_column<int16_t, 2> { };
+template <> struct column_traits<'H'> : detail::integer_column<uint16_t, 2> { };
+template <> struct column_traits<'e'> : detail::integer_column<int32_t, 4> { };
+template <> struct column_traits<'E'> : detail::integer_column<uint32_t, 4> { };
+template <> struct column_traits<'L'> : detail::integer_column<int32_t, 4> { };
+template <> struct column_traits<'i'> : detail::integer_column<int32_t, 4> { };
+template <> struct column_traits<'I'> : detail::integer_column<uint32_t, 4> { };
+template <> struct column_traits<'q'> : detail::integer_column<int64_t, 8> { };
+template <> struct column_traits<'Q'> : detail::integer_column<uint64_t, 8> { };
+template <> struct column_traits<'n'> : detail::string_column<4> { };
+template <> struct column_traits<'N'> : detail::string_column<16> { };
+template <> struct column_traits<'Z'> : detail::string_column<64> { };
+// clang-format on
+
+template <>
+struct column_traits<'f'> {
+    using type = float;
+    static constexpr std::size_t size = 4;
+    static void store(uint8_t* dest, type value) noexcept { sdlog_store_f32_le(dest, value); }
+};
+
+template <>
+struct column_traits<'d'> {
+    using type = double;
+    static constexpr std::size_t size = 8;
+    static void store(uint8_t* dest, type value) noexcept { sdlog_store_f64_le(dest, value); }
+};
+
+/**
+ * @brief Message format whose column types are known at compile time.
+ *
+ * The object owns an \ref sdlog_message_format_t that describes the format to
+ * the rest of the library. Objects of this class cannot be copied or moved
+ * because log writers identify message formats by their addresses.
+ *
+ * @tparam Types  the type codes of the columns of the format
+ */
+template <char... Types>
+class BasicFormat {
+public:
+    /** Number of columns in the format */
+    static constexpr std::size_t column_count = sizeof...(Types);
+
+    /** Size of the body of a record, without the sync bytes and the message ID */
+    static constexpr std::size_t body_size = (std::size_t(0) + ... + column_traits<Types>::size);
+
+    /** Total size of an encoded record, including the sync bytes and the message ID */
+    static constexpr std::size_t size = body_size + 3;
+
+    static_assert(column_count > 0, "a message format needs at least one column");
+    static_assert(column_count <= 16, "a message format may have at most 16 columns");
+    static_assert(size <= 255, "encoded records may not be longer than 255 bytes");
+
+    /**
+     * @brief Creates a new message format.
+     *
+     * @param id     the numeric ID of the message format
+     * @param type   the human-readable short type code of the message format
+     * @param names  the names of the columns, comma-separated
+     * @param units  the units of the columns; \c nullptr means no units
+     * @throw error  if the format cannot be created
+     */
+    BasicFormat(uint8_t id, const char* type, const char* names, const char* units = nullptr)
+    {
+        static const char types[] = { Types..., 0 };
+        sdlog_error_t retval;
+
+        retval = sdlog_message_format_init(&format_, id, type);
+        if (retval != SDLOG_SUCCESS) {
+            throw error(retval);
+        }
+
+        retval = sdlog_message_format_add_columns(&format_, names, types, units ? units : "");
+        if (retval != SDLOG_SUCCESS) {
+            sdlog_message_format_destroy(&format_);
+            throw error(retval);
+        }
+    }
+
+    ~BasicFormat() { sdlog_message_format_destroy(&format_); }
+
+    BasicFormat(const BasicFormat&) = delete;
+    BasicFormat& operator=(const BasicFormat&) = delete;
+
+    /** Returns the underlying message format object */
+    const sdlog_message_format_t* get() const noexcept { return &format_; }
+
+    /** Returns the numeric ID of the message format */
+    uint8_t id() const noexcept { return format_.id; }
+
+    /**
+     * @brief Encodes a record into the given buffer.
+     *
+     * @param buf     the buffer to encode the record into; it must have room
+     *                for at least \ref size bytes
+     * @param values  the values of the columns
+     * @return the number of bytes written, which is always \ref size
+     */
+    std::size_t encode(uint8_t* buf, typename column_traits<Types>::type... values) const noexcept
+    {
+        uint8_t* ptr = buf + 3;
+
+        buf[0] = 0xA3;
+        buf[1] = 0x95;
+        buf[2] = format_.id;
+        ((column_traits<Types>::store(ptr, values), ptr += column_traits<Types>::size), ...);
+
+        return size;
+    }
+
+    /**
+     * @brief Encodes a record and writes it to a log writer.
+     *
+     * @param writer  the writer to use
+     * @param values  the values of the columns
+     */
+    sdlog_error_t write(sdlog_writer_t* writer, typename column_traits<Types>::type... values) const
+    {
+        uint8_t buf[size];
+        encode(buf, values...);
+        return sdlog_writer_write_encoded(writer, &format_, buf, size);
+    }
+
+private:
+    sdlog_message_format_t format_;
+};
+
+#if defined(__cpp_nontype_template_args) && __cpp_nontype_template_args >= 201911L
+
+/**
+ * @brief String literal wrapper that can be used as a template argument.
+ */
+template <std::size_t N>
+struct fixed_string {
+    char value[N] {};
+
+    constexpr fixed_string(const char (&str)[N])
+    {
+        for (std::size_t i = 0; i < N; i++) {
+            value[i] = str[i];
+        }
+    }
+};
+
+/**
+ * @brief Message format whose type and column types are known at compile time.
+ *
+ * Requires C++20. Example:
+ *
+ * \code
+ * sdlog::Format<"IMU", 'Q', 'f', 'f'> imu(0x20, "TimeUS,GyrX,GyrY", "sEE");
+ * imu.write(&writer, time_usec, gyro_x, gyro_y);
+ * \endcode
+ *
+ * @tparam Type   the human-readable short type code of the message format
+ * @tparam Types  the type codes of the columns of the format
+ */
+template <fixed_string Type, char... Types>
+class Format : public BasicFormat<Types...> {
+public:
+    static_assert(sizeof(Type.value) <= SDLOG_MAX_MESSAGE_TYPE_LENGTH + 1, "message type is too long");
+
+    /**
+     * @brief Creates a new message format.
+     *
+     * @param id     the numeric ID of the message format
+     * @param names  the names of the columns, comma-separated
+     * @param units  the units of the columns; \c nullptr means no units
+     * @throw error  if the format cannot be created
+     */
+    Format(uint8_t id, const char* names, const char* units = nullptr)
+        : BasicFormat<Types...>(id, Type.value, names, units)
+    {
+    }
+};
+
+#endif
+
+} // namespace sdlog
+
+#endif
@@ -44,7 +44,9 @@ typedef struct {
     /** The unit code character of this column */
     char unit;
 
-    /** The name of this column. Owned by the message column format itself. */
+    /** The name of this column. Interned with \ref sdlog_symbol_intern() and
+     * shared with the other columns of the same name, so it must not be
+     * modified; it is \c char* only for compatibility. */
     char* name;
 } sdlog_message_column_format_t;
 
@@ -65,6 +67,8 @@ sdlog_error_t sdlog_message_column_format_init(
 /**
  * @brief Destroys a message column format object.
  *
+ * Releases the reference of the column to its interned name.
+ *
  * @param format  the format object to destroy
  */
 void sdlog_message_column_format_destroy(sdlog_message_column_format_t* format);
@@ -173,6 +177,23 @@ uint8_t sdlog_message_format_get_column_count(const sdlog_message_format_t* form
 const sdlog_message_column_format_t* sdlog_message_format_get_column(
     const sdlog_message_format_t* format, uint8_t index);
 
+/**
+ * @brief Finds the column with the given name in the format object.
+ *
+ * The hash and the length of the name are compared to those of the
+ * interned column names before their characters, without locking the table
+ * of interned names. Formats defined with \ref SDLOG_DEFINE_FORMAT do not
+ * intern their column names; their columns are compared to the name
+ * character by character.
+ *
+ * @param format  the format object to query
+ * @param name    the name of the column
+ * @return the index of the first column with the given name, or -1 if there
+ *         is no such column
+ */
+int sdlog_message_format_find_column(
+    const sdlog_message_format_t* format, const char* name);
+
 /**
  * @brief Allocates and returns a new string containing the names of the columns.
  *
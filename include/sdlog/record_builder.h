@@ -0,0 +1,159 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SDLOG_RECORD_BUILDER_H
+#define SDLOG_RECORD_BUILDER_H
+
+#include <stdint.h>
+
+#include <sdlog/decls.h>
+#include <sdlog/error.h>
+#include <sdlog/model.h>
+#include <sdlog/writer.h>
+
+/**
+ * @file record_builder.h
+ * @brief Typed, field-by-field construction of log records
+ *
+ * The record builder is an alternative to \ref sdlog_writer_write() and
+ * \ref sdlog_message_format_encode() for callers that cannot or do not want
+ * to use variadic functions, such as foreign function interfaces. Each setter
+ * writes its value directly to the precomputed offset of the column in the
+ * record being assembled; columns that are not set are left at zero.
+ */
+
+__BEGIN_DECLS
+
+typedef struct {
+    /** The message format of the records being built */
+    const sdlog_message_format_t* format;
+
+    /** Offset of each column from the start of the record, including the
+     * sync bytes and the message ID */
+    uint16_t* offsets;
+
+    /** Cached empty record: sync bytes and message ID followed by zeros */
+    uint8_t* template_record;
+
+    /** The record being assembled */
+    uint8_t* record;
+
+    /** Total length of a record, including the sync bytes and the message ID */
+    uint16_t length;
+} sdlog_record_builder_t;
+
+/**
+ * @brief Creates a new record builder for the given message format.
+ *
+ * The message format must not be modified or destroyed while the builder is
+ * in use.
+ *
+ * @param builder  the builder to initialize
+ * @param format   the message format of the records to build
+ */
+sdlog_error_t sdlog_record_builder_init(
+    sdlog_record_builder_t* builder, const sdlog_message_format_t* format);
+
+/**
+ * @brief Destroys a record builder.
+ *
+ * @param builder  the builder to destroy
+ */
+void sdlog_record_builder_destroy(sdlog_record_builder_t* builder);
+
+/**
+ * @brief Clears all the columns of the record being assembled.
+ *
+ * @param builder  the builder to reset
+ */
+void sdlog_record_builder_reset(sdlog_record_builder_t* builder);
+
+/**
+ * @brief Sets the value of an integer column in the record being assembled.
+ *
+ * The width of the setter must match the width of the column type; the
+ * signedness does not need to match. Fixed-point columns (\c c, \c C, \c e,
+ * \c E and \c L) expect the raw integer value.
+ *
+ * @param builder  the builder to modify
+ * @param index    the index of the column
+ * @param value    the value to store
+ * @return \c SDLOG_SUCCESS if the value was stored, \c SDLOG_EINVAL if the
+ *         index is out of range or the column is not an integer column of the
+ *         given width
+ */
+sdlog_error_t sdlog_record_builder_set_i8(sdlog_record_builder_t* builder, uint8_t index, int8_t value);
+sdlog_error_t sdlog_record_builder_set_u8(sdlog_record_builder_t* builder, uint8_t index, uint8_t value);
+sdlog_error_t sdlog_record_builder_set_i16(sdlog_record_builder_t* builder, uint8_t index, int16_t value);
+sdlog_error_t sdlog_record_builder_set_u16(sdlog_record_builder_t* builder, uint8_t index, uint16_t value);
+sdlog_error_t sdlog_record_builder_set_i32(sdlog_record_builder_t* builder, uint8_t index, int32_t value);
+sdlog_error_t sdlog_record_builder_set_u32(sdlog_record_builder_t* builder, uint8_t index, uint32_t value);
+sdlog_error_t sdlog_record_builder_set_i64(sdlog_record_builder_t* builder, uint8_t index, int64_t value);
+sdlog_error_t sdlog_record_builder_set_u64(sdlog_record_builder_t* builder, uint8_t index, uint64_t value);
+
+/**
+ * @brief Sets the value of a single-precision float column (\c f).
+ *
+ * @return \c SDLOG_EINVAL if the index is out of range or the column has a
+ *         different type
+ */
+sdlog_error_t sdlog_record_builder_set_f32(sdlog_record_builder_t* builder, uint8_t index, float value);
+
+/**
+ * @brief Sets the value of a double-precision float column (\c d).
+ *
+ * @return \c SDLOG_EINVAL if the index is out of range or the column has a
+ *         different type
+ */
+sdlog_error_t sdlog_record_builder_set_f64(sdlog_record_builder_t* builder, uint8_t index, double value);
+
+/**
+ * @brief Sets the value of a string column (\c n, \c N or \c Z).
+ *
+ * Strings longer than the column are truncated.
+ *
+ * @return \c SDLOG_EINVAL if the index is out of range or the column is not a
+ *         string column
+ */
+sdlog_error_t sdlog_record_builder_set_str(sdlog_record_builder_t* builder, uint8_t index, const char* value);
+
+/**
+ * @brief Returns the record being assembled.
+ *
+ * @param builder  the builder to query
+ * @param length   when not a NULL pointer, the length of the record is returned here
+ */
+const uint8_t* sdlog_record_builder_get(const sdlog_record_builder_t* builder, size_t* length);
+
+/**
+ * @brief Writes the record being assembled to a log writer and resets the builder.
+ *
+ * @param builder  the builder whose record is to be written
+ * @param writer   the writer to write the record to
+ */
+sdlog_error_t sdlog_record_builder_commit(sdlog_record_builder_t* builder, sdlog_writer_t* writer);
+
+__END_DECLS
+
+#endif
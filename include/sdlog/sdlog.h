@@ -25,12 +25,17 @@
 #ifndef SDLOG_SDLOG_H
 #define SDLOG_SDLOG_H
 
+#include <sdlog/byteorder.h>
 #include <sdlog/encoder.h>
 #include <sdlog/error.h>
 #include <sdlog/memory.h>
 #include <sdlog/model.h>
 #include <sdlog/parser.h>
+#include <sdlog/record_builder.h>
+#include <sdlog/slicer.h>
+#include <sdlog/static_format.h>
 #include <sdlog/streams.h>
+#include <sdlog/symbols.h>
 #include <sdlog/version.h>
 #include <sdlog/writer.h>
 
@@ -0,0 +1,104 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SDLOG_SLICER_H
+#define SDLOG_SLICER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sdlog/decls.h>
+#include <sdlog/error.h>
+#include <sdlog/streams.h>
+
+/**
+ * @file slicer.h
+ * @brief Extraction of a subset of the records of a log into a new log
+ *
+ * The slicer scans a log once to find the records to keep, then copies each
+ * contiguous run of them from the input to the output with
+ * \ref sdlog_ostream_copy_range(). Between file descriptors the runs are
+ * copied in the kernel, so only the FMT records that the output needs in
+ * front of the runs pass through user space on the way out.
+ */
+
+__BEGIN_DECLS
+
+/**
+ * @brief Decisions of a slice filter about a log record.
+ */
+typedef enum {
+    SDLOG_SLICE_SKIP = 0, /**< Leave the record out */
+    SDLOG_SLICE_KEEP,     /**< Copy the record to the output */
+    SDLOG_SLICE_STOP,     /**< Leave the record out and stop scanning the log */
+} sdlog_slice_decision_t;
+
+/**
+ * @brief Callback that decides which records of a log to keep when slicing.
+ *
+ * The callback is not called for FMT records; the slicer writes those to the
+ * output as needed.
+ *
+ * @param arg     the argument given to \ref sdlog_slice()
+ * @param offset  the offset of the record in the input stream
+ * @param record  the record, starting with the sync bytes and the message ID
+ * @param length  the length of the record
+ */
+typedef sdlog_slice_decision_t sdlog_slice_filter_t(
+    void* arg, uint64_t offset, const uint8_t* record, size_t length);
+
+/**
+ * @brief Copies the records of a log that the given filter keeps to a new log.
+ *
+ * The output starts with the FMT records of the message formats that the
+ * kept records use, and each FMT record is repeated if the format is
+ * redefined in the input. Records are copied in the order they appear in
+ * the input. Scanning stops at the end of the log, at the first truncated
+ * record, or when the filter asks for it; the filter can therefore carve a
+ * time window out of a log by returning \ref SDLOG_SLICE_STOP after the end
+ * of the window.
+ *
+ * The input stream must support \ref sdlog_istream_tell() and
+ * \ref sdlog_istream_read_at(), like streams created with
+ * \ref sdlog_istream_init_buffer(), \ref sdlog_istream_init_fd() or
+ * \ref sdlog_istream_init_file(). Its read position after slicing is
+ * unspecified. A writing session is started on the output stream before
+ * writing and ended afterwards.
+ *
+ * @param input   the stream to read the log from, starting at its current
+ *        read position
+ * @param output  the stream to write the new log to
+ * @param filter  the callback that decides which records to keep
+ * @param arg     arbitrary pointer passed to the filter
+ * @return \c SDLOG_SUCCESS if the log was sliced, \c SDLOG_EPARSE if the log
+ *         is malformed or uses a message format before defining it, or any
+ *         other error code in case of read or write errors
+ */
+sdlog_error_t sdlog_slice(
+    sdlog_istream_t* input, sdlog_ostream_t* output, sdlog_slice_filter_t* filter,
+    void* arg);
+
+__END_DECLS
+
+#endif
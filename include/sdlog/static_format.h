@@ -0,0 +1,259 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SDLOG_STATIC_FORMAT_H
+#define SDLOG_STATIC_FORMAT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <sdlog/byteorder.h>
+#include <sdlog/model.h>
+#include <sdlog/writer.h>
+
+/**
+ * @file static_format.h
+ * @brief Compile-time message format definitions
+ *
+ * This header provides the \ref SDLOG_DEFINE_FORMAT macro that turns a list of
+ * columns into a static message format descriptor, a typed encoder function
+ * and the pre-encoded FMT record of the format. The generated encoder knows
+ * the type and the offset of each column at compile time, so it needs no
+ * variadic argument list and no dispatch on the column type.
+ *
+ * The generated code relies on C99 designated initializers and on character
+ * arrays initialized from string literals without a terminating zero, so this
+ * header is meant to be used from C only.
+ */
+
+/**
+ * @def SDLOG_DEFINE_FORMAT(name, id, ...)
+ * @brief Defines a message format at compile time.
+ *
+ * Each column is given as a parenthesized <tt>(name, type, unit)</tt> triplet
+ * where \c type is one of the column type codes supported by the encoder
+ * (except \c a) and \c unit is the unit code character of the column, without
+ * quotes. At most 16 columns are supported. For instance:
+ *
+ * \code
+ * SDLOG_DEFINE_FORMAT(IMU, 0x20, (TimeUS, Q, s), (GyrX, f, E), (GyrY, f, E))
+ * \endcode
+ *
+ * defines the following objects, all of them with internal linkage:
+ *
+ * - \c SDLOG_IMU_LENGTH, an enum constant holding the length of a single
+ *   encoded record, including the sync bytes and the message ID
+ * - \c sdlog_IMU_format, a constant \ref sdlog_message_format_t object that
+ *   can be passed to any function that takes a message format. Do not call
+ *   \ref sdlog_message_format_destroy() on it.
+ * - \c sdlog_IMU_fmt, a constant structure holding the pre-encoded FMT record
+ *   of the format. Its size is exactly the size of an FMT record.
+ * - <tt>size_t sdlog_IMU_encode(uint8_t* buf, uint64_t TimeUS, float GyrX, float GyrY)</tt>
+ *   that encodes a record into the given buffer and returns its length
+ * - <tt>sdlog_error_t sdlog_IMU_write(sdlog_writer_t* writer, uint64_t TimeUS, float GyrX, float GyrY)</tt>
+ *   that encodes a record and writes it with \ref sdlog_writer_write_encoded()
+ *
+ * The log writer identifies message formats by their addresses, so a format
+ * should be defined in a single translation unit only; otherwise each
+ * translation unit gets its own copy and the writer emits a new FMT record
+ * whenever it sees a different copy.
+ */
+#define SDLOG_DEFINE_FORMAT(name, id, ...) \
+    SDLOG__DEFINE_FORMAT(name, id, SDLOG__NARGS(__VA_ARGS__), __VA_ARGS__)
+
+/* ************************************************************************** */
+
+/* Implementation details below; do not use these macros directly */
+
+#if defined(__GNUC__)
+#define SDLOG__UNUSED __attribute__((unused))
+#else
+#define SDLOG__UNUSED /* empty */
+#endif
+
+#define SDLOG__CAT(a, b) SDLOG__CAT_(a, b)
+#define SDLOG__CAT_(a, b) a##b
+
+/* Counts the columns in a column list, up to 16 */
+#define SDLOG__NARGS(...) \
+    SDLOG__NARGS_(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define SDLOG__NARGS_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, \
+    _14, _15, _16, n, ...) n
+
+/* Applies M to each (name, type, unit) triplet, separated by the expansion of S() */
+#define SDLOG__FOREACH(n, M, S, ...) SDLOG__CAT(SDLOG__FE_, n)(M, S, __VA_ARGS__)
+#define SDLOG__FE_1(M, S, x) M x
+#define SDLOG__FE_2(M, S, x, ...) M x S() SDLOG__FE_1(M, S, __VA_ARGS__)
+#define SDLOG__FE_3(M, S, x, ...) M x S() SDLOG__FE_2(M, S, __VA_ARGS__)
+#define SDLOG__FE_4(M, S, x, ...) M x S() SDLOG__FE_3(M, S, __VA_ARGS__)
+#define SDLOG__FE_5(M, S, x, ...) M x S() SDLOG__FE_4(M, S, __VA_ARGS__)
+#define SDLOG__FE_6(M, S, x, ...) M x S() SDLOG__FE_5(M, S, __VA_ARGS__)
+#define SDLOG__FE_7(M, S, x, ...) M x S() SDLOG__FE_6(M, S, __VA_ARGS__)
+#define SDLOG__FE_8(M, S, x, ...) M x S() SDLOG__FE_7(M, S, __VA_ARGS__)
+#define SDLOG__FE_9(M, S, x, ...) M x S() SDLOG__FE_8(M, S, __VA_ARGS__)
+#define SDLOG__FE_10(M, S, x, ...) M x S() SDLOG__FE_9(M, S, __VA_ARGS__)
+#define SDLOG__FE_11(M, S, x, ...) M x S() SDLOG__FE_10(M, S, __VA_ARGS__)
+#define SDLOG__FE_12(M, S, x, ...) M x S() SDLOG__FE_11(M, S, __VA_ARGS__)
+#define SDLOG__FE_13(M, S, x, ...) M x S() SDLOG__FE_12(M, S, __VA_ARGS__)
+#define SDLOG__FE_14(M, S, x, ...) M x S() SDLOG__FE_13(M, S, __VA_ARGS__)
+#define SDLOG__FE_15(M, S, x, ...) M x S() SDLOG__FE_14(M, S, __VA_ARGS__)
+#define SDLOG__FE_16(M, S, x, ...) M x S() SDLOG__FE_15(M, S, __VA_ARGS__)
+
+#define SDLOG__SEP_NONE() /* empty */
+#define SDLOG__SEP_COMMA() ,
+#define SDLOG__SEP_PLUS() +
+#define SDLOG__SEP_COMMA_STR() ","
+
+/* C type, size and store operation for each column type code. The sizes must
+ * be kept in sync with get_size_of_column_type() in src/core/model.c */
+#define SDLOG__CTYPE_b int8_t
+#define SDLOG__CTYPE_B uint8_t
+#define SDLOG__CTYPE_M uint8_t
+#define SDLOG__CTYPE_c int16_t
+#define SDLOG__CTYPE_C uint16_t
+#define SDLOG__CTYPE_h int16_t
+#define SDLOG__CTYPE_H uint16_t
+#define SDLOG__CTYPE_e int32_t
+#define SDLOG__CTYPE_E uint32_t
+#define SDLOG__CTYPE_L int32_t
+#define SDLOG__CTYPE_i int32_t
+#define SDLOG__CTYPE_I uint32_t
+#define SDLOG__CTYPE_q int64_t
+#define SDLOG__CTYPE_Q uint64_t
+#define SDLOG__CTYPE_f float
+#define SDLOG__CTYPE_d double
+#define SDLOG__CTYPE_n const char*
+#define SDLOG__CTYPE_N const char*
+#define SDLOG__CTYPE_Z const char*
+
+#define SDLOG__SIZE_b 1
+#define SDLOG__SIZE_B 1
+#define SDLOG__SIZE_M 1
+#define SDLOG__SIZE_c 2
+#define SDLOG__SIZE_C 2
+#define SDLOG__SIZE_h 2
+#define SDLOG__SIZE_H 2
+#define SDLOG__SIZE_e 4
+#define SDLOG__SIZE_E 4
+#define SDLOG__SIZE_L 4
+#define SDLOG__SIZE_i 4
+#define SDLOG__SIZE_I 4
+#define SDLOG__SIZE_q 8
+#define SDLOG__SIZE_Q 8
+#define SDLOG__SIZE_f 4
+#define SDLOG__SIZE_d 8
+#define SDLOG__SIZE_n 4
+#define SDLOG__SIZE_N 16
+#define SDLOG__SIZE_Z 64
+
+#define SDLOG__STORE_b(ptr, value) (*(ptr) = (uint8_t)(value))
+#define SDLOG__STORE_B(ptr, value) (*(ptr) = (uint8_t)(value))
+#define SDLOG__STORE_M(ptr, value) (*(ptr) = (uint8_t)(value))
+#define SDLOG__STORE_c(ptr, value) sdlog_store_u16_le((ptr), (uint16_t)(value))
+#define SDLOG__STORE_C(ptr, value) sdlog_store_u16_le((ptr), (uint16_t)(value))
+#define SDLOG__STORE_h(ptr, value) sdlog_store_u16_le((ptr), (uint16_t)(value))
+#define SDLOG__STORE_H(ptr, value) sdlog_store_u16_le((ptr), (uint16_t)(value))
+#define SDLOG__STORE_e(ptr, value) sdlog_store_u32_le((ptr), (uint32_t)(value))
+#define SDLOG__STORE_E(ptr, value) sdlog_store_u32_le((ptr), (uint32_t)(value))
+#define SDLOG__STORE_L(ptr, value) sdlog_store_u32_le((ptr), (uint32_t)(value))
+#define SDLOG__STORE_i(ptr, value) sdlog_store_u32_le((ptr), (uint32_t)(value))
+#define SDLOG__STORE_I(ptr, value) sdlog_store_u32_le((ptr), (uint32_t)(value))
+#define SDLOG__STORE_q(ptr, value) sdlog_store_u64_le((ptr), (uint64_t)(value))
+#define SDLOG__STORE_Q(ptr, value) sdlog_store_u64_le((ptr), (uint64_t)(value))
+#define SDLOG__STORE_f(ptr, value) sdlog_store_f32_le((ptr), (value))
+#define SDLOG__STORE_d(ptr, value) sdlog_store_f64_le((ptr), (value))
+#define SDLOG__STORE_n(ptr, value) strncpy((char*)(ptr), (value), SDLOG__SIZE_n)
+#define SDLOG__STORE_N(ptr, value) strncpy((char*)(ptr), (value), SDLOG__SIZE_N)
+#define SDLOG__STORE_Z(ptr, value) strncpy((char*)(ptr), (value), SDLOG__SIZE_Z)
+
+/* Per-column expansions used by SDLOG__DEFINE_FORMAT */
+#define SDLOG__COL_SIZE(cname, ctype, cunit) SDLOG__SIZE_##ctype
+#define SDLOG__COL_TYPE_STR(cname, ctype, cunit) #ctype
+#define SDLOG__COL_NAME_STR(cname, ctype, cunit) #cname
+#define SDLOG__COL_PARAM(cname, ctype, cunit) SDLOG__CTYPE_##ctype cname
+#define SDLOG__COL_ARG(cname, ctype, cunit) cname
+#define SDLOG__COL_DESC(cname, ctype, cunit) \
+    { .type = #ctype[0], .unit = #cunit[0], .name = (char*)#cname }
+#define SDLOG__COL_STORE(cname, ctype, cunit) \
+    SDLOG__STORE_##ctype(sdlog__ptr, cname);  \
+    sdlog__ptr += SDLOG__SIZE_##ctype;
+
+#define SDLOG__DEFINE_FORMAT(msg_name, msg_id, n, ...) SDLOG__DEFINE_FORMAT_(msg_name, msg_id, n, __VA_ARGS__)
+#define SDLOG__DEFINE_FORMAT_(msg_name, msg_id, n, ...)                                                        \
+    enum { SDLOG_##msg_name##_LENGTH = 3 + SDLOG__FOREACH(n, SDLOG__COL_SIZE, SDLOG__SEP_PLUS, __VA_ARGS__) }; \
+                                                                                                               \
+    typedef char sdlog__##msg_name##_checks[                                                                   \
+        (SDLOG_##msg_name##_LENGTH <= 255                                                                      \
+            && sizeof(#msg_name) <= SDLOG_MAX_MESSAGE_TYPE_LENGTH + 1                                          \
+            && sizeof(SDLOG__FOREACH(n, SDLOG__COL_NAME_STR, SDLOG__SEP_COMMA_STR, __VA_ARGS__)) <= 65)        \
+            ? 1                                                                                                \
+            : -1];                                                                                             \
+                                                                                                               \
+    static const sdlog_message_column_format_t sdlog_##msg_name##_columns[] SDLOG__UNUSED = {                  \
+        SDLOG__FOREACH(n, SDLOG__COL_DESC, SDLOG__SEP_COMMA, __VA_ARGS__)                                      \
+    };                                                                                                         \
+                                                                                                               \
+    static const sdlog_message_format_t sdlog_##msg_name##_format SDLOG__UNUSED = {                            \
+        .id = (msg_id),                                                                                        \
+        .type = #msg_name,                                                                                     \
+        .num_columns = (n),                                                                                    \
+        .num_alloc_columns = 0,                                                                                \
+        .columns = (sdlog_message_column_format_t*)sdlog_##msg_name##_columns,                                 \
+    };                                                                                                         \
+                                                                                                               \
+    static const struct {                                                                                      \
+        uint8_t header[5];                                                                                     \
+        char type[4];                                                                                          \
+        char format[16];                                                                                       \
+        char columns[64];                                                                                      \
+    } sdlog_##msg_name##_fmt SDLOG__UNUSED = {                                                                 \
+        { 0xA3, 0x95, SDLOG_ID_FMT, (msg_id), SDLOG_##msg_name##_LENGTH },                                     \
+        #msg_name,                                                                                             \
+        SDLOG__FOREACH(n, SDLOG__COL_TYPE_STR, SDLOG__SEP_NONE, __VA_ARGS__),                                  \
+        SDLOG__FOREACH(n, SDLOG__COL_NAME_STR, SDLOG__SEP_COMMA_STR, __VA_ARGS__),                             \
+    };                                                                                                         \
+                                                                                                               \
+    static inline size_t sdlog_##msg_name##_encode(                                                            \
+        uint8_t* sdlog__buf, SDLOG__FOREACH(n, SDLOG__COL_PARAM, SDLOG__SEP_COMMA, __VA_ARGS__))               \
+    {                                                                                                          \
+        uint8_t* sdlog__ptr = sdlog__buf + 3;                                                                  \
+        sdlog__buf[0] = 0xA3;                                                                                  \
+        sdlog__buf[1] = 0x95;                                                                                  \
+        sdlog__buf[2] = (msg_id);                                                                              \
+        SDLOG__FOREACH(n, SDLOG__COL_STORE, SDLOG__SEP_NONE, __VA_ARGS__)                                      \
+        (void)sdlog__ptr;                                                                                      \
+        return SDLOG_##msg_name##_LENGTH;                                                                      \
+    }                                                                                                          \
+                                                                                                               \
+    static inline sdlog_error_t sdlog_##msg_name##_write(                                                      \
+        sdlog_writer_t* writer, SDLOG__FOREACH(n, SDLOG__COL_PARAM, SDLOG__SEP_COMMA, __VA_ARGS__))            \
+    {                                                                                                          \
+        uint8_t sdlog__record[SDLOG_##msg_name##_LENGTH];                                                      \
+        sdlog_##msg_name##_encode(                                                                             \
+            sdlog__record, SDLOG__FOREACH(n, SDLOG__COL_ARG, SDLOG__SEP_COMMA, __VA_ARGS__));                  \
+        return sdlog_writer_write_encoded(                                                                     \
+            writer, &sdlog_##msg_name##_format, sdlog__record, SDLOG_##msg_name##_LENGTH);                     \
+    }
+
+#endif
@@ -28,8 +28,10 @@
 #include <sdlog/decls.h>
 #include <sdlog/error.h>
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 /**
  * @file streams.h
@@ -79,6 +81,67 @@ typedef struct {
     sdlog_error_t (*read)(
         struct sdlog_istream_s* self, uint8_t* data, size_t length,
         size_t* bytes_read);
+
+    /**
+     * Returns the file descriptor that the stream reads from (optional).
+     *
+     * Nonblocking streams that read from a file descriptor should implement
+     * this so that callers can wait for the descriptor to become readable
+     * instead of retrying reads that return no data.
+     *
+     * @param  self  the stream
+     * @param  fd    the file descriptor is returned here. Guaranteed not to be
+     *         a null pointer.
+     */
+    sdlog_error_t (*get_fd)(struct sdlog_istream_s* self, int* fd);
+
+    /**
+     * Moves the read position of the stream to the given offset from the
+     * start of the stream (optional).
+     *
+     * @param  self    the stream
+     * @param  offset  the new read position
+     * @return \c SDLOG_SUCCESS if the position was changed, \c SDLOG_EINVAL
+     *         if the offset is beyond the end of a stream of known length,
+     *         \c SDLOG_UNIMPLEMENTED if this particular stream cannot seek,
+     *         \c SDLOG_EIO in case of other errors
+     */
+    sdlog_error_t (*seek)(struct sdlog_istream_s* self, uint64_t offset);
+
+    /**
+     * Returns the read position of the stream as an offset from the start of
+     * the stream (optional).
+     *
+     * @param  self    the stream
+     * @param  offset  the read position is returned here. Guaranteed not to
+     *         be a null pointer.
+     */
+    sdlog_error_t (*tell)(struct sdlog_istream_s* self, uint64_t* offset);
+
+    /**
+     * Reads at most the given number of bytes from the given offset of the
+     * stream without using or changing the read position (optional).
+     *
+     * Implementations must allow concurrent calls from multiple threads, so
+     * that a single stream can serve workers that read disjoint regions of
+     * it. The semantics are otherwise the same as for \c read.
+     *
+     * @param  self    the stream to read from
+     * @param  offset  the offset to read from
+     * @param  data    the buffer to read into
+     * @param  length  maximum number of bytes that can be stored in the buffer.
+     *                 Guaranteed to be positive.
+     * @param  bytes_read  the number of bytes read is returned here. Guaranteed
+     *         not to be a null pointer.
+     * @return \c SDLOG_SUCCESS in case of a successful read, \c SDLOG_EOF if
+     *         the offset is at or after the end of the stream,
+     *         \c SDLOG_UNIMPLEMENTED if this particular stream cannot read
+     *         from arbitrary offsets, \c SDLOG_EREAD in case of other read
+     *         errors.
+     */
+    sdlog_error_t (*read_at)(
+        struct sdlog_istream_s* self, uint64_t offset, uint8_t* data,
+        size_t length, size_t* bytes_read);
 } sdlog_istream_spec_t;
 
 /**
@@ -114,6 +177,42 @@ sdlog_error_t sdlog_istream_init(
     sdlog_istream_t* stream, const sdlog_istream_spec_t* spec,
     void* ctx);
 
+/**
+ * @brief Creates an input stream that filters the data read from another
+ * stream.
+ *
+ * The methods in \c spec are called with the new stream; use
+ * \ref sdlog_istream_filter_get_context() and
+ * \ref sdlog_istream_filter_get_inner() to access the context and the inner
+ * stream from them. Methods that are \c NULL are forwarded to the inner
+ * stream, except that \c seek, \c tell and \c read_at are not forwarded
+ * when \c read is given, as the filter is then assumed to change the data.
+ * \c init is called after the stream was set up; \c destroy is called
+ * before it is torn down. The inner stream is not owned by the new stream
+ * and must outlive it.
+ *
+ * @param stream  the stream to initialize
+ * @param inner   the stream to read from
+ * @param spec    the methods that the filter overrides; \c NULL forwards
+ *        everything to the inner stream
+ * @param ctx     context object that the methods may make use of
+ */
+sdlog_error_t sdlog_istream_init_filter(
+    sdlog_istream_t* stream, sdlog_istream_t* inner,
+    const sdlog_istream_spec_t* spec, void* ctx);
+
+/**
+ * @brief Returns the inner stream of an input stream created with
+ * \ref sdlog_istream_init_filter().
+ */
+sdlog_istream_t* sdlog_istream_filter_get_inner(sdlog_istream_t* stream);
+
+/**
+ * @brief Returns the context of an input stream created with
+ * \ref sdlog_istream_init_filter().
+ */
+void* sdlog_istream_filter_get_context(sdlog_istream_t* stream);
+
 /**
  * @brief Creates an input stream that reads from a fixed-size in-memory buffer.
  *
@@ -132,6 +231,241 @@ sdlog_error_t sdlog_istream_init_buffer(
  */
 sdlog_error_t sdlog_istream_init_file(sdlog_istream_t* stream, FILE* fp);
 
+/**
+ * @brief Creates an input stream that reads from the given file descriptor.
+ *
+ * Reads are passed to the file descriptor directly without buffering. If the
+ * descriptor is nonblocking, reads that would block return no bytes; use
+ * \ref sdlog_poller_init() to wait until the descriptor is readable. The
+ * file descriptor is not owned by the stream.
+ *
+ * @param stream  the stream to initialize
+ * @param fd      the file descriptor to read from
+ * @return \c SDLOG_UNIMPLEMENTED if the platform does not support file
+ *         descriptors
+ */
+sdlog_error_t sdlog_istream_init_fd(sdlog_istream_t* stream, int fd);
+
+/**
+ * @brief Callback that concatenating input streams call to open a segment.
+ *
+ * @param arg      the argument given when the stream was created
+ * @param index    the index of the segment to open
+ * @param segment  the stream to initialize for reading the segment. The
+ *        concatenating stream takes ownership of it and destroys it when it
+ *        is not needed any more.
+ * @return \c SDLOG_SUCCESS if the segment was opened, \c SDLOG_EOF if there
+ *         is no segment with the given index, any other error code if the
+ *         segment could not be opened
+ */
+typedef sdlog_error_t sdlog_segment_opener_t(void* arg, uint32_t index, sdlog_istream_t* segment);
+
+/**
+ * @brief Creates an input stream that reads a series of segments one after
+ * the other as a single stream.
+ *
+ * Segments are opened lazily with the given callback as the stream reaches
+ * them, starting from the segment with the given index and ending with the
+ * first index for which the callback returns \c SDLOG_EOF. Each segment is
+ * opened while the one before it is still being read, so opening it does not
+ * stall the reader; a segment that was not there yet at that time is looked
+ * for again when the previous one ends.
+ *
+ * A single read never returns bytes from two segments, so the caller can
+ * tell where a segment ends with \ref sdlog_istream_concat_get_segment_index().
+ * The stream has no file descriptor of its own, even if the segments do, as
+ * the file descriptor would change from segment to segment.
+ *
+ * @param stream       the stream to initialize
+ * @param opener       the callback that opens the segments
+ * @param arg          arbitrary pointer passed to the callback
+ * @param first_index  the index of the first segment
+ * @return \c SDLOG_SUCCESS if the first segment was opened or does not
+ *         exist, otherwise the error returned by the callback
+ */
+sdlog_error_t sdlog_istream_init_concat(
+    sdlog_istream_t* stream, sdlog_segment_opener_t* opener, void* arg,
+    uint32_t first_index);
+
+/**
+ * @brief Creates an input stream that reads a series of files one after the
+ * other as a single stream.
+ *
+ * The paths of the files are generated from a template in the same way as
+ * for \ref sdlog_ostream_init_rotating(), so the segments of a rotated log or
+ * the parts of a split log can be parsed as a single log without joining
+ * them first. The next file is opened and the operating system is asked to
+ * start reading it while the current one is being read.
+ *
+ * Segments written by \ref sdlog_ostream_init_rotating() repeat the FMT
+ * records at their start; parsers see the same formats defined again.
+ *
+ * @param stream         the stream to initialize
+ * @param path_template  the template of the paths of the files
+ * @param first_index    the index of the first file
+ * @return \c SDLOG_UNIMPLEMENTED if the platform does not support file
+ *         descriptors, \c SDLOG_EINVAL if the template is invalid,
+ *         \c SDLOG_EIO if the first file exists but could not be opened
+ */
+sdlog_error_t sdlog_istream_init_concat_files(
+    sdlog_istream_t* stream, const char* path_template, uint32_t first_index);
+
+/**
+ * @brief Returns the index of the segment that a concatenating input stream
+ * is reading.
+ *
+ * After a read, this is the segment that the bytes returned by the read came
+ * from. After the end of the stream, it is one past the last segment.
+ *
+ * @param stream  the stream created with \ref sdlog_istream_init_concat() or
+ *        \ref sdlog_istream_init_concat_files()
+ */
+uint32_t sdlog_istream_concat_get_segment_index(sdlog_istream_t* stream);
+
+/**
+ * @brief Creates an input stream that reads a circular log file.
+ *
+ * The stream starts at the oldest valid block of the file and returns the
+ * contents of the blocks in the order they were written, up to the newest
+ * one. The result is a regular log; FMT records repeated at the start of
+ * each block are harmless to parsers.
+ *
+ * @param stream  the stream to initialize
+ * @param path    the path of the file, written earlier by a stream created
+ *        with \ref sdlog_ostream_init_circular_file()
+ * @return \c SDLOG_UNIMPLEMENTED if the platform does not support circular
+ *         log files, \c SDLOG_EIO if the file could not be opened,
+ *         \c SDLOG_EREAD if it is not a circular log file
+ */
+sdlog_error_t sdlog_istream_init_circular_file(sdlog_istream_t* stream, const char* path);
+
+/**
+ * @brief Creates an input stream that drains a shared-memory ring written by
+ * another process.
+ *
+ * This is the consumer side of \ref sdlog_ostream_init_shm(). Reads block
+ * until the producer writes something; the end of the stream is reached when
+ * the ring is empty and the producer ended its session. A producer that
+ * detaches without ending its session, e.g. because it crashed, does not end
+ * the stream; reads block until a new producer attaches and continues the
+ * ring. The read position is kept in the shared memory segment, so a
+ * restarted consumer continues where the previous one stopped.
+ *
+ * @param stream  the stream to initialize
+ * @param name    the name of the shared memory segment, as for \c shm_open()
+ * @return \c SDLOG_UNIMPLEMENTED if the platform does not support shared
+ *         memory rings, \c SDLOG_EIO if the segment does not exist or could
+ *         not be mapped, \c SDLOG_EREAD if it does not hold a valid ring.
+ *         Reads return \c SDLOG_EREAD if a new producer reinitialized the
+ *         ring with a different capacity; the stream must be recreated then.
+ */
+sdlog_error_t sdlog_istream_init_shm(sdlog_istream_t* stream, const char* name);
+
+/**
+ * @brief Creates an input stream that decompresses a block-compressed log
+ * container.
+ *
+ * This is the reading side of \ref sdlog_ostream_init_compressed(). The
+ * blocks are read and decompressed one by one, in the order they were
+ * written; the indices in the container are skipped. Reading stops at the
+ * last complete block, so containers that were not closed properly can
+ * still be read up to the point where they were cut off.
+ *
+ * If the source supports \ref sdlog_istream_read_at(), the indices of the
+ * container are loaded when the stream is created, and the stream supports
+ * \ref sdlog_istream_seek(), \ref sdlog_istream_tell() and
+ * \ref sdlog_istream_read_at() with offsets in the uncompressed log. These
+ * find the block holding the offset in the index and decompress only that
+ * block; positional reads stop at the end of the block. Containers that
+ * were not closed properly, or that were concatenated, cannot be seeked.
+ *
+ * @param stream  the stream to initialize
+ * @param source  the stream to read the container from. It is not owned by
+ *        the new stream and must outlive it.
+ * @return \c SDLOG_ENOMEM if the index could not be loaded for lack of
+ *         memory. \c SDLOG_EREAD from reads if the container is malformed,
+ *         \c SDLOG_UNIMPLEMENTED if it uses a codec that is not available in
+ *         this build
+ */
+sdlog_error_t sdlog_istream_init_compressed(sdlog_istream_t* stream, sdlog_istream_t* source);
+
+/**
+ * @brief Decompresses the blocks of a compressed input stream on a pool of
+ * background threads.
+ *
+ * The reading thread keeps reading compressed blocks from the source ahead of
+ * the consumer, two blocks per worker thread, while the workers decompress
+ * them in parallel. The blocks are still returned in their original order,
+ * so the stream can be passed to a parser as usual.
+ *
+ * Must be called before the first read from the stream.
+ *
+ * @param stream       the stream created with \ref sdlog_istream_init_compressed()
+ * @param num_threads  the number of worker threads; zero means one thread
+ *        for each online processor
+ * @return \c SDLOG_UNIMPLEMENTED if the library was compiled without thread
+ *         support, \c SDLOG_EINVAL if reading has started already or the
+ *         stream has worker threads already, \c SDLOG_FAILURE if the
+ *         threads could not be started
+ */
+sdlog_error_t sdlog_istream_compressed_set_threads(sdlog_istream_t* stream, size_t num_threads);
+
+/**
+ * @brief Callback that checksummed input streams call for each corrupt block
+ * or damaged region that they skip.
+ *
+ * @param arg     the argument given in the options of the stream
+ * @param offset  the offset of the corrupt region in the source
+ * @param length  the length of the corrupt region, in bytes
+ */
+typedef void sdlog_corrupt_block_handler_t(void* arg, uint64_t offset, uint64_t length);
+
+/**
+ * @brief Options of input streams that validate checksummed blocks.
+ */
+typedef struct {
+    /**
+     * Whether reads fail with \c SDLOG_EREAD when a corrupt block is found.
+     * Corrupt blocks are skipped and reading may continue after the error.
+     * When \c false, corrupt blocks are skipped silently, apart from the
+     * callback.
+     */
+    bool strict;
+
+    /** Function to call for each corrupt block; \c NULL if not needed */
+    sdlog_corrupt_block_handler_t* on_corrupt;
+
+    /** Argument to pass to \c on_corrupt */
+    void* arg;
+} sdlog_checksummed_istream_options_t;
+
+/**
+ * @brief Creates an input stream that validates the blocks written by a
+ * checksummed output stream and returns their payload.
+ *
+ * This is the reading side of \ref sdlog_ostream_init_checksummed(). Blocks
+ * whose checksum does not match their payload are skipped, and so are the
+ * damaged regions in which no valid block header is found; the stream
+ * continues with the next intact block. A block cut off at the end of the
+ * source counts as corrupt too.
+ *
+ * @param stream   the stream to initialize
+ * @param source   the stream to read the blocks from. It is not owned by the
+ *        new stream and must outlive it.
+ * @param options  options of the stream; \c NULL means the defaults
+ */
+sdlog_error_t sdlog_istream_init_checksummed(
+    sdlog_istream_t* stream, sdlog_istream_t* source,
+    const sdlog_checksummed_istream_options_t* options);
+
+/**
+ * @brief Returns the number of corrupt blocks and damaged regions that a
+ * checksummed input stream skipped so far.
+ *
+ * @param stream  the stream, created with \ref sdlog_istream_init_checksummed()
+ */
+uint64_t sdlog_istream_checksummed_get_corrupt_blocks(sdlog_istream_t* stream);
+
 /**
  * @brief Creates a null input stream that does not contain any bytes to read.
  *
@@ -177,6 +511,8 @@ sdlog_error_t sdlog_istream_read(
  * is filled with exactly the desired number of bytes. This is done by retrying
  * reads if the previous read attempt did not deliver enough bytes, but this
  * also means that the function may potentially block the calling thread.
+ * When a read delivers no bytes and the stream has a file descriptor, the
+ * function waits for the descriptor to become readable before retrying.
  *
  * @param stream        the stream to read
  * @param data          the buffer to read into
@@ -188,6 +524,174 @@ sdlog_error_t sdlog_istream_read(
 sdlog_error_t sdlog_istream_read_exactly(
     sdlog_istream_t* stream, uint8_t* data, size_t length);
 
+/**
+ * @brief Returns the file descriptor that an input stream reads from.
+ *
+ * @param stream  the stream
+ * @param fd      the file descriptor is returned here
+ * @return \c SDLOG_SUCCESS if the stream has a file descriptor,
+ *         \c SDLOG_UNIMPLEMENTED if it does not
+ */
+sdlog_error_t sdlog_istream_get_fd(sdlog_istream_t* stream, int* fd);
+
+/**
+ * @brief Moves the read position of an input stream.
+ *
+ * Supported by streams created with \ref sdlog_istream_init_buffer(),
+ * \ref sdlog_istream_init_buffered(), \ref sdlog_istream_init_fd() and
+ * \ref sdlog_istream_init_file() if the underlying file is seekable.
+ *
+ * @param stream  the stream
+ * @param offset  the new read position, from the start of the stream
+ * @return \c SDLOG_SUCCESS if the position was changed,
+ *         \c SDLOG_UNIMPLEMENTED if the stream cannot seek,
+ *         \c SDLOG_EINVAL if the offset is beyond the end of a stream of
+ *         known length, \c SDLOG_EIO in case of other errors
+ */
+sdlog_error_t sdlog_istream_seek(sdlog_istream_t* stream, uint64_t offset);
+
+/**
+ * @brief Returns the read position of an input stream.
+ *
+ * @param stream  the stream
+ * @param offset  the read position, from the start of the stream, is
+ *        returned here
+ * @return \c SDLOG_SUCCESS if the position is known,
+ *         \c SDLOG_UNIMPLEMENTED if the stream has no position,
+ *         \c SDLOG_EIO in case of other errors
+ */
+sdlog_error_t sdlog_istream_tell(sdlog_istream_t* stream, uint64_t* offset);
+
+/**
+ * @brief Reads some bytes from a given offset of an input stream without
+ * changing its read position.
+ *
+ * Unlike \ref sdlog_istream_read(), this function may be called from
+ * multiple threads at the same time on the same stream, so workers can
+ * parse disjoint regions of a log in parallel. It must not be called at the
+ * same time as other functions that use the stream, such as
+ * \ref sdlog_istream_read() or \ref sdlog_istream_seek(). Supported by the
+ * same streams as \ref sdlog_istream_seek(), except for file streams
+ * without a file descriptor, such as those created with \c fmemopen().
+ *
+ * @param stream      the stream to read
+ * @param offset      the offset to read from
+ * @param data        the buffer to read into
+ * @param length      the length of the buffer
+ * @param bytes_read  when not null, the number of bytes read is returned here
+ * @return \c SDLOG_SUCCESS in case of a successful read,
+ *         \c SDLOG_EOF if the offset is at or after the end of the stream,
+ *         \c SDLOG_UNIMPLEMENTED if the stream does not support positional
+ *         reads, \c SDLOG_EREAD in case of other read errors.
+ */
+sdlog_error_t sdlog_istream_read_at(
+    sdlog_istream_t* stream, uint64_t offset, uint8_t* data, size_t length,
+    size_t* bytes_read);
+
+/**
+ * @brief Unread part of the buffer of a buffered input stream.
+ *
+ * Exposed only so that \ref sdlog_istream_buffered_read_exactly() can be
+ * inlined; do not modify it directly.
+ */
+typedef struct {
+    /** The next unread byte in the buffer */
+    const uint8_t* pos;
+
+    /** The end of the data in the buffer */
+    const uint8_t* end;
+} sdlog_istream_buffered_cursor_t;
+
+/**
+ * @brief Creates an input stream that reads another stream in large chunks
+ * and serves small reads from an internal buffer.
+ *
+ * Reading a log record by record through a stream that makes a system call
+ * or takes a lock for every read is slow; this stream reads as much as fits
+ * in its buffer at once instead. Reads at least as large as the buffer
+ * bypass it when it is empty. Use \ref sdlog_istream_buffered_read_exactly()
+ * for small reads that are served from the buffer without calling into the
+ * stream, and \ref sdlog_istream_buffered_peek() to decode data in the
+ * buffer without copying it.
+ *
+ * The source stream is not owned by the new stream and must outlive it.
+ *
+ * @param stream       the stream to initialize
+ * @param source       the stream to read from
+ * @param buffer_size  the size of the buffer, in bytes. Zero means the
+ *        default of 64 KiB.
+ */
+sdlog_error_t sdlog_istream_init_buffered(
+    sdlog_istream_t* stream, sdlog_istream_t* source, size_t buffer_size);
+
+/**
+ * @brief Makes at least the given number of bytes available in the buffer
+ * of a buffered input stream without consuming them.
+ *
+ * Reads from the source stream until enough bytes are buffered, which may
+ * block like \ref sdlog_istream_read_exactly(). The bytes stay valid until
+ * the next operation on the stream other than
+ * \ref sdlog_istream_buffered_consume().
+ *
+ * @param stream     the stream, created with \ref sdlog_istream_init_buffered()
+ * @param length     the number of bytes needed; zero returns whatever is
+ *        buffered without reading from the source stream
+ * @param ptr        the first unread byte is returned here
+ * @param available  when not null, the number of bytes available at \c ptr
+ *        is returned here; it may exceed \c length
+ * @return \c SDLOG_SUCCESS if at least \c length bytes are available,
+ *         \c SDLOG_ELIMIT if \c length exceeds the size of the buffer,
+ *         \c SDLOG_EOF if the stream ended before that many bytes; the
+ *         remaining bytes are still returned then
+ */
+sdlog_error_t sdlog_istream_buffered_peek(
+    sdlog_istream_t* stream, size_t length, const uint8_t** ptr, size_t* available);
+
+/**
+ * @brief Consumes bytes made available by \ref sdlog_istream_buffered_peek().
+ *
+ * @param stream  the stream, created with \ref sdlog_istream_init_buffered()
+ * @param length  the number of bytes to consume
+ * @return \c SDLOG_EINVAL if fewer bytes are buffered
+ */
+sdlog_error_t sdlog_istream_buffered_consume(sdlog_istream_t* stream, size_t length);
+
+/**
+ * @brief Reads exactly a given number of bytes from a buffered input stream.
+ *
+ * Equivalent to \ref sdlog_istream_read_exactly(), but reads that can be
+ * served from the buffer are inlined in the caller.
+ *
+ * @param stream  the stream, created with \ref sdlog_istream_init_buffered()
+ * @param data    the buffer to read into
+ * @param length  the number of bytes to read
+ */
+static inline sdlog_error_t sdlog_istream_buffered_read_exactly(
+    sdlog_istream_t* stream, uint8_t* data, size_t length)
+{
+    /* The cursor is the first member of the context of the stream */
+    sdlog_istream_buffered_cursor_t* cursor = (sdlog_istream_buffered_cursor_t*)stream->context;
+
+    if (length <= (size_t)(cursor->end - cursor->pos)) {
+        memcpy(data, cursor->pos, length);
+        cursor->pos += length;
+        return SDLOG_SUCCESS;
+    }
+
+    return sdlog_istream_read_exactly(stream, data, length);
+}
+
+/**
+ * @brief A single buffer in a vectored write.
+ */
+typedef struct {
+    /** Pointer to the data to write */
+    const uint8_t* data;
+
+    /** Number of bytes to write from the buffer */
+    size_t length;
+} sdlog_iovec_t;
+
 /**
  * @brief Structure representing the methods of an output stream.
  *
@@ -240,6 +744,97 @@ typedef struct {
 
     /** Notifies the stream that the current writing session has ended */
     sdlog_error_t (*end)(struct sdlog_ostream_s* self);
+
+    /**
+     * Writes multiple buffers to the stream in a single call.
+     *
+     * Optional; streams that do not implement it are served by calling
+     * \c write for each buffer in turn. The semantics are the same as for
+     * \c write as if the buffers were concatenated; in particular, nonblocking
+     * streams may write fewer bytes than the total length of the buffers.
+     *
+     * @param  self    the stream to write to
+     * @param  iov     the buffers to write
+     * @param  iovcnt  the number of buffers. Guaranteed to be positive.
+     *         Individual buffers may be empty, but the total length is
+     *         guaranteed to be positive.
+     * @param  bytes_written  the total number of bytes written is returned
+     *         here. Guaranteed not to be a null pointer.
+     * @return \c SDLOG_SUCCESS in case of a successful write (even if no bytes
+     *         were actually written, as long as the stream is not closed),
+     *         \c SDLOG_EOF if the end of the stream has been reached or it
+     *         was closed, \c SDLOG_EWRITE in case of other write errors.
+     */
+    sdlog_error_t (*writev)(
+        struct sdlog_ostream_s* self, const sdlog_iovec_t* iov, size_t iovcnt,
+        size_t* bytes_written);
+
+    /**
+     * Reserves a contiguous region of memory in the stream where the caller
+     * can assemble the next bytes to write (optional).
+     *
+     * The region stays valid until the next call to \c commit. The caller
+     * must not call any other method of the stream until then.
+     *
+     * @param  self    the stream to reserve memory in
+     * @param  length  the number of bytes to reserve. Guaranteed to be
+     *         positive.
+     * @param  ptr     the start of the reserved region is returned here.
+     *         Guaranteed not to be a null pointer.
+     * @return \c SDLOG_SUCCESS if the region was reserved, \c SDLOG_ELIMIT
+     *         if the stream cannot provide that many contiguous bytes, or
+     *         any other error code in case of write errors
+     */
+    sdlog_error_t (*reserve)(
+        struct sdlog_ostream_s* self, size_t length, uint8_t** ptr);
+
+    /**
+     * Appends the first bytes of the region returned by the last call to
+     * \c reserve to the stream and releases the rest of the region.
+     * Mandatory if \c reserve is implemented.
+     *
+     * @param  self    the stream to commit to
+     * @param  length  the number of bytes to commit; zero cancels the
+     *         reservation. Guaranteed not to exceed the reserved length.
+     */
+    sdlog_error_t (*commit)(struct sdlog_ostream_s* self, size_t length);
+
+    /**
+     * Returns the file descriptor that the stream writes to (optional).
+     *
+     * Nonblocking streams that write to a file descriptor should implement
+     * this so that callers can wait for the descriptor to become writable
+     * instead of retrying writes that did not make progress.
+     *
+     * @param  self  the stream
+     * @param  fd    the file descriptor is returned here. Guaranteed not to be
+     *         a null pointer.
+     */
+    sdlog_error_t (*get_fd)(struct sdlog_ostream_s* self, int* fd);
+
+    /**
+     * Appends bytes from the given offset of an input stream to the stream
+     * without copying them through user space (optional).
+     *
+     * Streams that implement this typically ask the operating system to copy
+     * the data between two file descriptors. Callers fall back to reading
+     * and writing the data when this returns \c SDLOG_UNIMPLEMENTED.
+     *
+     * @param  self    the stream to write to
+     * @param  source  the stream to copy from; its read position is not used
+     * @param  offset  the offset in the source stream to copy from
+     * @param  length  the number of bytes to copy. Guaranteed to be positive.
+     * @param  bytes_written  the number of bytes copied is returned here.
+     *         Guaranteed not to be a null pointer.
+     * @return \c SDLOG_SUCCESS if some bytes were copied,
+     *         \c SDLOG_UNIMPLEMENTED if the two streams cannot be copied
+     *         between this way, \c SDLOG_EOF if the source stream ended
+     *         before the given offset, \c SDLOG_EWRITE in case of other
+     *         errors
+     */
+    sdlog_error_t (*copy_range)(
+        struct sdlog_ostream_s* self, sdlog_istream_t* source, uint64_t offset,
+        size_t length, size_t* bytes_written);
 } sdlog_ostream_spec_t;
 
 /**
@@ -276,67 +871,731 @@ sdlog_error_t sdlog_ostream_init(
     void* ctx);
 
 /**
- * @brief Creates an output stream that writes to a growing in-memory buffer.
+ * @brief Creates an output stream that filters the data written to it before
+ * passing it on to another stream.
+ *
+ * The methods in \c spec are called with the new stream; use
+ * \ref sdlog_ostream_filter_get_context() and
+ * \ref sdlog_ostream_filter_get_inner() to access the context and the inner
+ * stream from them. Methods that are \c NULL are forwarded to the inner
+ * stream, with the following exceptions:
+ *
+ * - If any of \c write, \c writev or \c reserve is given, the filter is
+ *   assumed to process the data itself, so the missing ones among
+ *   \c writev, \c reserve and \c copy_range are not forwarded. Vectored
+ *   writes and copies then fall back to \c write, and reservations are not
+ *   supported.
+ * - \c init is called after the stream was set up; \c destroy is called
+ *   before it is torn down. The inner stream is not owned by the new stream
+ *   and must outlive it.
+ *
+ * Overridden \c begin, \c flush and \c end methods should propagate the
+ * call to the inner stream after processing it themselves.
  *
  * @param stream  the stream to initialize
+ * @param inner   the stream to write to
+ * @param spec    the methods that the filter overrides; \c NULL forwards
+ *        everything to the inner stream
+ * @param ctx     context object that the methods may make use of
  */
-sdlog_error_t sdlog_ostream_init_buffer(sdlog_ostream_t* stream);
+sdlog_error_t sdlog_ostream_init_filter(
+    sdlog_ostream_t* stream, sdlog_ostream_t* inner,
+    const sdlog_ostream_spec_t* spec, void* ctx);
 
 /**
- * @brief Creates an output stream that writes to the given file.
+ * @brief Returns the inner stream of an output stream created with
+ * \ref sdlog_ostream_init_filter().
+ */
+sdlog_ostream_t* sdlog_ostream_filter_get_inner(sdlog_ostream_t* stream);
+
+/**
+ * @brief Returns the context of an output stream created with
+ * \ref sdlog_ostream_init_filter().
+ */
+void* sdlog_ostream_filter_get_context(sdlog_ostream_t* stream);
+
+/**
+ * @brief Writes data from a filter stream to its inner stream.
  *
- * @param stream  the stream to initialize
- * @param fp      the file to write to
+ * Filters that pass the data through unchanged should report to their
+ * caller exactly as many bytes as the inner stream accepted, so nonblocking
+ * inner streams keep working; pass \c bytes_written for that. Filters that
+ * transform the data cannot map a partial write back to their input, so
+ * they should write their output in full; pass \c NULL for that.
+ *
+ * @param stream         the filter stream
+ * @param data           the data to write
+ * @param length         the number of bytes to write
+ * @param bytes_written  when not null, a single write is attempted and the
+ *        number of bytes accepted by the inner stream is returned here; when
+ *        null, the call retries until all the bytes are written
  */
-sdlog_error_t sdlog_ostream_init_file(sdlog_ostream_t* stream, FILE* fp);
+sdlog_error_t sdlog_ostream_filter_write_inner(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* bytes_written);
 
 /**
- * @brief Creates a null output stream that does not write anything anywhere.
+ * @brief Creates an output stream that writes to a growing in-memory buffer.
  *
  * @param stream  the stream to initialize
  */
-sdlog_error_t sdlog_ostream_init_null(sdlog_ostream_t* stream);
+sdlog_error_t sdlog_ostream_init_buffer(sdlog_ostream_t* stream);
 
 /**
- * @brief Destroys an output stream.
+ * @brief Policies that decide when the data written to a file is synced to
+ * the disk.
+ */
+typedef enum {
+    /** Never sync; the operating system writes the data whenever it likes */
+    SDLOG_DURABILITY_NEVER = 0,
+
+    /** Sync whenever the given number of bytes were written since the last
+     * sync */
+    SDLOG_DURABILITY_BYTES,
+
+    /** Sync periodically, at the given interval. Data that the stream still
+     * buffers is handed to the operating system only by the first write
+     * after the interval has elapsed or by a flush */
+    SDLOG_DURABILITY_INTERVAL,
+
+    /** Sync whenever the stream is flushed */
+    SDLOG_DURABILITY_FLUSH
+} sdlog_durability_mode_t;
+
+/**
+ * @brief Durability policy of output streams that write to a file.
  *
- * @param stream  the stream to destroy
+ * Syncs run on a background thread so the writer never waits for the disk;
+ * sync requests that arrive while a sync is running are served together by
+ * the next sync. The data that may be lost in a crash is therefore bounded
+ * by the threshold of the policy plus the data written during a single
+ * sync. In \c SDLOG_DURABILITY_INTERVAL mode, the bound covers only the data
+ * that the stream has already handed to the operating system; a writer that
+ * goes quiet leaves its last records in the buffer of the stream until it
+ * writes again, so it should flush the stream when it stops writing.
+ *
+ * When the session ends or the stream is destroyed, the stream waits until
+ * all the data written is durable, unless the policy is
+ * \c SDLOG_DURABILITY_NEVER.
  */
-void sdlog_ostream_destroy(sdlog_ostream_t* stream);
+typedef struct {
+    /** When to sync the data */
+    sdlog_durability_mode_t mode;
+
+    /** Number of bytes after which the data is synced in
+     * \c SDLOG_DURABILITY_BYTES mode */
+    uint64_t bytes;
+
+    /** Interval between syncs in \c SDLOG_DURABILITY_INTERVAL mode, in
+     * milliseconds */
+    uint32_t interval_ms;
+} sdlog_durability_t;
 
 /**
- * @brief Starts a new writing session on the output stream.
+ * @brief Creates an output stream that writes to the given file.
+ *
+ * @param stream  the stream to initialize
+ * @param fp      the file to write to
  */
-sdlog_error_t sdlog_ostream_begin_session(sdlog_ostream_t* stream);
+sdlog_error_t sdlog_ostream_init_file(sdlog_ostream_t* stream, FILE* fp);
 
 /**
- * @brief Ends the current writing session on the output stream.
+ * @brief Sets when the data written to a file stream is synced to the disk.
+ *
+ * Must be called before anything is written to the stream. Data is synced
+ * only after it left the buffer of the \c FILE object, so the stream flushes
+ * that buffer whenever the policy needs the data to be synced.
+ *
+ * @param stream      the stream, created with \ref sdlog_ostream_init_file()
+ * @param durability  the durability policy
+ * @return \c SDLOG_UNIMPLEMENTED if the platform does not support syncing
+ *         files, \c SDLOG_EINVAL if the policy is invalid or the file is not
+ *         a seekable file with a file descriptor
  */
-sdlog_error_t sdlog_ostream_end_session(sdlog_ostream_t* stream);
+sdlog_error_t sdlog_ostream_file_set_durability(
+    sdlog_ostream_t* stream, const sdlog_durability_t* durability);
 
 /**
- * @brief Flushes the output stream to ensure that all pending bytes are written.
+ * @brief Returns the offset in the file up to which the data written to a
+ * file stream is known to be durable.
  *
- * @param stream  the stream to flush
+ * @param stream  the stream, created with \ref sdlog_ostream_init_file()
+ * @return the durable offset, or zero if the stream does not sync the data
  */
-sdlog_error_t sdlog_ostream_flush(sdlog_ostream_t* stream);
+uint64_t sdlog_ostream_file_get_durable_offset(sdlog_ostream_t* stream);
 
 /**
- * @brief Writes some bytes to an output stream.
+ * @brief Creates an output stream that writes to a list of fixed-size
+ * chunks in memory.
  *
- * It is up to the stream to define whether the function is blocking or
- * nonblocking. Nonblocking writes may write a smaller number of bytes to
- * the stream. The number of bytes actually written must be returned in an
- * output argument.
+ * Unlike \ref sdlog_ostream_init_buffer(), the stream never moves the data
+ * written to it; it allocates a new chunk whenever the last one is full, so
+ * large logs are neither copied while they grow nor need twice their size
+ * temporarily. The contents are not contiguous; use
+ * \ref sdlog_ostream_chunked_get_iovec() or
+ * \ref sdlog_ostream_chunked_write_to() to access them.
  *
- * if you want to ensure that the entire buffer is written, use
- * \ref sdlog_ostream_write_all(), which may block indefinitely.
+ * The stream supports \ref sdlog_ostream_reserve() for regions not larger
+ * than a chunk.
  *
- * @param stream        the stream to write to
- * @param data          the buffer to write
- * @param length        the length of the buffer
- * @param bytes_written when not null, the number of bytes written is returned here
- * @return \c SDLOG_SUCCESS in case of a successful write (even if no bytes
+ * @param stream      the stream to initialize
+ * @param chunk_size  the size of each chunk, in bytes. Zero means the default
+ *        of 64 KiB.
+ */
+sdlog_error_t sdlog_ostream_init_chunked(sdlog_ostream_t* stream, size_t chunk_size);
+
+/**
+ * @brief Options of output streams that write to a file descriptor.
+ */
+typedef struct {
+    /**
+     * Size of the internal buffer, in bytes. Rounded up to a multiple of the
+     * page size. Zero means the default size of 1 MiB.
+     */
+    size_t buffer_size;
+
+    /**
+     * Whether to bypass the page cache with \c O_DIRECT. In direct mode, all
+     * writes are issued in whole, page-aligned blocks. Flushing the stream
+     * writes the last, partially filled block padded with zeros and rewrites
+     * it in place when more data arrives; the padding is truncated when the
+     * session ends. Requires a seekable file descriptor positioned at a
+     * page-aligned offset.
+     */
+    bool direct;
+
+    /**
+     * Number of bytes to preallocate on disk after the current position when
+     * a session begins. Zero means no preallocation. Preallocation does not
+     * change the apparent size of the file where the platform supports it.
+     */
+    uint64_t preallocate;
+
+    /**
+     * When to sync the data written to the disk. The default is to never
+     * sync. Syncing requires a seekable file descriptor.
+     */
+    sdlog_durability_t durability;
+} sdlog_fd_ostream_options_t;
+
+/**
+ * @brief Creates an output stream that writes to the given file descriptor.
+ *
+ * Unlike \ref sdlog_ostream_init_file(), this stream bypasses stdio; it
+ * collects the data in a large, page-aligned buffer and writes it with
+ * positioned writes when the buffer is full or the stream is flushed. The
+ * file descriptor is not owned by the stream; when the session ends or the
+ * stream is destroyed, the file offset of the descriptor is left at the end
+ * of the data written.
+ *
+ * Nonblocking pipes and sockets are supported. Writes to them accept only as
+ * many bytes as fit in the buffer after writing out what the descriptor
+ * accepts without blocking, so they may write fewer bytes than requested,
+ * or none at all; use \ref sdlog_poller_init() to wait until the descriptor
+ * is writable. Flushing the stream and ending the session still wait until
+ * all the buffered data is written.
+ *
+ * @param stream   the stream to initialize
+ * @param fd       the file descriptor to write to
+ * @param options  options of the stream; \c NULL means the defaults
+ * @return \c SDLOG_UNIMPLEMENTED if the platform does not support file
+ *         descriptors or direct I/O was requested but is not supported,
+ *         \c SDLOG_EINVAL if the file descriptor is invalid or not suitable
+ *         for direct I/O, \c SDLOG_EIO if direct I/O could not be enabled
+ */
+sdlog_error_t sdlog_ostream_init_fd(
+    sdlog_ostream_t* stream, int fd, const sdlog_fd_ostream_options_t* options);
+
+/**
+ * @brief Returns the offset in the file up to which the data written to a
+ * file descriptor stream is known to be durable.
+ *
+ * @param stream  the stream, created with \ref sdlog_ostream_init_fd()
+ * @return the durable offset, or zero if the stream does not sync the data
+ */
+uint64_t sdlog_ostream_fd_get_durable_offset(sdlog_ostream_t* stream);
+
+/**
+ * @brief Creates an output stream that writes to a memory-mapped file.
+ *
+ * The file is created or truncated, then a window of it is preallocated
+ * and mapped into memory so that writes become plain memory stores. When
+ * the window is full, the next window is allocated and mapped. Flushing the
+ * stream schedules the write-back of the modified pages without waiting for
+ * it. When the session ends, the file is truncated to the length of the data
+ * written.
+ *
+ * The stream supports \ref sdlog_ostream_reserve() so records can be encoded
+ * directly into the mapped file.
+ *
+ * @param stream          the stream to initialize
+ * @param path            the path of the file to write to
+ * @param prealloc_bytes  size of the windows that are preallocated and mapped
+ *        at once, rounded up to a multiple of the page size. Zero means the
+ *        default of 16 MiB.
+ * @return \c SDLOG_UNIMPLEMENTED if the platform does not support memory
+ *         mapped files, \c SDLOG_EIO if the file could not be opened,
+ *         \c SDLOG_EINVAL if the window size is too large
+ */
+sdlog_error_t sdlog_ostream_init_mmap(
+    sdlog_ostream_t* stream, const char* path, uint64_t prealloc_bytes);
+
+/**
+ * @brief Creates an output stream that writes to a fixed-size circular log
+ * file.
+ *
+ * The file is divided into blocks of equal size; the first one holds a
+ * small header pointing at the oldest valid block, and the others are
+ * filled with records in a circular manner, overwriting the oldest block
+ * when the file is full. Each block starts with the FMT records of all the
+ * formats seen so far and holds complete records only, so the file remains
+ * decodable from the oldest block onwards. The size of the file never
+ * changes once it has been created.
+ *
+ * If the file already exists with the same layout, new data is written
+ * after the newest block in it; otherwise the file is created or
+ * reinitialized. Data is kept in memory until the current block is full or
+ * the stream is flushed. Use \ref sdlog_istream_init_circular_file() to read
+ * the file.
+ *
+ * @param stream      the stream to initialize
+ * @param path        the path of the file
+ * @param file_size   the size of the file, in bytes; rounded down to a
+ *        multiple of the block size. Must be at least three blocks.
+ * @param block_size  the size of a block, in bytes. Zero means the default of
+ *        64 KiB. Larger blocks waste less space on repeated FMT records, but
+ *        more data is overwritten at once when the file wraps around. The
+ *        FMT records of all formats and a record of the largest possible
+ *        size must fit in a block; writing the FMT record of a format that
+ *        would break this fails with \c SDLOG_ELIMIT, without changing the
+ *        file.
+ * @return \c SDLOG_UNIMPLEMENTED if the platform does not support circular
+ *         log files, \c SDLOG_EINVAL if the sizes are invalid, \c SDLOG_EIO
+ *         if the file could not be opened or initialized
+ */
+sdlog_error_t sdlog_ostream_init_circular_file(
+    sdlog_ostream_t* stream, const char* path, uint64_t file_size, size_t block_size);
+
+/**
+ * @brief Creates an output stream that splits the data into blocks
+ * protected by a CRC-32C checksum and writes them to another stream.
+ *
+ * Each block carries the checksum of its payload and of its own header, so
+ * a reader can detect corrupt blocks, skip them and find the next intact
+ * block. The checksums are computed with the CRC instructions of the CPU
+ * where available. Flushing the stream writes the partial block collected
+ * so far.
+ *
+ * Use \ref sdlog_istream_init_checksummed() to read the blocks.
+ *
+ * @param stream      the stream to initialize
+ * @param target      the stream to write the blocks to. It is not owned by
+ *        the new stream and must outlive it; sessions and flushes are
+ *        forwarded to it.
+ * @param block_size  the size of the payload of each block, in bytes. Zero
+ *        means the default of 64 KiB.
+ * @return \c SDLOG_EINVAL if the block size is larger than 16 MiB
+ */
+sdlog_error_t sdlog_ostream_init_checksummed(
+    sdlog_ostream_t* stream, sdlog_ostream_t* target, size_t block_size);
+
+/**
+ * @brief Compression algorithms of block-compressed log containers.
+ */
+typedef enum {
+    /** The best algorithm available in this build: zstd, LZ4 or the built-in
+     * LZ codec, in this order of preference */
+    SDLOG_COMPRESSION_DEFAULT = 0,
+    /** No compression; blocks are stored as they are */
+    SDLOG_COMPRESSION_NONE,
+    /** The built-in LZ codec, which is always available */
+    SDLOG_COMPRESSION_LZ,
+    /** LZ4, if the library was available at build time */
+    SDLOG_COMPRESSION_LZ4,
+    /** zstd, if the library was available at build time */
+    SDLOG_COMPRESSION_ZSTD
+} sdlog_compression_t;
+
+/**
+ * @brief Options of output streams that write block-compressed log containers.
+ */
+typedef struct {
+    /**
+     * Uncompressed size of a block, in bytes. Zero means the default of
+     * 256 KiB. Larger blocks compress better, but more data is lost if the
+     * process stops before the block is complete.
+     */
+    size_t block_size;
+
+    /** The compression algorithm to use */
+    sdlog_compression_t compression;
+
+    /** Compression level; used by zstd only. Zero means the default level. */
+    int level;
+} sdlog_compressed_ostream_options_t;
+
+/**
+ * @brief Creates an output stream that compresses the log in independent
+ * blocks and writes them to another stream.
+ *
+ * The data written to the stream is collected into blocks of a fixed size
+ * and each block is compressed on its own, so a reader may decompress any
+ * block without the others, or decompress multiple blocks in parallel.
+ * Each block records the offset of the first record starting in it, and
+ * the end of each session writes an index of the blocks written in that
+ * session, linked to the index of the previous session. Blocks that
+ * do not compress are stored uncompressed. Flushing the stream compresses
+ * and writes the partial block collected so far.
+ *
+ * Use \ref sdlog_istream_init_compressed() to read the container.
+ *
+ * @param stream   the stream to initialize
+ * @param target   the stream to write the container to. It is not owned by
+ *        the new stream and must outlive it; sessions and flushes are
+ *        forwarded to it.
+ * @param options  options of the stream; \c NULL means the defaults
+ * @return \c SDLOG_UNIMPLEMENTED if the requested compression algorithm is
+ *         not available in this build, \c SDLOG_EINVAL if the block size
+ *         is larger than 64 MiB
+ */
+sdlog_error_t sdlog_ostream_init_compressed(
+    sdlog_ostream_t* stream, sdlog_ostream_t* target,
+    const sdlog_compressed_ostream_options_t* options);
+
+/**
+ * @brief Creates a null output stream that does not write anything anywhere.
+ *
+ * @param stream  the stream to initialize
+ */
+sdlog_error_t sdlog_ostream_init_null(sdlog_ostream_t* stream);
+
+/**
+ * @brief Options of counting output streams.
+ */
+typedef struct {
+    /** Simulated latency of each write, in microseconds */
+    uint32_t latency_us;
+
+    /** Simulated latency of each flush, in microseconds */
+    uint32_t flush_latency_us;
+
+    /** Simulated bandwidth, in bytes per second. Zero means unlimited. */
+    uint64_t bandwidth;
+} sdlog_counting_ostream_options_t;
+
+/**
+ * @brief Statistics collected by counting output streams.
+ */
+typedef struct {
+    /** Number of bytes written */
+    uint64_t bytes;
+
+    /** Number of writes; a vectored write or a commit counts as one */
+    uint64_t writes;
+
+    /** Number of flushes */
+    uint64_t flushes;
+
+    /** Number of sessions started */
+    uint64_t sessions;
+
+    /** Total time that the writer was delayed to simulate the latency and
+     * the bandwidth, in microseconds */
+    uint64_t delay_us;
+} sdlog_counting_ostream_stats_t;
+
+/**
+ * @brief Creates an output stream that discards the data written to it,
+ * like a null stream, but counts it.
+ *
+ * The stream can also simulate a slow device by delaying the writer: each
+ * write and flush takes at least the given latency, and the writes are
+ * throttled to the given bandwidth. The device is modelled as busy until
+ * the previous operations are complete, so the delays do not depend on how
+ * the data is split into writes. The stream supports
+ * \ref sdlog_ostream_reserve() with a scratch buffer.
+ *
+ * @param stream   the stream to initialize
+ * @param options  options of the stream; \c NULL means counting only
+ * @return \c SDLOG_UNIMPLEMENTED if a delay was requested but the platform
+ *         cannot sleep
+ */
+sdlog_error_t sdlog_ostream_init_counting(
+    sdlog_ostream_t* stream, const sdlog_counting_ostream_options_t* options);
+
+/**
+ * @brief Returns the statistics collected by a counting output stream.
+ *
+ * @param stream  the stream, created with \ref sdlog_ostream_init_counting()
+ * @param stats   the statistics are returned here
+ */
+void sdlog_ostream_counting_get_stats(
+    sdlog_ostream_t* stream, sdlog_counting_ostream_stats_t* stats);
+
+/**
+ * @brief Resets the statistics collected by a counting output stream.
+ *
+ * @param stream  the stream, created with \ref sdlog_ostream_init_counting()
+ */
+void sdlog_ostream_counting_reset_stats(sdlog_ostream_t* stream);
+
+/**
+ * @brief Options of output streams that write to rotating log files.
+ */
+typedef struct {
+    /**
+     * Size limit of a segment, in bytes. A new segment is started when the
+     * next record would make the current one larger. Zero means no limit.
+     */
+    uint64_t max_size;
+
+    /**
+     * Time limit of a segment, in microseconds. A new segment is started
+     * with the first record written after the limit was reached. Zero means
+     * no limit.
+     */
+    uint64_t max_duration_us;
+
+    /**
+     * Options of the file descriptor streams writing the segments; \c NULL
+     * means the defaults.
+     */
+    const sdlog_fd_ostream_options_t* fd_options;
+} sdlog_rotating_ostream_options_t;
+
+/**
+ * @brief Creates an output stream that writes to a series of files, starting
+ * a new one when a size or time limit is reached.
+ *
+ * The files (segments) are named after a template that contains a single
+ * \c %u conversion, optionally with a field width such as \c %04u, which is
+ * replaced by the index of the segment, starting from zero. Segments are cut
+ * at record boundaries only, and each new segment starts with the FMT
+ * records of all the formats seen so far, so every segment can be parsed on
+ * its own. Each segment is written with a stream created by
+ * \ref sdlog_ostream_init_fd().
+ *
+ * When thread support is available, a background thread opens the next
+ * segment ahead of time and flushes and closes the finished ones, so
+ * starting a new segment does not block the writer on file system
+ * operations. Flushing the stream waits until the finished segments were
+ * closed.
+ *
+ * @param stream         the stream to initialize
+ * @param path_template  the template of the paths of the segments
+ * @param options        options of the stream; \c NULL means no limits
+ * @return \c SDLOG_UNIMPLEMENTED if the platform does not support file
+ *         descriptors, \c SDLOG_EINVAL if the template is invalid, \c SDLOG_EIO
+ *         if the first segment could not be created
+ */
+sdlog_error_t sdlog_ostream_init_rotating(
+    sdlog_ostream_t* stream, const char* path_template,
+    const sdlog_rotating_ostream_options_t* options);
+
+/**
+ * @brief Returns the index of the segment being written by a rotating stream.
+ *
+ * @param stream  the stream created with \ref sdlog_ostream_init_rotating()
+ */
+uint32_t sdlog_ostream_rotating_get_segment_index(sdlog_ostream_t* stream);
+
+/**
+ * @brief Creates an output stream that keeps the most recent records in a
+ * fixed-size ring buffer in memory.
+ *
+ * The stream is meant for flight-recorder style logging: everything is
+ * logged at full rate into bounded memory, and the contents of the ring are
+ * persisted with \ref sdlog_ostream_ring_dump() only when something
+ * interesting happens. When the ring is full, the oldest records are
+ * overwritten; records are never torn. The FMT records needed to decode the
+ * records remaining in the ring are retained even if the records themselves
+ * were overwritten.
+ *
+ * Each record is stored with the time when it was written, which takes
+ * nine bytes of extra space per record. Bytes that cannot be split into
+ * records, i.e. records whose format is unknown to the stream, are dropped.
+ *
+ * The stream supports \ref sdlog_ostream_reserve() so records can be encoded
+ * directly into the ring, except for regions that would wrap around its end.
+ *
+ * @param stream    the stream to initialize
+ * @param capacity  the size of the ring buffer, in bytes
+ * @return \c SDLOG_EINVAL if the capacity is too small to hold a single FMT
+ *         record
+ */
+sdlog_error_t sdlog_ostream_init_ring(sdlog_ostream_t* stream, size_t capacity);
+
+/**
+ * @brief Writes the recent contents of a ring buffer stream to another stream.
+ *
+ * The output is a self-contained log: it starts with the FMT records of all
+ * the formats that were in effect when the first dumped record was written,
+ * followed by the records themselves, oldest first. The ring is left intact.
+ * The session of the target stream is not started or ended by this function.
+ *
+ * The function must not be called concurrently with writes to the ring.
+ *
+ * @param stream      the ring buffer stream
+ * @param target      the stream to write the records to
+ * @param max_age_us  dump only the records written in the last this many
+ *        microseconds; zero means all the records in the ring
+ */
+sdlog_error_t sdlog_ostream_ring_dump(
+    sdlog_ostream_t* stream, sdlog_ostream_t* target, uint64_t max_age_us);
+
+/**
+ * @brief Returns the number of records that were too large to be stored in a
+ * ring buffer stream at all.
+ *
+ * @param stream  the ring buffer stream
+ */
+uint64_t sdlog_ostream_ring_get_records_dropped(sdlog_ostream_t* stream);
+
+/**
+ * @brief Creates an output stream that writes to a lock-free ring in shared
+ * memory, to be drained by another process.
+ *
+ * The ring has a single producer (this stream) and a single consumer (a
+ * stream created with \ref sdlog_istream_init_shm(), typically in a separate,
+ * lower-priority process that writes the data to disk). The producer never
+ * blocks and never makes system calls, except for waking up the consumer
+ * when it is waiting for data. Only complete records are published; the
+ * bytes of a record that is not complete yet are held back until the record
+ * is completed. Each write is published as a whole or not at all: when the
+ * consumer lags behind and a write does not fit in the ring, its complete
+ * records are dropped and counted, and all the FMT records seen so far are
+ * sent again in front of the next write that fits, so the consumer can
+ * decode the records that follow. A record that is still incomplete when
+ * the session ends is dropped and counted as well.
+ *
+ * The shared memory segment is created if needed. If it already holds a ring
+ * with the same capacity, e.g. because the producer was restarted, the
+ * stream continues where the previous producer stopped. Ending the session
+ * of the stream closes the ring, and the consumer reaches the end of the
+ * stream once it read everything; destroying the stream without ending the
+ * session leaves the consumer waiting for a new producer. The segment is not
+ * removed when the stream is destroyed; use \c shm_unlink() for that.
+ *
+ * @param stream    the stream to initialize
+ * @param name      the name of the shared memory segment, as for \c shm_open()
+ * @param capacity  the size of the ring, in bytes. It should comfortably
+ *        exceed the total size of the FMT records of the log.
+ * @return \c SDLOG_UNIMPLEMENTED if the platform does not support shared
+ *         memory rings, \c SDLOG_EINVAL if the capacity is too small,
+ *         \c SDLOG_EIO if the segment could not be created or mapped
+ */
+sdlog_error_t sdlog_ostream_init_shm(sdlog_ostream_t* stream, const char* name, size_t capacity);
+
+/**
+ * @brief Returns the number of bytes dropped by a shared-memory ring stream
+ * because the consumer was lagging behind.
+ *
+ * @param stream  the shared-memory ring stream
+ */
+uint64_t sdlog_ostream_shm_get_bytes_dropped(sdlog_ostream_t* stream);
+
+/**
+ * @brief Creates an output stream that forwards everything to multiple streams.
+ *
+ * Each write, flush, session start and session end is forwarded to all the
+ * child streams. Partial writes are retried separately for each child,
+ * straight from the caller's buffer, so the data is never copied for
+ * synchronous children. Errors from any child are reported to the caller,
+ * but only after all the other children were served. Writes of 4 GiB or more
+ * are rejected with \c SDLOG_ELIMIT. The file descriptor of the stream is
+ * the one of the first synchronous child that has one.
+ *
+ * The child streams are not owned by the tee stream; they must outlive it and
+ * they must be destroyed separately by the caller.
+ *
+ * @param stream        the stream to initialize
+ * @param children      the child streams to forward to
+ * @param num_children  the number of child streams
+ */
+sdlog_error_t sdlog_ostream_init_tee(
+    sdlog_ostream_t* stream, sdlog_ostream_t* const* children, size_t num_children);
+
+/**
+ * @brief Makes a child of a tee stream asynchronous.
+ *
+ * Asynchronous children are served from a dedicated background thread
+ * through a bounded queue, so a stalled child does not add latency for the
+ * others. Data is queued in units that end on record boundaries; a unit
+ * that does not fit in the queue is dropped as a whole and is counted, and
+ * the FMT records seen so far are sent again in front of the next unit, so
+ * the log of the child stays decodable. Session starts, ends and flushes are
+ * never dropped, and they do not block the writer either: those that do not
+ * fit in the queue are kept aside and run by the thread of the child once
+ * the queue is empty, and writes are dropped until then. Flushes that follow
+ * a session start or another flush, or that precede a session end, are
+ * merged with them. Errors of asynchronous children are not reported to the
+ * writer; use
+ * \ref sdlog_ostream_tee_get_child_status() to query them.
+ *
+ * Must be called before the first write to the tee stream.
+ *
+ * @param stream      the tee stream
+ * @param index       the index of the child to make asynchronous
+ * @param queue_size  the size of the queue of the child, in bytes
+ * @return \c SDLOG_UNIMPLEMENTED if the library was compiled without thread
+ *         support, \c SDLOG_EINVAL if the index is invalid or the child is
+ *         already asynchronous
+ */
+sdlog_error_t sdlog_ostream_tee_set_async(
+    sdlog_ostream_t* stream, size_t index, size_t queue_size);
+
+/**
+ * @brief Returns the status of a child of a tee stream.
+ *
+ * @param stream         the tee stream
+ * @param index          the index of the child
+ * @param bytes_dropped  when not null, the number of bytes dropped because
+ *        the queue of an asynchronous child was full is returned here
+ * @return the last error reported by the child, or \c SDLOG_EINVAL if the
+ *         index is invalid
+ */
+sdlog_error_t sdlog_ostream_tee_get_child_status(
+    sdlog_ostream_t* stream, size_t index, size_t* bytes_dropped);
+
+/**
+ * @brief Destroys an output stream.
+ *
+ * @param stream  the stream to destroy
+ */
+void sdlog_ostream_destroy(sdlog_ostream_t* stream);
+
+/**
+ * @brief Starts a new writing session on the output stream.
+ */
+sdlog_error_t sdlog_ostream_begin_session(sdlog_ostream_t* stream);
+
+/**
+ * @brief Ends the current writing session on the output stream.
+ */
+sdlog_error_t sdlog_ostream_end_session(sdlog_ostream_t* stream);
+
+/**
+ * @brief Flushes the output stream to ensure that all pending bytes are written.
+ *
+ * @param stream  the stream to flush
+ */
+sdlog_error_t sdlog_ostream_flush(sdlog_ostream_t* stream);
+
+/**
+ * @brief Writes some bytes to an output stream.
+ *
+ * It is up to the stream to define whether the function is blocking or
+ * nonblocking. Nonblocking writes may write a smaller number of bytes to
+ * the stream. The number of bytes actually written must be returned in an
+ * output argument.
+ *
+ * if you want to ensure that the entire buffer is written, use
+ * \ref sdlog_ostream_write_all(), which may block indefinitely.
+ *
+ * @param stream        the stream to write to
+ * @param data          the buffer to write
+ * @param length        the length of the buffer
+ * @param bytes_written when not null, the number of bytes written is returned here
+ * @return \c SDLOG_SUCCESS in case of a successful write (even if no bytes
  *         were actually written, as long as the stream is not closed),
  *         \c SDLOG_EOF if the end of the stream has been reached,
  *         \c SDLOG_EWRITE in case of other write errors.
@@ -351,7 +1610,9 @@ sdlog_error_t sdlog_ostream_write(
  * Unlike \ref sdlog_ostream_write(), this function ensures that all the bytes
  * in the buffer are written to the stream. This is done by retrying writes if
  * the previous write attempt did not deliver all of them, but this also means
- * that the function may potentially block the calling thread.
+ * that the function may potentially block the calling thread. When a write
+ * makes no progress and the stream has a file descriptor, the function waits
+ * for the descriptor to become writable before retrying.
  *
  * @param stream        the stream to write to
  * @param data          the buffer to write
@@ -363,6 +1624,111 @@ sdlog_error_t sdlog_ostream_write(
 sdlog_error_t sdlog_ostream_write_all(
     sdlog_ostream_t* stream, const uint8_t* data, size_t length);
 
+/**
+ * @brief Writes multiple buffers to an output stream in a single call.
+ *
+ * Streams backed by a file descriptor submit all the buffers with a single
+ * system call; other streams write them one by one. Empty buffers are
+ * allowed and are skipped.
+ *
+ * @param stream        the stream to write to
+ * @param iov           the buffers to write
+ * @param iovcnt        the number of buffers
+ * @param bytes_written when not null, the total number of bytes written is
+ *        returned here
+ * @return \c SDLOG_SUCCESS in case of a successful write (even if no bytes
+ *         were actually written, as long as the stream is not closed),
+ *         \c SDLOG_EOF if the end of the stream has been reached,
+ *         \c SDLOG_EWRITE in case of other write errors.
+ */
+sdlog_error_t sdlog_ostream_writev(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt,
+    size_t* bytes_written);
+
+/**
+ * @brief Writes all the bytes in multiple buffers to an output stream.
+ *
+ * This is the vectored counterpart of \ref sdlog_ostream_write_all(); it
+ * retries partial writes until all the buffers were written, which may
+ * block the calling thread.
+ *
+ * @param stream  the stream to write to
+ * @param iov     the buffers to write
+ * @param iovcnt  the number of buffers
+ * @return \c SDLOG_SUCCESS when all the buffers were written,
+ *         \c SDLOG_EOF if the end of the stream has been reached,
+ *         \c SDLOG_EWRITE in case of other write errors.
+ */
+sdlog_error_t sdlog_ostream_writev_all(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt);
+
+/**
+ * @brief Reserves memory in an output stream for the next bytes to write.
+ *
+ * Together with \ref sdlog_ostream_commit(), this function lets the caller
+ * assemble data directly in the memory of the stream instead of in a
+ * separate buffer that is then copied to the stream with
+ * \ref sdlog_ostream_write(). Each successful reservation must be followed
+ * by exactly one commit before any other operation on the stream.
+ *
+ * @param stream  the stream to reserve memory in
+ * @param length  the number of bytes to reserve
+ * @param ptr     the start of the reserved region is returned here
+ * @return \c SDLOG_SUCCESS if the region was reserved,
+ *         \c SDLOG_UNIMPLEMENTED if the stream does not support reservations,
+ *         \c SDLOG_ELIMIT if the stream cannot provide that many contiguous
+ *         bytes, or any other error code in case of write errors. The
+ *         caller is expected to fall back to \ref sdlog_ostream_write() when
+ *         the first two are returned.
+ */
+sdlog_error_t sdlog_ostream_reserve(
+    sdlog_ostream_t* stream, size_t length, uint8_t** ptr);
+
+/**
+ * @brief Writes the bytes assembled in a region reserved earlier.
+ *
+ * @param stream  the stream to commit to
+ * @param length  the number of bytes to commit from the start of the region
+ *        returned by \ref sdlog_ostream_reserve(); it must not exceed the
+ *        reserved length. Zero cancels the reservation.
+ */
+sdlog_error_t sdlog_ostream_commit(sdlog_ostream_t* stream, size_t length);
+
+/**
+ * @brief Returns the file descriptor that an output stream writes to.
+ *
+ * @param stream  the stream
+ * @param fd      the file descriptor is returned here
+ * @return \c SDLOG_SUCCESS if the stream has a file descriptor,
+ *         \c SDLOG_UNIMPLEMENTED if it does not
+ */
+sdlog_error_t sdlog_ostream_get_fd(sdlog_ostream_t* stream, int* fd);
+
+/**
+ * @brief Appends a range of an input stream to an output stream.
+ *
+ * Streams created with \ref sdlog_ostream_init_fd() copy from input streams
+ * created with \ref sdlog_istream_init_fd() in the kernel, with
+ * \c copy_file_range() if they write to a file and with \c splice() if they
+ * write to a pipe, so the data does not pass through user space. Other input
+ * streams with a file descriptor, such as filters or concatenated streams,
+ * may not read the file as it is. In all other cases the data is read
+ * with \ref sdlog_istream_read_at() and written with
+ * \ref sdlog_ostream_write_all().
+ *
+ * @param stream  the stream to write to
+ * @param source  the stream to copy from; its read position is not used
+ *        and not changed
+ * @param offset  the offset in the source stream to copy from
+ * @param length  the number of bytes to copy
+ * @return \c SDLOG_SUCCESS if all the bytes were copied, \c SDLOG_EOF if the
+ *         source stream ended before all the bytes were copied, or any
+ *         other error code in case of read or write errors
+ */
+sdlog_error_t sdlog_ostream_copy_range(
+    sdlog_ostream_t* stream, sdlog_istream_t* source, uint64_t offset,
+    uint64_t length);
+
 /**
  * @brief Returns the internal buffer previously created by \c sdlog_ostream_init_buffer.
  *
@@ -377,21 +1743,263 @@ sdlog_error_t sdlog_ostream_write_all(
  */
 const uint8_t* sdlog_ostream_buffer_get(sdlog_ostream_t* stream, size_t* size);
 
+/**
+ * @brief Preallocates memory in a buffer stream.
+ *
+ * Grows the internal buffer of the stream so it can hold at least the given
+ * number of bytes in total without reallocating it. Useful when the final
+ * size of the log is known in advance; the buffer would otherwise be grown
+ * gradually, copying its contents each time.
+ *
+ * @param stream    the stream created with \ref sdlog_ostream_init_buffer()
+ * @param capacity  the number of bytes the buffer should be able to hold
+ */
+sdlog_error_t sdlog_ostream_buffer_ensure_capacity(sdlog_ostream_t* stream, size_t capacity);
+
+/**
+ * @brief Returns the number of bytes written to a chunked buffer stream.
+ *
+ * @param stream  the stream created with \ref sdlog_ostream_init_chunked()
+ */
+size_t sdlog_ostream_chunked_get_size(sdlog_ostream_t* stream);
+
+/**
+ * @brief Exports the contents of a chunked buffer stream as an array of
+ * buffers.
+ *
+ * The buffers point into the internal chunks of the stream; they remain valid
+ * until the stream is destroyed, even when more data is written to it.
+ *
+ * @param stream  the stream created with \ref sdlog_ostream_init_chunked()
+ * @param iov     the array to fill; may be \c NULL if \c iovcnt is zero
+ * @param iovcnt  the number of entries in the array
+ * @return the number of buffers needed to describe the entire contents of
+ *         the stream. Only the first \c iovcnt of them are stored if this is
+ *         larger than \c iovcnt.
+ */
+size_t sdlog_ostream_chunked_get_iovec(
+    sdlog_ostream_t* stream, sdlog_iovec_t* iov, size_t iovcnt);
+
+/**
+ * @brief Writes the contents of a chunked buffer stream to another stream.
+ *
+ * The chunks are submitted in a single vectored write, so streams created
+ * with \ref sdlog_ostream_init_fd() write them to their file descriptor
+ * without copying them first when they do not fit in the buffer of the
+ * stream.
+ *
+ * @param stream  the stream created with \ref sdlog_ostream_init_chunked()
+ * @param target  the stream to write to
+ */
+sdlog_error_t sdlog_ostream_chunked_write_to(sdlog_ostream_t* stream, sdlog_ostream_t* target);
+
+/**
+ * @brief Readiness flags reported by a poller.
+ */
+typedef enum {
+    SDLOG_POLL_READABLE = 1, /**< The input stream can be read without blocking */
+    SDLOG_POLL_WRITABLE = 2, /**< The output stream can be written without blocking */
+    SDLOG_POLL_HANGUP = 4,   /**< The other end of the file descriptor was closed */
+    SDLOG_POLL_ERROR = 8,    /**< An error occurred on the file descriptor */
+} sdlog_poll_flags_t;
+
+/**
+ * @brief A stream that became ready, as reported by \ref sdlog_poller_wait().
+ */
+typedef struct {
+    /** The input stream that became ready; \c NULL for output streams */
+    sdlog_istream_t* istream;
+
+    /** The output stream that became ready; \c NULL for input streams */
+    sdlog_ostream_t* ostream;
+
+    /** The argument that the stream was registered with */
+    void* arg;
+
+    /** Combination of \ref sdlog_poll_flags_t values */
+    unsigned int flags;
+} sdlog_poll_event_t;
+
+/**
+ * @brief Waits for multiple streams backed by file descriptors to become
+ * ready for reading or writing.
+ *
+ * Uses \c epoll where available and \c poll otherwise. A single thread can
+ * use a poller to serve many nonblocking input and output streams, reading
+ * or writing only those that are ready. Streams are registered with their
+ * file descriptors as returned by \ref sdlog_istream_get_fd() and
+ * \ref sdlog_ostream_get_fd(); the same descriptor may be registered once
+ * as an input and once as an output stream.
+ *
+ * Do not modify the fields of this structure directly.
+ */
+typedef struct {
+    /** The epoll instance, or -1 if the poller falls back to \c poll */
+    int fd;
+
+    /** The registered streams */
+    void* entries;
+
+    /** Number of registered file descriptors */
+    size_t count;
+
+    /** Number of entries allocated */
+    size_t capacity;
+} sdlog_poller_t;
+
+/**
+ * @brief Creates a poller with no streams.
+ *
+ * @param poller  the poller to initialize
+ * @return \c SDLOG_UNIMPLEMENTED if the platform supports neither \c epoll
+ *         nor \c poll, \c SDLOG_EIO if the epoll instance could not be
+ *         created
+ */
+sdlog_error_t sdlog_poller_init(sdlog_poller_t* poller);
+
+/**
+ * @brief Destroys a poller. The registered streams are not affected.
+ *
+ * @param poller  the poller to destroy
+ */
+void sdlog_poller_destroy(sdlog_poller_t* poller);
+
+/**
+ * @brief Registers an input stream with a poller.
+ *
+ * @param poller  the poller
+ * @param stream  the stream to wait for; it must have a file descriptor
+ * @param arg     arbitrary pointer reported together with the stream
+ * @return \c SDLOG_UNIMPLEMENTED if the stream has no file descriptor,
+ *         \c SDLOG_EINVAL if the stream or another input stream with the same
+ *         file descriptor is already registered
+ */
+sdlog_error_t sdlog_poller_add_istream(
+    sdlog_poller_t* poller, sdlog_istream_t* stream, void* arg);
+
+/**
+ * @brief Registers an output stream with a poller.
+ *
+ * Output streams are usually writable most of the time, so register them
+ * only while they have data pending and remove them afterwards, otherwise
+ * \ref sdlog_poller_wait() keeps reporting them.
+ *
+ * @param poller  the poller
+ * @param stream  the stream to wait for; it must have a file descriptor
+ * @param arg     arbitrary pointer reported together with the stream
+ * @return \c SDLOG_UNIMPLEMENTED if the stream has no file descriptor,
+ *         \c SDLOG_EINVAL if the stream or another output stream with the
+ *         same file descriptor is already registered
+ */
+sdlog_error_t sdlog_poller_add_ostream(
+    sdlog_poller_t* poller, sdlog_ostream_t* stream, void* arg);
+
+/**
+ * @brief Removes an input stream from a poller.
+ *
+ * @return \c SDLOG_EINVAL if the stream is not registered
+ */
+sdlog_error_t sdlog_poller_remove_istream(sdlog_poller_t* poller, sdlog_istream_t* stream);
+
+/**
+ * @brief Removes an output stream from a poller.
+ *
+ * @return \c SDLOG_EINVAL if the stream is not registered
+ */
+sdlog_error_t sdlog_poller_remove_ostream(sdlog_poller_t* poller, sdlog_ostream_t* stream);
+
+/**
+ * @brief Waits until at least one of the registered streams becomes ready.
+ *
+ * A file descriptor registered both as an input and as an output stream may
+ * produce two events, one for each stream.
+ *
+ * @param poller      the poller
+ * @param events      the ready streams are returned here
+ * @param max_events  the number of entries in \c events; must be positive
+ * @param timeout_ms  the maximum time to wait, in milliseconds; negative
+ *        means no limit and zero means that the function does not block
+ * @param count       the number of events stored in \c events is returned
+ *        here; zero if the wait timed out or was interrupted by a signal
+ * @return \c SDLOG_EINVAL if \c max_events is zero, \c SDLOG_EIO if the
+ *         wait failed
+ */
+sdlog_error_t sdlog_poller_wait(
+    sdlog_poller_t* poller, sdlog_poll_event_t* events, size_t max_events,
+    int timeout_ms, size_t* count);
+
 /**
  * @brief Method table of an output stream that writes to an in-memory buffer.
  */
 extern const sdlog_ostream_spec_t sdlog_ostream_buffer_methods;
 
+/**
+ * @brief Method table of an output stream that writes checksummed blocks.
+ */
+extern const sdlog_ostream_spec_t sdlog_ostream_checksummed_methods;
+
+/**
+ * @brief Method table of an output stream that writes to a list of chunks
+ * in memory.
+ */
+extern const sdlog_ostream_spec_t sdlog_ostream_chunked_methods;
+
+/**
+ * @brief Method table of an output stream that writes to a circular log file.
+ */
+extern const sdlog_ostream_spec_t sdlog_ostream_circular_file_methods;
+
+/**
+ * @brief Method table of an output stream that writes a block-compressed log
+ * container.
+ */
+extern const sdlog_ostream_spec_t sdlog_ostream_compressed_methods;
+
+/**
+ * @brief Method table of an output stream that counts the data written to it.
+ */
+extern const sdlog_ostream_spec_t sdlog_ostream_counting_methods;
+
+/**
+ * @brief Method table of an output stream that writes to a file descriptor.
+ */
+extern const sdlog_ostream_spec_t sdlog_ostream_fd_methods;
+
 /**
  * @brief Method table of an output stream that writes to a file.
  */
 extern const sdlog_ostream_spec_t sdlog_ostream_file_methods;
 
+/**
+ * @brief Method table of an output stream that writes to a memory-mapped file.
+ */
+extern const sdlog_ostream_spec_t sdlog_ostream_mmap_methods;
+
 /**
  * @brief Method table of an output stream that writes to a null stream.
  */
 extern const sdlog_ostream_spec_t sdlog_ostream_null_methods;
 
+/**
+ * @brief Method table of an output stream that writes to a ring buffer.
+ */
+extern const sdlog_ostream_spec_t sdlog_ostream_ring_methods;
+
+/**
+ * @brief Method table of an output stream that writes to rotating log files.
+ */
+extern const sdlog_ostream_spec_t sdlog_ostream_rotating_methods;
+
+/**
+ * @brief Method table of an output stream that writes to a shared-memory ring.
+ */
+extern const sdlog_ostream_spec_t sdlog_ostream_shm_methods;
+
+/**
+ * @brief Method table of an output stream that forwards to multiple streams.
+ */
+extern const sdlog_ostream_spec_t sdlog_ostream_tee_methods;
+
 __END_DECLS
 
 #endif
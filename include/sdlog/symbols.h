@@ -0,0 +1,84 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SDLOG_SYMBOLS_H
+#define SDLOG_SYMBOLS_H
+
+#include <sdlog/decls.h>
+
+/**
+ * @file symbols.h
+ * @brief Process-wide table of interned column names
+ *
+ * Column names such as \c TimeUS repeat across many message formats and
+ * across every log that is parsed. Message formats therefore do not store
+ * their own copies of column names; they store pointers into a table that
+ * holds a single, reference-counted copy of each distinct name. A name is
+ * freed when its last reference is released, so the table holds only the
+ * names of the formats that exist. Two interned names are equal if and only
+ * if their pointers are equal.
+ *
+ * The functions in this file may be called from multiple threads at the
+ * same time if the library was built with thread support.
+ */
+
+__BEGIN_DECLS
+
+/**
+ * @brief Returns the interned copy of a name, adding it to the table if needed.
+ *
+ * Each call takes a new reference to the name; release it with
+ * \ref sdlog_symbol_release() when it is not needed any more.
+ *
+ * @param name  the name to intern
+ * @return the interned copy of the name, which stays valid until the
+ *         reference is released, or \c NULL if there was not enough memory
+ */
+const char* sdlog_symbol_intern(const char* name);
+
+/**
+ * @brief Releases a reference to an interned name.
+ *
+ * The name is freed when its last reference is released.
+ *
+ * @param name  the interned name returned by \ref sdlog_symbol_intern();
+ *        \c NULL is ignored
+ */
+void sdlog_symbol_release(const char* name);
+
+/**
+ * @brief Returns the interned copy of a name without adding it to the table.
+ *
+ * No reference is taken, so the result is valid only as long as the caller
+ * knows that someone else holds a reference to the name.
+ *
+ * @param name  the name to look up
+ * @return the interned copy of the name, or \c NULL if the name is not
+ *         interned
+ */
+const char* sdlog_symbol_find(const char* name);
+
+__END_DECLS
+
+#endif
@@ -25,6 +25,7 @@
 #ifndef SDLOG_WRITER_H
 #define SDLOG_WRITER_H
 
+#include <stdarg.h>
 #include <stdbool.h>
 
 #include <sdlog/decls.h>
@@ -57,6 +58,10 @@ typedef struct {
 
     /** Internal buffer where the current log record is assembled */
     uint8_t* buf;
+
+    /** Internal buffer where the FMT record preceding the current log record
+     * is assembled, if needed, so the two can be written together */
+    uint8_t* fmt_buf;
 } sdlog_writer_t;
 
 /**
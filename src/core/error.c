@@ -36,6 +36,7 @@ static char *sdlog_i_error_messages[] = {
     "Generic I/O error",                                   /* SDLOG_EIO */
     "Unimplemented function call",                         /* SDLOG_UNIMPLEMENTED */
     "End of file",                                         /* SDLOG_EOF */
+    "Malformed log",                                       /* SDLOG_EPARSE */
 };
 /* clang-format on */
 
@@ -30,16 +30,16 @@
 
 #include <sdlog/memory.h>
 #include <sdlog/model.h>
+#include <sdlog/symbols.h>
+
+#include "symbol_table.h"
 
 static uint8_t get_size_of_column_type(char type);
 
 sdlog_error_t sdlog_message_column_format_init(
     sdlog_message_column_format_t* format, const char* name, char type, char unit)
 {
-    size_t length = strlen(name);
-
-    SDLOG_CHECK_OOM(format->name = sdlog_malloc(length + 1));
-    memcpy(format->name, name, length + 1);
+    SDLOG_CHECK_OOM(format->name = (char*)sdlog_symbol_intern(name));
 
     format->type = type;
     format->unit = unit;
@@ -49,7 +49,7 @@ sdlog_error_t sdlog_message_column_format_init(
 
 void sdlog_message_column_format_destroy(sdlog_message_column_format_t* format)
 {
-    sdlog_free(format->name);
+    sdlog_symbol_release(format->name);
     memset(format, 0, sizeof(sdlog_message_column_format_t));
 }
 
@@ -114,6 +114,39 @@ const sdlog_message_column_format_t* sdlog_message_format_get_column(
     return index < format->num_columns ? &format->columns[index] : NULL;
 }
 
+int sdlog_message_format_find_column(
+    const sdlog_message_format_t* format, const char* name)
+{
+    const sdlog_i_symbol_t* symbol;
+    size_t length;
+    uint32_t hash;
+    uint8_t i;
+
+    /* Formats defined at compile time do not own their columns, and the
+     * names of their columns are not interned */
+    if (format->num_alloc_columns == 0) {
+        for (i = 0; i < format->num_columns; i++) {
+            if (strcmp(format->columns[i].name, name) == 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    length = strlen(name);
+    hash = sdlog_i_symbol_hash(name, length);
+
+    for (i = 0; i < format->num_columns; i++) {
+        symbol = sdlog_i_symbol_of(format->columns[i].name);
+        if (symbol->name == name
+            || (symbol->hash == hash && symbol->length == length && !memcmp(symbol->name, name, length))) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
 char* sdlog_message_format_get_column_names(
     const sdlog_message_format_t* format, const char* sep)
 {
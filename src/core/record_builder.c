@@ -0,0 +1,254 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include <sdlog/byteorder.h>
+#include <sdlog/memory.h>
+#include <sdlog/record_builder.h>
+
+typedef enum {
+    COLUMN_KIND_INTEGER,
+    COLUMN_KIND_FLOAT,
+    COLUMN_KIND_STRING
+} column_kind_t;
+
+static uint8_t* get_column_ptr(
+    sdlog_record_builder_t* builder, uint8_t index, column_kind_t kind, uint8_t size);
+
+sdlog_error_t sdlog_record_builder_init(
+    sdlog_record_builder_t* builder, const sdlog_message_format_t* format)
+{
+    uint8_t i, num_columns = sdlog_message_format_get_column_count(format);
+    uint16_t offset = 3;
+
+    memset(builder, 0, sizeof(sdlog_record_builder_t));
+    builder->format = format;
+    builder->length = sdlog_message_format_get_size(format) + 3;
+
+    if (builder->length > SDLOG_MAX_MESSAGE_LENGTH) {
+        return SDLOG_ELIMIT;
+    }
+
+    /* Allocate at least one slot so a NULL pointer always means OOM */
+    SDLOG_CHECK_OOM(builder->offsets = sdlog_malloc((num_columns + 1) * sizeof(uint16_t)));
+    for (i = 0; i < num_columns; i++) {
+        builder->offsets[i] = offset;
+        offset += sdlog_message_column_format_get_size(sdlog_message_format_get_column(format, i));
+    }
+
+    builder->template_record = sdlog_malloc(builder->length * sizeof(uint8_t));
+    builder->record = sdlog_malloc(builder->length * sizeof(uint8_t));
+    if (builder->template_record == NULL || builder->record == NULL) {
+        sdlog_record_builder_destroy(builder);
+        return SDLOG_ENOMEM;
+    }
+
+    memset(builder->template_record, 0, builder->length);
+    builder->template_record[0] = 0xA3;
+    builder->template_record[1] = 0x95;
+    builder->template_record[2] = format->id;
+
+    sdlog_record_builder_reset(builder);
+
+    return SDLOG_SUCCESS;
+}
+
+void sdlog_record_builder_destroy(sdlog_record_builder_t* builder)
+{
+    sdlog_free(builder->record);
+    sdlog_free(builder->template_record);
+    sdlog_free(builder->offsets);
+    memset(builder, 0, sizeof(sdlog_record_builder_t));
+}
+
+void sdlog_record_builder_reset(sdlog_record_builder_t* builder)
+{
+    memcpy(builder->record, builder->template_record, builder->length);
+}
+
+sdlog_error_t sdlog_record_builder_set_i8(sdlog_record_builder_t* builder, uint8_t index, int8_t value)
+{
+    return sdlog_record_builder_set_u8(builder, index, (uint8_t)value);
+}
+
+sdlog_error_t sdlog_record_builder_set_u8(sdlog_record_builder_t* builder, uint8_t index, uint8_t value)
+{
+    uint8_t* ptr = get_column_ptr(builder, index, COLUMN_KIND_INTEGER, 1);
+    if (ptr == NULL) {
+        return SDLOG_EINVAL;
+    }
+
+    *ptr = value;
+
+    return SDLOG_SUCCESS;
+}
+
+sdlog_error_t sdlog_record_builder_set_i16(sdlog_record_builder_t* builder, uint8_t index, int16_t value)
+{
+    return sdlog_record_builder_set_u16(builder, index, (uint16_t)value);
+}
+
+sdlog_error_t sdlog_record_builder_set_u16(sdlog_record_builder_t* builder, uint8_t index, uint16_t value)
+{
+    uint8_t* ptr = get_column_ptr(builder, index, COLUMN_KIND_INTEGER, 2);
+    if (ptr == NULL) {
+        return SDLOG_EINVAL;
+    }
+
+    sdlog_store_u16_le(ptr, value);
+
+    return SDLOG_SUCCESS;
+}
+
+sdlog_error_t sdlog_record_builder_set_i32(sdlog_record_builder_t* builder, uint8_t index, int32_t value)
+{
+    return sdlog_record_builder_set_u32(builder, index, (uint32_t)value);
+}
+
+sdlog_error_t sdlog_record_builder_set_u32(sdlog_record_builder_t* builder, uint8_t index, uint32_t value)
+{
+    uint8_t* ptr = get_column_ptr(builder, index, COLUMN_KIND_INTEGER, 4);
+    if (ptr == NULL) {
+        return SDLOG_EINVAL;
+    }
+
+    sdlog_store_u32_le(ptr, value);
+
+    return SDLOG_SUCCESS;
+}
+
+sdlog_error_t sdlog_record_builder_set_i64(sdlog_record_builder_t* builder, uint8_t index, int64_t value)
+{
+    return sdlog_record_builder_set_u64(builder, index, (uint64_t)value);
+}
+
+sdlog_error_t sdlog_record_builder_set_u64(sdlog_record_builder_t* builder, uint8_t index, uint64_t value)
+{
+    uint8_t* ptr = get_column_ptr(builder, index, COLUMN_KIND_INTEGER, 8);
+    if (ptr == NULL) {
+        return SDLOG_EINVAL;
+    }
+
+    sdlog_store_u64_le(ptr, value);
+
+    return SDLOG_SUCCESS;
+}
+
+sdlog_error_t sdlog_record_builder_set_f32(sdlog_record_builder_t* builder, uint8_t index, float value)
+{
+    uint8_t* ptr = get_column_ptr(builder, index, COLUMN_KIND_FLOAT, 4);
+    if (ptr == NULL) {
+        return SDLOG_EINVAL;
+    }
+
+    sdlog_store_f32_le(ptr, value);
+
+    return SDLOG_SUCCESS;
+}
+
+sdlog_error_t sdlog_record_builder_set_f64(sdlog_record_builder_t* builder, uint8_t index, double value)
+{
+    uint8_t* ptr = get_column_ptr(builder, index, COLUMN_KIND_FLOAT, 8);
+    if (ptr == NULL) {
+        return SDLOG_EINVAL;
+    }
+
+    sdlog_store_f64_le(ptr, value);
+
+    return SDLOG_SUCCESS;
+}
+
+sdlog_error_t sdlog_record_builder_set_str(sdlog_record_builder_t* builder, uint8_t index, const char* value)
+{
+    uint8_t* ptr = get_column_ptr(builder, index, COLUMN_KIND_STRING, 0);
+    if (ptr == NULL) {
+        return SDLOG_EINVAL;
+    }
+
+    /* strncpy() also zero-fills the rest of the column */
+    strncpy((char*)ptr, value, sdlog_message_column_format_get_size(&builder->format->columns[index]));
+
+    return SDLOG_SUCCESS;
+}
+
+const uint8_t* sdlog_record_builder_get(const sdlog_record_builder_t* builder, size_t* length)
+{
+    if (length) {
+        *length = builder->length;
+    }
+
+    return builder->record;
+}
+
+sdlog_error_t sdlog_record_builder_commit(sdlog_record_builder_t* builder, sdlog_writer_t* writer)
+{
+    SDLOG_CHECK(sdlog_writer_write_encoded(writer, builder->format, builder->record, builder->length));
+    sdlog_record_builder_reset(builder);
+    return SDLOG_SUCCESS;
+}
+
+/* ************************************************************************** */
+
+/**
+ * Returns a pointer to the given column in the record being assembled if the
+ * column has the given kind and size (zero means any size), or \c NULL otherwise.
+ */
+static uint8_t* get_column_ptr(
+    sdlog_record_builder_t* builder, uint8_t index, column_kind_t kind, uint8_t size)
+{
+    const sdlog_message_column_format_t* column = sdlog_message_format_get_column(builder->format, index);
+    column_kind_t column_kind;
+
+    if (column == NULL) {
+        return NULL;
+    }
+
+    switch (column->type) {
+    case 'f':
+    case 'd':
+        column_kind = COLUMN_KIND_FLOAT;
+        break;
+
+    case 'n':
+    case 'N':
+    case 'Z':
+        column_kind = COLUMN_KIND_STRING;
+        break;
+
+    case 'a':
+        /* int16_t[32] arrays have no setter */
+        return NULL;
+
+    default:
+        column_kind = COLUMN_KIND_INTEGER;
+        break;
+    }
+
+    if (column_kind != kind || (size > 0 && sdlog_message_column_format_get_size(column) != size)) {
+        return NULL;
+    }
+
+    return builder->record + builder->offsets[index];
+}
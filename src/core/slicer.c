@@ -0,0 +1,230 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <sdlog/memory.h>
+#include <sdlog/model.h>
+#include <sdlog/slicer.h>
+
+/**
+ * Length of FMT records, including the sync bytes and the message ID: the
+ * ID and length of the described format, its 4-character type, a
+ * 16-character format string and 64 characters of column names.
+ */
+#define FMT_RECORD_LENGTH 89
+
+/**
+ * Size of the buffer that the log is scanned through.
+ */
+#define SCAN_BUFFER_SIZE (256 * 1024)
+
+typedef struct {
+    /** The stream to copy the kept records from */
+    sdlog_istream_t* input;
+
+    /** The stream to write the new log to */
+    sdlog_ostream_t* output;
+
+    /** Offset of the start of the run of kept records not copied yet */
+    uint64_t run_start;
+
+    /** Offset of the end of the run of kept records not copied yet */
+    uint64_t run_end;
+
+    /** Length of the records with each message ID; zero if the message ID
+     * has not been defined yet */
+    uint8_t lengths[SDLOG_NUM_MESSAGE_FORMATS];
+
+    /** Whether the last FMT record of each message ID is in the output */
+    bool written[SDLOG_NUM_MESSAGE_FORMATS];
+
+    /** The last FMT record of each message ID */
+    uint8_t fmt_records[SDLOG_NUM_MESSAGE_FORMATS][FMT_RECORD_LENGTH];
+} slicer_t;
+
+static void define_format(slicer_t* slicer, uint64_t offset, const uint8_t* record);
+static sdlog_error_t flush_run(slicer_t* slicer);
+static sdlog_error_t keep(slicer_t* slicer, uint8_t id, uint64_t offset, size_t length);
+static sdlog_error_t scan(
+    slicer_t* slicer, sdlog_istream_t* scanner, uint64_t offset,
+    sdlog_slice_filter_t* filter, void* arg);
+
+sdlog_error_t sdlog_slice(
+    sdlog_istream_t* input, sdlog_ostream_t* output, sdlog_slice_filter_t* filter,
+    void* arg)
+{
+    slicer_t* slicer;
+    sdlog_istream_t scanner;
+    uint64_t offset;
+    sdlog_error_t retval, end_retval;
+
+    SDLOG_CHECK(sdlog_istream_tell(input, &offset));
+
+    SDLOG_CHECK_OOM(slicer = sdlog_malloc(sizeof(slicer_t)));
+    memset(slicer, 0, sizeof(slicer_t));
+
+    slicer->input = input;
+    slicer->output = output;
+    slicer->run_start = slicer->run_end = offset;
+
+    retval = sdlog_istream_init_buffered(&scanner, input, SCAN_BUFFER_SIZE);
+    if (retval != SDLOG_SUCCESS) {
+        goto cleanup;
+    }
+
+    retval = sdlog_ostream_begin_session(output);
+    if (retval == SDLOG_SUCCESS) {
+        retval = scan(slicer, &scanner, offset, filter, arg);
+        if (retval == SDLOG_SUCCESS) {
+            retval = flush_run(slicer);
+        }
+
+        end_retval = sdlog_ostream_end_session(output);
+        if (retval == SDLOG_SUCCESS) {
+            retval = end_retval;
+        }
+    }
+
+    sdlog_istream_destroy(&scanner);
+
+cleanup:
+    sdlog_free(slicer);
+
+    return retval;
+}
+
+/**
+ * Records the message format defined by the given FMT record. The FMT record
+ * is copied along with the run of kept records that it follows directly, if
+ * any; otherwise it is written when the first record of the format is kept.
+ */
+static void define_format(slicer_t* slicer, uint64_t offset, const uint8_t* record)
+{
+    uint8_t id = record[3];
+
+    slicer->lengths[id] = record[4];
+    slicer->written[id] = false;
+    memcpy(slicer->fmt_records[id], record, FMT_RECORD_LENGTH);
+
+    if (slicer->run_end == offset && slicer->run_end > slicer->run_start) {
+        slicer->run_end += FMT_RECORD_LENGTH;
+        slicer->written[id] = true;
+    }
+}
+
+/**
+ * Copies the current run of kept records to the output.
+ */
+static sdlog_error_t flush_run(slicer_t* slicer)
+{
+    if (slicer->run_end > slicer->run_start) {
+        SDLOG_CHECK(sdlog_ostream_copy_range(
+            slicer->output, slicer->input, slicer->run_start,
+            slicer->run_end - slicer->run_start));
+    }
+
+    slicer->run_start = slicer->run_end;
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Adds a record to the run of kept records, starting a new run if the record
+ * does not follow the current one directly or its FMT record has to be
+ * written first.
+ */
+static sdlog_error_t keep(slicer_t* slicer, uint8_t id, uint64_t offset, size_t length)
+{
+    if (!slicer->written[id]) {
+        SDLOG_CHECK(flush_run(slicer));
+        SDLOG_CHECK(sdlog_ostream_write_all(slicer->output, slicer->fmt_records[id], FMT_RECORD_LENGTH));
+        slicer->written[id] = true;
+    }
+
+    if (slicer->run_end != offset) {
+        SDLOG_CHECK(flush_run(slicer));
+        slicer->run_start = offset;
+    }
+
+    slicer->run_end = offset + length;
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Scans the log record by record, starting at the given offset, and collects
+ * the records that the filter keeps.
+ */
+static sdlog_error_t scan(
+    slicer_t* slicer, sdlog_istream_t* scanner, uint64_t offset,
+    sdlog_slice_filter_t* filter, void* arg)
+{
+    const uint8_t* record;
+    size_t length;
+    sdlog_slice_decision_t decision;
+    sdlog_error_t retval;
+    uint8_t id;
+
+    while (true) {
+        /* The end of the log, or a truncated header */
+        retval = sdlog_istream_buffered_peek(scanner, 3, &record, NULL);
+        if (retval == SDLOG_EOF) {
+            return SDLOG_SUCCESS;
+        }
+        SDLOG_CHECK(retval);
+
+        if (record[0] != 0xA3 || record[1] != 0x95) {
+            return SDLOG_EPARSE;
+        }
+
+        id = record[2];
+        length = id == SDLOG_ID_FMT ? FMT_RECORD_LENGTH : slicer->lengths[id];
+        if (length < 3) {
+            return SDLOG_EPARSE;
+        }
+
+        /* A truncated last record, which a crash may leave behind */
+        retval = sdlog_istream_buffered_peek(scanner, length, &record, NULL);
+        if (retval == SDLOG_EOF) {
+            return SDLOG_SUCCESS;
+        }
+        SDLOG_CHECK(retval);
+
+        if (id == SDLOG_ID_FMT) {
+            define_format(slicer, offset, record);
+        } else {
+            decision = filter(arg, offset, record, length);
+            if (decision == SDLOG_SLICE_STOP) {
+                return SDLOG_SUCCESS;
+            } else if (decision == SDLOG_SLICE_KEEP) {
+                SDLOG_CHECK(keep(slicer, id, offset, length));
+            }
+        }
+
+        SDLOG_CHECK(sdlog_istream_buffered_consume(scanner, length));
+        offset += length;
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SDLOG_SYMBOL_TABLE_H
+#define SDLOG_SYMBOL_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sdlog/decls.h>
+
+/**
+ * @file symbol_table.h
+ * @brief Internal layout of the names interned with \ref sdlog_symbol_intern()
+ *
+ * Each interned name is stored after a header holding its hash and length.
+ * These never change while the name is interned, so they can be read
+ * without holding the lock of the symbol table; this lets callers compare a
+ * name to interned names cheaply before comparing the characters.
+ */
+
+__BEGIN_DECLS
+
+typedef struct {
+    /** Number of references to the name; guarded by the lock of the table */
+    size_t refcount;
+
+    /** Hash of the name, as returned by \ref sdlog_i_symbol_hash() */
+    uint32_t hash;
+
+    /** Length of the name, excluding the terminating zero byte */
+    uint32_t length;
+
+    /** The name itself */
+    char name[];
+} sdlog_i_symbol_t;
+
+/**
+ * Returns the hash of a name of the given length.
+ */
+uint32_t sdlog_i_symbol_hash(const char* name, size_t length);
+
+/**
+ * Returns the header of a name that was interned with
+ * \ref sdlog_symbol_intern().
+ */
+static inline const sdlog_i_symbol_t* sdlog_i_symbol_of(const char* symbol)
+{
+    return (const sdlog_i_symbol_t*)(symbol - offsetof(sdlog_i_symbol_t, name));
+}
+
+__END_DECLS
+
+#endif
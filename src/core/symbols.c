@@ -0,0 +1,270 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <sdlog/memory.h>
+#include <sdlog/symbols.h>
+
+#include "config.h"
+#include "symbol_table.h"
+
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+/**
+ * Number of slots in the hash table when the first name is interned; must be
+ * a power of two.
+ */
+#define INITIAL_CAPACITY 256
+
+/**
+ * Open-addressing hash table of the interned names, with linear probing.
+ * Names are freed when their last reference is released, and the table
+ * itself is freed when it becomes empty.
+ */
+static struct {
+    /** The slots of the table; \c NULL for empty slots */
+    sdlog_i_symbol_t** slots;
+
+    /** Number of slots; a power of two */
+    size_t capacity;
+
+    /** Number of names in the table */
+    size_t count;
+} table;
+
+#if HAVE_PTHREAD
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK() pthread_mutex_lock(&mutex)
+#define UNLOCK() pthread_mutex_unlock(&mutex)
+#else
+#define LOCK()
+#define UNLOCK()
+#endif
+
+static sdlog_i_symbol_t* add_name(const char* name, size_t length, uint32_t hash, size_t slot);
+static bool grow(void);
+static size_t probe(const char* name, size_t length, uint32_t hash);
+static void remove_slot(size_t slot);
+
+const char* sdlog_symbol_intern(const char* name)
+{
+    size_t length = strlen(name);
+    uint32_t hash;
+    size_t slot;
+    sdlog_i_symbol_t* symbol;
+
+    if (length > UINT32_MAX) {
+        return NULL;
+    }
+
+    hash = sdlog_i_symbol_hash(name, length);
+
+    LOCK();
+
+    /* Keep the table at most half full */
+    if (2 * (table.count + 1) > table.capacity && !grow()) {
+        UNLOCK();
+        return NULL;
+    }
+
+    slot = probe(name, length, hash);
+    symbol = table.slots[slot];
+    if (symbol) {
+        symbol->refcount++;
+    } else {
+        symbol = add_name(name, length, hash, slot);
+    }
+
+    UNLOCK();
+
+    return symbol ? symbol->name : NULL;
+}
+
+void sdlog_symbol_release(const char* name)
+{
+    sdlog_i_symbol_t* symbol;
+    size_t slot;
+
+    if (name == NULL) {
+        return;
+    }
+
+    symbol = (sdlog_i_symbol_t*)sdlog_i_symbol_of(name);
+
+    LOCK();
+
+    if (--symbol->refcount == 0) {
+        slot = probe(symbol->name, symbol->length, symbol->hash);
+        remove_slot(slot);
+        sdlog_free(symbol);
+
+        if (table.count == 0) {
+            sdlog_free(table.slots);
+            table.slots = NULL;
+            table.capacity = 0;
+        }
+    }
+
+    UNLOCK();
+}
+
+const char* sdlog_symbol_find(const char* name)
+{
+    size_t length = strlen(name);
+    sdlog_i_symbol_t* symbol = NULL;
+
+    LOCK();
+
+    if (table.capacity > 0 && length <= UINT32_MAX) {
+        symbol = table.slots[probe(name, length, sdlog_i_symbol_hash(name, length))];
+    }
+
+    UNLOCK();
+
+    return symbol ? symbol->name : NULL;
+}
+
+/**
+ * FNV-1a hash of a name.
+ */
+uint32_t sdlog_i_symbol_hash(const char* name, size_t length)
+{
+    uint32_t result = 2166136261u;
+
+    while (length-- > 0) {
+        result = (result ^ (uint8_t)*name++) * 16777619u;
+    }
+
+    return result;
+}
+
+/**
+ * Copies a name with a single reference into the given empty slot of the
+ * table.
+ */
+static sdlog_i_symbol_t* add_name(const char* name, size_t length, uint32_t hash, size_t slot)
+{
+    sdlog_i_symbol_t* symbol;
+
+    symbol = sdlog_malloc(sizeof(sdlog_i_symbol_t) + length + 1);
+    if (symbol == NULL) {
+        return NULL;
+    }
+
+    symbol->refcount = 1;
+    symbol->hash = hash;
+    symbol->length = (uint32_t)length;
+    memcpy(symbol->name, name, length + 1);
+
+    table.slots[slot] = symbol;
+    table.count++;
+
+    return symbol;
+}
+
+/**
+ * Doubles the number of slots in the table and rehashes the names.
+ */
+static bool grow(void)
+{
+    sdlog_i_symbol_t** old_slots = table.slots;
+    sdlog_i_symbol_t* symbol;
+    size_t old_capacity = table.capacity;
+    size_t i;
+
+    table.capacity = old_capacity > 0 ? 2 * old_capacity : INITIAL_CAPACITY;
+    table.slots = sdlog_malloc(table.capacity * sizeof(sdlog_i_symbol_t*));
+    if (table.slots == NULL) {
+        table.slots = old_slots;
+        table.capacity = old_capacity;
+        return false;
+    }
+
+    memset(table.slots, 0, table.capacity * sizeof(sdlog_i_symbol_t*));
+
+    for (i = 0; i < old_capacity; i++) {
+        symbol = old_slots[i];
+        if (symbol) {
+            table.slots[probe(symbol->name, symbol->length, symbol->hash)] = symbol;
+        }
+    }
+
+    sdlog_free(old_slots);
+
+    return true;
+}
+
+/**
+ * Returns the slot that holds the given name, or the empty slot where it
+ * belongs if it is not in the table. The table must have an empty slot.
+ */
+static size_t probe(const char* name, size_t length, uint32_t hash)
+{
+    size_t mask = table.capacity - 1;
+    size_t slot = hash & mask;
+    const sdlog_i_symbol_t* symbol;
+
+    while ((symbol = table.slots[slot]) != NULL) {
+        if (symbol->hash == hash && symbol->length == length && !memcmp(symbol->name, name, length)) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+/**
+ * Empties a slot of the table, moving the names after it back so that each
+ * name can still be found by probing from the slot that its hash points to.
+ */
+static void remove_slot(size_t slot)
+{
+    size_t mask = table.capacity - 1;
+    size_t next = slot;
+    size_t home;
+
+    while (1) {
+        next = (next + 1) & mask;
+        if (table.slots[next] == NULL) {
+            break;
+        }
+
+        /* The name in the next slot stays if its home slot lies cyclically
+         * after the emptied slot and not after the next slot */
+        home = table.slots[next]->hash & mask;
+        if (next > slot ? (home <= slot || home > next) : (home <= slot && home > next)) {
+            table.slots[slot] = table.slots[next];
+            slot = next;
+        }
+    }
+
+    table.slots[slot] = NULL;
+    table.count--;
+}
@@ -31,10 +31,15 @@
 #include <sdlog/writer.h>
 
 static sdlog_error_t ensure_session_started(sdlog_writer_t* writer);
-static sdlog_error_t write_format(sdlog_writer_t* writer, const sdlog_message_format_t* format);
-static sdlog_error_t write_format_if_needed(sdlog_writer_t* writer, const sdlog_message_format_t* format);
-static sdlog_error_t write_record(sdlog_writer_t* writer, const sdlog_message_format_t* format, ...);
-static sdlog_error_t write_record_va(sdlog_writer_t* writer, const sdlog_message_format_t* format, va_list args);
+static sdlog_error_t encode_format(
+    sdlog_writer_t* writer, const sdlog_message_format_t* format, size_t* length);
+static sdlog_error_t encode_format_if_needed(
+    sdlog_writer_t* writer, const sdlog_message_format_t* format, size_t* length);
+static sdlog_error_t mark_format_written(
+    sdlog_writer_t* writer, const sdlog_message_format_t* format, size_t fmt_length,
+    sdlog_error_t retval);
+static sdlog_error_t write_with_format(
+    sdlog_writer_t* writer, size_t fmt_length, const uint8_t* message, size_t length);
 
 sdlog_error_t sdlog_writer_init(sdlog_writer_t* writer, sdlog_ostream_t* stream)
 {
@@ -51,6 +56,7 @@ sdlog_error_t sdlog_writer_init(sdlog_writer_t* writer, sdlog_ostream_t* stream)
     writer->fmt_message_format = fmt_format;
 
     SDLOG_CHECK_OOM(writer->buf = sdlog_malloc(SDLOG_MAX_MESSAGE_LENGTH * sizeof(uint8_t)));
+    SDLOG_CHECK_OOM(writer->fmt_buf = sdlog_malloc(SDLOG_MAX_MESSAGE_LENGTH * sizeof(uint8_t)));
 
     return SDLOG_SUCCESS;
 }
@@ -63,6 +69,7 @@ void sdlog_writer_destroy(sdlog_writer_t* writer)
 
     sdlog_message_format_destroy(&writer->fmt_message_format);
     sdlog_free(writer->buf);
+    sdlog_free(writer->fmt_buf);
 
     memset(writer, 0, sizeof(sdlog_writer_t));
 }
@@ -99,23 +106,59 @@ sdlog_error_t sdlog_writer_write_encoded(
     sdlog_writer_t* writer, const sdlog_message_format_t* format,
     const uint8_t* message, size_t length)
 {
+    size_t fmt_length;
+
     if (length == 0) {
         length = sdlog_message_format_get_size(format) + 3;
     }
 
     SDLOG_CHECK(ensure_session_started(writer));
-    SDLOG_CHECK(write_format_if_needed(writer, format));
-    return sdlog_ostream_write_all(writer->stream, message, length);
+    SDLOG_CHECK(encode_format_if_needed(writer, format, &fmt_length));
+    return mark_format_written(
+        writer, format, fmt_length, write_with_format(writer, fmt_length, message, length));
 }
 
 sdlog_error_t sdlog_writer_write_va(sdlog_writer_t* writer, const sdlog_message_format_t* format, va_list args)
 {
+    size_t fmt_length, length;
+    uint8_t* ptr;
+    sdlog_error_t retval;
+
     SDLOG_CHECK(ensure_session_started(writer));
-    SDLOG_CHECK(write_format_if_needed(writer, format));
-    return write_record_va(writer, format, args);
+    SDLOG_CHECK(encode_format_if_needed(writer, format, &fmt_length));
+
+    /* Encode the record straight into the memory of the stream if the stream
+     * allows it, saving a copy */
+    length = sdlog_message_format_get_size(format) + 3;
+    retval = sdlog_ostream_reserve(writer->stream, fmt_length + length, &ptr);
+    if (retval == SDLOG_SUCCESS) {
+        if (fmt_length > 0) {
+            memcpy(ptr, writer->fmt_buf, fmt_length);
+        }
+
+        retval = sdlog_message_format_encode_va(format, ptr + fmt_length, &length, args);
+        if (retval != SDLOG_SUCCESS) {
+            sdlog_ostream_commit(writer->stream, 0);
+            return retval;
+        }
+
+        return mark_format_written(
+            writer, format, fmt_length, sdlog_ostream_commit(writer->stream, fmt_length + length));
+    } else if (retval != SDLOG_UNIMPLEMENTED && retval != SDLOG_ELIMIT) {
+        return retval;
+    }
+
+    SDLOG_CHECK(sdlog_message_format_encode_va(format, writer->buf, &length, args));
+    return mark_format_written(
+        writer, format, fmt_length, write_with_format(writer, fmt_length, writer->buf, length));
 }
 
-static sdlog_error_t write_format(sdlog_writer_t* writer, const sdlog_message_format_t* format)
+/**
+ * Encodes the FMT record of the given message format into the FMT buffer of
+ * the writer.
+ */
+static sdlog_error_t encode_format(
+    sdlog_writer_t* writer, const sdlog_message_format_t* format, size_t* length)
 {
     char* format_str = NULL;
     char* column_names = NULL;
@@ -133,8 +176,8 @@ static sdlog_error_t write_format(sdlog_writer_t* writer, const sdlog_message_fo
         goto cleanup;
     }
 
-    retval = write_record(
-        writer, &writer->fmt_message_format,
+    retval = sdlog_message_format_encode(
+        &writer->fmt_message_format, writer->fmt_buf, length,
         /* type = */ format->id,
         /* length = */ sdlog_message_format_get_size(format) + 3,
         /* name = */ format->type,
@@ -148,17 +191,39 @@ cleanup:
     return retval;
 }
 
-static sdlog_error_t write_format_if_needed(sdlog_writer_t* writer, const sdlog_message_format_t* format)
+/**
+ * Encodes an FMT record into the FMT buffer of the writer if this message
+ * format is a new one or its definition changed since the last time we wrote
+ * an FMT record. The length of the FMT record is returned in \c length; zero
+ * means that no FMT record is needed.
+ *
+ * The format is not considered written until \ref mark_format_written() is
+ * called for it.
+ */
+static sdlog_error_t encode_format_if_needed(
+    sdlog_writer_t* writer, const sdlog_message_format_t* format, size_t* length)
 {
-    sdlog_error_t retval;
-
-    /* Write an FMT record if this message format is a new one or its definition
-     * changed since the last time we wrote an FMT record */
     if (writer->formats[format->id] != format) {
-        retval = write_format(writer, format);
-        writer->formats[format->id] = (sdlog_message_format_t*)format;
+        return encode_format(writer, format, length);
     } else {
-        retval = SDLOG_SUCCESS;
+        *length = 0;
+        return SDLOG_SUCCESS;
+    }
+}
+
+/**
+ * Records that the FMT record of the given format has reached the stream if
+ * an FMT record was submitted (\c fmt_length is positive) and the stream
+ * accepted it (\c retval is \c SDLOG_SUCCESS). Returns \c retval so it can
+ * wrap the call that submitted the record. When the submission failed, the
+ * FMT record is sent again with the next record of the format.
+ */
+static sdlog_error_t mark_format_written(
+    sdlog_writer_t* writer, const sdlog_message_format_t* format, size_t fmt_length,
+    sdlog_error_t retval)
+{
+    if (retval == SDLOG_SUCCESS && fmt_length > 0) {
+        writer->formats[format->id] = (sdlog_message_format_t*)format;
     }
 
     return retval;
@@ -174,24 +239,24 @@ static sdlog_error_t ensure_session_started(sdlog_writer_t* writer)
     return SDLOG_SUCCESS;
 }
 
-static sdlog_error_t write_record(sdlog_writer_t* writer, const sdlog_message_format_t* format, ...)
+/**
+ * Writes a log record, preceded by the FMT record in the FMT buffer of the
+ * writer if its length is positive. The two records are submitted to the
+ * stream in a single vectored write.
+ */
+static sdlog_error_t write_with_format(
+    sdlog_writer_t* writer, size_t fmt_length, const uint8_t* message, size_t length)
 {
-    va_list args;
-    sdlog_error_t retval;
-
-    va_start(args, format);
-    retval = write_record_va(writer, format, args);
-    va_end(args);
-
-    return retval;
-}
+    sdlog_iovec_t iov[2];
 
-static sdlog_error_t write_record_va(sdlog_writer_t* writer, const sdlog_message_format_t* format, va_list args)
-{
-    size_t written;
+    if (fmt_length == 0) {
+        return sdlog_ostream_write_all(writer->stream, message, length);
+    }
 
-    SDLOG_CHECK(sdlog_message_format_encode_va(format, writer->buf, &written, args));
-    SDLOG_CHECK(sdlog_ostream_write_all(writer->stream, writer->buf, written));
+    iov[0].data = writer->fmt_buf;
+    iov[0].length = fmt_length;
+    iov[1].data = message;
+    iov[1].length = length;
 
-    return SDLOG_SUCCESS;
+    return sdlog_ostream_writev_all(writer->stream, iov, 2);
 }
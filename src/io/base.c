@@ -25,8 +25,28 @@
 #include <assert.h>
 #include <string.h>
 
+#include <sdlog/memory.h>
 #include <sdlog/streams.h>
 
+#include "config.h"
+#include "stream_base.h"
+
+#if HAVE_POLL_H
+#include <errno.h>
+#include <poll.h>
+#endif
+
+/**
+ * Size of the buffer that copies data between streams that cannot copy in
+ * the kernel.
+ */
+#define COPY_BUFFER_SIZE (64 * 1024)
+
+/**
+ * Maximum number of bytes that an in-kernel copy is asked to copy at once.
+ */
+#define MAX_COPY_CHUNK_SIZE (1024 * 1024 * 1024)
+
 sdlog_error_t sdlog_istream_init(
     sdlog_istream_t* stream, const sdlog_istream_spec_t* spec,
     void* ctx)
@@ -71,10 +91,13 @@ sdlog_error_t sdlog_istream_read_exactly(
 {
     uint8_t* buf = data;
     size_t read;
+    int fd;
 
     while (length > 0) {
         SDLOG_CHECK(sdlog_istream_read(stream, buf, length, &read));
-        if (read <= length) {
+        if (read == 0 && sdlog_istream_get_fd(stream, &fd) == SDLOG_SUCCESS) {
+            SDLOG_CHECK(sdlog_i_wait_for_fd(fd, false));
+        } else if (read <= length) {
             length -= read;
             buf += read;
         } else {
@@ -88,6 +111,48 @@ sdlog_error_t sdlog_istream_read_exactly(
     return SDLOG_SUCCESS;
 }
 
+sdlog_error_t sdlog_istream_get_fd(sdlog_istream_t* stream, int* fd)
+{
+    return stream->methods->get_fd
+        ? stream->methods->get_fd(stream, fd)
+        : SDLOG_UNIMPLEMENTED;
+}
+
+sdlog_error_t sdlog_istream_seek(sdlog_istream_t* stream, uint64_t offset)
+{
+    return stream->methods->seek
+        ? stream->methods->seek(stream, offset)
+        : SDLOG_UNIMPLEMENTED;
+}
+
+sdlog_error_t sdlog_istream_tell(sdlog_istream_t* stream, uint64_t* offset)
+{
+    return stream->methods->tell
+        ? stream->methods->tell(stream, offset)
+        : SDLOG_UNIMPLEMENTED;
+}
+
+sdlog_error_t sdlog_istream_read_at(
+    sdlog_istream_t* stream, uint64_t offset, uint8_t* data, size_t length,
+    size_t* bytes_read)
+{
+    size_t dummy;
+
+    if (!bytes_read) {
+        bytes_read = &dummy;
+    }
+
+    *bytes_read = 0;
+
+    if (!stream->methods->read_at) {
+        return SDLOG_UNIMPLEMENTED;
+    }
+
+    return length > 0
+        ? stream->methods->read_at(stream, offset, data, length, bytes_read)
+        : SDLOG_SUCCESS;
+}
+
 /* ************************************************************************** */
 
 sdlog_error_t sdlog_ostream_init(
@@ -155,10 +220,13 @@ sdlog_error_t sdlog_ostream_write_all(
 {
     const uint8_t* buf = data;
     size_t written;
+    int fd;
 
     while (length > 0) {
         SDLOG_CHECK(sdlog_ostream_write(stream, buf, length, &written));
-        if (written <= length) {
+        if (written == 0 && sdlog_ostream_get_fd(stream, &fd) == SDLOG_SUCCESS) {
+            SDLOG_CHECK(sdlog_i_wait_for_fd(fd, true));
+        } else if (written <= length) {
             length -= written;
             buf += written;
         } else {
@@ -171,3 +239,186 @@ sdlog_error_t sdlog_ostream_write_all(
 
     return SDLOG_SUCCESS;
 }
+
+sdlog_error_t sdlog_ostream_writev(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt,
+    size_t* bytes_written)
+{
+    size_t dummy, i, total, written;
+
+    if (bytes_written == NULL) {
+        bytes_written = &dummy;
+    }
+
+    /* Skip empty buffers at the front so the stream sees nonempty data */
+    while (iovcnt > 0 && iov->length == 0) {
+        iov++;
+        iovcnt--;
+    }
+
+    *bytes_written = 0;
+
+    if (iovcnt == 0) {
+        return SDLOG_SUCCESS;
+    }
+
+    if (stream->methods->writev) {
+        return stream->methods->writev(stream, iov, iovcnt, bytes_written);
+    }
+
+    if (!stream->methods->write) {
+        return SDLOG_UNIMPLEMENTED;
+    }
+
+    /* Generic fallback: write the buffers one by one, stopping at the first
+     * partial write so that the caller sees a contiguous prefix */
+    total = 0;
+    for (i = 0; i < iovcnt; i++) {
+        if (iov[i].length == 0) {
+            continue;
+        }
+
+        written = 0;
+        SDLOG_CHECK(stream->methods->write(stream, iov[i].data, iov[i].length, &written));
+        total += written;
+        *bytes_written = total;
+
+        if (written < iov[i].length) {
+            break;
+        }
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+sdlog_error_t sdlog_ostream_writev_all(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt)
+{
+    size_t written;
+    int fd;
+
+    while (iovcnt > 0) {
+        SDLOG_CHECK(sdlog_ostream_writev(stream, iov, iovcnt, &written));
+
+        if (written == 0 && sdlog_ostream_get_fd(stream, &fd) == SDLOG_SUCCESS) {
+            SDLOG_CHECK(sdlog_i_wait_for_fd(fd, true));
+            continue;
+        }
+
+        /* Skip the buffers that were written entirely */
+        while (iovcnt > 0 && written >= iov->length) {
+            written -= iov->length;
+            iov++;
+            iovcnt--;
+        }
+
+        /* Finish the partially written buffer on its own */
+        if (iovcnt > 0 && written > 0) {
+            SDLOG_CHECK(sdlog_ostream_write_all(stream, iov->data + written, iov->length - written));
+            iov++;
+            iovcnt--;
+        }
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+sdlog_error_t sdlog_ostream_reserve(
+    sdlog_ostream_t* stream, size_t length, uint8_t** ptr)
+{
+    if (!stream->methods->reserve) {
+        return SDLOG_UNIMPLEMENTED;
+    }
+
+    if (length == 0) {
+        return SDLOG_EINVAL;
+    }
+
+    assert(stream->methods->commit);
+
+    return stream->methods->reserve(stream, length, ptr);
+}
+
+sdlog_error_t sdlog_ostream_commit(sdlog_ostream_t* stream, size_t length)
+{
+    return stream->methods->commit
+        ? stream->methods->commit(stream, length)
+        : SDLOG_UNIMPLEMENTED;
+}
+
+sdlog_error_t sdlog_ostream_get_fd(sdlog_ostream_t* stream, int* fd)
+{
+    return stream->methods->get_fd
+        ? stream->methods->get_fd(stream, fd)
+        : SDLOG_UNIMPLEMENTED;
+}
+
+sdlog_error_t sdlog_ostream_copy_range(
+    sdlog_ostream_t* stream, sdlog_istream_t* source, uint64_t offset,
+    uint64_t length)
+{
+    uint8_t* buf;
+    size_t chunk, copied;
+    sdlog_error_t retval = SDLOG_SUCCESS;
+
+    while (length > 0 && stream->methods->copy_range) {
+        chunk = length < MAX_COPY_CHUNK_SIZE ? length : MAX_COPY_CHUNK_SIZE;
+        copied = 0;
+
+        retval = stream->methods->copy_range(stream, source, offset, chunk, &copied);
+        if (retval == SDLOG_UNIMPLEMENTED) {
+            break;
+        }
+        SDLOG_CHECK(retval);
+
+        if (copied == 0) {
+            break;
+        }
+
+        offset += copied;
+        length -= copied;
+    }
+
+    if (length == 0) {
+        return SDLOG_SUCCESS;
+    }
+
+    /* Generic fallback: copy the data through a bounce buffer */
+    SDLOG_CHECK_OOM(buf = sdlog_malloc(COPY_BUFFER_SIZE));
+
+    retval = SDLOG_SUCCESS;
+    while (length > 0 && retval == SDLOG_SUCCESS) {
+        chunk = length < COPY_BUFFER_SIZE ? length : COPY_BUFFER_SIZE;
+
+        retval = sdlog_istream_read_at(source, offset, buf, chunk, &copied);
+        if (retval == SDLOG_SUCCESS) {
+            retval = sdlog_ostream_write_all(stream, buf, copied);
+        }
+
+        offset += copied;
+        length -= copied;
+    }
+
+    sdlog_free(buf);
+
+    return retval;
+}
+
+sdlog_error_t sdlog_i_wait_for_fd(int fd, bool writable)
+{
+#if HAVE_POLL_H
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = writable ? POLLOUT : POLLIN;
+    pfd.revents = 0;
+
+    while (poll(&pfd, 1, -1) < 0) {
+        if (errno != EINTR) {
+            return writable ? SDLOG_EWRITE : SDLOG_EREAD;
+        }
+    }
+#endif
+
+    return SDLOG_SUCCESS;
+}
@@ -23,6 +23,7 @@
  */
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -47,19 +48,34 @@ static void buffer_destroy_i(sdlog_istream_t* stream);
 static void buffer_destroy_o(sdlog_ostream_t* stream);
 static sdlog_error_t buffer_read(
     sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read);
+static sdlog_error_t buffer_seek(sdlog_istream_t* stream, uint64_t offset);
+static sdlog_error_t buffer_tell(sdlog_istream_t* stream, uint64_t* offset);
+static sdlog_error_t buffer_read_at(
+    sdlog_istream_t* stream, uint64_t offset, uint8_t* data, size_t length,
+    size_t* read);
 static sdlog_error_t buffer_write(
     sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written);
+static sdlog_error_t buffer_writev(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt, size_t* written);
+static sdlog_error_t buffer_reserve_o(sdlog_ostream_t* stream, size_t length, uint8_t** ptr);
+static sdlog_error_t buffer_commit(sdlog_ostream_t* stream, size_t length);
 static size_t buffer_remaining(sdlog_ostream_t* stream);
-static sdlog_error_t buffer_grow(sdlog_ostream_t* stream);
+static sdlog_error_t buffer_reserve(sdlog_ostream_t* stream, size_t length);
 
 const sdlog_istream_spec_t sdlog_istream_buffer_methods = {
     .destroy = buffer_destroy_i,
     .read = buffer_read,
+    .seek = buffer_seek,
+    .tell = buffer_tell,
+    .read_at = buffer_read_at,
 };
 
 const sdlog_ostream_spec_t sdlog_ostream_buffer_methods = {
     .destroy = buffer_destroy_o,
     .write = buffer_write,
+    .writev = buffer_writev,
+    .reserve = buffer_reserve_o,
+    .commit = buffer_commit,
 };
 
 sdlog_error_t sdlog_istream_init_buffer(
@@ -102,6 +118,26 @@ const uint8_t* sdlog_ostream_buffer_get(sdlog_ostream_t* stream, size_t* size)
     return ctx->data;
 }
 
+sdlog_error_t sdlog_ostream_buffer_ensure_capacity(sdlog_ostream_t* stream, size_t capacity)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+    size_t used = ctx->end - ctx->data;
+    size_t alloc_length = ctx->alloc_end - ctx->data;
+    uint8_t* new_data;
+
+    if (capacity <= alloc_length) {
+        return SDLOG_SUCCESS;
+    }
+
+    SDLOG_CHECK_OOM(new_data = sdlog_realloc(ctx->data, alloc_length, capacity));
+
+    ctx->data = new_data;
+    ctx->end = ctx->data + used;
+    ctx->alloc_end = ctx->data + capacity;
+
+    return SDLOG_SUCCESS;
+}
+
 static void buffer_destroy_i(sdlog_istream_t* stream)
 {
     istream_context_t* ctx = CONTEXT_AS(istream_context_t);
@@ -142,14 +178,54 @@ static sdlog_error_t buffer_read(
     return SDLOG_SUCCESS;
 }
 
+static sdlog_error_t buffer_seek(sdlog_istream_t* stream, uint64_t offset)
+{
+    istream_context_t* ctx = CONTEXT_AS(istream_context_t);
+
+    if (offset > (uint64_t)(ctx->end - ctx->data)) {
+        return SDLOG_EINVAL;
+    }
+
+    ctx->read_ptr = ctx->data + offset;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t buffer_tell(sdlog_istream_t* stream, uint64_t* offset)
+{
+    istream_context_t* ctx = CONTEXT_AS(istream_context_t);
+    *offset = ctx->read_ptr - ctx->data;
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t buffer_read_at(
+    sdlog_istream_t* stream, uint64_t offset, uint8_t* data, size_t length,
+    size_t* read)
+{
+    istream_context_t* ctx = CONTEXT_AS(istream_context_t);
+    size_t size = ctx->end - ctx->data;
+
+    if (offset >= size) {
+        *read = 0;
+        return SDLOG_EOF;
+    }
+
+    if (length > size - offset) {
+        length = size - offset;
+    }
+
+    memcpy(data, ctx->data + offset, length);
+    *read = length;
+
+    return SDLOG_SUCCESS;
+}
+
 static sdlog_error_t buffer_write(
     sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
 {
     ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
 
-    while (buffer_remaining(stream) < length) {
-        SDLOG_CHECK(buffer_grow(stream));
-    }
+    SDLOG_CHECK(buffer_reserve(stream, length));
 
     memcpy(ctx->end, data, length);
     ctx->end += length;
@@ -158,6 +234,50 @@ static sdlog_error_t buffer_write(
     return SDLOG_SUCCESS;
 }
 
+static sdlog_error_t buffer_writev(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt, size_t* written)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+    size_t i, total = 0;
+
+    for (i = 0; i < iovcnt; i++) {
+        total += iov[i].length;
+    }
+
+    SDLOG_CHECK(buffer_reserve(stream, total));
+
+    for (i = 0; i < iovcnt; i++) {
+        if (iov[i].length > 0) {
+            memcpy(ctx->end, iov[i].data, iov[i].length);
+            ctx->end += iov[i].length;
+        }
+    }
+
+    *written = total;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t buffer_reserve_o(sdlog_ostream_t* stream, size_t length, uint8_t** ptr)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+
+    SDLOG_CHECK(buffer_reserve(stream, length));
+    *ptr = ctx->end;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t buffer_commit(sdlog_ostream_t* stream, size_t length)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+
+    assert(length <= buffer_remaining(stream));
+    ctx->end += length;
+
+    return SDLOG_SUCCESS;
+}
+
 static size_t buffer_remaining(sdlog_ostream_t* stream)
 {
     ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
@@ -165,19 +285,38 @@ static size_t buffer_remaining(sdlog_ostream_t* stream)
     return ctx->alloc_end - ctx->end;
 }
 
-static sdlog_error_t buffer_grow(sdlog_ostream_t* stream)
+/**
+ * Ensures that at least the given number of bytes can be appended to the
+ * buffer, growing it with a single reallocation if needed.
+ */
+static sdlog_error_t buffer_reserve(sdlog_ostream_t* stream, size_t length)
 {
     ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
-    size_t length = ctx->end - ctx->data;
+    size_t used = ctx->end - ctx->data;
     size_t alloc_length = ctx->alloc_end - ctx->data;
     size_t new_alloc_length;
     uint8_t* new_data;
 
-    new_alloc_length = alloc_length * 2;
+    if (buffer_remaining(stream) >= length) {
+        return SDLOG_SUCCESS;
+    }
+
+    if (length > SIZE_MAX - used) {
+        return SDLOG_ELIMIT;
+    }
+
+    new_alloc_length = alloc_length;
+    do {
+        if (new_alloc_length > SIZE_MAX / 2) {
+            return SDLOG_ELIMIT;
+        }
+        new_alloc_length *= 2;
+    } while (new_alloc_length - used < length);
+
     SDLOG_CHECK_OOM(new_data = sdlog_realloc(ctx->data, alloc_length, new_alloc_length));
 
     ctx->data = new_data;
-    ctx->end = ctx->data + length;
+    ctx->end = ctx->data + used;
     ctx->alloc_end = ctx->data + new_alloc_length;
 
     return SDLOG_SUCCESS;
@@ -0,0 +1,236 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sdlog/memory.h>
+#include <sdlog/streams.h>
+
+#include "stream_base.h"
+
+/**
+ * Default size of the buffer of buffered input streams.
+ */
+#define DEFAULT_BUFFER_SIZE (64 * 1024)
+
+typedef struct {
+    /** Unread part of the buffer. Must be the first member; the inline
+     * functions in the public header find it through the context pointer */
+    sdlog_istream_buffered_cursor_t cursor;
+
+    /** The stream to read from; not owned */
+    sdlog_istream_t* source;
+
+    /** The buffer */
+    uint8_t* buf;
+
+    /** Size of the buffer */
+    size_t capacity;
+} context_t;
+
+static void buffered_destroy(sdlog_istream_t* stream);
+static sdlog_error_t buffered_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read);
+static sdlog_error_t buffered_get_fd(sdlog_istream_t* stream, int* fd);
+static sdlog_error_t buffered_seek(sdlog_istream_t* stream, uint64_t offset);
+static sdlog_error_t buffered_tell(sdlog_istream_t* stream, uint64_t* offset);
+static sdlog_error_t buffered_read_at(
+    sdlog_istream_t* stream, uint64_t offset, uint8_t* data, size_t length,
+    size_t* read);
+
+static sdlog_error_t refill(context_t* ctx, size_t* read);
+
+const sdlog_istream_spec_t sdlog_istream_buffered_methods = {
+    .destroy = buffered_destroy,
+    .read = buffered_read,
+    .get_fd = buffered_get_fd,
+    .seek = buffered_seek,
+    .tell = buffered_tell,
+    .read_at = buffered_read_at,
+};
+
+sdlog_error_t sdlog_istream_init_buffered(
+    sdlog_istream_t* stream, sdlog_istream_t* source, size_t buffer_size)
+{
+    context_t* ctx;
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(context_t)));
+    memset(ctx, 0, sizeof(context_t));
+
+    ctx->source = source;
+    ctx->capacity = buffer_size > 0 ? buffer_size : DEFAULT_BUFFER_SIZE;
+
+    ctx->buf = sdlog_malloc(ctx->capacity);
+    if (ctx->buf == NULL) {
+        sdlog_free(ctx);
+        return SDLOG_ENOMEM;
+    }
+
+    ctx->cursor.pos = ctx->cursor.end = ctx->buf;
+
+    return sdlog_istream_init(stream, &sdlog_istream_buffered_methods, ctx);
+}
+
+sdlog_error_t sdlog_istream_buffered_peek(
+    sdlog_istream_t* stream, size_t length, const uint8_t** ptr, size_t* available)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    sdlog_error_t retval = SDLOG_SUCCESS;
+    size_t read;
+    int fd;
+
+    if (length > ctx->capacity) {
+        return SDLOG_ELIMIT;
+    }
+
+    while ((size_t)(ctx->cursor.end - ctx->cursor.pos) < length) {
+        retval = refill(ctx, &read);
+        if (retval == SDLOG_EOF) {
+            break;
+        }
+        SDLOG_CHECK(retval);
+
+        /* Same as sdlog_istream_read_exactly() when a nonblocking source has
+         * no data yet */
+        if (read == 0 && sdlog_istream_get_fd(ctx->source, &fd) == SDLOG_SUCCESS) {
+            SDLOG_CHECK(sdlog_i_wait_for_fd(fd, false));
+        }
+    }
+
+    *ptr = ctx->cursor.pos;
+    if (available) {
+        *available = ctx->cursor.end - ctx->cursor.pos;
+    }
+
+    return retval;
+}
+
+sdlog_error_t sdlog_istream_buffered_consume(sdlog_istream_t* stream, size_t length)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    if (length > (size_t)(ctx->cursor.end - ctx->cursor.pos)) {
+        return SDLOG_EINVAL;
+    }
+
+    ctx->cursor.pos += length;
+
+    return SDLOG_SUCCESS;
+}
+
+static void buffered_destroy(sdlog_istream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    sdlog_free(ctx->buf);
+    memset(ctx, 0, sizeof(context_t));
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t buffered_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    size_t available = ctx->cursor.end - ctx->cursor.pos;
+
+    if (available == 0) {
+        /* Copying large reads through the buffer would not save anything */
+        if (length >= ctx->capacity) {
+            return sdlog_istream_read(ctx->source, data, length, read);
+        }
+
+        SDLOG_CHECK(refill(ctx, read));
+        available = *read;
+    }
+
+    if (available > length) {
+        available = length;
+    }
+
+    memcpy(data, ctx->cursor.pos, available);
+    ctx->cursor.pos += available;
+    *read = available;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t buffered_get_fd(sdlog_istream_t* stream, int* fd)
+{
+    return sdlog_istream_get_fd(CONTEXT_AS(context_t)->source, fd);
+}
+
+static sdlog_error_t buffered_seek(sdlog_istream_t* stream, uint64_t offset)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    SDLOG_CHECK(sdlog_istream_seek(ctx->source, offset));
+    ctx->cursor.pos = ctx->cursor.end = ctx->buf;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t buffered_tell(sdlog_istream_t* stream, uint64_t* offset)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    uint64_t source_offset;
+
+    /* The source is ahead of the reader by the unread part of the buffer */
+    SDLOG_CHECK(sdlog_istream_tell(ctx->source, &source_offset));
+    *offset = source_offset - (ctx->cursor.end - ctx->cursor.pos);
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t buffered_read_at(
+    sdlog_istream_t* stream, uint64_t offset, uint8_t* data, size_t length,
+    size_t* read)
+{
+    return sdlog_istream_read_at(CONTEXT_AS(context_t)->source, offset, data, length, read);
+}
+
+/**
+ * Moves the unread bytes to the front of the buffer and reads as much from
+ * the source stream as fits after them with a single read. The number of
+ * bytes read is returned in \c read.
+ */
+static sdlog_error_t refill(context_t* ctx, size_t* read)
+{
+    size_t used = ctx->cursor.end - ctx->cursor.pos;
+
+    assert(used < ctx->capacity);
+
+    if (ctx->cursor.pos != ctx->buf) {
+        memmove(ctx->buf, ctx->cursor.pos, used);
+        ctx->cursor.pos = ctx->buf;
+        ctx->cursor.end = ctx->buf + used;
+    }
+
+    *read = 0;
+    SDLOG_CHECK(sdlog_istream_read(ctx->source, ctx->buf + used, ctx->capacity - used, read));
+    ctx->cursor.end += *read;
+
+    return SDLOG_SUCCESS;
+}
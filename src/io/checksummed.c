@@ -0,0 +1,463 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sdlog/byteorder.h>
+#include <sdlog/memory.h>
+#include <sdlog/streams.h>
+
+#include "crc32c.h"
+
+/*
+ * Layout of checksummed streams
+ * -----------------------------
+ *
+ * The data is split into blocks, each preceded by a header (little-endian):
+ *
+ *   0  magic "SDCB"
+ *   4  u32  length of the payload after the header
+ *   8  u32  CRC-32C of the payload
+ *   12 u32  CRC-32C of the first 12 bytes of the header
+ *
+ * The checksum of the header lets readers trust the length before reading
+ * the payload, and find the next block after a damaged region by looking
+ * for a valid header.
+ */
+
+#define BLOCK_MAGIC "SDCB"
+#define HEADER_LENGTH 16
+
+/** Default size of the payload of the blocks */
+#define DEFAULT_BLOCK_SIZE (64 * 1024)
+
+/** Largest allowed payload of a block */
+#define MAX_BLOCK_SIZE (16 * 1024 * 1024)
+
+/** Number of bytes that readers request from the source at once */
+#define READ_CHUNK_SIZE (64 * 1024)
+
+typedef struct {
+    /** Header and payload of the block being assembled */
+    uint8_t* block;
+    size_t block_size;
+
+    /** Number of bytes in the payload */
+    size_t used;
+} ostream_context_t;
+
+typedef struct {
+    /** Options of the stream */
+    sdlog_checksummed_istream_options_t options;
+
+    /** Raw data read from the source; the unprocessed bytes are between
+     * \c start and \c end */
+    uint8_t* raw;
+    size_t capacity;
+    size_t start;
+    size_t end;
+
+    /** Whether the source reached its end */
+    bool eof;
+
+    /** Offset of the first unprocessed byte in the source */
+    uint64_t offset;
+
+    /** Payload of the current block in \c raw, and the number of bytes
+     * returned from it so far */
+    const uint8_t* payload;
+    size_t payload_length;
+    size_t payload_pos;
+
+    /** Start of the damaged region being skipped, if any */
+    bool in_damage;
+    uint64_t damage_start;
+
+    /** Number of corrupt blocks or damaged regions found so far */
+    uint64_t corrupt_blocks;
+} istream_context_t;
+
+static void checksummed_destroy_o(sdlog_ostream_t* stream);
+static sdlog_error_t checksummed_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written);
+static sdlog_error_t checksummed_flush(sdlog_ostream_t* stream);
+static sdlog_error_t checksummed_end(sdlog_ostream_t* stream);
+
+static void checksummed_destroy_i(sdlog_istream_t* stream);
+static sdlog_error_t checksummed_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read);
+
+static sdlog_error_t write_block(sdlog_ostream_t* stream);
+static void fill_header(uint8_t* header, const uint8_t* payload, size_t length);
+static bool is_valid_header(const uint8_t* header);
+static sdlog_error_t next_block(sdlog_istream_t* stream);
+static sdlog_error_t fill(sdlog_istream_t* stream, size_t length);
+static sdlog_error_t report_damage(istream_context_t* ctx, uint64_t start, uint64_t length);
+static sdlog_error_t end_damage(istream_context_t* ctx);
+static void consume(istream_context_t* ctx, size_t length);
+
+const sdlog_ostream_spec_t sdlog_ostream_checksummed_methods = {
+    .destroy = checksummed_destroy_o,
+    .write = checksummed_write,
+    .flush = checksummed_flush,
+    .end = checksummed_end,
+};
+
+const sdlog_istream_spec_t sdlog_istream_checksummed_methods = {
+    .destroy = checksummed_destroy_i,
+    .read = checksummed_read,
+};
+
+sdlog_error_t sdlog_ostream_init_checksummed(
+    sdlog_ostream_t* stream, sdlog_ostream_t* target, size_t block_size)
+{
+    ostream_context_t* ctx;
+    sdlog_error_t retval;
+
+    if (block_size == 0) {
+        block_size = DEFAULT_BLOCK_SIZE;
+    } else if (block_size > MAX_BLOCK_SIZE) {
+        return SDLOG_EINVAL;
+    }
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(ostream_context_t)));
+    memset(ctx, 0, sizeof(ostream_context_t));
+
+    ctx->block_size = block_size;
+    ctx->block = sdlog_malloc(HEADER_LENGTH + block_size);
+    if (ctx->block == NULL) {
+        sdlog_free(ctx);
+        return SDLOG_ENOMEM;
+    }
+
+    retval = sdlog_ostream_init_filter(stream, target, &sdlog_ostream_checksummed_methods, ctx);
+    if (retval != SDLOG_SUCCESS) {
+        sdlog_free(ctx->block);
+        sdlog_free(ctx);
+    }
+
+    return retval;
+}
+
+sdlog_error_t sdlog_istream_init_checksummed(
+    sdlog_istream_t* stream, sdlog_istream_t* source,
+    const sdlog_checksummed_istream_options_t* options)
+{
+    istream_context_t* ctx;
+    sdlog_error_t retval;
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(istream_context_t)));
+    memset(ctx, 0, sizeof(istream_context_t));
+
+    if (options) {
+        ctx->options = *options;
+    }
+
+    retval = sdlog_istream_init_filter(stream, source, &sdlog_istream_checksummed_methods, ctx);
+    if (retval != SDLOG_SUCCESS) {
+        sdlog_free(ctx);
+    }
+
+    return retval;
+}
+
+uint64_t sdlog_istream_checksummed_get_corrupt_blocks(sdlog_istream_t* stream)
+{
+    istream_context_t* ctx = (istream_context_t*)sdlog_istream_filter_get_context(stream);
+    return ctx->corrupt_blocks;
+}
+
+static void checksummed_destroy_o(sdlog_ostream_t* stream)
+{
+    ostream_context_t* ctx = (ostream_context_t*)sdlog_ostream_filter_get_context(stream);
+
+    sdlog_free(ctx->block);
+    memset(ctx, 0, sizeof(ostream_context_t));
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t checksummed_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    ostream_context_t* ctx = (ostream_context_t*)sdlog_ostream_filter_get_context(stream);
+    uint8_t header[HEADER_LENGTH];
+    sdlog_iovec_t iov[2];
+    size_t chunk;
+
+    *written = 0;
+
+    while (length > 0) {
+        if (ctx->used == 0 && length >= ctx->block_size) {
+            /* Whole blocks are checksummed and written without copying */
+            fill_header(header, data, ctx->block_size);
+            iov[0].data = header;
+            iov[0].length = HEADER_LENGTH;
+            iov[1].data = data;
+            iov[1].length = ctx->block_size;
+            SDLOG_CHECK(sdlog_ostream_writev_all(sdlog_ostream_filter_get_inner(stream), iov, 2));
+            chunk = ctx->block_size;
+        } else {
+            chunk = ctx->block_size - ctx->used;
+            if (chunk > length) {
+                chunk = length;
+            }
+
+            memcpy(ctx->block + HEADER_LENGTH + ctx->used, data, chunk);
+            ctx->used += chunk;
+
+            if (ctx->used == ctx->block_size) {
+                SDLOG_CHECK(write_block(stream));
+            }
+        }
+
+        data += chunk;
+        length -= chunk;
+        *written += chunk;
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t checksummed_flush(sdlog_ostream_t* stream)
+{
+    SDLOG_CHECK(write_block(stream));
+    return sdlog_ostream_flush(sdlog_ostream_filter_get_inner(stream));
+}
+
+static sdlog_error_t checksummed_end(sdlog_ostream_t* stream)
+{
+    SDLOG_CHECK(write_block(stream));
+    return sdlog_ostream_end_session(sdlog_ostream_filter_get_inner(stream));
+}
+
+static void checksummed_destroy_i(sdlog_istream_t* stream)
+{
+    istream_context_t* ctx = (istream_context_t*)sdlog_istream_filter_get_context(stream);
+
+    sdlog_free(ctx->raw);
+    memset(ctx, 0, sizeof(istream_context_t));
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t checksummed_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read)
+{
+    istream_context_t* ctx = (istream_context_t*)sdlog_istream_filter_get_context(stream);
+    size_t chunk;
+
+    *read = 0;
+
+    while (ctx->payload_pos == ctx->payload_length) {
+        SDLOG_CHECK(next_block(stream));
+    }
+
+    chunk = ctx->payload_length - ctx->payload_pos;
+    if (chunk > length) {
+        chunk = length;
+    }
+
+    memcpy(data, ctx->payload + ctx->payload_pos, chunk);
+    ctx->payload_pos += chunk;
+    *read = chunk;
+
+    return SDLOG_SUCCESS;
+}
+
+/** Writes the block being assembled to the target, if it is not empty */
+static sdlog_error_t write_block(sdlog_ostream_t* stream)
+{
+    ostream_context_t* ctx = (ostream_context_t*)sdlog_ostream_filter_get_context(stream);
+
+    if (ctx->used == 0) {
+        return SDLOG_SUCCESS;
+    }
+
+    fill_header(ctx->block, ctx->block + HEADER_LENGTH, ctx->used);
+    SDLOG_CHECK(sdlog_ostream_filter_write_inner(stream, ctx->block, HEADER_LENGTH + ctx->used, NULL));
+    ctx->used = 0;
+
+    return SDLOG_SUCCESS;
+}
+
+/** Fills the header of a block with the given payload */
+static void fill_header(uint8_t* header, const uint8_t* payload, size_t length)
+{
+    memcpy(header, BLOCK_MAGIC, 4);
+    sdlog_store_u32_le(header + 4, (uint32_t)length);
+    sdlog_store_u32_le(header + 8, sdlog_i_crc32c(0, payload, length));
+    sdlog_store_u32_le(header + 12, sdlog_i_crc32c(0, header, 12));
+}
+
+static bool is_valid_header(const uint8_t* header)
+{
+    return !memcmp(header, BLOCK_MAGIC, 4)
+        && sdlog_load_u32_le(header + 4) <= MAX_BLOCK_SIZE
+        && sdlog_load_u32_le(header + 12) == sdlog_i_crc32c(0, header, 12);
+}
+
+/**
+ * Finds the next intact block in the source and makes it the current block.
+ * Damaged regions and blocks whose payload does not match its checksum are
+ * reported and skipped on the way.
+ */
+static sdlog_error_t next_block(sdlog_istream_t* stream)
+{
+    istream_context_t* ctx = (istream_context_t*)sdlog_istream_filter_get_context(stream);
+    const uint8_t* header;
+    const uint8_t* next;
+    size_t available, length;
+
+    ctx->payload = NULL;
+    ctx->payload_length = ctx->payload_pos = 0;
+
+    while (1) {
+        SDLOG_CHECK(fill(stream, HEADER_LENGTH));
+
+        available = ctx->end - ctx->start;
+        header = ctx->raw + ctx->start;
+
+        if (available == 0) {
+            SDLOG_CHECK(end_damage(ctx));
+            return SDLOG_EOF;
+        }
+
+        if (available < HEADER_LENGTH || !is_valid_header(header)) {
+            /* Skip to the next possible start of a header */
+            if (!ctx->in_damage) {
+                ctx->in_damage = true;
+                ctx->damage_start = ctx->offset;
+            }
+
+            next = available > 1 ? memchr(header + 1, BLOCK_MAGIC[0], available - 1) : NULL;
+            consume(ctx, next ? (size_t)(next - header) : available);
+            continue;
+        }
+
+        length = sdlog_load_u32_le(header + 4);
+        SDLOG_CHECK(fill(stream, HEADER_LENGTH + length));
+
+        /* The buffer may have moved */
+        available = ctx->end - ctx->start;
+        header = ctx->raw + ctx->start;
+
+        if (available < HEADER_LENGTH + length) {
+            /* Truncated block at the end of the source */
+            if (!ctx->in_damage) {
+                ctx->in_damage = true;
+                ctx->damage_start = ctx->offset;
+            }
+            consume(ctx, available);
+            continue;
+        }
+
+        SDLOG_CHECK(end_damage(ctx));
+
+        if (sdlog_load_u32_le(header + 8) != sdlog_i_crc32c(0, header + HEADER_LENGTH, length)) {
+            consume(ctx, HEADER_LENGTH + length);
+            SDLOG_CHECK(report_damage(ctx, ctx->offset - HEADER_LENGTH - length, HEADER_LENGTH + length));
+            continue;
+        }
+
+        ctx->payload = header + HEADER_LENGTH;
+        ctx->payload_length = length;
+        consume(ctx, HEADER_LENGTH + length);
+
+        return SDLOG_SUCCESS;
+    }
+}
+
+/**
+ * Reads from the source until at least the given number of unprocessed bytes
+ * are in the buffer or the source ends.
+ */
+static sdlog_error_t fill(sdlog_istream_t* stream, size_t length)
+{
+    istream_context_t* ctx = (istream_context_t*)sdlog_istream_filter_get_context(stream);
+    sdlog_error_t retval;
+    uint8_t* raw;
+    size_t capacity, read;
+
+    if (ctx->end - ctx->start >= length || ctx->eof) {
+        return SDLOG_SUCCESS;
+    }
+
+    /* Unprocessed bytes are moved to the front to make room */
+    if (ctx->start > 0) {
+        memmove(ctx->raw, ctx->raw + ctx->start, ctx->end - ctx->start);
+        ctx->end -= ctx->start;
+        ctx->start = 0;
+    }
+
+    if (ctx->capacity < length + READ_CHUNK_SIZE) {
+        capacity = length + READ_CHUNK_SIZE;
+        SDLOG_CHECK_OOM(raw = sdlog_realloc(ctx->raw, ctx->capacity, capacity));
+        ctx->raw = raw;
+        ctx->capacity = capacity;
+    }
+
+    while (ctx->end < length) {
+        retval = sdlog_istream_read(sdlog_istream_filter_get_inner(stream), ctx->raw + ctx->end, ctx->capacity - ctx->end, &read);
+        if (retval == SDLOG_EOF) {
+            ctx->eof = true;
+            break;
+        }
+
+        SDLOG_CHECK(retval);
+        ctx->end += read;
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+/** Counts a damaged region and reports it to the handler of the user */
+static sdlog_error_t report_damage(istream_context_t* ctx, uint64_t start, uint64_t length)
+{
+    ctx->corrupt_blocks++;
+
+    if (ctx->options.on_corrupt) {
+        ctx->options.on_corrupt(ctx->options.arg, start, length);
+    }
+
+    return ctx->options.strict ? SDLOG_EREAD : SDLOG_SUCCESS;
+}
+
+/** Reports the damaged region being skipped, if any */
+static sdlog_error_t end_damage(istream_context_t* ctx)
+{
+    if (!ctx->in_damage) {
+        return SDLOG_SUCCESS;
+    }
+
+    ctx->in_damage = false;
+    return report_damage(ctx, ctx->damage_start, ctx->offset - ctx->damage_start);
+}
+
+/** Marks the given number of unprocessed bytes as processed */
+static void consume(istream_context_t* ctx, size_t length)
+{
+    ctx->start += length;
+    ctx->offset += length;
+}
@@ -0,0 +1,235 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sdlog/memory.h>
+#include <sdlog/streams.h>
+
+#include "stream_base.h"
+
+/** Default size of the chunks of chunked buffers */
+#define DEFAULT_CHUNK_SIZE (64 * 1024)
+
+typedef struct {
+    uint8_t* data;
+    size_t used;
+} chunk_t;
+
+typedef struct {
+    /** Chunks holding the data, in order; only the last one may grow */
+    chunk_t* chunks;
+    size_t num_chunks;
+    size_t chunks_capacity;
+
+    /** Size of each chunk */
+    size_t chunk_size;
+
+    /** Total number of bytes in the chunks */
+    size_t size;
+} context_t;
+
+static void chunked_destroy(sdlog_ostream_t* stream);
+static sdlog_error_t chunked_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written);
+static sdlog_error_t chunked_reserve(sdlog_ostream_t* stream, size_t length, uint8_t** ptr);
+static sdlog_error_t chunked_commit(sdlog_ostream_t* stream, size_t length);
+static sdlog_error_t add_chunk(context_t* ctx);
+
+const sdlog_ostream_spec_t sdlog_ostream_chunked_methods = {
+    .destroy = chunked_destroy,
+    .write = chunked_write,
+    .reserve = chunked_reserve,
+    .commit = chunked_commit,
+};
+
+sdlog_error_t sdlog_ostream_init_chunked(sdlog_ostream_t* stream, size_t chunk_size)
+{
+    context_t* ctx;
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(context_t)));
+    memset(ctx, 0, sizeof(context_t));
+
+    ctx->chunk_size = chunk_size > 0 ? chunk_size : DEFAULT_CHUNK_SIZE;
+
+    return sdlog_ostream_init(stream, &sdlog_ostream_chunked_methods, ctx);
+}
+
+size_t sdlog_ostream_chunked_get_size(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    return ctx->size;
+}
+
+size_t sdlog_ostream_chunked_get_iovec(
+    sdlog_ostream_t* stream, sdlog_iovec_t* iov, size_t iovcnt)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    size_t i, count = 0;
+
+    for (i = 0; i < ctx->num_chunks; i++) {
+        if (ctx->chunks[i].used == 0) {
+            continue;
+        }
+
+        if (count < iovcnt) {
+            iov[count].data = ctx->chunks[i].data;
+            iov[count].length = ctx->chunks[i].used;
+        }
+        count++;
+    }
+
+    return count;
+}
+
+sdlog_error_t sdlog_ostream_chunked_write_to(sdlog_ostream_t* stream, sdlog_ostream_t* target)
+{
+    sdlog_iovec_t* iov;
+    size_t iovcnt;
+    sdlog_error_t retval;
+
+    iovcnt = sdlog_ostream_chunked_get_iovec(stream, NULL, 0);
+    if (iovcnt == 0) {
+        return SDLOG_SUCCESS;
+    }
+
+    SDLOG_CHECK_OOM(iov = sdlog_malloc(iovcnt * sizeof(sdlog_iovec_t)));
+    sdlog_ostream_chunked_get_iovec(stream, iov, iovcnt);
+    retval = sdlog_ostream_writev_all(target, iov, iovcnt);
+    sdlog_free(iov);
+
+    return retval;
+}
+
+static void chunked_destroy(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    size_t i;
+
+    for (i = 0; i < ctx->num_chunks; i++) {
+        sdlog_free(ctx->chunks[i].data);
+    }
+
+    sdlog_free(ctx->chunks);
+    memset(ctx, 0, sizeof(context_t));
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t chunked_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    chunk_t* chunk;
+    size_t to_copy;
+
+    *written = 0;
+
+    while (length > 0) {
+        if (ctx->num_chunks == 0 || ctx->chunks[ctx->num_chunks - 1].used == ctx->chunk_size) {
+            SDLOG_CHECK(add_chunk(ctx));
+        }
+
+        chunk = &ctx->chunks[ctx->num_chunks - 1];
+        to_copy = ctx->chunk_size - chunk->used;
+        if (to_copy > length) {
+            to_copy = length;
+        }
+
+        memcpy(chunk->data + chunk->used, data, to_copy);
+        chunk->used += to_copy;
+        ctx->size += to_copy;
+        data += to_copy;
+        length -= to_copy;
+        *written += to_copy;
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t chunked_reserve(sdlog_ostream_t* stream, size_t length, uint8_t** ptr)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    chunk_t* chunk;
+
+    if (length > ctx->chunk_size) {
+        return SDLOG_ELIMIT;
+    }
+
+    /* Reserved regions never span chunks; the rest of the last chunk is left
+     * unused if the region does not fit in it */
+    if (ctx->num_chunks == 0 || ctx->chunk_size - ctx->chunks[ctx->num_chunks - 1].used < length) {
+        SDLOG_CHECK(add_chunk(ctx));
+    }
+
+    chunk = &ctx->chunks[ctx->num_chunks - 1];
+    *ptr = chunk->data + chunk->used;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t chunked_commit(sdlog_ostream_t* stream, size_t length)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    chunk_t* chunk;
+
+    if (length == 0) {
+        return SDLOG_SUCCESS;
+    }
+
+    chunk = &ctx->chunks[ctx->num_chunks - 1];
+    assert(chunk->used + length <= ctx->chunk_size);
+    chunk->used += length;
+    ctx->size += length;
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Appends a new, empty chunk to the end of the chunk list. Only the array of
+ * chunk descriptors is ever reallocated; the data in the chunks never moves.
+ */
+static sdlog_error_t add_chunk(context_t* ctx)
+{
+    chunk_t* chunks;
+    size_t new_capacity;
+    uint8_t* data;
+
+    if (ctx->num_chunks == ctx->chunks_capacity) {
+        new_capacity = ctx->chunks_capacity ? ctx->chunks_capacity * 2 : 16;
+        SDLOG_CHECK_OOM(chunks = sdlog_realloc(
+                            ctx->chunks, ctx->chunks_capacity * sizeof(chunk_t),
+                            new_capacity * sizeof(chunk_t)));
+        ctx->chunks = chunks;
+        ctx->chunks_capacity = new_capacity;
+    }
+
+    SDLOG_CHECK_OOM(data = sdlog_malloc(ctx->chunk_size));
+    ctx->chunks[ctx->num_chunks].data = data;
+    ctx->chunks[ctx->num_chunks].used = 0;
+    ctx->num_chunks++;
+
+    return SDLOG_SUCCESS;
+}
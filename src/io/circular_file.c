@@ -0,0 +1,653 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sdlog/byteorder.h>
+#include <sdlog/memory.h>
+#include <sdlog/streams.h>
+
+#include "config.h"
+#include "framer.h"
+#include "stream_base.h"
+
+#if HAVE_UNISTD_H
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Layout of circular log files
+ * ----------------------------
+ *
+ * The file is divided into blocks of equal size. The first block holds the
+ * file header; the remaining ones are data blocks that are filled in a
+ * circular manner. Each data block starts with a block header, followed by
+ * the FMT records of all the formats known at the time the block was
+ * started, and then by complete log records. Records never span blocks, so
+ * every block can be decoded on its own.
+ *
+ * File header (little-endian):
+ *
+ *   0  magic "SDLC"
+ *   4  u32  version of the layout (1)
+ *   8  u32  size of a block, in bytes
+ *   12 u32  number of data blocks
+ *   16 u32  index of the oldest valid data block
+ *   20 u32  reserved, zero
+ *   24 u64  sequence number of the oldest valid data block
+ *
+ * Data block header (little-endian):
+ *
+ *   0  magic "SDLB"
+ *   4  u32  number of bytes used in the block after the header
+ *   8  u64  sequence number of the block
+ *
+ * Sequence numbers increase by one for each new block. Readers start from
+ * the oldest block and stop at the first block whose sequence number does
+ * not follow the previous one.
+ */
+
+#define FILE_MAGIC "SDLC"
+#define BLOCK_MAGIC "SDLB"
+#define FILE_VERSION 1
+#define FILE_HEADER_LENGTH 32
+#define BLOCK_HEADER_LENGTH 16
+
+/** Default size of the blocks of circular log files */
+#define DEFAULT_BLOCK_SIZE (64 * 1024)
+
+/** Smallest allowed block size */
+#define MIN_BLOCK_SIZE 512
+
+#if HAVE_UNISTD_H
+
+typedef struct {
+    /** The file descriptor of the file; owned by the stream */
+    int fd;
+
+    /** Size of a block */
+    uint32_t block_size;
+
+    /** Number of data blocks in the file */
+    uint32_t num_blocks;
+
+    /** Number of data blocks holding valid data */
+    uint32_t num_valid;
+
+    /** Index of the oldest valid data block */
+    uint32_t oldest_index;
+
+    /** Sequence number of the oldest valid data block */
+    uint64_t oldest_seq;
+
+    /** Index of the data block being filled */
+    uint32_t current_index;
+
+    /** Sequence number of the data block being filled */
+    uint64_t current_seq;
+
+    /** Contents of the data block being filled, including its header */
+    uint8_t* block;
+
+    /** Number of bytes used in \c block, including the header */
+    size_t block_used;
+
+    /** Whether \c current_index and \c current_seq refer to a block that was
+     * already started; if not, they refer to the first block to fill */
+    bool has_block;
+
+    /** Whether \c block has data not written to the file yet */
+    bool dirty;
+
+    /** Framer that splits the incoming bytes into records */
+    sdlog_i_framer_t framer;
+
+    /** The most recent FMT record for each message ID */
+    sdlog_i_format_table_t* formats;
+
+    /** Number of message IDs with an FMT record in \c formats */
+    size_t num_formats;
+} ostream_context_t;
+
+typedef struct {
+    /** The file descriptor of the file; owned by the stream */
+    int fd;
+
+    /** Size of a block */
+    uint32_t block_size;
+
+    /** Number of data blocks in the file */
+    uint32_t num_blocks;
+
+    /** Number of data blocks not visited yet */
+    uint32_t remaining;
+
+    /** Index of the next data block to read */
+    uint32_t next_index;
+
+    /** Expected sequence number of the next data block */
+    uint64_t next_seq;
+
+    /** Data of the current block, without the header */
+    uint8_t* data;
+
+    /** Number of valid bytes in \c data */
+    size_t length;
+
+    /** Number of bytes in \c data already returned to the reader */
+    size_t consumed;
+} istream_context_t;
+
+static void circular_destroy_o(sdlog_ostream_t* stream);
+static sdlog_error_t circular_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written);
+static sdlog_error_t circular_flush(sdlog_ostream_t* stream);
+
+static void circular_destroy_i(sdlog_istream_t* stream);
+static sdlog_error_t circular_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read);
+
+static sdlog_error_t store_record(void* arg, const uint8_t* record, size_t length);
+static bool formats_fit(size_t block_size, size_t num_formats);
+static sdlog_error_t start_block(ostream_context_t* ctx);
+static sdlog_error_t write_block(ostream_context_t* ctx);
+static sdlog_error_t write_file_header(ostream_context_t* ctx);
+static sdlog_error_t recover(ostream_context_t* ctx);
+static bool parse_file_header(
+    const uint8_t* header, uint32_t* block_size, uint32_t* num_blocks,
+    uint32_t* oldest_index, uint64_t* oldest_seq);
+static bool read_block_header(
+    int fd, uint32_t block_size, uint32_t index, uint64_t seq, uint32_t* used);
+static sdlog_error_t read_at(int fd, uint8_t* data, size_t length, off_t pos);
+static sdlog_error_t write_at(int fd, const uint8_t* data, size_t length, off_t pos);
+
+const sdlog_ostream_spec_t sdlog_ostream_circular_file_methods = {
+    .destroy = circular_destroy_o,
+    .write = circular_write,
+    .flush = circular_flush,
+    .end = circular_flush,
+};
+
+const sdlog_istream_spec_t sdlog_istream_circular_file_methods = {
+    .destroy = circular_destroy_i,
+    .read = circular_read,
+};
+
+sdlog_error_t sdlog_ostream_init_circular_file(
+    sdlog_ostream_t* stream, const char* path, uint64_t file_size, size_t block_size)
+{
+    ostream_context_t* ctx;
+    uint64_t num_blocks;
+    sdlog_error_t retval;
+
+    if (block_size == 0) {
+        block_size = DEFAULT_BLOCK_SIZE;
+    }
+
+    if (block_size < MIN_BLOCK_SIZE || block_size > UINT32_MAX || !formats_fit(block_size, 1)) {
+        return SDLOG_EINVAL;
+    }
+
+    /* One block for the header and at least two data blocks so that the
+     * oldest one can be overwritten while the newest one is still valid */
+    num_blocks = file_size / block_size;
+    if (num_blocks < 3 || num_blocks - 1 > UINT32_MAX) {
+        return SDLOG_EINVAL;
+    }
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(ostream_context_t)));
+    memset(ctx, 0, sizeof(ostream_context_t));
+
+    ctx->block_size = (uint32_t)block_size;
+    ctx->num_blocks = (uint32_t)(num_blocks - 1);
+    sdlog_i_framer_init(&ctx->framer);
+
+    ctx->block = sdlog_malloc(block_size);
+    ctx->formats = sdlog_malloc(sizeof(sdlog_i_format_table_t));
+    if (ctx->block == NULL || ctx->formats == NULL) {
+        retval = SDLOG_ENOMEM;
+        goto fail;
+    }
+    memset(ctx->formats, 0, sizeof(sdlog_i_format_table_t));
+
+    ctx->fd = open(path, O_RDWR | O_CREAT, 0666);
+    if (ctx->fd < 0) {
+        retval = SDLOG_EIO;
+        goto fail;
+    }
+
+    retval = recover(ctx);
+    if (retval != SDLOG_SUCCESS) {
+        close(ctx->fd);
+        goto fail;
+    }
+
+    return sdlog_ostream_init(stream, &sdlog_ostream_circular_file_methods, ctx);
+
+fail:
+    sdlog_free(ctx->block);
+    sdlog_free(ctx->formats);
+    sdlog_free(ctx);
+    return retval;
+}
+
+sdlog_error_t sdlog_istream_init_circular_file(sdlog_istream_t* stream, const char* path)
+{
+    istream_context_t* ctx;
+    uint8_t header[FILE_HEADER_LENGTH];
+    uint32_t block_size, num_blocks, oldest_index;
+    uint64_t oldest_seq;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return SDLOG_EIO;
+    }
+
+    if (read_at(fd, header, FILE_HEADER_LENGTH, 0) != SDLOG_SUCCESS
+        || !parse_file_header(header, &block_size, &num_blocks, &oldest_index, &oldest_seq)) {
+        close(fd);
+        return SDLOG_EREAD;
+    }
+
+    ctx = sdlog_malloc(sizeof(istream_context_t));
+    if (ctx == NULL) {
+        close(fd);
+        return SDLOG_ENOMEM;
+    }
+    memset(ctx, 0, sizeof(istream_context_t));
+
+    ctx->data = sdlog_malloc(block_size);
+    if (ctx->data == NULL) {
+        close(fd);
+        sdlog_free(ctx);
+        return SDLOG_ENOMEM;
+    }
+
+    ctx->fd = fd;
+    ctx->block_size = block_size;
+    ctx->num_blocks = num_blocks;
+    ctx->remaining = num_blocks;
+    ctx->next_index = oldest_index;
+    ctx->next_seq = oldest_seq;
+
+    return sdlog_istream_init(stream, &sdlog_istream_circular_file_methods, ctx);
+}
+
+static void circular_destroy_o(sdlog_ostream_t* stream)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+
+    circular_flush(stream);
+    close(ctx->fd);
+
+    sdlog_free(ctx->block);
+    sdlog_free(ctx->formats);
+    memset(ctx, 0, sizeof(ostream_context_t));
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t circular_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+
+    SDLOG_CHECK(sdlog_i_framer_feed(&ctx->framer, data, length, store_record, ctx));
+    *written = length;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t circular_flush(sdlog_ostream_t* stream)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+    return ctx->dirty ? write_block(ctx) : SDLOG_SUCCESS;
+}
+
+static void circular_destroy_i(sdlog_istream_t* stream)
+{
+    istream_context_t* ctx = CONTEXT_AS(istream_context_t);
+
+    close(ctx->fd);
+    sdlog_free(ctx->data);
+    memset(ctx, 0, sizeof(istream_context_t));
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t circular_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read)
+{
+    istream_context_t* ctx = CONTEXT_AS(istream_context_t);
+    off_t pos;
+    uint32_t used;
+
+    while (ctx->consumed == ctx->length) {
+        if (ctx->remaining == 0
+            || !read_block_header(ctx->fd, ctx->block_size, ctx->next_index, ctx->next_seq, &used)) {
+            *read = 0;
+            return SDLOG_EOF;
+        }
+
+        pos = ((off_t)ctx->next_index + 1) * ctx->block_size + BLOCK_HEADER_LENGTH;
+        SDLOG_CHECK(read_at(ctx->fd, ctx->data, used, pos));
+
+        ctx->length = used;
+        ctx->consumed = 0;
+        ctx->remaining--;
+        ctx->next_index = (ctx->next_index + 1) % ctx->num_blocks;
+        ctx->next_seq++;
+    }
+
+    if (length > ctx->length - ctx->consumed) {
+        length = ctx->length - ctx->consumed;
+    }
+
+    memcpy(data, ctx->data + ctx->consumed, length);
+    ctx->consumed += length;
+    *read = length;
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Appends a complete record to the current block, starting a new block if
+ * the record does not fit. FMT records of new message IDs are rejected
+ * before anything is changed if the FMT records of the known formats would
+ * not leave room for a record of any size in a new block.
+ */
+static sdlog_error_t store_record(void* arg, const uint8_t* record, size_t length)
+{
+    ostream_context_t* ctx = (ostream_context_t*)arg;
+    bool is_new_format;
+
+    is_new_format = sdlog_i_record_is_fmt(record, length) && !ctx->formats->present[record[3]];
+    if (is_new_format && !formats_fit(ctx->block_size, ctx->num_formats + 1)) {
+        return SDLOG_ELIMIT;
+    }
+
+    /* The record fits in a new block since the known FMT records leave room
+     * for a record of any size */
+    if (!ctx->has_block || ctx->block_used + length > ctx->block_size) {
+        SDLOG_CHECK(start_block(ctx));
+    }
+
+    memcpy(ctx->block + ctx->block_used, record, length);
+    ctx->block_used += length;
+    ctx->dirty = true;
+
+    /* Remembered only now so that a block does not start with an FMT record
+     * that is then repeated right after the other FMT records */
+    sdlog_i_format_table_remember(ctx->formats, record, length);
+    if (is_new_format) {
+        ctx->num_formats++;
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Returns whether a block can hold the FMT records of the given number of
+ * formats and a record of the largest possible size after them.
+ */
+static bool formats_fit(size_t block_size, size_t num_formats)
+{
+    return BLOCK_HEADER_LENGTH + num_formats * SDLOG_I_FMT_RECORD_LENGTH + SDLOG_MAX_MESSAGE_LENGTH
+        <= block_size;
+}
+
+/**
+ * Finishes the current block and starts a new one, overwriting the oldest
+ * block if all the blocks are in use. The new block starts with the FMT
+ * records of all the known formats.
+ */
+static sdlog_error_t start_block(ostream_context_t* ctx)
+{
+    int i;
+
+    if (ctx->has_block) {
+        if (ctx->dirty) {
+            SDLOG_CHECK(write_block(ctx));
+        }
+        ctx->current_index = (ctx->current_index + 1) % ctx->num_blocks;
+        ctx->current_seq++;
+    }
+
+    if (ctx->num_valid == ctx->num_blocks) {
+        /* Move the oldest block pointer out of the way before the block is
+         * overwritten */
+        ctx->oldest_index = (ctx->oldest_index + 1) % ctx->num_blocks;
+        ctx->oldest_seq++;
+        SDLOG_CHECK(write_file_header(ctx));
+    } else {
+        ctx->num_valid++;
+    }
+
+    ctx->has_block = true;
+    ctx->block_used = BLOCK_HEADER_LENGTH;
+    for (i = 0; i < SDLOG_NUM_MESSAGE_FORMATS; i++) {
+        if (ctx->formats->present[i]) {
+            memcpy(ctx->block + ctx->block_used, ctx->formats->records[i], SDLOG_I_FMT_RECORD_LENGTH);
+            ctx->block_used += SDLOG_I_FMT_RECORD_LENGTH;
+        }
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+/** Writes the current block to the file */
+static sdlog_error_t write_block(ostream_context_t* ctx)
+{
+    memcpy(ctx->block, BLOCK_MAGIC, 4);
+    sdlog_store_u32_le(ctx->block + 4, (uint32_t)(ctx->block_used - BLOCK_HEADER_LENGTH));
+    sdlog_store_u64_le(ctx->block + 8, ctx->current_seq);
+
+    SDLOG_CHECK(write_at(
+        ctx->fd, ctx->block, ctx->block_used,
+        ((off_t)ctx->current_index + 1) * ctx->block_size));
+
+    ctx->dirty = false;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t write_file_header(ostream_context_t* ctx)
+{
+    uint8_t header[FILE_HEADER_LENGTH];
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, FILE_MAGIC, 4);
+    sdlog_store_u32_le(header + 4, FILE_VERSION);
+    sdlog_store_u32_le(header + 8, ctx->block_size);
+    sdlog_store_u32_le(header + 12, ctx->num_blocks);
+    sdlog_store_u32_le(header + 16, ctx->oldest_index);
+    sdlog_store_u64_le(header + 24, ctx->oldest_seq);
+
+    return write_at(ctx->fd, header, FILE_HEADER_LENGTH, 0);
+}
+
+/**
+ * Picks up the state of an existing circular log file with the same layout,
+ * or initializes a new one. New data is always written to a new block after
+ * the newest valid block in the file.
+ */
+static sdlog_error_t recover(ostream_context_t* ctx)
+{
+    uint8_t header[FILE_HEADER_LENGTH];
+    uint32_t block_size, num_blocks, oldest_index, used, index;
+    uint64_t oldest_seq, file_size = (uint64_t)(ctx->num_blocks + 1) * ctx->block_size;
+
+    if (read_at(ctx->fd, header, FILE_HEADER_LENGTH, 0) == SDLOG_SUCCESS
+        && parse_file_header(header, &block_size, &num_blocks, &oldest_index, &oldest_seq)
+        && block_size == ctx->block_size && num_blocks == ctx->num_blocks) {
+        ctx->oldest_index = oldest_index;
+        ctx->oldest_seq = oldest_seq;
+
+        index = oldest_index;
+        while (ctx->num_valid < num_blocks
+            && read_block_header(ctx->fd, block_size, index, oldest_seq + ctx->num_valid, &used)) {
+            ctx->num_valid++;
+            index = (index + 1) % num_blocks;
+        }
+
+        /* Pretend that the newest block is full so the next record starts
+         * a new block after it */
+        if (ctx->num_valid > 0) {
+            ctx->current_index = (oldest_index + ctx->num_valid - 1) % num_blocks;
+            ctx->current_seq = oldest_seq + ctx->num_valid - 1;
+            ctx->block_used = ctx->block_size;
+            ctx->has_block = true;
+        } else {
+            ctx->current_index = oldest_index;
+            ctx->current_seq = oldest_seq;
+        }
+
+        return SDLOG_SUCCESS;
+    }
+
+    /* Start from scratch; the file is zeroed so that no stale block can be
+     * mistaken for a valid one */
+    if (ftruncate(ctx->fd, 0) < 0 || ftruncate(ctx->fd, file_size) < 0) {
+        return SDLOG_EIO;
+    }
+
+#if HAVE_POSIX_FALLOCATE
+    /* Reserve the space upfront so that the file never grows afterwards;
+     * failures are not fatal */
+    (void)posix_fallocate(ctx->fd, 0, file_size);
+#endif
+
+    ctx->oldest_index = 0;
+    ctx->oldest_seq = 1;
+    ctx->current_index = 0;
+    ctx->current_seq = 1;
+
+    return write_file_header(ctx);
+}
+
+static bool parse_file_header(
+    const uint8_t* header, uint32_t* block_size, uint32_t* num_blocks,
+    uint32_t* oldest_index, uint64_t* oldest_seq)
+{
+    if (memcmp(header, FILE_MAGIC, 4) != 0 || sdlog_load_u32_le(header + 4) != FILE_VERSION) {
+        return false;
+    }
+
+    *block_size = sdlog_load_u32_le(header + 8);
+    *num_blocks = sdlog_load_u32_le(header + 12);
+    *oldest_index = sdlog_load_u32_le(header + 16);
+    *oldest_seq = sdlog_load_u64_le(header + 24);
+
+    return *block_size >= MIN_BLOCK_SIZE && *num_blocks > 0 && *oldest_index < *num_blocks;
+}
+
+/**
+ * Reads the header of a data block and checks whether it is a valid block
+ * with the given sequence number.
+ */
+static bool read_block_header(
+    int fd, uint32_t block_size, uint32_t index, uint64_t seq, uint32_t* used)
+{
+    uint8_t header[BLOCK_HEADER_LENGTH];
+
+    if (read_at(fd, header, BLOCK_HEADER_LENGTH, ((off_t)index + 1) * block_size) != SDLOG_SUCCESS) {
+        return false;
+    }
+
+    *used = sdlog_load_u32_le(header + 4);
+
+    return memcmp(header, BLOCK_MAGIC, 4) == 0
+        && sdlog_load_u64_le(header + 8) == seq
+        && *used <= block_size - BLOCK_HEADER_LENGTH;
+}
+
+/** Reads exactly the given number of bytes from the given file offset */
+static sdlog_error_t read_at(int fd, uint8_t* data, size_t length, off_t pos)
+{
+    ssize_t result;
+
+    while (length > 0) {
+        result = pread(fd, data, length, pos);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return SDLOG_EREAD;
+        } else if (result == 0) {
+            return SDLOG_EOF;
+        }
+
+        data += result;
+        length -= result;
+        pos += result;
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+/** Writes the whole buffer at the given file offset */
+static sdlog_error_t write_at(int fd, const uint8_t* data, size_t length, off_t pos)
+{
+    ssize_t result;
+
+    while (length > 0) {
+        result = pwrite(fd, data, length, pos);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return SDLOG_EWRITE;
+        } else if (result == 0) {
+            return SDLOG_EWRITE;
+        }
+
+        data += result;
+        length -= result;
+        pos += result;
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+#else
+
+const sdlog_ostream_spec_t sdlog_ostream_circular_file_methods = { 0 };
+const sdlog_istream_spec_t sdlog_istream_circular_file_methods = { 0 };
+
+sdlog_error_t sdlog_ostream_init_circular_file(
+    sdlog_ostream_t* stream, const char* path, uint64_t file_size, size_t block_size)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+sdlog_error_t sdlog_istream_init_circular_file(sdlog_istream_t* stream, const char* path)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+#endif
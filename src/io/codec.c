@@ -0,0 +1,352 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "codec.h"
+#include "config.h"
+
+#if HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#if HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/* The built-in LZ codec produces blocks in the LZ4 block format. Each
+ * sequence starts with a token whose upper four bits hold the number of
+ * literals and whose lower four bits hold the match length minus four, with
+ * 15 meaning that more length bytes follow. The literals come next, then the
+ * two-byte little-endian offset of the match and the remaining length bytes
+ * of the match. The last sequence holds literals only. */
+
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+
+/* The last five bytes of a block are always literals, and the last match
+ * starts at least twelve bytes before the end, as required by LZ4 */
+#define LZ_LAST_LITERALS 5
+#define LZ_MATCH_FIND_LIMIT 12
+
+/* Misses are counted in units of 2^LZ_SKIP_SHIFT; the compressor steps
+ * faster over data that does not seem to compress */
+#define LZ_SKIP_SHIFT 5
+
+static size_t lz_compress(
+    const uint8_t* src, size_t length, uint8_t* dst, uint32_t* table);
+static sdlog_error_t lz_decompress(
+    const uint8_t* src, size_t compressed_length, uint8_t* dst, size_t length);
+
+int sdlog_i_codec_is_available(sdlog_i_codec_t codec)
+{
+    switch (codec) {
+    case SDLOG_I_CODEC_NONE:
+    case SDLOG_I_CODEC_LZ:
+        return 1;
+
+    case SDLOG_I_CODEC_LZ4:
+        return HAVE_LZ4;
+
+    case SDLOG_I_CODEC_ZSTD:
+        return HAVE_ZSTD;
+
+    default:
+        return 0;
+    }
+}
+
+size_t sdlog_i_codec_bound(sdlog_i_codec_t codec, size_t length)
+{
+    switch (codec) {
+#if HAVE_LZ4
+    case SDLOG_I_CODEC_LZ4:
+        return LZ4_compressBound((int)length);
+#endif
+
+#if HAVE_ZSTD
+    case SDLOG_I_CODEC_ZSTD:
+        return ZSTD_compressBound(length);
+#endif
+
+    case SDLOG_I_CODEC_LZ:
+        return length + length / 255 + 16;
+
+    default:
+        return length;
+    }
+}
+
+sdlog_error_t sdlog_i_codec_compress(
+    sdlog_i_codec_t codec, int level, const uint8_t* src, size_t length,
+    uint8_t* dst, size_t capacity, size_t* compressed_length,
+    uint32_t* workspace)
+{
+    (void)level;
+
+    if (capacity < sdlog_i_codec_bound(codec, length)) {
+        return SDLOG_EINVAL;
+    }
+
+    switch (codec) {
+    case SDLOG_I_CODEC_NONE:
+        memcpy(dst, src, length);
+        *compressed_length = length;
+        return SDLOG_SUCCESS;
+
+    case SDLOG_I_CODEC_LZ:
+        *compressed_length = lz_compress(src, length, dst, workspace);
+        return SDLOG_SUCCESS;
+
+#if HAVE_LZ4
+    case SDLOG_I_CODEC_LZ4: {
+        int result = LZ4_compress_default(
+            (const char*)src, (char*)dst, (int)length, (int)capacity);
+        if (result <= 0) {
+            return SDLOG_FAILURE;
+        }
+        *compressed_length = result;
+        return SDLOG_SUCCESS;
+    }
+#endif
+
+#if HAVE_ZSTD
+    case SDLOG_I_CODEC_ZSTD: {
+        size_t result = ZSTD_compress(dst, capacity, src, length, level);
+        if (ZSTD_isError(result)) {
+            return SDLOG_FAILURE;
+        }
+        *compressed_length = result;
+        return SDLOG_SUCCESS;
+    }
+#endif
+
+    default:
+        return SDLOG_UNIMPLEMENTED;
+    }
+}
+
+sdlog_error_t sdlog_i_codec_decompress(
+    sdlog_i_codec_t codec, const uint8_t* src, size_t compressed_length,
+    uint8_t* dst, size_t length)
+{
+    switch (codec) {
+    case SDLOG_I_CODEC_NONE:
+        if (compressed_length != length) {
+            return SDLOG_EREAD;
+        }
+        memcpy(dst, src, length);
+        return SDLOG_SUCCESS;
+
+    case SDLOG_I_CODEC_LZ:
+        return lz_decompress(src, compressed_length, dst, length);
+
+#if HAVE_LZ4
+    case SDLOG_I_CODEC_LZ4: {
+        int result = LZ4_decompress_safe(
+            (const char*)src, (char*)dst, (int)compressed_length, (int)length);
+        return result == (int)length ? SDLOG_SUCCESS : SDLOG_EREAD;
+    }
+#endif
+
+#if HAVE_ZSTD
+    case SDLOG_I_CODEC_ZSTD: {
+        size_t result = ZSTD_decompress(dst, length, src, compressed_length);
+        return !ZSTD_isError(result) && result == length ? SDLOG_SUCCESS : SDLOG_EREAD;
+    }
+#endif
+
+    default:
+        return SDLOG_UNIMPLEMENTED;
+    }
+}
+
+/* ************************************************************************** */
+
+static inline uint32_t lz_read32(const uint8_t* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t lz_hash(uint32_t value)
+{
+    return (value * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+static uint8_t* lz_write_length(uint8_t* op, size_t length)
+{
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+static uint8_t* lz_write_literals(uint8_t* op, uint8_t token, const uint8_t* literals, size_t length)
+{
+    *op++ = token | (uint8_t)((length < 15 ? length : 15) << 4);
+    if (length >= 15) {
+        op = lz_write_length(op, length - 15);
+    }
+    memcpy(op, literals, length);
+    return op + length;
+}
+
+static size_t lz_compress(
+    const uint8_t* src, size_t length, uint8_t* dst, uint32_t* table)
+{
+    const uint8_t* ip = src;
+    const uint8_t* anchor = src;
+    const uint8_t* end = src + length;
+    const uint8_t* match_limit = length > LZ_MATCH_FIND_LIMIT ? end - LZ_MATCH_FIND_LIMIT : src;
+    const uint8_t* ref;
+    uint8_t* op = dst;
+    uint32_t value, hash;
+    size_t match_length, step, misses = 0;
+
+    memset(table, 0, SDLOG_I_LZ_HASH_SIZE * sizeof(uint32_t));
+
+    while (ip < match_limit) {
+        value = lz_read32(ip);
+        hash = lz_hash(value);
+        ref = src + table[hash];
+        table[hash] = (uint32_t)(ip - src);
+
+        if (ref >= ip || ip - ref > LZ_MAX_OFFSET || lz_read32(ref) != value) {
+            step = 1 + (misses++ >> LZ_SKIP_SHIFT);
+            if (step >= (size_t)(match_limit - ip)) {
+                break;
+            }
+            ip += step;
+            continue;
+        }
+
+        match_length = LZ_MIN_MATCH;
+        while (ip + match_length < end - LZ_LAST_LITERALS && ref[match_length] == ip[match_length]) {
+            match_length++;
+        }
+
+        match_length -= LZ_MIN_MATCH;
+        op = lz_write_literals(op, match_length < 15 ? match_length : 15, anchor, ip - anchor);
+        *op++ = (uint8_t)((ip - ref) & 0xff);
+        *op++ = (uint8_t)((ip - ref) >> 8);
+        if (match_length >= 15) {
+            op = lz_write_length(op, match_length - 15);
+        }
+
+        ip += match_length + LZ_MIN_MATCH;
+        anchor = ip;
+        misses = 0;
+    }
+
+    op = lz_write_literals(op, 0, anchor, end - anchor);
+    return op - dst;
+}
+
+static sdlog_error_t lz_read_length(const uint8_t** ip, const uint8_t* end, size_t* length)
+{
+    uint8_t byte;
+
+    do {
+        if (*ip >= end) {
+            return SDLOG_EREAD;
+        }
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 255);
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t lz_decompress(
+    const uint8_t* src, size_t compressed_length, uint8_t* dst, size_t length)
+{
+    const uint8_t* ip = src;
+    const uint8_t* end = src + compressed_length;
+    uint8_t* op = dst;
+    uint8_t* op_end = dst + length;
+    const uint8_t* ref;
+    uint8_t token;
+    size_t literal_length, match_length, offset, i;
+
+    while (1) {
+        if (ip >= end) {
+            return SDLOG_EREAD;
+        }
+
+        token = *ip++;
+
+        literal_length = token >> 4;
+        if (literal_length == 15) {
+            SDLOG_CHECK(lz_read_length(&ip, end, &literal_length));
+        }
+        if (literal_length > (size_t)(end - ip) || literal_length > (size_t)(op_end - op)) {
+            return SDLOG_EREAD;
+        }
+
+        memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+
+        if (ip == end) {
+            break;
+        }
+
+        if (end - ip < 2) {
+            return SDLOG_EREAD;
+        }
+
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) {
+            return SDLOG_EREAD;
+        }
+
+        match_length = token & 0x0f;
+        if (match_length == 15) {
+            SDLOG_CHECK(lz_read_length(&ip, end, &match_length));
+        }
+        match_length += LZ_MIN_MATCH;
+        if (match_length > (size_t)(op_end - op)) {
+            return SDLOG_EREAD;
+        }
+
+        /* Matches may overlap the bytes they produce */
+        if (offset >= match_length) {
+            memcpy(op, op - offset, match_length);
+        } else {
+            ref = op - offset;
+            for (i = 0; i < match_length; i++) {
+                op[i] = ref[i];
+            }
+        }
+        op += match_length;
+    }
+
+    return op == op_end ? SDLOG_SUCCESS : SDLOG_EREAD;
+}
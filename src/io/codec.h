@@ -0,0 +1,89 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SDLOG_CODEC_H
+#define SDLOG_CODEC_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <sdlog/decls.h>
+#include <sdlog/error.h>
+
+/**
+ * @file codec.h
+ * @brief Internal block compression codecs
+ *
+ * Compressed streams compress independent blocks of data with one of the
+ * codecs below. The built-in LZ codec is always available; it uses the LZ4
+ * block format, so it trades compression ratio for speed. LZ4 and zstd are
+ * used through their own libraries when those were found at build time.
+ */
+
+__BEGIN_DECLS
+
+/** Identifiers of the codecs, as stored in compressed blocks */
+typedef enum {
+    SDLOG_I_CODEC_NONE = 0,
+    SDLOG_I_CODEC_LZ = 1,
+    SDLOG_I_CODEC_LZ4 = 2,
+    SDLOG_I_CODEC_ZSTD = 3
+} sdlog_i_codec_t;
+
+/** Number of entries in the hash table of the built-in LZ compressor */
+#define SDLOG_I_LZ_HASH_SIZE 4096
+
+/**
+ * Returns whether the given codec is available in this build.
+ */
+int sdlog_i_codec_is_available(sdlog_i_codec_t codec);
+
+/**
+ * Returns the size of the output buffer needed to compress the given number
+ * of bytes in the worst case.
+ */
+size_t sdlog_i_codec_bound(sdlog_i_codec_t codec, size_t length);
+
+/**
+ * Compresses a block of data. The output buffer must be at least as large as
+ * the bound returned by \c sdlog_i_codec_bound(). \c workspace must point to
+ * \c SDLOG_I_LZ_HASH_SIZE integers; it is used by the built-in LZ codec only.
+ */
+sdlog_error_t sdlog_i_codec_compress(
+    sdlog_i_codec_t codec, int level, const uint8_t* src, size_t length,
+    uint8_t* dst, size_t capacity, size_t* compressed_length,
+    uint32_t* workspace);
+
+/**
+ * Decompresses a block of data. The block must decompress into exactly
+ * \c length bytes; malformed blocks are rejected with \c SDLOG_EREAD without
+ * reading or writing outside the buffers.
+ */
+sdlog_error_t sdlog_i_codec_decompress(
+    sdlog_i_codec_t codec, const uint8_t* src, size_t compressed_length,
+    uint8_t* dst, size_t length);
+
+__END_DECLS
+
+#endif
@@ -0,0 +1,1306 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sdlog/byteorder.h>
+#include <sdlog/memory.h>
+#include <sdlog/streams.h>
+
+#include "codec.h"
+#include "config.h"
+#include "framer.h"
+#include "stream_base.h"
+
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+/*
+ * Layout of compressed log containers
+ * -----------------------------------
+ *
+ * The container starts with a file header, followed by blocks that were
+ * compressed independently of each other. Records may span blocks; each
+ * block header tells where the first record starting in the block is, so a
+ * reader may start decoding at any block. The container is closed by an
+ * index of the blocks and a fixed-size footer pointing at the index, so
+ * readers can locate blocks without decompressing the ones before them. A
+ * new index is written at the end of each session; it covers the blocks
+ * written since the previous index and points at the previous index, so the
+ * indices form a chain that covers all the blocks.
+ *
+ * File header (little-endian):
+ *
+ *   0  magic "SDLZ"
+ *   4  u8   version of the layout (1)
+ *   5  u8   reserved, zero (3 bytes)
+ *   8  u32  nominal uncompressed size of a block
+ *
+ * Block header (little-endian):
+ *
+ *   0  magic "SDZB"
+ *   4  u8   codec of the block payload
+ *   5  u8   reserved, zero (3 bytes)
+ *   8  u32  length of the compressed payload after the header
+ *   12 u32  uncompressed length of the block
+ *   16 u32  offset of the first record starting in the block, relative to
+ *           the start of the uncompressed block, or 0xFFFFFFFF if unknown
+ *
+ * Index (little-endian):
+ *
+ *   0  magic "SDZI"
+ *   4  u32  number of blocks
+ *   8  u64  offset of the previous index from the start of the container,
+ *           or 0xFFFFFFFFFFFFFFFF for the first index; followed by an entry
+ *           for each block:
+ *
+ *      0  u64  offset of the block header from the start of the container
+ *      8  u64  offset of the uncompressed block in the uncompressed log
+ *      16 u32  length of the compressed payload
+ *      20 u32  uncompressed length of the block
+ *      24 u32  offset of the first record in the block, as above
+ *      28 u8   codec of the block payload
+ *      29 u8   reserved, zero (3 bytes)
+ *
+ * Footer (little-endian):
+ *
+ *   0  u64  offset of the index from the start of the container
+ *   8  magic "SDZE"
+ */
+
+#define FILE_MAGIC "SDLZ"
+#define BLOCK_MAGIC "SDZB"
+#define INDEX_MAGIC "SDZI"
+#define FOOTER_MAGIC "SDZE"
+#define FILE_VERSION 1
+#define FILE_HEADER_LENGTH 12
+#define BLOCK_HEADER_LENGTH 20
+#define INDEX_HEADER_LENGTH 16
+#define INDEX_ENTRY_LENGTH 32
+#define FOOTER_LENGTH 12
+
+/** Marker of blocks in which no record starts */
+#define NO_RECORD UINT32_MAX
+
+/** Marker of the first index in the chain of indices */
+#define NO_INDEX UINT64_MAX
+
+/** Default uncompressed size of the blocks */
+#define DEFAULT_BLOCK_SIZE (256 * 1024)
+
+/** Largest allowed uncompressed or compressed block size */
+#define MAX_BLOCK_SIZE (64 * 1024 * 1024)
+
+typedef struct {
+    uint64_t offset;
+    uint64_t uncompressed_offset;
+    uint32_t compressed_length;
+    uint32_t uncompressed_length;
+    uint32_t first_record;
+    uint8_t codec;
+} block_info_t;
+
+typedef struct {
+    /** The stream receiving the container; not owned */
+    sdlog_ostream_t* target;
+
+    /** Codec and compression level used for new blocks */
+    sdlog_i_codec_t codec;
+    int level;
+
+    /** The uncompressed block being assembled and the number of bytes in it */
+    uint8_t* block;
+    size_t block_size;
+    size_t used;
+
+    /** Buffer holding the header and the payload of a compressed block */
+    uint8_t* compressed;
+    size_t compressed_capacity;
+
+    /** Hash table of the built-in LZ compressor */
+    uint32_t* workspace;
+
+    /** Framer that finds the record boundaries in the uncompressed data */
+    sdlog_i_framer_t framer;
+
+    /** Offset of the first record starting in the current block */
+    uint32_t first_record;
+
+    /** Number of bytes written to the target so far */
+    uint64_t offset;
+
+    /** Offset of the current block in the uncompressed log */
+    uint64_t uncompressed_offset;
+
+    /** Blocks written since the last index, for the next index */
+    block_info_t* blocks;
+    size_t num_blocks;
+    size_t blocks_capacity;
+
+    /** Offset of the last index written, or \c NO_INDEX */
+    uint64_t last_index;
+
+    /** Whether the file header was written already */
+    bool header_written;
+} ostream_context_t;
+
+typedef enum {
+    SLOT_FREE,
+    SLOT_PENDING,
+    SLOT_RUNNING,
+    SLOT_DONE
+} slot_state_t;
+
+/* A block read from the container, in its compressed and uncompressed form */
+typedef struct {
+    uint8_t* compressed;
+    size_t compressed_capacity;
+    size_t compressed_length;
+
+    uint8_t* block;
+    size_t block_capacity;
+    size_t length;
+
+    sdlog_i_codec_t codec;
+    slot_state_t state;
+    sdlog_error_t error;
+} slot_t;
+
+typedef struct {
+    /** The stream holding the container; not owned */
+    sdlog_istream_t* source;
+
+    /** Whether the file header was read already */
+    bool header_read;
+
+    /** Whether reading has started already */
+    bool started;
+
+    /** Position of the stream in the uncompressed log */
+    uint64_t position;
+
+    /** All the blocks of the container, ordered by their offset in the
+     * uncompressed log, if the source supports positional reads and the
+     * container was closed properly; NULL otherwise */
+    block_info_t* index;
+    size_t index_length;
+
+    /** Length of the uncompressed log according to the index */
+    uint64_t total_length;
+
+    /** Error that stopped reading from the source; \c SDLOG_EOF at the end */
+    sdlog_error_t source_error;
+
+    /** Ring of blocks that were read from the source. Blocks are consumed in
+     * the order they were read, starting from the head of the ring. */
+    slot_t* slots;
+    size_t num_slots;
+    size_t head;
+    size_t num_queued;
+
+    /** Read position in the block at the head of the ring */
+    size_t pos;
+
+#if HAVE_PTHREAD
+    /** Worker threads decompressing the queued blocks; NULL if blocks are
+     * decompressed by the reading thread */
+    pthread_t* threads;
+    size_t num_threads;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t has_job;
+    pthread_cond_t has_result;
+    bool stopping;
+#endif
+} istream_context_t;
+
+static void compressed_destroy_o(sdlog_ostream_t* stream);
+static sdlog_error_t compressed_begin(sdlog_ostream_t* stream);
+static sdlog_error_t compressed_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written);
+static sdlog_error_t compressed_flush(sdlog_ostream_t* stream);
+static sdlog_error_t compressed_end(sdlog_ostream_t* stream);
+
+static void compressed_destroy_i(sdlog_istream_t* stream);
+static sdlog_error_t compressed_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read);
+static sdlog_error_t compressed_seek(sdlog_istream_t* stream, uint64_t offset);
+static sdlog_error_t compressed_tell(sdlog_istream_t* stream, uint64_t* offset);
+static sdlog_error_t compressed_read_at(
+    sdlog_istream_t* stream, uint64_t offset, uint8_t* data, size_t length, size_t* read);
+
+static sdlog_error_t note_record(void* arg, const uint8_t* record, size_t length);
+static sdlog_error_t write_file_header(ostream_context_t* ctx);
+static sdlog_error_t write_block(ostream_context_t* ctx);
+static sdlog_error_t write_index(ostream_context_t* ctx);
+static sdlog_error_t load_index(istream_context_t* ctx);
+static sdlog_error_t find_source_length(sdlog_istream_t* source, uint64_t* length);
+static sdlog_error_t read_exactly_at(
+    sdlog_istream_t* source, uint64_t offset, uint8_t* data, size_t length);
+static const block_info_t* find_block(const istream_context_t* ctx, uint64_t offset);
+static void fill_slots(istream_context_t* ctx);
+static sdlog_error_t read_block(istream_context_t* ctx, slot_t* slot);
+static void wait_for_slot(istream_context_t* ctx, slot_t* slot);
+static void release_slot(istream_context_t* ctx, slot_t* slot);
+static void decompress_slot(slot_t* slot);
+
+#if HAVE_PTHREAD
+static void stop_workers(istream_context_t* ctx, size_t num_threads);
+static slot_t* next_job(istream_context_t* ctx);
+static void* decompress_worker(void* arg);
+#endif
+static sdlog_error_t skip(istream_context_t* ctx, uint64_t length);
+static sdlog_error_t ensure_capacity(uint8_t** buf, size_t* capacity, size_t length);
+
+const sdlog_ostream_spec_t sdlog_ostream_compressed_methods = {
+    .destroy = compressed_destroy_o,
+    .begin = compressed_begin,
+    .write = compressed_write,
+    .flush = compressed_flush,
+    .end = compressed_end,
+};
+
+const sdlog_istream_spec_t sdlog_istream_compressed_methods = {
+    .destroy = compressed_destroy_i,
+    .read = compressed_read,
+    .seek = compressed_seek,
+    .tell = compressed_tell,
+    .read_at = compressed_read_at,
+};
+
+sdlog_error_t sdlog_ostream_init_compressed(
+    sdlog_ostream_t* stream, sdlog_ostream_t* target,
+    const sdlog_compressed_ostream_options_t* options)
+{
+    ostream_context_t* ctx;
+    sdlog_i_codec_t codec;
+    size_t block_size = options ? options->block_size : 0;
+
+    if (block_size == 0) {
+        block_size = DEFAULT_BLOCK_SIZE;
+    } else if (block_size > MAX_BLOCK_SIZE) {
+        return SDLOG_EINVAL;
+    }
+
+    switch (options ? options->compression : SDLOG_COMPRESSION_DEFAULT) {
+    case SDLOG_COMPRESSION_DEFAULT:
+        if (sdlog_i_codec_is_available(SDLOG_I_CODEC_ZSTD)) {
+            codec = SDLOG_I_CODEC_ZSTD;
+        } else if (sdlog_i_codec_is_available(SDLOG_I_CODEC_LZ4)) {
+            codec = SDLOG_I_CODEC_LZ4;
+        } else {
+            codec = SDLOG_I_CODEC_LZ;
+        }
+        break;
+
+    case SDLOG_COMPRESSION_NONE:
+        codec = SDLOG_I_CODEC_NONE;
+        break;
+
+    case SDLOG_COMPRESSION_LZ:
+        codec = SDLOG_I_CODEC_LZ;
+        break;
+
+    case SDLOG_COMPRESSION_LZ4:
+        codec = SDLOG_I_CODEC_LZ4;
+        break;
+
+    case SDLOG_COMPRESSION_ZSTD:
+        codec = SDLOG_I_CODEC_ZSTD;
+        break;
+
+    default:
+        return SDLOG_EINVAL;
+    }
+
+    if (!sdlog_i_codec_is_available(codec)) {
+        return SDLOG_UNIMPLEMENTED;
+    }
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(ostream_context_t)));
+    memset(ctx, 0, sizeof(ostream_context_t));
+
+    ctx->target = target;
+    ctx->codec = codec;
+    ctx->level = options ? options->level : 0;
+    ctx->block_size = block_size;
+    ctx->compressed_capacity = BLOCK_HEADER_LENGTH + sdlog_i_codec_bound(codec, block_size);
+    ctx->first_record = NO_RECORD;
+    ctx->last_index = NO_INDEX;
+    sdlog_i_framer_init(&ctx->framer);
+
+    ctx->block = sdlog_malloc(block_size);
+    ctx->compressed = sdlog_malloc(ctx->compressed_capacity);
+    ctx->workspace = sdlog_malloc(SDLOG_I_LZ_HASH_SIZE * sizeof(uint32_t));
+    if (ctx->block == NULL || ctx->compressed == NULL || ctx->workspace == NULL) {
+        sdlog_free(ctx->block);
+        sdlog_free(ctx->compressed);
+        sdlog_free(ctx->workspace);
+        sdlog_free(ctx);
+        return SDLOG_ENOMEM;
+    }
+
+    return sdlog_ostream_init(stream, &sdlog_ostream_compressed_methods, ctx);
+}
+
+sdlog_error_t sdlog_istream_init_compressed(sdlog_istream_t* stream, sdlog_istream_t* source)
+{
+    istream_context_t* ctx;
+    sdlog_error_t retval;
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(istream_context_t)));
+    memset(ctx, 0, sizeof(istream_context_t));
+
+    ctx->source = source;
+    ctx->num_slots = 1;
+    ctx->slots = sdlog_malloc(sizeof(slot_t));
+    if (ctx->slots == NULL) {
+        sdlog_free(ctx);
+        return SDLOG_ENOMEM;
+    }
+    memset(ctx->slots, 0, sizeof(slot_t));
+
+    /* Containers without a usable index can still be read sequentially */
+    retval = load_index(ctx);
+    if (retval != SDLOG_SUCCESS) {
+        sdlog_free(ctx->index);
+        ctx->index = NULL;
+        ctx->index_length = 0;
+
+        if (retval == SDLOG_ENOMEM) {
+            sdlog_free(ctx->slots);
+            sdlog_free(ctx);
+            return retval;
+        }
+    }
+
+    return sdlog_istream_init(stream, &sdlog_istream_compressed_methods, ctx);
+}
+
+sdlog_error_t sdlog_istream_compressed_set_threads(sdlog_istream_t* stream, size_t num_threads)
+{
+#if HAVE_PTHREAD
+    istream_context_t* ctx = CONTEXT_AS(istream_context_t);
+    slot_t* slots;
+    size_t i, num_slots;
+
+    if (ctx->started || ctx->threads) {
+        return SDLOG_EINVAL;
+    }
+
+    if (num_threads == 0) {
+#if HAVE_UNISTD_H
+        long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = num_cpus > 0 ? num_cpus : 1;
+#else
+        num_threads = 1;
+#endif
+    }
+
+    /* Two blocks per thread let the reading thread fetch the next blocks
+     * and consume the finished ones while the workers are busy */
+    num_slots = 2 * num_threads;
+    SDLOG_CHECK_OOM(slots = sdlog_malloc(num_slots * sizeof(slot_t)));
+    memset(slots, 0, num_slots * sizeof(slot_t));
+
+    ctx->threads = sdlog_malloc(num_threads * sizeof(pthread_t));
+    if (ctx->threads == NULL) {
+        sdlog_free(slots);
+        return SDLOG_ENOMEM;
+    }
+
+    sdlog_free(ctx->slots);
+    ctx->slots = slots;
+    ctx->num_slots = num_slots;
+    ctx->num_threads = num_threads;
+
+    pthread_mutex_init(&ctx->mutex, NULL);
+    pthread_cond_init(&ctx->has_job, NULL);
+    pthread_cond_init(&ctx->has_result, NULL);
+
+    for (i = 0; i < num_threads; i++) {
+        if (pthread_create(&ctx->threads[i], NULL, decompress_worker, ctx)) {
+            stop_workers(ctx, i);
+            return SDLOG_FAILURE;
+        }
+    }
+
+    return SDLOG_SUCCESS;
+#else
+    return SDLOG_UNIMPLEMENTED;
+#endif
+}
+
+static void compressed_destroy_o(sdlog_ostream_t* stream)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+
+    sdlog_free(ctx->blocks);
+    sdlog_free(ctx->workspace);
+    sdlog_free(ctx->compressed);
+    sdlog_free(ctx->block);
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t compressed_begin(sdlog_ostream_t* stream)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+    return sdlog_ostream_begin_session(ctx->target);
+}
+
+static sdlog_error_t compressed_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+    size_t chunk;
+
+    *written = 0;
+
+    while (length > 0) {
+        chunk = ctx->block_size - ctx->used;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        /* The framer sees the bytes before they are added to the block so
+         * records completed by them are attributed to the current block */
+        SDLOG_CHECK(sdlog_i_framer_feed(&ctx->framer, data, chunk, note_record, ctx));
+
+        memcpy(ctx->block + ctx->used, data, chunk);
+        ctx->used += chunk;
+        data += chunk;
+        length -= chunk;
+        *written += chunk;
+
+        if (ctx->used == ctx->block_size) {
+            SDLOG_CHECK(write_block(ctx));
+        }
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t compressed_flush(sdlog_ostream_t* stream)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+
+    SDLOG_CHECK(write_block(ctx));
+    return sdlog_ostream_flush(ctx->target);
+}
+
+static sdlog_error_t compressed_end(sdlog_ostream_t* stream)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+
+    SDLOG_CHECK(write_block(ctx));
+    SDLOG_CHECK(write_index(ctx));
+    return sdlog_ostream_end_session(ctx->target);
+}
+
+static sdlog_error_t note_record(void* arg, const uint8_t* record, size_t length)
+{
+    ostream_context_t* ctx = (ostream_context_t*)arg;
+
+    /* Records that started in an earlier block are not useful here; the
+     * earlier block was written already without knowing about them */
+    if (ctx->first_record == NO_RECORD && ctx->framer.record_start >= ctx->uncompressed_offset) {
+        ctx->first_record = (uint32_t)(ctx->framer.record_start - ctx->uncompressed_offset);
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t write_file_header(ostream_context_t* ctx)
+{
+    uint8_t header[FILE_HEADER_LENGTH] = { 0 };
+
+    if (ctx->header_written) {
+        return SDLOG_SUCCESS;
+    }
+
+    memcpy(header, FILE_MAGIC, 4);
+    header[4] = FILE_VERSION;
+    sdlog_store_u32_le(header + 8, (uint32_t)ctx->block_size);
+
+    SDLOG_CHECK(sdlog_ostream_write_all(ctx->target, header, FILE_HEADER_LENGTH));
+    ctx->offset += FILE_HEADER_LENGTH;
+    ctx->header_written = true;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t write_block(ostream_context_t* ctx)
+{
+    uint8_t* header = ctx->compressed;
+    sdlog_iovec_t iov[2];
+    block_info_t* info;
+    size_t compressed_length = 0;
+    sdlog_i_codec_t codec = ctx->codec;
+
+    if (ctx->used == 0) {
+        return SDLOG_SUCCESS;
+    }
+
+    SDLOG_CHECK(write_file_header(ctx));
+
+    if (ctx->num_blocks == ctx->blocks_capacity) {
+        size_t new_capacity = ctx->blocks_capacity ? ctx->blocks_capacity * 2 : 64;
+        block_info_t* blocks = sdlog_realloc(
+            ctx->blocks, ctx->blocks_capacity * sizeof(block_info_t),
+            new_capacity * sizeof(block_info_t));
+        SDLOG_CHECK_OOM(blocks);
+        ctx->blocks = blocks;
+        ctx->blocks_capacity = new_capacity;
+    }
+
+    iov[1].data = ctx->compressed + BLOCK_HEADER_LENGTH;
+    if (codec != SDLOG_I_CODEC_NONE) {
+        SDLOG_CHECK(sdlog_i_codec_compress(
+            codec, ctx->level, ctx->block, ctx->used,
+            ctx->compressed + BLOCK_HEADER_LENGTH,
+            ctx->compressed_capacity - BLOCK_HEADER_LENGTH,
+            &compressed_length, ctx->workspace));
+    }
+
+    /* Blocks that do not compress are stored as they are */
+    if (codec == SDLOG_I_CODEC_NONE || compressed_length >= ctx->used) {
+        codec = SDLOG_I_CODEC_NONE;
+        compressed_length = ctx->used;
+        iov[1].data = ctx->block;
+    }
+    iov[1].length = compressed_length;
+
+    memset(header, 0, BLOCK_HEADER_LENGTH);
+    memcpy(header, BLOCK_MAGIC, 4);
+    header[4] = (uint8_t)codec;
+    sdlog_store_u32_le(header + 8, (uint32_t)compressed_length);
+    sdlog_store_u32_le(header + 12, (uint32_t)ctx->used);
+    sdlog_store_u32_le(header + 16, ctx->first_record);
+    iov[0].data = header;
+    iov[0].length = BLOCK_HEADER_LENGTH;
+
+    SDLOG_CHECK(sdlog_ostream_writev_all(ctx->target, iov, 2));
+
+    info = &ctx->blocks[ctx->num_blocks++];
+    info->offset = ctx->offset;
+    info->uncompressed_offset = ctx->uncompressed_offset;
+    info->compressed_length = (uint32_t)compressed_length;
+    info->uncompressed_length = (uint32_t)ctx->used;
+    info->first_record = ctx->first_record;
+    info->codec = (uint8_t)codec;
+
+    ctx->offset += BLOCK_HEADER_LENGTH + compressed_length;
+    ctx->uncompressed_offset += ctx->used;
+    ctx->used = 0;
+    ctx->first_record = NO_RECORD;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t write_index(ostream_context_t* ctx)
+{
+    uint8_t *index, *p;
+    size_t i, length;
+    sdlog_error_t retval;
+
+    SDLOG_CHECK(write_file_header(ctx));
+
+    length = INDEX_HEADER_LENGTH + ctx->num_blocks * INDEX_ENTRY_LENGTH + FOOTER_LENGTH;
+    SDLOG_CHECK_OOM(index = sdlog_malloc(length));
+    memset(index, 0, length);
+
+    memcpy(index, INDEX_MAGIC, 4);
+    sdlog_store_u32_le(index + 4, (uint32_t)ctx->num_blocks);
+    sdlog_store_u64_le(index + 8, ctx->last_index);
+
+    p = index + INDEX_HEADER_LENGTH;
+    for (i = 0; i < ctx->num_blocks; i++, p += INDEX_ENTRY_LENGTH) {
+        const block_info_t* info = &ctx->blocks[i];
+        sdlog_store_u64_le(p, info->offset);
+        sdlog_store_u64_le(p + 8, info->uncompressed_offset);
+        sdlog_store_u32_le(p + 16, info->compressed_length);
+        sdlog_store_u32_le(p + 20, info->uncompressed_length);
+        sdlog_store_u32_le(p + 24, info->first_record);
+        p[28] = info->codec;
+    }
+
+    sdlog_store_u64_le(p, ctx->offset);
+    memcpy(p + 8, FOOTER_MAGIC, 4);
+
+    retval = sdlog_ostream_write_all(ctx->target, index, length);
+    if (retval == SDLOG_SUCCESS) {
+        /* The next index covers only the blocks written after this one */
+        ctx->last_index = ctx->offset;
+        ctx->offset += length;
+        ctx->num_blocks = 0;
+    }
+
+    sdlog_free(index);
+    return retval;
+}
+
+/* ************************************************************************** */
+
+static void compressed_destroy_i(sdlog_istream_t* stream)
+{
+    istream_context_t* ctx = CONTEXT_AS(istream_context_t);
+    size_t i;
+
+#if HAVE_PTHREAD
+    if (ctx->threads) {
+        stop_workers(ctx, ctx->num_threads);
+    }
+#endif
+
+    for (i = 0; i < ctx->num_slots; i++) {
+        sdlog_free(ctx->slots[i].compressed);
+        sdlog_free(ctx->slots[i].block);
+    }
+
+    sdlog_free(ctx->index);
+    sdlog_free(ctx->slots);
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t compressed_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read)
+{
+    istream_context_t* ctx = CONTEXT_AS(istream_context_t);
+    slot_t* slot;
+    size_t chunk;
+
+    *read = 0;
+    ctx->started = true;
+
+    while (1) {
+        fill_slots(ctx);
+        if (ctx->num_queued == 0) {
+            return ctx->source_error;
+        }
+
+        slot = &ctx->slots[ctx->head];
+        wait_for_slot(ctx, slot);
+        SDLOG_CHECK(slot->error);
+
+        if (ctx->pos < slot->length) {
+            break;
+        }
+
+        release_slot(ctx, slot);
+    }
+
+    chunk = slot->length - ctx->pos;
+    if (chunk > length) {
+        chunk = length;
+    }
+
+    memcpy(data, slot->block + ctx->pos, chunk);
+    ctx->pos += chunk;
+    ctx->position += chunk;
+    *read = chunk;
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Moves the read position with the help of the index. The blocks that were
+ * read ahead are discarded, and reading continues with the block holding
+ * the new position.
+ */
+static sdlog_error_t compressed_seek(sdlog_istream_t* stream, uint64_t offset)
+{
+    istream_context_t* ctx = CONTEXT_AS(istream_context_t);
+    const block_info_t* block;
+    uint64_t source_offset = FILE_HEADER_LENGTH;
+
+    if (ctx->index == NULL) {
+        return SDLOG_UNIMPLEMENTED;
+    }
+
+    if (offset > ctx->total_length) {
+        return SDLOG_EINVAL;
+    }
+
+    while (ctx->num_queued > 0) {
+        wait_for_slot(ctx, &ctx->slots[ctx->head]);
+        release_slot(ctx, &ctx->slots[ctx->head]);
+    }
+
+    /* An offset at the end of the log is in the last block */
+    block = find_block(ctx, offset);
+    if (block) {
+        source_offset = block->offset;
+    }
+
+    SDLOG_CHECK(sdlog_istream_seek(ctx->source, source_offset));
+
+    ctx->header_read = true;
+    ctx->started = true;
+    ctx->source_error = SDLOG_SUCCESS;
+    ctx->pos = block ? offset - block->uncompressed_offset : 0;
+    ctx->position = offset;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t compressed_tell(sdlog_istream_t* stream, uint64_t* offset)
+{
+    istream_context_t* ctx = CONTEXT_AS(istream_context_t);
+    *offset = ctx->position;
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Reads from the given offset of the uncompressed log by decompressing only
+ * the block holding it. The read stops at the end of the block.
+ */
+static sdlog_error_t compressed_read_at(
+    sdlog_istream_t* stream, uint64_t offset, uint8_t* data, size_t length, size_t* read)
+{
+    istream_context_t* ctx = CONTEXT_AS(istream_context_t);
+    const block_info_t* block;
+    uint8_t *compressed = NULL, *uncompressed = NULL;
+    size_t skip_length;
+    sdlog_error_t retval;
+
+    if (ctx->index == NULL) {
+        return SDLOG_UNIMPLEMENTED;
+    }
+
+    if (offset >= ctx->total_length) {
+        return SDLOG_EOF;
+    }
+
+    block = find_block(ctx, offset);
+    if (!sdlog_i_codec_is_available((sdlog_i_codec_t)block->codec)) {
+        return SDLOG_UNIMPLEMENTED;
+    }
+
+    skip_length = offset - block->uncompressed_offset;
+    if (length > block->uncompressed_length - skip_length) {
+        length = block->uncompressed_length - skip_length;
+    }
+
+    /* Whole blocks are decompressed straight into the buffer of the caller.
+     * Positional reads may come from multiple threads, so the buffers are not
+     * shared with the stream. */
+    compressed = sdlog_malloc(block->compressed_length > 0 ? block->compressed_length : 1);
+    if (compressed == NULL) {
+        return SDLOG_ENOMEM;
+    }
+
+    if (length < block->uncompressed_length) {
+        uncompressed = sdlog_malloc(block->uncompressed_length);
+        if (uncompressed == NULL) {
+            sdlog_free(compressed);
+            return SDLOG_ENOMEM;
+        }
+    }
+
+    retval = read_exactly_at(
+        ctx->source, block->offset + BLOCK_HEADER_LENGTH, compressed, block->compressed_length);
+    if (retval == SDLOG_EOF) {
+        retval = SDLOG_EREAD;
+    }
+    if (retval != SDLOG_SUCCESS) {
+        goto cleanup;
+    }
+
+    retval = sdlog_i_codec_decompress(
+        (sdlog_i_codec_t)block->codec, compressed, block->compressed_length,
+        uncompressed ? uncompressed : data, block->uncompressed_length);
+    if (retval == SDLOG_SUCCESS && uncompressed) {
+        memcpy(data, uncompressed + skip_length, length);
+    }
+
+cleanup:
+    sdlog_free(uncompressed);
+    sdlog_free(compressed);
+
+    *read = retval == SDLOG_SUCCESS ? length : 0;
+    return retval;
+}
+
+/**
+ * Loads the chain of indices of the container with positional reads,
+ * starting from the footer at the end of the source. Fails if the source
+ * does not support positional reads, if the container was not closed
+ * properly or if the indices do not cover the container without gaps.
+ */
+static sdlog_error_t load_index(istream_context_t* ctx)
+{
+    uint8_t buf[INDEX_HEADER_LENGTH];
+    uint8_t* entries;
+    uint8_t* p;
+    block_info_t* new_index;
+    block_info_t* info;
+    uint64_t source_length, index_offset, expected_offset;
+    uint32_t count;
+    size_t i;
+    sdlog_error_t retval;
+
+    SDLOG_CHECK(read_exactly_at(ctx->source, 0, buf, FILE_HEADER_LENGTH));
+    if (memcmp(buf, FILE_MAGIC, 4) || buf[4] != FILE_VERSION) {
+        return SDLOG_EREAD;
+    }
+
+    SDLOG_CHECK(find_source_length(ctx->source, &source_length));
+    if (source_length < FILE_HEADER_LENGTH + INDEX_HEADER_LENGTH + FOOTER_LENGTH) {
+        return SDLOG_EREAD;
+    }
+
+    SDLOG_CHECK(read_exactly_at(ctx->source, source_length - FOOTER_LENGTH, buf, FOOTER_LENGTH));
+    if (memcmp(buf + 8, FOOTER_MAGIC, 4)) {
+        return SDLOG_EREAD;
+    }
+
+    /* Indices are visited from the last one; each one holds the blocks
+     * written after the one before it, so the blocks are filled in from the
+     * end of the array */
+    index_offset = sdlog_load_u64_le(buf);
+    while (index_offset != NO_INDEX) {
+        if (index_offset < FILE_HEADER_LENGTH || index_offset >= source_length) {
+            return SDLOG_EREAD;
+        }
+
+        SDLOG_CHECK(read_exactly_at(ctx->source, index_offset, buf, INDEX_HEADER_LENGTH));
+        if (memcmp(buf, INDEX_MAGIC, 4)) {
+            return SDLOG_EREAD;
+        }
+
+        count = sdlog_load_u32_le(buf + 4);
+        if ((uint64_t)count * INDEX_ENTRY_LENGTH > source_length - index_offset) {
+            return SDLOG_EREAD;
+        }
+
+        /* Offsets are relative to the start of the container, so the last
+         * index must end right before the footer; this is not the case if
+         * the source holds concatenated containers */
+        if (ctx->index == NULL
+            && index_offset + INDEX_HEADER_LENGTH + (uint64_t)count * INDEX_ENTRY_LENGTH + FOOTER_LENGTH != source_length) {
+            return SDLOG_EREAD;
+        }
+
+        SDLOG_CHECK_OOM(new_index = sdlog_malloc((ctx->index_length + count) * sizeof(block_info_t) + 1));
+        if (ctx->index_length > 0) {
+            memcpy(new_index + count, ctx->index, ctx->index_length * sizeof(block_info_t));
+        }
+        sdlog_free(ctx->index);
+        ctx->index = new_index;
+        ctx->index_length += count;
+
+        entries = sdlog_malloc((size_t)count * INDEX_ENTRY_LENGTH + 1);
+        if (entries == NULL) {
+            return SDLOG_ENOMEM;
+        }
+
+        retval = read_exactly_at(ctx->source, index_offset + INDEX_HEADER_LENGTH,
+            entries, (size_t)count * INDEX_ENTRY_LENGTH);
+        if (retval == SDLOG_SUCCESS) {
+            for (i = 0, p = entries; i < count; i++, p += INDEX_ENTRY_LENGTH) {
+                info = &ctx->index[i];
+                info->offset = sdlog_load_u64_le(p);
+                info->uncompressed_offset = sdlog_load_u64_le(p + 8);
+                info->compressed_length = sdlog_load_u32_le(p + 16);
+                info->uncompressed_length = sdlog_load_u32_le(p + 20);
+                info->first_record = sdlog_load_u32_le(p + 24);
+                info->codec = p[28];
+            }
+        }
+
+        sdlog_free(entries);
+        SDLOG_CHECK(retval);
+
+        index_offset = sdlog_load_u64_le(buf + 8);
+    }
+
+    /* The blocks must follow each other in the uncompressed log */
+    expected_offset = 0;
+    for (i = 0; i < ctx->index_length; i++) {
+        info = &ctx->index[i];
+        if (info->uncompressed_offset != expected_offset
+            || info->codec > SDLOG_I_CODEC_ZSTD
+            || info->compressed_length > MAX_BLOCK_SIZE
+            || info->uncompressed_length > MAX_BLOCK_SIZE
+            || info->offset + BLOCK_HEADER_LENGTH + info->compressed_length > source_length) {
+            return SDLOG_EREAD;
+        }
+        expected_offset += info->uncompressed_length;
+    }
+
+    ctx->total_length = expected_offset;
+
+    /* The array must exist even for containers without blocks */
+    if (ctx->index == NULL) {
+        SDLOG_CHECK_OOM(ctx->index = sdlog_malloc(sizeof(block_info_t)));
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Finds the length of a source that supports positional reads by probing
+ * it at exponentially growing offsets, then by bisection.
+ */
+static sdlog_error_t find_source_length(sdlog_istream_t* source, uint64_t* length)
+{
+    uint64_t low = 0, high = 1, mid;
+    uint8_t byte;
+    size_t read;
+    sdlog_error_t retval;
+
+    /* Invariant: the byte before low exists (or low is zero), the byte
+     * before high may not */
+    while (1) {
+        retval = sdlog_istream_read_at(source, high - 1, &byte, 1, &read);
+        if (retval == SDLOG_EOF || (retval == SDLOG_SUCCESS && read == 0)) {
+            break;
+        }
+        SDLOG_CHECK(retval);
+        if (high > UINT64_MAX / 2) {
+            return SDLOG_ELIMIT;
+        }
+        low = high;
+        high *= 2;
+    }
+
+    while (high - low > 1) {
+        mid = low + (high - low) / 2;
+        retval = sdlog_istream_read_at(source, mid - 1, &byte, 1, &read);
+        if (retval == SDLOG_EOF || (retval == SDLOG_SUCCESS && read == 0)) {
+            high = mid;
+        } else {
+            SDLOG_CHECK(retval);
+            low = mid;
+        }
+    }
+
+    *length = low;
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t read_exactly_at(
+    sdlog_istream_t* source, uint64_t offset, uint8_t* data, size_t length)
+{
+    size_t read;
+
+    while (length > 0) {
+        SDLOG_CHECK(sdlog_istream_read_at(source, offset, data, length, &read));
+        if (read == 0) {
+            return SDLOG_EOF;
+        }
+        offset += read;
+        data += read;
+        length -= read;
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Returns the block holding the given offset of the uncompressed log; the
+ * end of the log is considered to be in the last block. Returns NULL if the
+ * container has no blocks.
+ */
+static const block_info_t* find_block(const istream_context_t* ctx, uint64_t offset)
+{
+    size_t low = 0, high = ctx->index_length, mid;
+
+    if (high == 0) {
+        return NULL;
+    }
+
+    /* Finds the last block starting at or before the offset */
+    while (high - low > 1) {
+        mid = low + (high - low) / 2;
+        if (ctx->index[mid].uncompressed_offset <= offset) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    return &ctx->index[low];
+}
+
+/**
+ * Reads blocks from the source into the free slots, in order, and queues
+ * them for decompression. Stops at the first error of the source, including
+ * the end of the container; the error is reported once the blocks read
+ * before it were consumed.
+ */
+static void fill_slots(istream_context_t* ctx)
+{
+    slot_t* slot;
+    sdlog_error_t retval;
+
+    while (ctx->source_error == SDLOG_SUCCESS && ctx->num_queued < ctx->num_slots) {
+        slot = &ctx->slots[(ctx->head + ctx->num_queued) % ctx->num_slots];
+
+        retval = read_block(ctx, slot);
+        if (retval != SDLOG_SUCCESS) {
+            ctx->source_error = retval;
+            break;
+        }
+
+#if HAVE_PTHREAD
+        if (ctx->threads) {
+            pthread_mutex_lock(&ctx->mutex);
+            slot->state = SLOT_PENDING;
+            ctx->num_queued++;
+            pthread_cond_signal(&ctx->has_job);
+            pthread_mutex_unlock(&ctx->mutex);
+            continue;
+        }
+#endif
+
+        slot->state = SLOT_PENDING;
+        ctx->num_queued++;
+    }
+}
+
+static sdlog_error_t read_block(istream_context_t* ctx, slot_t* slot)
+{
+    uint8_t header[BLOCK_HEADER_LENGTH];
+
+    if (!ctx->header_read) {
+        SDLOG_CHECK(sdlog_istream_read_exactly(ctx->source, header, FILE_HEADER_LENGTH));
+        if (memcmp(header, FILE_MAGIC, 4) || header[4] != FILE_VERSION) {
+            return SDLOG_EREAD;
+        }
+        ctx->header_read = true;
+    }
+
+    while (1) {
+        SDLOG_CHECK(sdlog_istream_read_exactly(ctx->source, header, 4));
+
+        if (!memcmp(header, BLOCK_MAGIC, 4)) {
+            break;
+        }
+
+        if (!memcmp(header, INDEX_MAGIC, 4)) {
+            /* Indices are not needed when reading sequentially */
+            SDLOG_CHECK(sdlog_istream_read_exactly(ctx->source, header, 4));
+            SDLOG_CHECK(skip(ctx,
+                INDEX_HEADER_LENGTH - 8 + (uint64_t)sdlog_load_u32_le(header) * INDEX_ENTRY_LENGTH
+                + FOOTER_LENGTH));
+        } else if (!memcmp(header, FILE_MAGIC, 4)) {
+            /* Concatenated containers are read one after the other */
+            SDLOG_CHECK(sdlog_istream_read_exactly(ctx->source, header + 4, FILE_HEADER_LENGTH - 4));
+            if (header[4] != FILE_VERSION) {
+                return SDLOG_EREAD;
+            }
+        } else {
+            return SDLOG_EREAD;
+        }
+    }
+
+    SDLOG_CHECK(sdlog_istream_read_exactly(ctx->source, header + 4, BLOCK_HEADER_LENGTH - 4));
+
+    if (header[4] > SDLOG_I_CODEC_ZSTD) {
+        return SDLOG_EREAD;
+    }
+
+    slot->codec = (sdlog_i_codec_t)header[4];
+    slot->compressed_length = sdlog_load_u32_le(header + 8);
+    slot->length = sdlog_load_u32_le(header + 12);
+    if (slot->compressed_length > MAX_BLOCK_SIZE || slot->length > MAX_BLOCK_SIZE) {
+        return SDLOG_EREAD;
+    }
+
+    if (!sdlog_i_codec_is_available(slot->codec)) {
+        return SDLOG_UNIMPLEMENTED;
+    }
+
+    SDLOG_CHECK(ensure_capacity(&slot->compressed, &slot->compressed_capacity, slot->compressed_length));
+    SDLOG_CHECK(ensure_capacity(&slot->block, &slot->block_capacity, slot->length));
+    SDLOG_CHECK(sdlog_istream_read_exactly(ctx->source, slot->compressed, slot->compressed_length));
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Waits until the given queued slot is decompressed; decompresses it in the
+ * calling thread if there are no worker threads.
+ */
+static void wait_for_slot(istream_context_t* ctx, slot_t* slot)
+{
+#if HAVE_PTHREAD
+    if (ctx->threads) {
+        pthread_mutex_lock(&ctx->mutex);
+        while (slot->state != SLOT_DONE) {
+            pthread_cond_wait(&ctx->has_result, &ctx->mutex);
+        }
+        pthread_mutex_unlock(&ctx->mutex);
+        return;
+    }
+#endif
+
+    if (slot->state == SLOT_PENDING) {
+        decompress_slot(slot);
+        slot->state = SLOT_DONE;
+    }
+}
+
+/**
+ * Releases the slot at the head of the ring after it was consumed.
+ */
+static void release_slot(istream_context_t* ctx, slot_t* slot)
+{
+#if HAVE_PTHREAD
+    if (ctx->threads) {
+        pthread_mutex_lock(&ctx->mutex);
+    }
+#endif
+
+    slot->state = SLOT_FREE;
+    ctx->head = (ctx->head + 1) % ctx->num_slots;
+    ctx->num_queued--;
+    ctx->pos = 0;
+
+#if HAVE_PTHREAD
+    if (ctx->threads) {
+        pthread_mutex_unlock(&ctx->mutex);
+    }
+#endif
+}
+
+static void decompress_slot(slot_t* slot)
+{
+    slot->error = sdlog_i_codec_decompress(
+        slot->codec, slot->compressed, slot->compressed_length,
+        slot->block, slot->length);
+}
+
+#if HAVE_PTHREAD
+
+static void stop_workers(istream_context_t* ctx, size_t num_threads)
+{
+    size_t i;
+
+    pthread_mutex_lock(&ctx->mutex);
+    ctx->stopping = true;
+    pthread_cond_broadcast(&ctx->has_job);
+    pthread_mutex_unlock(&ctx->mutex);
+
+    for (i = 0; i < num_threads; i++) {
+        pthread_join(ctx->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&ctx->has_result);
+    pthread_cond_destroy(&ctx->has_job);
+    pthread_mutex_destroy(&ctx->mutex);
+
+    sdlog_free(ctx->threads);
+    ctx->threads = NULL;
+    ctx->num_threads = 0;
+}
+
+/**
+ * Returns the oldest queued slot that is waiting for a worker, or NULL if
+ * there is none. Must be called with the mutex held.
+ */
+static slot_t* next_job(istream_context_t* ctx)
+{
+    slot_t* slot;
+    size_t i;
+
+    for (i = 0; i < ctx->num_queued; i++) {
+        slot = &ctx->slots[(ctx->head + i) % ctx->num_slots];
+        if (slot->state == SLOT_PENDING) {
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+static void* decompress_worker(void* arg)
+{
+    istream_context_t* ctx = (istream_context_t*)arg;
+    slot_t* slot;
+
+    pthread_mutex_lock(&ctx->mutex);
+
+    while (1) {
+        while (!ctx->stopping && (slot = next_job(ctx)) == NULL) {
+            pthread_cond_wait(&ctx->has_job, &ctx->mutex);
+        }
+
+        if (ctx->stopping) {
+            break;
+        }
+
+        slot->state = SLOT_RUNNING;
+        pthread_mutex_unlock(&ctx->mutex);
+
+        decompress_slot(slot);
+
+        pthread_mutex_lock(&ctx->mutex);
+        slot->state = SLOT_DONE;
+        pthread_cond_broadcast(&ctx->has_result);
+    }
+
+    pthread_mutex_unlock(&ctx->mutex);
+
+    return NULL;
+}
+
+#endif
+
+static sdlog_error_t skip(istream_context_t* ctx, uint64_t length)
+{
+    uint8_t buf[256];
+    size_t chunk;
+
+    while (length > 0) {
+        chunk = length > sizeof(buf) ? sizeof(buf) : length;
+        SDLOG_CHECK(sdlog_istream_read_exactly(ctx->source, buf, chunk));
+        length -= chunk;
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t ensure_capacity(uint8_t** buf, size_t* capacity, size_t length)
+{
+    uint8_t* new_buf;
+
+    if (length <= *capacity) {
+        return SDLOG_SUCCESS;
+    }
+
+    SDLOG_CHECK_OOM(new_buf = sdlog_realloc(*buf, *capacity, length));
+    *buf = new_buf;
+    *capacity = length;
+
+    return SDLOG_SUCCESS;
+}
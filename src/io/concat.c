@@ -0,0 +1,330 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sdlog/memory.h>
+#include <sdlog/streams.h>
+
+#include "config.h"
+#include "segment_path.h"
+#include "stream_base.h"
+
+#if HAVE_UNISTD_H
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+/* Longest path generated from the path template */
+#define MAX_PATH_LENGTH 4096
+
+typedef struct {
+    /** Callback that opens the segments, and its argument */
+    sdlog_segment_opener_t* opener;
+    void* arg;
+
+    /** Template of the paths of the segments if they are files; owned */
+    char* path_template;
+
+    /** The segment being read and the one opened ahead of it */
+    sdlog_istream_t segments[2];
+
+    /** Index of the current segment in the array above */
+    int current;
+
+    /** Whether the current segment is open */
+    bool has_current;
+
+    /** Whether the next segment was opened ahead of time */
+    bool has_next;
+
+    /** Whether there are no more segments */
+    bool ended;
+
+    /** Index of the current segment */
+    uint32_t index;
+} context_t;
+
+static void concat_destroy(sdlog_istream_t* stream);
+static sdlog_error_t concat_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read);
+
+static sdlog_error_t init_context(sdlog_istream_t* stream, context_t* ctx);
+static sdlog_error_t open_current(context_t* ctx);
+static void open_ahead(context_t* ctx);
+
+const sdlog_istream_spec_t sdlog_istream_concat_methods = {
+    .destroy = concat_destroy,
+    .read = concat_read,
+};
+
+sdlog_error_t sdlog_istream_init_concat(
+    sdlog_istream_t* stream, sdlog_segment_opener_t* opener, void* arg,
+    uint32_t first_index)
+{
+    context_t* ctx;
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(context_t)));
+    memset(ctx, 0, sizeof(context_t));
+
+    ctx->opener = opener;
+    ctx->arg = arg;
+    ctx->index = first_index;
+
+    return init_context(stream, ctx);
+}
+
+uint32_t sdlog_istream_concat_get_segment_index(sdlog_istream_t* stream)
+{
+    return CONTEXT_AS(context_t)->index;
+}
+
+static void concat_destroy(sdlog_istream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    if (ctx->has_current) {
+        sdlog_istream_destroy(&ctx->segments[ctx->current]);
+    }
+    if (ctx->has_next) {
+        sdlog_istream_destroy(&ctx->segments[1 - ctx->current]);
+    }
+
+    sdlog_free(ctx->path_template);
+    memset(ctx, 0, sizeof(context_t));
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t concat_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    sdlog_error_t retval;
+
+    *read = 0;
+
+    while (!ctx->ended) {
+        if (!ctx->has_current) {
+            /* Failures are reported but not final; the next read tries to
+             * open the segment again */
+            SDLOG_CHECK(open_current(ctx));
+            continue;
+        }
+
+        /* Reads stop at the end of the segment so the caller can see where
+         * the next one starts */
+        retval = sdlog_istream_read(&ctx->segments[ctx->current], data, length, read);
+        if (retval != SDLOG_EOF) {
+            return retval;
+        }
+
+        sdlog_istream_destroy(&ctx->segments[ctx->current]);
+        ctx->has_current = false;
+        ctx->index++;
+        ctx->ended = ctx->index == 0;
+    }
+
+    return SDLOG_EOF;
+}
+
+/**
+ * Opens the first segment of a newly allocated context and creates the
+ * stream. Frees the context if the first segment cannot be opened.
+ */
+static sdlog_error_t init_context(sdlog_istream_t* stream, context_t* ctx)
+{
+    sdlog_error_t retval;
+
+    /* The first segment is opened right away so errors are detected early */
+    retval = open_current(ctx);
+    if (retval != SDLOG_SUCCESS) {
+        sdlog_free(ctx->path_template);
+        sdlog_free(ctx);
+        return retval;
+    }
+
+    return sdlog_istream_init(stream, &sdlog_istream_concat_methods, ctx);
+}
+
+/**
+ * Makes the segment with the current index the current segment, using the
+ * one opened ahead of time if there is one, then opens the segment after it.
+ * Marks the stream as ended if the segment does not exist.
+ */
+static sdlog_error_t open_current(context_t* ctx)
+{
+    sdlog_error_t retval;
+
+    if (ctx->has_next) {
+        ctx->current = 1 - ctx->current;
+        ctx->has_next = false;
+    } else {
+        retval = ctx->opener(ctx->arg, ctx->index, &ctx->segments[ctx->current]);
+        if (retval == SDLOG_EOF) {
+            ctx->ended = true;
+            return SDLOG_SUCCESS;
+        }
+        SDLOG_CHECK(retval);
+    }
+
+    ctx->has_current = true;
+    open_ahead(ctx);
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Opens the segment after the current one while the current one is being
+ * read. A segment that cannot be opened yet is looked for again when it is
+ * needed, so failures are ignored here.
+ */
+static void open_ahead(context_t* ctx)
+{
+    if (ctx->index < UINT32_MAX) {
+        ctx->has_next = ctx->opener(ctx->arg, ctx->index + 1, &ctx->segments[1 - ctx->current]) == SDLOG_SUCCESS;
+    }
+}
+
+/* ************************************************************************** */
+
+#if HAVE_UNISTD_H
+
+/*
+ * File segments are read with file descriptor streams. These do not own
+ * their descriptors, so each one is wrapped in a filter stream that closes
+ * the descriptor when the segment is destroyed.
+ */
+
+typedef struct {
+    /** The stream reading the segment */
+    sdlog_istream_t stream;
+
+    /** The file descriptor of the segment; owned */
+    int fd;
+} file_segment_t;
+
+static void file_destroy(sdlog_istream_t* stream);
+
+static sdlog_error_t open_file(void* arg, uint32_t index, sdlog_istream_t* segment);
+
+static const sdlog_istream_spec_t file_segment_methods = {
+    .destroy = file_destroy,
+};
+
+sdlog_error_t sdlog_istream_init_concat_files(
+    sdlog_istream_t* stream, const char* path_template, uint32_t first_index)
+{
+    context_t* ctx;
+
+    if (!sdlog_i_segment_path_is_valid(path_template)) {
+        return SDLOG_EINVAL;
+    }
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(context_t)));
+    memset(ctx, 0, sizeof(context_t));
+
+    ctx->path_template = sdlog_malloc(strlen(path_template) + 1);
+    if (ctx->path_template == NULL) {
+        sdlog_free(ctx);
+        return SDLOG_ENOMEM;
+    }
+    strcpy(ctx->path_template, path_template);
+
+    ctx->opener = open_file;
+    ctx->arg = ctx->path_template;
+    ctx->index = first_index;
+
+    return init_context(stream, ctx);
+}
+
+static void file_destroy(sdlog_istream_t* stream)
+{
+    file_segment_t* file = (file_segment_t*)sdlog_istream_filter_get_context(stream);
+
+    sdlog_istream_destroy(&file->stream);
+    close(file->fd);
+    memset(file, 0, sizeof(file_segment_t));
+    sdlog_free(file);
+}
+
+static sdlog_error_t open_file(void* arg, uint32_t index, sdlog_istream_t* segment)
+{
+    char path[MAX_PATH_LENGTH];
+    file_segment_t* file;
+    sdlog_error_t retval;
+    int fd;
+
+    SDLOG_CHECK(sdlog_i_segment_path_format(path, sizeof(path), (const char*)arg, index));
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno == ENOENT ? SDLOG_EOF : SDLOG_EIO;
+    }
+
+#if HAVE_POSIX_FADVISE
+    /* Segments are opened one ahead, so the kernel can read this one while
+     * the previous one is being parsed */
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+
+    file = sdlog_malloc(sizeof(file_segment_t));
+    if (file == NULL) {
+        close(fd);
+        return SDLOG_ENOMEM;
+    }
+
+    file->fd = fd;
+
+    retval = sdlog_istream_init_fd(&file->stream, fd);
+    if (retval != SDLOG_SUCCESS) {
+        sdlog_free(file);
+        close(fd);
+        return retval;
+    }
+
+    retval = sdlog_istream_init_filter(segment, &file->stream, &file_segment_methods, file);
+    if (retval != SDLOG_SUCCESS) {
+        sdlog_istream_destroy(&file->stream);
+        sdlog_free(file);
+        close(fd);
+        return retval;
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+#else
+
+sdlog_error_t sdlog_istream_init_concat_files(
+    sdlog_istream_t* stream, const char* path_template, uint32_t first_index)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdbool.h>
+
+#include <sdlog/byteorder.h>
+
+#include "config.h"
+#include "crc32c.h"
+
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC32C_SSE42 1
+#include <nmmintrin.h>
+#else
+#define CRC32C_SSE42 0
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+#define CRC32C_ARM 1
+#include <arm_acle.h>
+#else
+#define CRC32C_ARM 0
+#endif
+
+/** The CRC-32C polynomial, bit-reversed */
+#define POLYNOMIAL 0x82F63B78
+
+typedef uint32_t crc32c_func_t(uint32_t crc, const uint8_t* data, size_t length);
+
+/** Tables of the slicing-by-8 implementation */
+static uint32_t tables[8][256];
+
+/** The implementation chosen for this CPU */
+static crc32c_func_t* implementation;
+
+#if HAVE_PTHREAD
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+#endif
+
+static void init(void);
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t* data, size_t length);
+#if CRC32C_SSE42
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t* data, size_t length);
+#endif
+#if CRC32C_ARM
+static uint32_t crc32c_arm(uint32_t crc, const uint8_t* data, size_t length);
+#endif
+
+uint32_t sdlog_i_crc32c(uint32_t crc, const uint8_t* data, size_t length)
+{
+#if HAVE_PTHREAD
+    pthread_once(&init_once, init);
+#else
+    if (implementation == NULL) {
+        init();
+    }
+#endif
+
+    return ~implementation(~crc, data, length);
+}
+
+/** Fills the tables and chooses the fastest implementation for this CPU */
+static void init(void)
+{
+    uint32_t crc;
+    int i, j;
+
+    for (i = 0; i < 256; i++) {
+        crc = i;
+        for (j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (crc & 1 ? POLYNOMIAL : 0);
+        }
+        tables[0][i] = crc;
+    }
+
+    for (i = 0; i < 256; i++) {
+        for (j = 1; j < 8; j++) {
+            tables[j][i] = (tables[j - 1][i] >> 8) ^ tables[0][tables[j - 1][i] & 0xFF];
+        }
+    }
+
+    implementation = crc32c_sw;
+
+#if CRC32C_SSE42
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        implementation = crc32c_sse42;
+    }
+#endif
+
+#if CRC32C_ARM
+    implementation = crc32c_arm;
+#endif
+}
+
+/** Slicing-by-8: processes eight bytes per step with eight table lookups */
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t* data, size_t length)
+{
+    uint32_t lo, hi;
+
+    while (length >= 8) {
+        lo = sdlog_load_u32_le(data) ^ crc;
+        hi = sdlog_load_u32_le(data + 4);
+        crc = tables[7][lo & 0xFF] ^ tables[6][(lo >> 8) & 0xFF]
+            ^ tables[5][(lo >> 16) & 0xFF] ^ tables[4][lo >> 24]
+            ^ tables[3][hi & 0xFF] ^ tables[2][(hi >> 8) & 0xFF]
+            ^ tables[1][(hi >> 16) & 0xFF] ^ tables[0][hi >> 24];
+        data += 8;
+        length -= 8;
+    }
+
+    while (length > 0) {
+        crc = tables[0][(crc ^ *data) & 0xFF] ^ (crc >> 8);
+        data++;
+        length--;
+    }
+
+    return crc;
+}
+
+#if CRC32C_SSE42
+__attribute__((target("sse4.2"))) static uint32_t crc32c_sse42(
+    uint32_t crc, const uint8_t* data, size_t length)
+{
+#if defined(__x86_64__)
+    uint64_t crc64;
+
+    while (length > 0 && ((uintptr_t)data & 7)) {
+        crc = _mm_crc32_u8(crc, *data);
+        data++;
+        length--;
+    }
+
+    crc64 = crc;
+    while (length >= 8) {
+        crc64 = _mm_crc32_u64(crc64, sdlog_load_u64_le(data));
+        data += 8;
+        length -= 8;
+    }
+    crc = (uint32_t)crc64;
+#endif
+
+    while (length >= 4) {
+        crc = _mm_crc32_u32(crc, sdlog_load_u32_le(data));
+        data += 4;
+        length -= 4;
+    }
+
+    while (length > 0) {
+        crc = _mm_crc32_u8(crc, *data);
+        data++;
+        length--;
+    }
+
+    return crc;
+}
+#endif
+
+#if CRC32C_ARM
+static uint32_t crc32c_arm(uint32_t crc, const uint8_t* data, size_t length)
+{
+    while (length >= 8) {
+        crc = __crc32cd(crc, sdlog_load_u64_le(data));
+        data += 8;
+        length -= 8;
+    }
+
+    while (length > 0) {
+        crc = __crc32cb(crc, *data);
+        data++;
+        length--;
+    }
+
+    return crc;
+}
+#endif
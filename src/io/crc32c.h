@@ -0,0 +1,52 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SDLOG_CRC32C_H
+#define SDLOG_CRC32C_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <sdlog/decls.h>
+
+/**
+ * @file crc32c.h
+ * @brief Internal CRC-32C (Castagnoli) checksum
+ *
+ * Uses the CRC instructions of the CPU where available, detected at
+ * runtime on x86, and a slicing-by-8 table-driven implementation otherwise.
+ */
+
+__BEGIN_DECLS
+
+/**
+ * Extends a CRC-32C checksum with the given bytes. Start from zero; the
+ * checksum of a concatenation of two buffers can be computed by passing the
+ * checksum of the first buffer when processing the second.
+ */
+uint32_t sdlog_i_crc32c(uint32_t crc, const uint8_t* data, size_t length);
+
+__END_DECLS
+
+#endif
@@ -0,0 +1,898 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sdlog/memory.h>
+#include <sdlog/streams.h>
+
+#include "config.h"
+#include "stream_base.h"
+#include "syncer.h"
+
+#if HAVE_UNISTD_H
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Default size of the internal buffer of file descriptor based output streams.
+ */
+#define DEFAULT_BUFFER_SIZE (1024 * 1024)
+
+/**
+ * Maximum number of buffers submitted in a single vectored system call.
+ */
+#define MAX_IOV_BATCH 64
+
+#if HAVE_UNISTD_H
+
+typedef struct {
+    /** The file descriptor to read from */
+    int fd;
+} istream_context_t;
+
+typedef struct {
+    /** The file descriptor to write to */
+    int fd;
+
+    /** File status flags of the file descriptor before we touched it */
+    int original_flags;
+
+    /** Raw allocation holding the buffer */
+    uint8_t* alloc;
+
+    /** Start of the buffer, aligned to the page size */
+    uint8_t* buf;
+
+    /** Size of the buffer; a multiple of the alignment */
+    size_t capacity;
+
+    /** Number of bytes in the buffer */
+    size_t used;
+
+    /** Alignment of the buffer and of the writes in direct mode */
+    size_t alignment;
+
+    /** Offset in the file where the first byte of the buffer belongs */
+    off_t file_pos;
+
+    /** Offset of the end of the data written to the file in direct mode,
+     * including the partial block kept in the buffer */
+    off_t direct_end;
+
+    /** Syncs the data according to the durability policy; NULL if the data
+     * is never synced */
+    sdlog_i_syncer_t* syncer;
+
+    /** Offset of the end of the data last reported to the syncer */
+    uint64_t reported;
+
+    /** Number of bytes to preallocate when a session begins */
+    uint64_t preallocate;
+
+    /** Whether the file descriptor supports positioned writes */
+    bool seekable;
+
+    /** Whether we are writing with O_DIRECT */
+    bool direct;
+
+    /** Whether the file descriptor is a nonblocking pipe or socket; writes
+     * then accept only as many bytes as fit in the buffer */
+    bool nonblocking;
+
+    /** Whether the file may extend beyond the end of the data written so
+     * far, due to padding or preallocation, and needs to be truncated when
+     * the session ends */
+    bool needs_truncate;
+} ostream_context_t;
+
+static void fd_destroy_i(sdlog_istream_t* stream);
+static sdlog_error_t fd_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* bytes_read);
+static sdlog_error_t fd_get_fd_i(sdlog_istream_t* stream, int* fd);
+static sdlog_error_t fd_seek(sdlog_istream_t* stream, uint64_t offset);
+static sdlog_error_t fd_tell(sdlog_istream_t* stream, uint64_t* offset);
+static sdlog_error_t fd_read_at(
+    sdlog_istream_t* stream, uint64_t offset, uint8_t* data, size_t length,
+    size_t* bytes_read);
+
+static void fd_destroy_o(sdlog_ostream_t* stream);
+static sdlog_error_t fd_begin(sdlog_ostream_t* stream);
+static sdlog_error_t fd_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written);
+static sdlog_error_t fd_writev(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt, size_t* written);
+static sdlog_error_t fd_reserve(sdlog_ostream_t* stream, size_t length, uint8_t** ptr);
+static sdlog_error_t fd_commit(sdlog_ostream_t* stream, size_t length);
+static sdlog_error_t fd_flush(sdlog_ostream_t* stream);
+static sdlog_error_t fd_end(sdlog_ostream_t* stream);
+static sdlog_error_t fd_get_fd_o(sdlog_ostream_t* stream, int* fd);
+static sdlog_error_t fd_copy_range(
+    sdlog_ostream_t* stream, sdlog_istream_t* source, uint64_t offset,
+    size_t length, size_t* written);
+
+static ssize_t copy_from_fd(ostream_context_t* ctx, int fd, uint64_t offset, size_t length);
+static sdlog_error_t drain_buffer(ostream_context_t* ctx);
+static sdlog_error_t flush_buffer(ostream_context_t* ctx);
+static sdlog_error_t sync_written(ostream_context_t* ctx, bool flush);
+static sdlog_error_t write_at(ostream_context_t* ctx, const uint8_t* data, size_t length, off_t pos);
+#if HAVE_PWRITEV
+static sdlog_error_t writev_all(ostream_context_t* ctx, struct iovec* iov, int iovcnt);
+#endif
+
+const sdlog_istream_spec_t sdlog_istream_fd_methods = {
+    .destroy = fd_destroy_i,
+    .read = fd_read,
+    .get_fd = fd_get_fd_i,
+    .seek = fd_seek,
+    .tell = fd_tell,
+    .read_at = fd_read_at,
+};
+
+const sdlog_ostream_spec_t sdlog_ostream_fd_methods = {
+    .destroy = fd_destroy_o,
+    .begin = fd_begin,
+    .write = fd_write,
+    .writev = fd_writev,
+    .reserve = fd_reserve,
+    .commit = fd_commit,
+    .flush = fd_flush,
+    .end = fd_end,
+    .get_fd = fd_get_fd_o,
+    .copy_range = fd_copy_range,
+};
+
+sdlog_error_t sdlog_istream_init_fd(sdlog_istream_t* stream, int fd)
+{
+    istream_context_t* ctx;
+
+    if (fd < 0) {
+        return SDLOG_EINVAL;
+    }
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(istream_context_t)));
+    memset(ctx, 0, sizeof(istream_context_t));
+
+    ctx->fd = fd;
+
+    return sdlog_istream_init(stream, &sdlog_istream_fd_methods, ctx);
+}
+
+sdlog_error_t sdlog_ostream_init_fd(
+    sdlog_ostream_t* stream, int fd, const sdlog_fd_ostream_options_t* options)
+{
+    ostream_context_t* ctx;
+    size_t buffer_size = options && options->buffer_size > 0 ? options->buffer_size : DEFAULT_BUFFER_SIZE;
+    bool direct = options && options->direct;
+    bool durable = options && options->durability.mode != SDLOG_DURABILITY_NEVER;
+    sdlog_error_t retval;
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(ostream_context_t)));
+    memset(ctx, 0, sizeof(ostream_context_t));
+
+    ctx->fd = fd;
+    ctx->original_flags = fcntl(fd, F_GETFL);
+    ctx->alignment = page_size > 0 ? (size_t)page_size : 4096;
+    ctx->capacity = (buffer_size + ctx->alignment - 1) / ctx->alignment * ctx->alignment;
+    ctx->preallocate = options ? options->preallocate : 0;
+    ctx->file_pos = lseek(fd, 0, SEEK_CUR);
+    ctx->seekable = ctx->file_pos >= 0;
+    if (!ctx->seekable) {
+        ctx->file_pos = 0;
+    }
+    ctx->direct_end = ctx->file_pos;
+
+    /* Syncing needs a regular file */
+    if (ctx->original_flags < 0 || (durable && !ctx->seekable)) {
+        sdlog_free(ctx);
+        return SDLOG_EINVAL;
+    }
+
+    /* Nonblocking mode has no effect on regular files */
+    ctx->nonblocking = !ctx->seekable && (ctx->original_flags & O_NONBLOCK);
+
+    if (direct) {
+#if HAVE_O_DIRECT
+        /* Direct I/O needs positioned writes from an aligned starting offset */
+        if (!ctx->seekable || ctx->file_pos % ctx->alignment != 0) {
+            sdlog_free(ctx);
+            return SDLOG_EINVAL;
+        }
+
+        if (fcntl(fd, F_SETFL, ctx->original_flags | O_DIRECT) < 0) {
+            sdlog_free(ctx);
+            return SDLOG_EIO;
+        }
+
+        ctx->direct = true;
+#else
+        sdlog_free(ctx);
+        return SDLOG_UNIMPLEMENTED;
+#endif
+    }
+
+    ctx->alloc = sdlog_malloc(ctx->capacity + ctx->alignment);
+    if (ctx->alloc == NULL) {
+        fcntl(fd, F_SETFL, ctx->original_flags);
+        sdlog_free(ctx);
+        return SDLOG_ENOMEM;
+    }
+
+    ctx->buf = ctx->alloc + (ctx->alignment - (uintptr_t)ctx->alloc % ctx->alignment) % ctx->alignment;
+
+    if (durable) {
+        ctx->reported = ctx->file_pos;
+        retval = sdlog_i_syncer_create(&ctx->syncer, fd, &options->durability, ctx->file_pos);
+        if (retval != SDLOG_SUCCESS) {
+            if (ctx->direct) {
+                fcntl(fd, F_SETFL, ctx->original_flags);
+            }
+            sdlog_free(ctx->alloc);
+            sdlog_free(ctx);
+            return retval;
+        }
+    }
+
+    return sdlog_ostream_init(stream, &sdlog_ostream_fd_methods, ctx);
+}
+
+uint64_t sdlog_ostream_fd_get_durable_offset(sdlog_ostream_t* stream)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+    return ctx->syncer ? sdlog_i_syncer_get_durable_offset(ctx->syncer) : 0;
+}
+
+static void fd_destroy_i(sdlog_istream_t* stream)
+{
+    istream_context_t* ctx = CONTEXT_AS(istream_context_t);
+
+    memset(ctx, 0, sizeof(istream_context_t));
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t fd_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* bytes_read)
+{
+    istream_context_t* ctx = CONTEXT_AS(istream_context_t);
+    ssize_t result;
+
+    *bytes_read = 0;
+
+    do {
+        result = read(ctx->fd, data, length);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? SDLOG_SUCCESS : SDLOG_EREAD;
+    } else if (result == 0) {
+        return SDLOG_EOF;
+    }
+
+    *bytes_read = result;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t fd_get_fd_i(sdlog_istream_t* stream, int* fd)
+{
+    *fd = CONTEXT_AS(istream_context_t)->fd;
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t fd_seek(sdlog_istream_t* stream, uint64_t offset)
+{
+    istream_context_t* ctx = CONTEXT_AS(istream_context_t);
+
+    if (offset != (uint64_t)(off_t)offset || (off_t)offset < 0) {
+        return SDLOG_EINVAL;
+    }
+
+    if (lseek(ctx->fd, (off_t)offset, SEEK_SET) < 0) {
+        return errno == ESPIPE ? SDLOG_UNIMPLEMENTED : SDLOG_EIO;
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t fd_tell(sdlog_istream_t* stream, uint64_t* offset)
+{
+    istream_context_t* ctx = CONTEXT_AS(istream_context_t);
+    off_t pos = lseek(ctx->fd, 0, SEEK_CUR);
+
+    if (pos < 0) {
+        return errno == ESPIPE ? SDLOG_UNIMPLEMENTED : SDLOG_EIO;
+    }
+
+    *offset = pos;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t fd_read_at(
+    sdlog_istream_t* stream, uint64_t offset, uint8_t* data, size_t length,
+    size_t* bytes_read)
+{
+    return sdlog_i_fd_read_at(
+        CONTEXT_AS(istream_context_t)->fd, offset, data, length, bytes_read);
+}
+
+sdlog_error_t sdlog_i_fd_read_at(
+    int fd, uint64_t offset, uint8_t* data, size_t length, size_t* bytes_read)
+{
+    ssize_t result;
+
+    *bytes_read = 0;
+
+    if (offset != (uint64_t)(off_t)offset || (off_t)offset < 0) {
+        return SDLOG_EINVAL;
+    }
+
+    /* pread() leaves the file offset alone, so concurrent positional reads
+     * need no locking */
+    do {
+        result = pread(fd, data, length, (off_t)offset);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0) {
+        return errno == ESPIPE ? SDLOG_UNIMPLEMENTED : SDLOG_EREAD;
+    } else if (result == 0) {
+        return SDLOG_EOF;
+    }
+
+    *bytes_read = result;
+
+    return SDLOG_SUCCESS;
+}
+
+static void fd_destroy_o(sdlog_ostream_t* stream)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+
+    /* Buffered data would be lost otherwise */
+    fd_end(stream);
+    sdlog_i_syncer_destroy(ctx->syncer);
+
+    if (ctx->direct) {
+        fcntl(ctx->fd, F_SETFL, ctx->original_flags);
+    }
+
+    sdlog_free(ctx->alloc);
+    memset(ctx, 0, sizeof(ostream_context_t));
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t fd_begin(sdlog_ostream_t* stream)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+    off_t pos = ctx->file_pos + ctx->used;
+
+    if (ctx->preallocate == 0 || !ctx->seekable) {
+        return SDLOG_SUCCESS;
+    }
+
+    /* Preallocation is an optimization only; failures are not fatal */
+#if HAVE_FALLOCATE
+    if (fallocate(ctx->fd, FALLOC_FL_KEEP_SIZE, pos, ctx->preallocate) == 0) {
+        return SDLOG_SUCCESS;
+    }
+#endif
+
+#if HAVE_POSIX_FALLOCATE
+    if (posix_fallocate(ctx->fd, pos, ctx->preallocate) == 0) {
+        ctx->needs_truncate = true;
+    }
+#endif
+
+    (void)pos;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t fd_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+    size_t chunk;
+
+    /* Nonblocking writes take only what fits in the buffer after writing
+     * out as much of it as the file descriptor accepts */
+    if (ctx->nonblocking) {
+        if (ctx->capacity - ctx->used < length) {
+            SDLOG_CHECK(drain_buffer(ctx));
+        }
+
+        chunk = ctx->capacity - ctx->used;
+        *written = chunk < length ? chunk : length;
+        memcpy(ctx->buf + ctx->used, data, *written);
+        ctx->used += *written;
+
+        return SDLOG_SUCCESS;
+    }
+
+    /* Large writes bypass the buffer if it is empty and we are not in direct
+     * mode, which would need aligned memory */
+    if (ctx->used == 0 && length >= ctx->capacity && !ctx->direct) {
+        SDLOG_CHECK(write_at(ctx, data, length, ctx->file_pos));
+        ctx->file_pos += length;
+        *written = length;
+        return sync_written(ctx, false);
+    }
+
+    *written = 0;
+    while (length > 0) {
+        chunk = ctx->capacity - ctx->used;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        memcpy(ctx->buf + ctx->used, data, chunk);
+        ctx->used += chunk;
+        data += chunk;
+        length -= chunk;
+        *written += chunk;
+
+        if (ctx->used == ctx->capacity) {
+            SDLOG_CHECK(flush_buffer(ctx));
+        }
+    }
+
+    return sync_written(ctx, false);
+}
+
+static sdlog_error_t fd_writev(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt, size_t* written)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+    size_t i, total = 0, chunk;
+
+#if HAVE_PWRITEV
+    struct iovec batch[MAX_IOV_BATCH];
+    int n = 0;
+#endif
+
+    for (i = 0; i < iovcnt; i++) {
+        total += iov[i].length;
+    }
+
+#if HAVE_PWRITEV
+    /* Batches that do not fit in the buffer are submitted together with the
+     * contents of the buffer in as few system calls as possible. Direct mode
+     * needs aligned memory so it always goes through the buffer. */
+    if (!ctx->direct && !ctx->nonblocking && total > ctx->capacity - ctx->used) {
+        if (ctx->used > 0) {
+            batch[n].iov_base = ctx->buf;
+            batch[n].iov_len = ctx->used;
+            n++;
+        }
+
+        for (i = 0; i < iovcnt; i++) {
+            if (iov[i].length == 0) {
+                continue;
+            }
+
+            batch[n].iov_base = (void*)iov[i].data;
+            batch[n].iov_len = iov[i].length;
+            n++;
+
+            if (n == MAX_IOV_BATCH) {
+                SDLOG_CHECK(writev_all(ctx, batch, n));
+                n = 0;
+            }
+        }
+
+        if (n > 0) {
+            SDLOG_CHECK(writev_all(ctx, batch, n));
+        }
+
+        *written = total;
+        return sync_written(ctx, false);
+    }
+#endif
+
+    /* Small batches are simply copied into the buffer */
+    *written = 0;
+    for (i = 0; i < iovcnt; i++) {
+        if (iov[i].length > 0) {
+            SDLOG_CHECK(fd_write(stream, iov[i].data, iov[i].length, &chunk));
+            *written += chunk;
+
+            if (chunk < iov[i].length) {
+                break;
+            }
+        }
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t fd_reserve(sdlog_ostream_t* stream, size_t length, uint8_t** ptr)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+
+    if (ctx->capacity - ctx->used < length) {
+        SDLOG_CHECK(ctx->nonblocking ? drain_buffer(ctx) : flush_buffer(ctx));
+
+        /* In direct mode, the partial block stays in the buffer; in
+         * nonblocking mode, whatever the file descriptor did not accept */
+        if (ctx->capacity - ctx->used < length) {
+            return SDLOG_ELIMIT;
+        }
+    }
+
+    *ptr = ctx->buf + ctx->used;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t fd_commit(sdlog_ostream_t* stream, size_t length)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+
+    ctx->used += length;
+
+    if (ctx->used == ctx->capacity) {
+        SDLOG_CHECK(ctx->nonblocking ? drain_buffer(ctx) : flush_buffer(ctx));
+    }
+
+    return sync_written(ctx, false);
+}
+
+static sdlog_error_t fd_flush(sdlog_ostream_t* stream)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+
+    SDLOG_CHECK(flush_buffer(ctx));
+
+    /* Leave the file offset at the end of the data for the caller */
+    if (ctx->seekable && lseek(ctx->fd, ctx->file_pos + ctx->used, SEEK_SET) < 0) {
+        return SDLOG_EIO;
+    }
+
+    return sync_written(ctx, true);
+}
+
+static sdlog_error_t fd_end(sdlog_ostream_t* stream)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+
+    SDLOG_CHECK(fd_flush(stream));
+
+    if (ctx->needs_truncate) {
+        if (ftruncate(ctx->fd, ctx->file_pos + ctx->used) < 0) {
+            return SDLOG_EIO;
+        }
+        ctx->needs_truncate = false;
+    }
+
+    return ctx->syncer ? sdlog_i_syncer_wait(ctx->syncer) : SDLOG_SUCCESS;
+}
+
+static sdlog_error_t fd_get_fd_o(sdlog_ostream_t* stream, int* fd)
+{
+    *fd = CONTEXT_AS(ostream_context_t)->fd;
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t fd_copy_range(
+    sdlog_ostream_t* stream, sdlog_istream_t* source, uint64_t offset,
+    size_t length, size_t* written)
+{
+    ostream_context_t* ctx = CONTEXT_AS(ostream_context_t);
+    ssize_t result;
+    int fd;
+
+    *written = 0;
+
+    /* Direct mode needs aligned memory and nonblocking mode needs the
+     * buffer, so the data has to go through the buffer in both cases.
+     * Offsets of other streams with a file descriptor, such as filters that
+     * transform the data or concatenated streams, are not offsets in the
+     * file, so only plain file descriptor streams are copied from. */
+    if (ctx->direct || ctx->nonblocking || source->methods != &sdlog_istream_fd_methods) {
+        return SDLOG_UNIMPLEMENTED;
+    }
+
+    fd = ((istream_context_t*)source->context)->fd;
+
+    /* The buffered bytes precede the copied ones */
+    SDLOG_CHECK(flush_buffer(ctx));
+
+    while (*written < length) {
+        result = copy_from_fd(ctx, fd, offset + *written, length - *written);
+
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            /* The kernel cannot copy between these two file descriptors;
+             * report what was copied so far and let the caller fall back
+             * to copying through memory */
+            if (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EBADF
+                || errno == ESPIPE || errno == EOPNOTSUPP) {
+                if (*written == 0) {
+                    return SDLOG_UNIMPLEMENTED;
+                }
+                break;
+            }
+
+            return SDLOG_EWRITE;
+        } else if (result == 0) {
+            return *written > 0 ? sync_written(ctx, false) : SDLOG_EOF;
+        }
+
+        ctx->file_pos += result;
+        *written += result;
+    }
+
+    return sync_written(ctx, false);
+}
+
+/**
+ * Copies bytes from the given offset of another file descriptor to the end
+ * of the data in the file, without passing them through user space. Returns
+ * the number of bytes copied, or -1 with \c errno set.
+ */
+static ssize_t copy_from_fd(ostream_context_t* ctx, int fd, uint64_t offset, size_t length)
+{
+#if HAVE_COPY_FILE_RANGE || HAVE_SPLICE
+    loff_t in_pos = offset;
+    loff_t out_pos = ctx->file_pos;
+#endif
+
+    if (ctx->seekable) {
+#if HAVE_COPY_FILE_RANGE
+        return copy_file_range(fd, &in_pos, ctx->fd, &out_pos, length, 0);
+#endif
+    } else {
+#if HAVE_SPLICE
+        /* splice() needs a pipe on one side; other unseekable file
+         * descriptors such as sockets fail with EINVAL */
+        return splice(fd, &in_pos, ctx->fd, NULL, length, 0);
+#endif
+    }
+
+#if HAVE_COPY_FILE_RANGE || HAVE_SPLICE
+    (void)in_pos;
+    (void)out_pos;
+#endif
+    errno = ENOSYS;
+
+    return -1;
+}
+
+/**
+ * Writes as much of the buffer to a nonblocking file descriptor as it
+ * accepts without blocking and moves the rest to the front of the buffer.
+ */
+static sdlog_error_t drain_buffer(ostream_context_t* ctx)
+{
+    ssize_t result;
+    size_t done = 0;
+
+    while (done < ctx->used) {
+        result = write(ctx->fd, ctx->buf + done, ctx->used - done);
+
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return SDLOG_EWRITE;
+        } else if (result == 0) {
+            return SDLOG_EWRITE;
+        }
+
+        done += result;
+    }
+
+    memmove(ctx->buf, ctx->buf + done, ctx->used - done);
+    ctx->file_pos += done;
+    ctx->used -= done;
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Writes the contents of the buffer to the file. In direct mode the last,
+ * partially filled block is padded with zeros and written as a whole; it is
+ * then kept in the buffer so it can be completed and rewritten in place
+ * later, and the padding is truncated when the session ends.
+ */
+static sdlog_error_t flush_buffer(ostream_context_t* ctx)
+{
+    size_t padded, aligned;
+
+    if (ctx->used == 0) {
+        return SDLOG_SUCCESS;
+    }
+
+    if (!ctx->direct) {
+        SDLOG_CHECK(write_at(ctx, ctx->buf, ctx->used, ctx->file_pos));
+        ctx->file_pos += ctx->used;
+        ctx->used = 0;
+        return SDLOG_SUCCESS;
+    }
+
+    padded = (ctx->used + ctx->alignment - 1) / ctx->alignment * ctx->alignment;
+    aligned = ctx->used / ctx->alignment * ctx->alignment;
+
+    memset(ctx->buf + ctx->used, 0, padded - ctx->used);
+    SDLOG_CHECK(write_at(ctx, ctx->buf, padded, ctx->file_pos));
+
+    if (padded > ctx->used) {
+        ctx->needs_truncate = true;
+    }
+
+    ctx->direct_end = ctx->file_pos + ctx->used;
+
+    memmove(ctx->buf, ctx->buf + aligned, ctx->used - aligned);
+    ctx->file_pos += aligned;
+    ctx->used -= aligned;
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Reports the data written to the file so far to the syncer, if any. Hands
+ * the buffered data to the operating system first if the durability policy
+ * needs it to be synced.
+ */
+static sdlog_error_t sync_written(ostream_context_t* ctx, bool flush)
+{
+    uint64_t end;
+
+    if (ctx->syncer == NULL) {
+        return SDLOG_SUCCESS;
+    }
+
+    if (ctx->used > 0 && sdlog_i_syncer_is_due(ctx->syncer, ctx->file_pos + ctx->used)) {
+        SDLOG_CHECK(flush_buffer(ctx));
+    }
+
+    end = ctx->direct ? ctx->direct_end : ctx->file_pos;
+    if (end == ctx->reported && !flush) {
+        return SDLOG_SUCCESS;
+    }
+
+    ctx->reported = end;
+
+    return sdlog_i_syncer_written(ctx->syncer, end, flush);
+}
+
+/**
+ * Writes the whole buffer at the given file offset, retrying partial writes
+ * and waiting for nonblocking file descriptors to become writable.
+ */
+static sdlog_error_t write_at(ostream_context_t* ctx, const uint8_t* data, size_t length, off_t pos)
+{
+    ssize_t result;
+
+    while (length > 0) {
+        result = ctx->seekable
+            ? pwrite(ctx->fd, data, length, pos)
+            : write(ctx->fd, data, length);
+
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                SDLOG_CHECK(sdlog_i_wait_for_fd(ctx->fd, true));
+                continue;
+            }
+            return SDLOG_EWRITE;
+        } else if (result == 0) {
+            return SDLOG_EWRITE;
+        }
+
+        data += result;
+        length -= result;
+        pos += result;
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+#if HAVE_PWRITEV
+/**
+ * Writes all the given buffers at the current file position of the stream,
+ * retrying partial writes, and advances the file position. The array is
+ * modified in place while partial writes are retried. When the first buffer
+ * is the buffer of the stream, it is considered emptied.
+ */
+static sdlog_error_t writev_all(ostream_context_t* ctx, struct iovec* iov, int iovcnt)
+{
+    ssize_t result;
+    size_t done;
+
+    if (iovcnt > 0 && iov[0].iov_base == ctx->buf) {
+        /* The contents of the buffer go out with this batch */
+        ctx->used = 0;
+    }
+
+    while (iovcnt > 0) {
+        result = ctx->seekable
+            ? pwritev(ctx->fd, iov, iovcnt, ctx->file_pos)
+            : writev(ctx->fd, iov, iovcnt);
+
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return SDLOG_EWRITE;
+        } else if (result == 0) {
+            return SDLOG_EWRITE;
+        }
+
+        ctx->file_pos += result;
+
+        done = result;
+        while (iovcnt > 0 && done >= iov->iov_len) {
+            done -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t*)iov->iov_base + done;
+            iov->iov_len -= done;
+        }
+    }
+
+    return SDLOG_SUCCESS;
+}
+#endif
+
+#else
+
+const sdlog_istream_spec_t sdlog_istream_fd_methods = { 0 };
+const sdlog_ostream_spec_t sdlog_ostream_fd_methods = { 0 };
+
+sdlog_error_t sdlog_istream_init_fd(sdlog_istream_t* stream, int fd)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+sdlog_error_t sdlog_ostream_init_fd(
+    sdlog_ostream_t* stream, int fd, const sdlog_fd_ostream_options_t* options)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+uint64_t sdlog_ostream_fd_get_durable_offset(sdlog_ostream_t* stream)
+{
+    return 0;
+}
+
+#endif
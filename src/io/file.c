@@ -22,32 +22,58 @@
  * SOFTWARE.
  */
 
+#include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <sdlog/memory.h>
 #include <sdlog/streams.h>
 
+#include "config.h"
 #include "stream_base.h"
+#include "syncer.h"
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 typedef struct {
     FILE* fp;
+
+    /** Syncs the data according to the durability policy; NULL if the data
+     * is never synced */
+    sdlog_i_syncer_t* syncer;
+
+    /** Offset of the end of the data written so far in the file */
+    uint64_t offset;
 } context_t;
 
 static void file_destroy_i(sdlog_istream_t* stream);
 static void file_destroy_o(sdlog_ostream_t* stream);
+static sdlog_error_t file_end(sdlog_ostream_t* stream);
 static sdlog_error_t file_flush(sdlog_ostream_t* stream);
 static sdlog_error_t file_read(
     sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read);
+static sdlog_error_t file_seek(sdlog_istream_t* stream, uint64_t offset);
+static sdlog_error_t file_tell(sdlog_istream_t* stream, uint64_t* offset);
+static sdlog_error_t file_read_at(
+    sdlog_istream_t* stream, uint64_t offset, uint8_t* data, size_t length,
+    size_t* read);
 static sdlog_error_t file_write(
     sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written);
 
 const sdlog_istream_spec_t sdlog_istream_file_methods = {
     .destroy = file_destroy_i,
     .read = file_read,
+    .seek = file_seek,
+    .tell = file_tell,
+    .read_at = file_read_at,
 };
 
 const sdlog_ostream_spec_t sdlog_ostream_file_methods = {
     .destroy = file_destroy_o,
+    .end = file_end,
     .flush = file_flush,
     .write = file_write,
 };
@@ -67,11 +93,52 @@ sdlog_error_t sdlog_ostream_init_file(sdlog_ostream_t* stream, FILE* fp)
     context_t* ctx;
 
     SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(context_t)));
+    memset(ctx, 0, sizeof(context_t));
     ctx->fp = fp;
 
     return sdlog_ostream_init(stream, &sdlog_ostream_file_methods, ctx);
 }
 
+sdlog_error_t sdlog_ostream_file_set_durability(
+    sdlog_ostream_t* stream, const sdlog_durability_t* durability)
+{
+#if HAVE_UNISTD_H
+    context_t* ctx = CONTEXT_AS(context_t);
+    sdlog_i_syncer_t* syncer = NULL;
+    long pos;
+    int fd;
+
+    if (durability->mode != SDLOG_DURABILITY_NEVER) {
+        /* Syncing needs a regular file; memory streams have no descriptor */
+        fd = fileno(ctx->fp);
+        pos = ftell(ctx->fp);
+        if (fd < 0 || pos < 0) {
+            return SDLOG_EINVAL;
+        }
+
+        if (fflush(ctx->fp)) {
+            return SDLOG_EWRITE;
+        }
+
+        SDLOG_CHECK(sdlog_i_syncer_create(&syncer, fd, durability, pos));
+        ctx->offset = pos;
+    }
+
+    sdlog_i_syncer_destroy(ctx->syncer);
+    ctx->syncer = syncer;
+
+    return SDLOG_SUCCESS;
+#else
+    return SDLOG_UNIMPLEMENTED;
+#endif
+}
+
+uint64_t sdlog_ostream_file_get_durable_offset(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    return ctx->syncer ? sdlog_i_syncer_get_durable_offset(ctx->syncer) : 0;
+}
+
 static void file_destroy_i(sdlog_istream_t* stream)
 {
     context_t* ctx = CONTEXT_AS(context_t);
@@ -82,6 +149,14 @@ static void file_destroy_i(sdlog_istream_t* stream)
 static void file_destroy_o(sdlog_ostream_t* stream)
 {
     context_t* ctx = CONTEXT_AS(context_t);
+
+    if (ctx->syncer) {
+        /* The data must leave the stdio buffer before it can be synced */
+        fflush(ctx->fp);
+        sdlog_i_syncer_written(ctx->syncer, ctx->offset, true);
+        sdlog_i_syncer_destroy(ctx->syncer);
+    }
+
     ctx->fp = NULL;
     sdlog_free(ctx);
 }
@@ -103,10 +178,74 @@ static sdlog_error_t file_read(
     return SDLOG_SUCCESS;
 }
 
+static sdlog_error_t file_seek(sdlog_istream_t* stream, uint64_t offset)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    if (offset > LONG_MAX) {
+        return SDLOG_EINVAL;
+    }
+
+    if (fseek(ctx->fp, (long)offset, SEEK_SET)) {
+        return errno == ESPIPE ? SDLOG_UNIMPLEMENTED : SDLOG_EIO;
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t file_tell(sdlog_istream_t* stream, uint64_t* offset)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    long pos = ftell(ctx->fp);
+
+    if (pos < 0) {
+        return errno == ESPIPE ? SDLOG_UNIMPLEMENTED : SDLOG_EIO;
+    }
+
+    *offset = pos;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t file_read_at(
+    sdlog_istream_t* stream, uint64_t offset, uint8_t* data, size_t length,
+    size_t* read)
+{
+#if HAVE_UNISTD_H
+    /* stdio keeps a single position per file, so positional reads go to the
+     * file descriptor directly, bypassing the stdio buffer */
+    int fd = fileno(CONTEXT_AS(context_t)->fp);
+
+    if (fd >= 0) {
+        return sdlog_i_fd_read_at(fd, offset, data, length, read);
+    }
+#endif
+
+    *read = 0;
+    return SDLOG_UNIMPLEMENTED;
+}
+
+static sdlog_error_t file_end(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    if (ctx->syncer == NULL) {
+        return SDLOG_SUCCESS;
+    }
+
+    SDLOG_CHECK(file_flush(stream));
+    return sdlog_i_syncer_wait(ctx->syncer);
+}
+
 static sdlog_error_t file_flush(sdlog_ostream_t* stream)
 {
     context_t* ctx = CONTEXT_AS(context_t);
-    return fflush(ctx->fp) ? SDLOG_EWRITE : SDLOG_SUCCESS;
+
+    if (fflush(ctx->fp)) {
+        return SDLOG_EWRITE;
+    }
+
+    return ctx->syncer ? sdlog_i_syncer_written(ctx->syncer, ctx->offset, true) : SDLOG_SUCCESS;
 }
 
 static sdlog_error_t file_write(
@@ -116,5 +255,22 @@ static sdlog_error_t file_write(
     *written = fwrite(data, sizeof(uint8_t), length, ctx->fp);
 
     /* fwrite() returns a short read count only if a write error has occurred */
-    return *written == length ? SDLOG_SUCCESS : SDLOG_EWRITE;
+    if (*written != length) {
+        return SDLOG_EWRITE;
+    }
+
+    if (ctx->syncer) {
+        ctx->offset += length;
+
+        /* We cannot tell how much of the data stdio passed on already, so
+         * the data is reported to the syncer only after an explicit flush */
+        if (sdlog_i_syncer_is_due(ctx->syncer, ctx->offset)) {
+            if (fflush(ctx->fp)) {
+                return SDLOG_EWRITE;
+            }
+            SDLOG_CHECK(sdlog_i_syncer_written(ctx->syncer, ctx->offset, false));
+        }
+    }
+
+    return SDLOG_SUCCESS;
 }
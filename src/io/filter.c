@@ -0,0 +1,345 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sdlog/memory.h>
+#include <sdlog/streams.h>
+
+#include "stream_base.h"
+
+/*
+ * The method table of a filter stream lives in its context. It is a copy of
+ * the table supplied by the user where the missing methods are replaced by
+ * ones that forward to the inner stream, so overridden methods are called
+ * without an extra indirection.
+ */
+
+typedef struct {
+    /** The stream that the filter reads from; not owned */
+    sdlog_istream_t* inner;
+
+    /** Context of the user-supplied methods */
+    void* context;
+
+    /** Destructor of the user, if any */
+    void (*destroy)(sdlog_istream_t* stream);
+
+    /** The resolved method table of the stream */
+    sdlog_istream_spec_t methods;
+} istream_context_t;
+
+typedef struct {
+    /** The stream that the filter writes to; not owned */
+    sdlog_ostream_t* inner;
+
+    /** Context of the user-supplied methods */
+    void* context;
+
+    /** Destructor of the user, if any */
+    void (*destroy)(sdlog_ostream_t* stream);
+
+    /** The resolved method table of the stream */
+    sdlog_ostream_spec_t methods;
+} ostream_context_t;
+
+static void filter_destroy_i(sdlog_istream_t* stream);
+static sdlog_error_t forward_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read);
+static sdlog_error_t forward_get_fd_i(sdlog_istream_t* stream, int* fd);
+static sdlog_error_t forward_seek(sdlog_istream_t* stream, uint64_t offset);
+static sdlog_error_t forward_tell(sdlog_istream_t* stream, uint64_t* offset);
+static sdlog_error_t forward_read_at(
+    sdlog_istream_t* stream, uint64_t offset, uint8_t* data, size_t length,
+    size_t* read);
+
+static void filter_destroy_o(sdlog_ostream_t* stream);
+static sdlog_error_t forward_begin(sdlog_ostream_t* stream);
+static sdlog_error_t forward_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written);
+static sdlog_error_t forward_writev(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt, size_t* written);
+static sdlog_error_t forward_reserve(sdlog_ostream_t* stream, size_t length, uint8_t** ptr);
+static sdlog_error_t forward_commit(sdlog_ostream_t* stream, size_t length);
+static sdlog_error_t forward_flush(sdlog_ostream_t* stream);
+static sdlog_error_t forward_end(sdlog_ostream_t* stream);
+static sdlog_error_t forward_get_fd_o(sdlog_ostream_t* stream, int* fd);
+static sdlog_error_t forward_copy_range(
+    sdlog_ostream_t* stream, sdlog_istream_t* source, uint64_t offset,
+    size_t length, size_t* written);
+
+sdlog_error_t sdlog_istream_init_filter(
+    sdlog_istream_t* stream, sdlog_istream_t* inner,
+    const sdlog_istream_spec_t* spec, void* ctx)
+{
+    istream_context_t* filter;
+    sdlog_error_t retval;
+    bool transforms;
+
+    SDLOG_CHECK_OOM(filter = sdlog_malloc(sizeof(istream_context_t)));
+    memset(filter, 0, sizeof(istream_context_t));
+
+    filter->inner = inner;
+    filter->context = ctx;
+
+    if (spec) {
+        filter->methods = *spec;
+        filter->destroy = spec->destroy;
+    }
+
+    /* Positions of the inner stream mean nothing to a filter that changes
+     * the data read from it */
+    transforms = filter->methods.read != NULL;
+
+    filter->methods.destroy = filter_destroy_i;
+    if (!filter->methods.read) {
+        filter->methods.read = forward_read;
+    }
+    if (!filter->methods.seek && !transforms) {
+        filter->methods.seek = forward_seek;
+    }
+    if (!filter->methods.tell && !transforms) {
+        filter->methods.tell = forward_tell;
+    }
+    if (!filter->methods.read_at && !transforms) {
+        filter->methods.read_at = forward_read_at;
+    }
+    if (!filter->methods.get_fd) {
+        filter->methods.get_fd = forward_get_fd_i;
+    }
+
+    SDLOG_CHECK(sdlog_istream_init(stream, &filter->methods, filter));
+
+    /* The stream is ready for use by the time the user initializes it */
+    retval = filter->methods.init ? filter->methods.init(stream) : SDLOG_SUCCESS;
+    if (retval != SDLOG_SUCCESS) {
+        sdlog_free(filter);
+        memset(stream, 0, sizeof(sdlog_istream_t));
+    }
+
+    return retval;
+}
+
+sdlog_istream_t* sdlog_istream_filter_get_inner(sdlog_istream_t* stream)
+{
+    return CONTEXT_AS(istream_context_t)->inner;
+}
+
+void* sdlog_istream_filter_get_context(sdlog_istream_t* stream)
+{
+    return CONTEXT_AS(istream_context_t)->context;
+}
+
+sdlog_error_t sdlog_ostream_init_filter(
+    sdlog_ostream_t* stream, sdlog_ostream_t* inner,
+    const sdlog_ostream_spec_t* spec, void* ctx)
+{
+    ostream_context_t* filter;
+    sdlog_error_t retval;
+    bool transforms;
+
+    SDLOG_CHECK_OOM(filter = sdlog_malloc(sizeof(ostream_context_t)));
+    memset(filter, 0, sizeof(ostream_context_t));
+
+    filter->inner = inner;
+    filter->context = ctx;
+
+    if (spec) {
+        filter->methods = *spec;
+        filter->destroy = spec->destroy;
+    }
+
+    /* A filter that handles the written data itself must see all of it, so
+     * vectored writes, reservations and copies are forwarded only if none of
+     * the data methods are overridden */
+    transforms = filter->methods.write || filter->methods.writev || filter->methods.reserve;
+
+    filter->methods.destroy = filter_destroy_o;
+    if (!filter->methods.begin) {
+        filter->methods.begin = forward_begin;
+    }
+    if (!filter->methods.write) {
+        filter->methods.write = forward_write;
+    }
+    if (!filter->methods.writev && !transforms) {
+        filter->methods.writev = forward_writev;
+    }
+    if (!filter->methods.reserve && !transforms) {
+        filter->methods.reserve = forward_reserve;
+        filter->methods.commit = forward_commit;
+    }
+    if (!filter->methods.flush) {
+        filter->methods.flush = forward_flush;
+    }
+    if (!filter->methods.end) {
+        filter->methods.end = forward_end;
+    }
+    if (!filter->methods.get_fd) {
+        filter->methods.get_fd = forward_get_fd_o;
+    }
+    if (!filter->methods.copy_range && !transforms) {
+        filter->methods.copy_range = forward_copy_range;
+    }
+
+    SDLOG_CHECK(sdlog_ostream_init(stream, &filter->methods, filter));
+
+    retval = filter->methods.init ? filter->methods.init(stream) : SDLOG_SUCCESS;
+    if (retval != SDLOG_SUCCESS) {
+        sdlog_free(filter);
+        memset(stream, 0, sizeof(sdlog_ostream_t));
+    }
+
+    return retval;
+}
+
+sdlog_ostream_t* sdlog_ostream_filter_get_inner(sdlog_ostream_t* stream)
+{
+    return CONTEXT_AS(ostream_context_t)->inner;
+}
+
+void* sdlog_ostream_filter_get_context(sdlog_ostream_t* stream)
+{
+    return CONTEXT_AS(ostream_context_t)->context;
+}
+
+sdlog_error_t sdlog_ostream_filter_write_inner(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* bytes_written)
+{
+    sdlog_ostream_t* inner = CONTEXT_AS(ostream_context_t)->inner;
+
+    return bytes_written
+        ? sdlog_ostream_write(inner, data, length, bytes_written)
+        : sdlog_ostream_write_all(inner, data, length);
+}
+
+static void filter_destroy_i(sdlog_istream_t* stream)
+{
+    istream_context_t* filter = CONTEXT_AS(istream_context_t);
+
+    if (filter->destroy) {
+        filter->destroy(stream);
+    }
+
+    memset(filter, 0, sizeof(istream_context_t));
+    sdlog_free(filter);
+}
+
+static sdlog_error_t forward_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read)
+{
+    return sdlog_istream_read(CONTEXT_AS(istream_context_t)->inner, data, length, read);
+}
+
+static sdlog_error_t forward_get_fd_i(sdlog_istream_t* stream, int* fd)
+{
+    return sdlog_istream_get_fd(CONTEXT_AS(istream_context_t)->inner, fd);
+}
+
+static sdlog_error_t forward_seek(sdlog_istream_t* stream, uint64_t offset)
+{
+    return sdlog_istream_seek(CONTEXT_AS(istream_context_t)->inner, offset);
+}
+
+static sdlog_error_t forward_tell(sdlog_istream_t* stream, uint64_t* offset)
+{
+    return sdlog_istream_tell(CONTEXT_AS(istream_context_t)->inner, offset);
+}
+
+static sdlog_error_t forward_read_at(
+    sdlog_istream_t* stream, uint64_t offset, uint8_t* data, size_t length,
+    size_t* read)
+{
+    return sdlog_istream_read_at(CONTEXT_AS(istream_context_t)->inner, offset, data, length, read);
+}
+
+static void filter_destroy_o(sdlog_ostream_t* stream)
+{
+    ostream_context_t* filter = CONTEXT_AS(ostream_context_t);
+
+    if (filter->destroy) {
+        filter->destroy(stream);
+    }
+
+    memset(filter, 0, sizeof(ostream_context_t));
+    sdlog_free(filter);
+}
+
+static sdlog_error_t forward_begin(sdlog_ostream_t* stream)
+{
+    return sdlog_ostream_begin_session(CONTEXT_AS(ostream_context_t)->inner);
+}
+
+static sdlog_error_t forward_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    return sdlog_ostream_write(CONTEXT_AS(ostream_context_t)->inner, data, length, written);
+}
+
+static sdlog_error_t forward_writev(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt, size_t* written)
+{
+    return sdlog_ostream_writev(CONTEXT_AS(ostream_context_t)->inner, iov, iovcnt, written);
+}
+
+static sdlog_error_t forward_reserve(sdlog_ostream_t* stream, size_t length, uint8_t** ptr)
+{
+    return sdlog_ostream_reserve(CONTEXT_AS(ostream_context_t)->inner, length, ptr);
+}
+
+static sdlog_error_t forward_commit(sdlog_ostream_t* stream, size_t length)
+{
+    return sdlog_ostream_commit(CONTEXT_AS(ostream_context_t)->inner, length);
+}
+
+static sdlog_error_t forward_flush(sdlog_ostream_t* stream)
+{
+    return sdlog_ostream_flush(CONTEXT_AS(ostream_context_t)->inner);
+}
+
+static sdlog_error_t forward_end(sdlog_ostream_t* stream)
+{
+    return sdlog_ostream_end_session(CONTEXT_AS(ostream_context_t)->inner);
+}
+
+static sdlog_error_t forward_get_fd_o(sdlog_ostream_t* stream, int* fd)
+{
+    return sdlog_ostream_get_fd(CONTEXT_AS(ostream_context_t)->inner, fd);
+}
+
+static sdlog_error_t forward_copy_range(
+    sdlog_ostream_t* stream, sdlog_istream_t* source, uint64_t offset,
+    size_t length, size_t* written)
+{
+    sdlog_ostream_t* inner = CONTEXT_AS(ostream_context_t)->inner;
+
+    *written = 0;
+
+    if (!inner->methods->copy_range) {
+        return SDLOG_UNIMPLEMENTED;
+    }
+
+    return inner->methods->copy_range(inner, source, offset, length, written);
+}
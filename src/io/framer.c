@@ -0,0 +1,211 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "framer.h"
+
+static void learn(sdlog_i_framer_t* framer, const uint8_t* record, size_t length);
+static int is_valid_prefix(const sdlog_i_framer_t* framer, const uint8_t* data, size_t length);
+
+void sdlog_i_framer_init(sdlog_i_framer_t* framer)
+{
+    memset(framer, 0, sizeof(sdlog_i_framer_t));
+    framer->lengths[SDLOG_ID_FMT] = SDLOG_I_FMT_RECORD_LENGTH;
+}
+
+sdlog_error_t sdlog_i_framer_feed(
+    sdlog_i_framer_t* framer, const uint8_t* data, size_t length,
+    sdlog_i_framer_callback_t* callback, void* arg)
+{
+    size_t record_length, chunk;
+
+    while (length > 0) {
+        if (framer->partial_length == 0) {
+            if (!is_valid_prefix(framer, data, length)) {
+                framer->bytes_skipped++;
+                framer->position++;
+                data++;
+                length--;
+                continue;
+            }
+
+            /* Complete records are passed on without copying */
+            if (length >= SDLOG_I_RECORD_HEADER_LENGTH) {
+                record_length = framer->lengths[data[2]];
+                if (length >= record_length) {
+                    learn(framer, data, record_length);
+                    framer->record_start = framer->position;
+                    framer->position += record_length;
+                    SDLOG_CHECK(callback(arg, data, record_length));
+                    data += record_length;
+                    length -= record_length;
+                    continue;
+                }
+            }
+
+            memcpy(framer->partial, data, length);
+            framer->partial_length = length;
+            framer->partial_start = framer->position;
+            framer->position += length;
+            return SDLOG_SUCCESS;
+        }
+
+        /* Complete the header of the partial record first */
+        if (framer->partial_length < SDLOG_I_RECORD_HEADER_LENGTH) {
+            framer->partial[framer->partial_length++] = *data;
+            framer->position++;
+            data++;
+            length--;
+
+            if (!is_valid_prefix(framer, framer->partial, framer->partial_length)) {
+                /* Resynchronize on the bytes after the first one */
+                uint8_t rest[SDLOG_I_RECORD_HEADER_LENGTH];
+
+                chunk = framer->partial_length - 1;
+                memcpy(rest, framer->partial + 1, chunk);
+                framer->partial_length = 0;
+                framer->bytes_skipped++;
+                framer->position = framer->partial_start + 1;
+                SDLOG_CHECK(sdlog_i_framer_feed(framer, rest, chunk, callback, arg));
+                continue;
+            }
+
+            if (framer->partial_length < SDLOG_I_RECORD_HEADER_LENGTH) {
+                continue;
+            }
+        }
+
+        record_length = framer->lengths[framer->partial[2]];
+        chunk = record_length - framer->partial_length;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        memcpy(framer->partial + framer->partial_length, data, chunk);
+        framer->partial_length += chunk;
+        framer->position += chunk;
+        data += chunk;
+        length -= chunk;
+
+        if (framer->partial_length == record_length) {
+            framer->partial_length = 0;
+            learn(framer, framer->partial, record_length);
+            framer->record_start = framer->partial_start;
+            SDLOG_CHECK(callback(arg, framer->partial, record_length));
+        }
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+size_t sdlog_i_framer_get_complete(
+    const sdlog_i_framer_t* framer, uint64_t fed,
+    const uint8_t* pending, size_t pending_length,
+    const sdlog_iovec_t* iov, size_t iovcnt, sdlog_iovec_t* parts)
+{
+    uint64_t remaining = sdlog_i_framer_get_boundary(framer) - (fed - pending_length);
+    size_t i, n = 0;
+
+    if (pending_length > 0 && remaining > 0) {
+        parts[n].data = pending;
+        parts[n].length = remaining < pending_length ? remaining : pending_length;
+        remaining -= parts[n].length;
+        n++;
+    }
+
+    for (i = 0; i < iovcnt && remaining > 0; i++) {
+        parts[n].data = iov[i].data;
+        parts[n].length = remaining < iov[i].length ? remaining : iov[i].length;
+        remaining -= parts[n].length;
+        n++;
+    }
+
+    return n;
+}
+
+void sdlog_i_framer_keep_incomplete(
+    const sdlog_i_framer_t* framer, uint64_t fed,
+    uint8_t* pending, size_t* pending_length,
+    const sdlog_iovec_t* iov, size_t iovcnt)
+{
+    uint64_t boundary = sdlog_i_framer_get_boundary(framer);
+    uint64_t skip = boundary > fed ? boundary - fed : 0;
+    size_t i, chunk, length = 0;
+
+    if (boundary < fed) {
+        length = fed - boundary;
+        memmove(pending, pending + *pending_length - length, length);
+    }
+
+    for (i = 0; i < iovcnt; i++) {
+        if (skip >= iov[i].length) {
+            skip -= iov[i].length;
+            continue;
+        }
+        chunk = iov[i].length - skip;
+        memcpy(pending + length, iov[i].data + skip, chunk);
+        length += chunk;
+        skip = 0;
+    }
+
+    *pending_length = length;
+}
+
+int sdlog_i_format_table_remember(
+    sdlog_i_format_table_t* table, const uint8_t* record, size_t length)
+{
+    uint8_t id;
+
+    if (!sdlog_i_record_is_fmt(record, length)) {
+        return 0;
+    }
+
+    id = record[3];
+    memcpy(table->records[id], record, SDLOG_I_FMT_RECORD_LENGTH);
+    table->present[id] = 1;
+
+    return 1;
+}
+
+/** Learns the length of records from an FMT record */
+static void learn(sdlog_i_framer_t* framer, const uint8_t* record, size_t length)
+{
+    if (!sdlog_i_record_is_fmt(record, length) || record[3] == SDLOG_ID_FMT) {
+        return;
+    }
+
+    framer->lengths[record[3]] = record[4] >= SDLOG_I_RECORD_HEADER_LENGTH ? record[4] : 0;
+}
+
+/**
+ * Returns whether the given bytes may be the start of a record that the
+ * framer can frame.
+ */
+static int is_valid_prefix(const sdlog_i_framer_t* framer, const uint8_t* data, size_t length)
+{
+    return data[0] == 0xA3
+        && (length < 2 || data[1] == 0x95)
+        && (length < 3 || framer->lengths[data[2]] > 0);
+}
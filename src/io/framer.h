@@ -0,0 +1,167 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SDLOG_FRAMER_H
+#define SDLOG_FRAMER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <sdlog/decls.h>
+#include <sdlog/error.h>
+#include <sdlog/model.h>
+#include <sdlog/streams.h>
+
+/**
+ * @file framer.h
+ * @brief Internal helper that splits a raw byte stream into log records
+ *
+ * Streams that need to know where records start and end (for instance,
+ * to avoid tearing records or to re-emit FMT records) feed the bytes they
+ * receive to a framer. The framer learns the lengths of the records from the
+ * FMT records passing through it and reports each complete record to a
+ * callback. Bytes that cannot be framed are skipped until the next valid
+ * record header.
+ */
+
+__BEGIN_DECLS
+
+/** Length of an FMT record, including the record header */
+#define SDLOG_I_FMT_RECORD_LENGTH 89
+
+/** Length of the header preceding each record */
+#define SDLOG_I_RECORD_HEADER_LENGTH 3
+
+/**
+ * Callback that the framer calls for each complete record. The record is
+ * valid only during the call.
+ */
+typedef sdlog_error_t sdlog_i_framer_callback_t(
+    void* arg, const uint8_t* record, size_t length);
+
+typedef struct {
+    /** Length of the records with each message ID, including the record
+     * header; zero if no FMT record was seen for the ID yet */
+    uint8_t lengths[SDLOG_NUM_MESSAGE_FORMATS];
+
+    /** Record that is being assembled from multiple chunks of input */
+    uint8_t partial[SDLOG_MAX_MESSAGE_LENGTH];
+
+    /** Number of bytes in \c partial */
+    size_t partial_length;
+
+    /** Number of bytes skipped because they could not be framed */
+    uint64_t bytes_skipped;
+
+    /** Number of bytes fed to the framer so far */
+    uint64_t position;
+
+    /** Position of the first byte of the record in \c partial */
+    uint64_t partial_start;
+
+    /** Position of the first byte of the record that is being reported to
+     * the callback; valid only during the callback */
+    uint64_t record_start;
+} sdlog_i_framer_t;
+
+void sdlog_i_framer_init(sdlog_i_framer_t* framer);
+
+/**
+ * Feeds some bytes to the framer and calls the callback for each record
+ * completed by them. Complete records are passed to the callback straight
+ * from the input when possible. Stops at the first error returned from the
+ * callback; the remaining bytes are discarded in this case.
+ */
+sdlog_error_t sdlog_i_framer_feed(
+    sdlog_i_framer_t* framer, const uint8_t* data, size_t length,
+    sdlog_i_framer_callback_t* callback, void* arg);
+
+/**
+ * Returns the position in the input where the record that is not complete
+ * yet starts, or the number of bytes fed so far if there is no such record.
+ * Everything before this position was either framed or skipped.
+ */
+static inline uint64_t sdlog_i_framer_get_boundary(const sdlog_i_framer_t* framer)
+{
+    return framer->partial_length > 0 ? framer->partial_start : framer->position;
+}
+
+/**
+ * Helper for streams that pass on complete records only. \c pending holds
+ * the bytes fed to the framer earlier that were not passed on yet; they
+ * start at a record boundary. \c fed is the number of bytes fed to the
+ * framer before the bytes in \c iov. Fills \c parts with the buffers that
+ * hold the bytes up to the current boundary, starting with \c pending, and
+ * returns their number. \c parts must have room for
+ * <code>iovcnt + 1</code> items.
+ */
+size_t sdlog_i_framer_get_complete(
+    const sdlog_i_framer_t* framer, uint64_t fed,
+    const uint8_t* pending, size_t pending_length,
+    const sdlog_iovec_t* iov, size_t iovcnt, sdlog_iovec_t* parts);
+
+/**
+ * Counterpart of \ref sdlog_i_framer_get_complete(), to be called once the
+ * complete records were passed on. Replaces the contents of \c pending with
+ * the bytes after the current boundary. \c pending must have room for
+ * \c SDLOG_MAX_MESSAGE_LENGTH bytes.
+ */
+void sdlog_i_framer_keep_incomplete(
+    const sdlog_i_framer_t* framer, uint64_t fed,
+    uint8_t* pending, size_t* pending_length,
+    const sdlog_iovec_t* iov, size_t iovcnt);
+
+/**
+ * Returns the length of records with the given message ID, including the
+ * record header, or zero if the length is not known yet.
+ */
+static inline size_t sdlog_i_framer_get_length(const sdlog_i_framer_t* framer, uint8_t id)
+{
+    return framer->lengths[id];
+}
+
+/**
+ * Returns whether the given record is an FMT record.
+ */
+static inline int sdlog_i_record_is_fmt(const uint8_t* record, size_t length)
+{
+    return length == SDLOG_I_FMT_RECORD_LENGTH && record[2] == SDLOG_ID_FMT;
+}
+
+/** Table of FMT records, indexed by the message ID they define */
+typedef struct {
+    uint8_t records[SDLOG_NUM_MESSAGE_FORMATS][SDLOG_I_FMT_RECORD_LENGTH];
+    uint8_t present[SDLOG_NUM_MESSAGE_FORMATS];
+} sdlog_i_format_table_t;
+
+/**
+ * Stores the given record in the table if it is an FMT record. Returns
+ * whether the record was stored.
+ */
+int sdlog_i_format_table_remember(
+    sdlog_i_format_table_t* table, const uint8_t* record, size_t length);
+
+__END_DECLS
+
+#endif
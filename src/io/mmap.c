@@ -0,0 +1,297 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sdlog/memory.h>
+#include <sdlog/streams.h>
+
+#include "config.h"
+#include "stream_base.h"
+
+#if HAVE_UNISTD_H && HAVE_SYS_MMAN_H
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Default size of the mapped window of memory-mapped output streams.
+ */
+#define DEFAULT_WINDOW_SIZE (16 * 1024 * 1024)
+
+#if HAVE_UNISTD_H && HAVE_SYS_MMAN_H
+
+typedef struct {
+    /** The file descriptor of the mapped file; owned by the stream */
+    int fd;
+
+    /** Start of the mapped window, or \c NULL if nothing is mapped */
+    uint8_t* map;
+
+    /** Offset in the file where the mapped window starts; page-aligned */
+    off_t map_offset;
+
+    /** Length of the mapped window */
+    size_t map_length;
+
+    /** Preferred length of a mapped window; a multiple of the page size */
+    size_t window;
+
+    /** Page size of the system */
+    size_t page_size;
+
+    /** Number of bytes written to the file so far */
+    off_t length;
+
+    /** Number of bytes allocated in the file */
+    off_t file_size;
+
+    /** Number of bytes from the start of the file that were already
+     * scheduled for writing back to the disk */
+    off_t synced;
+} context_t;
+
+static void mmap_destroy_o(sdlog_ostream_t* stream);
+static sdlog_error_t mmap_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written);
+static sdlog_error_t mmap_reserve(sdlog_ostream_t* stream, size_t length, uint8_t** ptr);
+static sdlog_error_t mmap_commit(sdlog_ostream_t* stream, size_t length);
+static sdlog_error_t mmap_flush(sdlog_ostream_t* stream);
+static sdlog_error_t mmap_end(sdlog_ostream_t* stream);
+
+static sdlog_error_t ensure_mapped(context_t* ctx, size_t length);
+static sdlog_error_t unmap(context_t* ctx);
+
+const sdlog_ostream_spec_t sdlog_ostream_mmap_methods = {
+    .destroy = mmap_destroy_o,
+    .write = mmap_write,
+    .flush = mmap_flush,
+    .end = mmap_end,
+    .reserve = mmap_reserve,
+    .commit = mmap_commit,
+};
+
+sdlog_error_t sdlog_ostream_init_mmap(
+    sdlog_ostream_t* stream, const char* path, uint64_t prealloc_bytes)
+{
+    context_t* ctx;
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(context_t)));
+    memset(ctx, 0, sizeof(context_t));
+
+    ctx->page_size = page_size > 0 ? (size_t)page_size : 4096;
+    if (prealloc_bytes == 0) {
+        prealloc_bytes = DEFAULT_WINDOW_SIZE;
+    } else if (prealloc_bytes > SIZE_MAX / 2) {
+        /* Cannot map this much at once */
+        sdlog_free(ctx);
+        return SDLOG_EINVAL;
+    }
+    ctx->window = (prealloc_bytes + ctx->page_size - 1) / ctx->page_size * ctx->page_size;
+
+    ctx->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (ctx->fd < 0) {
+        sdlog_free(ctx);
+        return SDLOG_EIO;
+    }
+
+    return sdlog_ostream_init(stream, &sdlog_ostream_mmap_methods, ctx);
+}
+
+static void mmap_destroy_o(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    /* Trailing preallocated space would remain in the file otherwise */
+    mmap_end(stream);
+
+    close(ctx->fd);
+    memset(ctx, 0, sizeof(context_t));
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t mmap_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    SDLOG_CHECK(ensure_mapped(ctx, length));
+    memcpy(ctx->map + (ctx->length - ctx->map_offset), data, length);
+    ctx->length += length;
+    *written = length;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t mmap_reserve(sdlog_ostream_t* stream, size_t length, uint8_t** ptr)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    SDLOG_CHECK(ensure_mapped(ctx, length));
+    *ptr = ctx->map + (ctx->length - ctx->map_offset);
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t mmap_commit(sdlog_ostream_t* stream, size_t length)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    ctx->length += length;
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t mmap_flush(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    off_t start;
+
+    if (ctx->map == NULL || ctx->length <= ctx->synced) {
+        return SDLOG_SUCCESS;
+    }
+
+    /* Schedule the write-back of the pages modified since the last flush
+     * without waiting for it to complete */
+    start = ctx->synced > ctx->map_offset ? ctx->synced : ctx->map_offset;
+    start -= (start - ctx->map_offset) % ctx->page_size;
+    if (msync(ctx->map + (start - ctx->map_offset), ctx->length - start, MS_ASYNC) < 0) {
+        return SDLOG_EIO;
+    }
+
+    ctx->synced = ctx->length;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t mmap_end(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    SDLOG_CHECK(mmap_flush(stream));
+    SDLOG_CHECK(unmap(ctx));
+
+    /* Cut off the preallocated space that was not used */
+    if (ctx->file_size > ctx->length) {
+        if (ftruncate(ctx->fd, ctx->length) < 0) {
+            return SDLOG_EIO;
+        }
+        ctx->file_size = ctx->length;
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Ensures that the given number of bytes after the end of the data are
+ * allocated in the file and mapped into memory. Moves the window forward
+ * if needed so that it starts at the page containing the end of the data.
+ */
+static sdlog_error_t ensure_mapped(context_t* ctx, size_t length)
+{
+    off_t offset, end;
+    size_t map_length;
+    void* map;
+
+    if (ctx->map != NULL && ctx->length + (off_t)length <= ctx->map_offset + (off_t)ctx->map_length) {
+        return SDLOG_SUCCESS;
+    }
+
+    SDLOG_CHECK(unmap(ctx));
+
+    offset = ctx->length - ctx->length % ctx->page_size;
+    map_length = ctx->window;
+    if (map_length < (ctx->length - offset) + length) {
+        map_length = ((ctx->length - offset) + length + ctx->page_size - 1) / ctx->page_size * ctx->page_size;
+    }
+    end = offset + map_length;
+
+    /* Allocate the disk space upfront; stores to a mapping beyond the end
+     * of the file, or to blocks that cannot be allocated, would raise
+     * SIGBUS instead of an error */
+    if (ctx->file_size < end) {
+#if HAVE_FALLOCATE
+        if (fallocate(ctx->fd, 0, ctx->file_size, end - ctx->file_size) < 0) {
+            if (errno == ENOSPC) {
+                return SDLOG_EWRITE;
+            }
+            if (ftruncate(ctx->fd, end) < 0) {
+                return SDLOG_EWRITE;
+            }
+        }
+#else
+        if (ftruncate(ctx->fd, end) < 0) {
+            return SDLOG_EWRITE;
+        }
+#endif
+        ctx->file_size = end;
+    }
+
+    map = mmap(NULL, map_length, PROT_READ | PROT_WRITE, MAP_SHARED, ctx->fd, offset);
+    if (map == MAP_FAILED) {
+        return errno == ENOMEM ? SDLOG_ENOMEM : SDLOG_EIO;
+    }
+
+    ctx->map = map;
+    ctx->map_offset = offset;
+    ctx->map_length = map_length;
+
+    return SDLOG_SUCCESS;
+}
+
+/** Unmaps the current window, if any */
+static sdlog_error_t unmap(context_t* ctx)
+{
+    if (ctx->map == NULL) {
+        return SDLOG_SUCCESS;
+    }
+
+    if (munmap(ctx->map, ctx->map_length) < 0) {
+        return SDLOG_EIO;
+    }
+
+    ctx->map = NULL;
+    ctx->map_offset = 0;
+    ctx->map_length = 0;
+
+    return SDLOG_SUCCESS;
+}
+
+#else
+
+const sdlog_ostream_spec_t sdlog_ostream_mmap_methods = { 0 };
+
+sdlog_error_t sdlog_ostream_init_mmap(
+    sdlog_ostream_t* stream, const char* path, uint64_t prealloc_bytes)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+#endif
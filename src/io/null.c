@@ -22,17 +22,57 @@
  * SOFTWARE.
  */
 
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include <sdlog/memory.h>
 #include <sdlog/streams.h>
 
+#include "clock.h"
+#include "config.h"
 #include "stream_base.h"
 
+#if HAVE_UNISTD_H
+#include <errno.h>
+#include <time.h>
+#endif
+
+typedef struct {
+    /** Statistics collected so far */
+    sdlog_counting_ostream_stats_t stats;
+
+    /** Parameters of the simulated device */
+    uint32_t latency_us;
+    uint32_t flush_latency_us;
+    uint64_t bandwidth;
+
+    /** Time when the simulated device completes the operations submitted so
+     * far, in nanoseconds on the clock of \ref sdlog_i_clock_now_us() */
+    uint64_t busy_until_ns;
+
+    /** Scratch buffer handed out by reserve */
+    uint8_t* scratch;
+    size_t scratch_size;
+} context_t;
+
 static sdlog_error_t null_read(
     sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read);
 static sdlog_error_t null_write(
     sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written);
 
+static void counting_destroy(sdlog_ostream_t* stream);
+static sdlog_error_t counting_begin(sdlog_ostream_t* stream);
+static sdlog_error_t counting_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written);
+static sdlog_error_t counting_writev(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt, size_t* written);
+static sdlog_error_t counting_reserve(sdlog_ostream_t* stream, size_t length, uint8_t** ptr);
+static sdlog_error_t counting_commit(sdlog_ostream_t* stream, size_t length);
+static sdlog_error_t counting_flush(sdlog_ostream_t* stream);
+
+static void simulate(context_t* ctx, uint32_t latency_us, size_t length);
+
 const sdlog_istream_spec_t sdlog_istream_null_methods = {
     .read = null_read,
 };
@@ -41,6 +81,16 @@ const sdlog_ostream_spec_t sdlog_ostream_null_methods = {
     .write = null_write,
 };
 
+const sdlog_ostream_spec_t sdlog_ostream_counting_methods = {
+    .destroy = counting_destroy,
+    .begin = counting_begin,
+    .write = counting_write,
+    .writev = counting_writev,
+    .reserve = counting_reserve,
+    .commit = counting_commit,
+    .flush = counting_flush,
+};
+
 sdlog_error_t sdlog_istream_init_null(sdlog_istream_t* stream)
 {
     return sdlog_istream_init(stream, &sdlog_istream_null_methods, NULL);
@@ -51,6 +101,42 @@ sdlog_error_t sdlog_ostream_init_null(sdlog_ostream_t* stream)
     return sdlog_ostream_init(stream, &sdlog_ostream_null_methods, NULL);
 }
 
+sdlog_error_t sdlog_ostream_init_counting(
+    sdlog_ostream_t* stream, const sdlog_counting_ostream_options_t* options)
+{
+    context_t* ctx;
+
+#if !HAVE_UNISTD_H
+    if (options && (options->latency_us || options->flush_latency_us || options->bandwidth)) {
+        return SDLOG_UNIMPLEMENTED;
+    }
+#endif
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(context_t)));
+    memset(ctx, 0, sizeof(context_t));
+
+    if (options) {
+        ctx->latency_us = options->latency_us;
+        ctx->flush_latency_us = options->flush_latency_us;
+        ctx->bandwidth = options->bandwidth;
+    }
+
+    return sdlog_ostream_init(stream, &sdlog_ostream_counting_methods, ctx);
+}
+
+void sdlog_ostream_counting_get_stats(
+    sdlog_ostream_t* stream, sdlog_counting_ostream_stats_t* stats)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    *stats = ctx->stats;
+}
+
+void sdlog_ostream_counting_reset_stats(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+}
+
 static sdlog_error_t null_read(
     sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read)
 {
@@ -63,3 +149,113 @@ static sdlog_error_t null_write(
     *written = length;
     return SDLOG_SUCCESS;
 }
+
+static void counting_destroy(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    sdlog_free(ctx->scratch);
+    memset(ctx, 0, sizeof(context_t));
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t counting_begin(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    ctx->stats.sessions++;
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t counting_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    ctx->stats.bytes += length;
+    ctx->stats.writes++;
+    simulate(ctx, ctx->latency_us, length);
+
+    *written = length;
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t counting_writev(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt, size_t* written)
+{
+    size_t i, total = 0;
+
+    for (i = 0; i < iovcnt; i++) {
+        total += iov[i].length;
+    }
+
+    return counting_write(stream, NULL, total, written);
+}
+
+static sdlog_error_t counting_reserve(sdlog_ostream_t* stream, size_t length, uint8_t** ptr)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    uint8_t* scratch;
+
+    if (length > ctx->scratch_size) {
+        SDLOG_CHECK_OOM(scratch = sdlog_realloc(ctx->scratch, ctx->scratch_size, length));
+        ctx->scratch = scratch;
+        ctx->scratch_size = length;
+    }
+
+    *ptr = ctx->scratch;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t counting_commit(sdlog_ostream_t* stream, size_t length)
+{
+    size_t written;
+    return counting_write(stream, NULL, length, &written);
+}
+
+static sdlog_error_t counting_flush(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    ctx->stats.flushes++;
+    simulate(ctx, ctx->flush_latency_us, 0);
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Submits an operation with the given latency and length to the simulated
+ * device and waits until the device completes it.
+ */
+static void simulate(context_t* ctx, uint32_t latency_us, size_t length)
+{
+#if HAVE_UNISTD_H
+    uint64_t now_ns, duration_ns;
+    struct timespec ts;
+
+    duration_ns = (uint64_t)latency_us * 1000;
+    if (ctx->bandwidth > 0) {
+        duration_ns += (uint64_t)((double)length * 1e9 / ctx->bandwidth);
+    }
+
+    if (duration_ns == 0) {
+        return;
+    }
+
+    /* Operations queue up behind each other on the device */
+    now_ns = sdlog_i_clock_now_us() * 1000;
+    if (ctx->busy_until_ns < now_ns) {
+        ctx->busy_until_ns = now_ns;
+    }
+    ctx->busy_until_ns += duration_ns;
+
+    duration_ns = ctx->busy_until_ns - now_ns;
+    ctx->stats.delay_us += duration_ns / 1000;
+
+    ts.tv_sec = duration_ns / 1000000000;
+    ts.tv_nsec = duration_ns % 1000000000;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+        /* Interrupted; sleep for the rest of the time */
+    }
+#endif
+}
@@ -0,0 +1,477 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sdlog/memory.h>
+#include <sdlog/streams.h>
+
+#include "config.h"
+
+#if HAVE_POLL_H || HAVE_SYS_EPOLL_H
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#if HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+#if HAVE_POLL_H
+#include <poll.h>
+#endif
+
+/**
+ * Maximum number of file descriptors reported by a single epoll wait.
+ */
+#define MAX_EPOLL_BATCH 64
+
+#if HAVE_POLL_H || HAVE_SYS_EPOLL_H
+
+/*
+ * The poller keeps one entry per file descriptor. Entries are allocated
+ * individually so the epoll instance can refer to them directly even when
+ * the array of entries grows or shrinks.
+ */
+
+typedef struct {
+    /** The file descriptor that the streams in this entry use */
+    int fd;
+
+    /** The input stream registered with the file descriptor, if any */
+    sdlog_istream_t* istream;
+
+    /** The argument that the input stream was registered with */
+    void* istream_arg;
+
+    /** The output stream registered with the file descriptor, if any */
+    sdlog_ostream_t* ostream;
+
+    /** The argument that the output stream was registered with */
+    void* ostream_arg;
+} entry_t;
+
+static sdlog_error_t add_entry(
+    sdlog_poller_t* poller, int fd, sdlog_istream_t* istream,
+    sdlog_ostream_t* ostream, void* arg);
+static sdlog_error_t remove_entry(
+    sdlog_poller_t* poller, int fd, sdlog_istream_t* istream,
+    sdlog_ostream_t* ostream);
+static size_t find_entry(sdlog_poller_t* poller, int fd);
+static sdlog_error_t update_interest(sdlog_poller_t* poller, entry_t* entry, bool added);
+static size_t report(
+    entry_t* entry, unsigned int flags, sdlog_poll_event_t* events, size_t max_events);
+
+sdlog_error_t sdlog_poller_init(sdlog_poller_t* poller)
+{
+    memset(poller, 0, sizeof(sdlog_poller_t));
+    poller->fd = -1;
+
+#if HAVE_SYS_EPOLL_H
+    poller->fd = epoll_create1(EPOLL_CLOEXEC);
+#if !HAVE_POLL_H
+    if (poller->fd < 0) {
+        return SDLOG_EIO;
+    }
+#endif
+#endif
+
+    return SDLOG_SUCCESS;
+}
+
+void sdlog_poller_destroy(sdlog_poller_t* poller)
+{
+    entry_t** entries = poller->entries;
+    size_t i;
+
+    for (i = 0; i < poller->count; i++) {
+        sdlog_free(entries[i]);
+    }
+
+    sdlog_free(entries);
+
+    if (poller->fd >= 0) {
+        close(poller->fd);
+    }
+
+    memset(poller, 0, sizeof(sdlog_poller_t));
+    poller->fd = -1;
+}
+
+sdlog_error_t sdlog_poller_add_istream(
+    sdlog_poller_t* poller, sdlog_istream_t* stream, void* arg)
+{
+    int fd;
+
+    SDLOG_CHECK(sdlog_istream_get_fd(stream, &fd));
+
+    return add_entry(poller, fd, stream, NULL, arg);
+}
+
+sdlog_error_t sdlog_poller_add_ostream(
+    sdlog_poller_t* poller, sdlog_ostream_t* stream, void* arg)
+{
+    int fd;
+
+    SDLOG_CHECK(sdlog_ostream_get_fd(stream, &fd));
+
+    return add_entry(poller, fd, NULL, stream, arg);
+}
+
+sdlog_error_t sdlog_poller_remove_istream(sdlog_poller_t* poller, sdlog_istream_t* stream)
+{
+    int fd;
+
+    SDLOG_CHECK(sdlog_istream_get_fd(stream, &fd));
+
+    return remove_entry(poller, fd, stream, NULL);
+}
+
+sdlog_error_t sdlog_poller_remove_ostream(sdlog_poller_t* poller, sdlog_ostream_t* stream)
+{
+    int fd;
+
+    SDLOG_CHECK(sdlog_ostream_get_fd(stream, &fd));
+
+    return remove_entry(poller, fd, NULL, stream);
+}
+
+sdlog_error_t sdlog_poller_wait(
+    sdlog_poller_t* poller, sdlog_poll_event_t* events, size_t max_events,
+    int timeout_ms, size_t* count)
+{
+    unsigned int flags;
+    size_t i, n = 0;
+    int result;
+
+#if HAVE_SYS_EPOLL_H
+    struct epoll_event ready[MAX_EPOLL_BATCH];
+#endif
+
+#if HAVE_POLL_H
+    entry_t** entries = poller->entries;
+    struct pollfd* pfds;
+#endif
+
+    *count = 0;
+
+    if (max_events == 0) {
+        return SDLOG_EINVAL;
+    }
+
+    /* Both backends are level-triggered, so readiness that does not fit in
+     * the output array is reported again by the next wait */
+
+#if HAVE_SYS_EPOLL_H
+    if (poller->fd >= 0) {
+        result = epoll_wait(
+            poller->fd, ready, max_events < MAX_EPOLL_BATCH ? max_events : MAX_EPOLL_BATCH,
+            timeout_ms);
+        if (result < 0) {
+            return errno == EINTR ? SDLOG_SUCCESS : SDLOG_EIO;
+        }
+
+        for (i = 0; i < (size_t)result && n < max_events; i++) {
+            flags = 0;
+            if (ready[i].events & EPOLLIN) {
+                flags |= SDLOG_POLL_READABLE;
+            }
+            if (ready[i].events & EPOLLOUT) {
+                flags |= SDLOG_POLL_WRITABLE;
+            }
+            if (ready[i].events & EPOLLHUP) {
+                flags |= SDLOG_POLL_HANGUP;
+            }
+            if (ready[i].events & EPOLLERR) {
+                flags |= SDLOG_POLL_ERROR;
+            }
+            n += report(ready[i].data.ptr, flags, events + n, max_events - n);
+        }
+
+        *count = n;
+        return SDLOG_SUCCESS;
+    }
+#endif
+
+#if HAVE_POLL_H
+    if (poller->count == 0) {
+        pfds = NULL;
+    } else {
+        SDLOG_CHECK_OOM(pfds = sdlog_malloc(poller->count * sizeof(struct pollfd)));
+    }
+
+    for (i = 0; i < poller->count; i++) {
+        pfds[i].fd = entries[i]->fd;
+        pfds[i].events = (entries[i]->istream ? POLLIN : 0) | (entries[i]->ostream ? POLLOUT : 0);
+        pfds[i].revents = 0;
+    }
+
+    result = poll(pfds, poller->count, timeout_ms);
+    if (result < 0) {
+        sdlog_free(pfds);
+        return errno == EINTR ? SDLOG_SUCCESS : SDLOG_EIO;
+    }
+
+    for (i = 0; i < poller->count && n < max_events; i++) {
+        flags = 0;
+        if (pfds[i].revents & POLLIN) {
+            flags |= SDLOG_POLL_READABLE;
+        }
+        if (pfds[i].revents & POLLOUT) {
+            flags |= SDLOG_POLL_WRITABLE;
+        }
+        if (pfds[i].revents & POLLHUP) {
+            flags |= SDLOG_POLL_HANGUP;
+        }
+        if (pfds[i].revents & (POLLERR | POLLNVAL)) {
+            flags |= SDLOG_POLL_ERROR;
+        }
+        n += report(entries[i], flags, events + n, max_events - n);
+    }
+
+    sdlog_free(pfds);
+    *count = n;
+#endif
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t add_entry(
+    sdlog_poller_t* poller, int fd, sdlog_istream_t* istream,
+    sdlog_ostream_t* ostream, void* arg)
+{
+    entry_t** entries = poller->entries;
+    entry_t* entry;
+    size_t capacity, index = find_entry(poller, fd);
+    sdlog_error_t retval;
+
+    if (index < poller->count) {
+        entry = entries[index];
+        if ((istream && entry->istream) || (ostream && entry->ostream)) {
+            return SDLOG_EINVAL;
+        }
+    } else {
+        if (poller->count == poller->capacity) {
+            capacity = poller->capacity > 0 ? poller->capacity * 2 : 8;
+            SDLOG_CHECK_OOM(entries = sdlog_realloc(
+                                entries, poller->capacity * sizeof(entry_t*),
+                                capacity * sizeof(entry_t*)));
+            poller->entries = entries;
+            poller->capacity = capacity;
+        }
+
+        SDLOG_CHECK_OOM(entry = sdlog_malloc(sizeof(entry_t)));
+        memset(entry, 0, sizeof(entry_t));
+        entry->fd = fd;
+    }
+
+    if (istream) {
+        entry->istream = istream;
+        entry->istream_arg = arg;
+    } else {
+        entry->ostream = ostream;
+        entry->ostream_arg = arg;
+    }
+
+    retval = update_interest(poller, entry, index == poller->count);
+    if (retval != SDLOG_SUCCESS) {
+        if (index < poller->count) {
+            /* Restore the registration of the other stream */
+            if (istream) {
+                entry->istream = NULL;
+            } else {
+                entry->ostream = NULL;
+            }
+        } else {
+            sdlog_free(entry);
+        }
+        return retval;
+    }
+
+    if (index == poller->count) {
+        entries[poller->count++] = entry;
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t remove_entry(
+    sdlog_poller_t* poller, int fd, sdlog_istream_t* istream,
+    sdlog_ostream_t* ostream)
+{
+    entry_t** entries = poller->entries;
+    entry_t* entry;
+    size_t index = find_entry(poller, fd);
+
+    if (index == poller->count) {
+        return SDLOG_EINVAL;
+    }
+
+    entry = entries[index];
+    if (istream) {
+        if (entry->istream != istream) {
+            return SDLOG_EINVAL;
+        }
+        entry->istream = NULL;
+    } else {
+        if (entry->ostream != ostream) {
+            return SDLOG_EINVAL;
+        }
+        entry->ostream = NULL;
+    }
+
+    if (entry->istream || entry->ostream) {
+        return update_interest(poller, entry, false);
+    }
+
+#if HAVE_SYS_EPOLL_H
+    /* The file descriptor may have been closed already; nothing to undo then */
+    if (poller->fd >= 0) {
+        epoll_ctl(poller->fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+#endif
+
+    sdlog_free(entry);
+    entries[index] = entries[--poller->count];
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Returns the index of the entry of the given file descriptor, or the number
+ * of entries if the file descriptor is not registered.
+ */
+static size_t find_entry(sdlog_poller_t* poller, int fd)
+{
+    entry_t** entries = poller->entries;
+    size_t i;
+
+    for (i = 0; i < poller->count; i++) {
+        if (entries[i]->fd == fd) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/**
+ * Tells the epoll instance which events the streams of an entry wait for.
+ * No-op when the poller falls back to \c poll, which receives the events
+ * with each wait.
+ */
+static sdlog_error_t update_interest(sdlog_poller_t* poller, entry_t* entry, bool added)
+{
+#if HAVE_SYS_EPOLL_H
+    struct epoll_event event;
+
+    if (poller->fd >= 0) {
+        memset(&event, 0, sizeof(event));
+        event.events = (entry->istream ? EPOLLIN : 0) | (entry->ostream ? EPOLLOUT : 0);
+        event.data.ptr = entry;
+
+        if (epoll_ctl(poller->fd, added ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, entry->fd, &event) < 0) {
+            return errno == EBADF || errno == EPERM ? SDLOG_EINVAL : SDLOG_EIO;
+        }
+    }
+#endif
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Stores the events for the streams of an entry that the given readiness
+ * flags concern. Returns the number of events stored.
+ */
+static size_t report(
+    entry_t* entry, unsigned int flags, sdlog_poll_event_t* events, size_t max_events)
+{
+    unsigned int common = flags & (SDLOG_POLL_HANGUP | SDLOG_POLL_ERROR);
+    size_t n = 0;
+
+    if (entry->istream && (flags & SDLOG_POLL_READABLE || common) && n < max_events) {
+        events[n].istream = entry->istream;
+        events[n].ostream = NULL;
+        events[n].arg = entry->istream_arg;
+        events[n].flags = (flags & SDLOG_POLL_READABLE) | common;
+        n++;
+    }
+
+    if (entry->ostream && (flags & SDLOG_POLL_WRITABLE || common) && n < max_events) {
+        events[n].istream = NULL;
+        events[n].ostream = entry->ostream;
+        events[n].arg = entry->ostream_arg;
+        events[n].flags = (flags & SDLOG_POLL_WRITABLE) | common;
+        n++;
+    }
+
+    return n;
+}
+
+#else
+
+sdlog_error_t sdlog_poller_init(sdlog_poller_t* poller)
+{
+    memset(poller, 0, sizeof(sdlog_poller_t));
+    poller->fd = -1;
+    return SDLOG_UNIMPLEMENTED;
+}
+
+void sdlog_poller_destroy(sdlog_poller_t* poller)
+{
+}
+
+sdlog_error_t sdlog_poller_add_istream(
+    sdlog_poller_t* poller, sdlog_istream_t* stream, void* arg)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+sdlog_error_t sdlog_poller_add_ostream(
+    sdlog_poller_t* poller, sdlog_ostream_t* stream, void* arg)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+sdlog_error_t sdlog_poller_remove_istream(sdlog_poller_t* poller, sdlog_istream_t* stream)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+sdlog_error_t sdlog_poller_remove_ostream(sdlog_poller_t* poller, sdlog_ostream_t* stream)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+sdlog_error_t sdlog_poller_wait(
+    sdlog_poller_t* poller, sdlog_poll_event_t* events, size_t max_events,
+    int timeout_ms, size_t* count)
+{
+    *count = 0;
+    return SDLOG_UNIMPLEMENTED;
+}
+
+#endif
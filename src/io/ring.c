@@ -0,0 +1,367 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sdlog/memory.h>
+#include <sdlog/streams.h>
+
+#include "clock.h"
+#include "framer.h"
+#include "stream_base.h"
+
+/**
+ * Size of the header stored in front of each record in the ring: the length
+ * of the record (one byte) and the time when it was written (eight bytes).
+ */
+#define ENTRY_HEADER_LENGTH 9
+
+/**
+ * Largest region that can be reserved in the ring: an FMT record followed by
+ * the record that needs it, which is what writers reserve at most.
+ */
+#define MAX_RESERVED_LENGTH (SDLOG_I_FMT_RECORD_LENGTH + SDLOG_MAX_MESSAGE_LENGTH)
+
+typedef struct {
+    /** Storage area of the ring */
+    uint8_t* data;
+
+    /** Size of the storage area */
+    size_t capacity;
+
+    /** Offset of the oldest entry in the storage area */
+    size_t head;
+
+    /** Number of bytes used in the storage area */
+    size_t used;
+
+    /** Framer that splits the incoming bytes into records */
+    sdlog_i_framer_t framer;
+
+    /** FMT records in effect for the oldest entry in the ring. Updated
+     * whenever an FMT record is overwritten. */
+    sdlog_i_format_table_t* base_formats;
+
+    /** Scratch table used while dumping the ring */
+    sdlog_i_format_table_t* dump_formats;
+
+    /** Number of records that did not fit in the ring at all */
+    uint64_t records_dropped;
+} context_t;
+
+static void ring_destroy_o(sdlog_ostream_t* stream);
+static sdlog_error_t ring_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written);
+static sdlog_error_t ring_reserve(sdlog_ostream_t* stream, size_t length, uint8_t** ptr);
+static sdlog_error_t ring_commit(sdlog_ostream_t* stream, size_t length);
+
+static sdlog_error_t store_record(void* arg, const uint8_t* record, size_t length);
+static sdlog_error_t store_record_in_place(void* arg, const uint8_t* record, size_t length);
+static void write_entry_header(context_t* ctx, size_t offset, size_t length);
+static void evict_oldest(context_t* ctx);
+static void copy_in(context_t* ctx, size_t offset, const uint8_t* src, size_t length);
+static void copy_out(const context_t* ctx, size_t offset, uint8_t* dest, size_t length);
+
+const sdlog_ostream_spec_t sdlog_ostream_ring_methods = {
+    .destroy = ring_destroy_o,
+    .write = ring_write,
+    .reserve = ring_reserve,
+    .commit = ring_commit,
+};
+
+sdlog_error_t sdlog_ostream_init_ring(sdlog_ostream_t* stream, size_t capacity)
+{
+    context_t* ctx;
+
+    if (capacity < ENTRY_HEADER_LENGTH + SDLOG_I_FMT_RECORD_LENGTH) {
+        return SDLOG_EINVAL;
+    }
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(context_t)));
+    memset(ctx, 0, sizeof(context_t));
+
+    ctx->capacity = capacity;
+    sdlog_i_framer_init(&ctx->framer);
+
+    ctx->data = sdlog_malloc(capacity);
+    ctx->base_formats = sdlog_malloc(sizeof(sdlog_i_format_table_t));
+    ctx->dump_formats = sdlog_malloc(sizeof(sdlog_i_format_table_t));
+    if (ctx->data == NULL || ctx->base_formats == NULL || ctx->dump_formats == NULL) {
+        sdlog_free(ctx->data);
+        sdlog_free(ctx->base_formats);
+        sdlog_free(ctx->dump_formats);
+        sdlog_free(ctx);
+        return SDLOG_ENOMEM;
+    }
+
+    memset(ctx->base_formats, 0, sizeof(sdlog_i_format_table_t));
+
+    return sdlog_ostream_init(stream, &sdlog_ostream_ring_methods, ctx);
+}
+
+sdlog_error_t sdlog_ostream_ring_dump(
+    sdlog_ostream_t* stream, sdlog_ostream_t* target, uint64_t max_age_us)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    sdlog_i_format_table_t* formats = ctx->dump_formats;
+    uint8_t header[ENTRY_HEADER_LENGTH];
+    uint8_t record[SDLOG_MAX_MESSAGE_LENGTH];
+    uint64_t now, cutoff, timestamp;
+    size_t offset, consumed, length;
+    bool started = false;
+    int i;
+
+    now = sdlog_i_clock_now_us();
+    cutoff = max_age_us > 0 && now > max_age_us ? now - max_age_us : 0;
+
+    memcpy(formats, ctx->base_formats, sizeof(sdlog_i_format_table_t));
+
+    for (consumed = 0; consumed < ctx->used; consumed += ENTRY_HEADER_LENGTH + length) {
+        offset = (ctx->head + consumed) % ctx->capacity;
+        copy_out(ctx, offset, header, ENTRY_HEADER_LENGTH);
+        length = header[0];
+        memcpy(&timestamp, header + 1, sizeof(timestamp));
+        copy_out(ctx, (offset + ENTRY_HEADER_LENGTH) % ctx->capacity, record, length);
+
+        if (timestamp < cutoff) {
+            /* Too old, but the formats it defines may still be needed */
+            sdlog_i_format_table_remember(formats, record, length);
+            continue;
+        }
+
+        if (!started) {
+            /* Make the dump self-contained by defining all the formats that
+             * were in effect when its first record was written */
+            for (i = 0; i < SDLOG_NUM_MESSAGE_FORMATS; i++) {
+                if (formats->present[i]) {
+                    SDLOG_CHECK(sdlog_ostream_write_all(
+                        target, formats->records[i], SDLOG_I_FMT_RECORD_LENGTH));
+                }
+            }
+            started = true;
+        }
+
+        SDLOG_CHECK(sdlog_ostream_write_all(target, record, length));
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+uint64_t sdlog_ostream_ring_get_records_dropped(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    return ctx->records_dropped;
+}
+
+static void ring_destroy_o(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    sdlog_free(ctx->data);
+    sdlog_free(ctx->base_formats);
+    sdlog_free(ctx->dump_formats);
+
+    memset(ctx, 0, sizeof(context_t));
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t ring_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    SDLOG_CHECK(sdlog_i_framer_feed(&ctx->framer, data, length, store_record, ctx));
+    *written = length;
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Reserves room for the next entry in the storage area so the caller can
+ * encode a record straight into the ring. The oldest entries are evicted as a
+ * whole to make room. Only regions that do not wrap around the end of the
+ * storage area can be reserved, and only between records; otherwise the
+ * caller falls back to a regular write.
+ */
+static sdlog_error_t ring_reserve(sdlog_ostream_t* stream, size_t length, uint8_t** ptr)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    size_t entry_length = ENTRY_HEADER_LENGTH + length;
+    size_t offset;
+
+    if (length > MAX_RESERVED_LENGTH || entry_length > ctx->capacity || ctx->framer.partial_length > 0) {
+        return SDLOG_ELIMIT;
+    }
+
+    offset = (ctx->head + ctx->used) % ctx->capacity;
+    if (offset + entry_length > ctx->capacity) {
+        return SDLOG_ELIMIT;
+    }
+
+    /* The region between the newest and the oldest entry is free; since the
+     * reserved region does not wrap around, it is free once there is enough
+     * free space in total */
+    while (ctx->capacity - ctx->used < entry_length) {
+        evict_oldest(ctx);
+    }
+
+    *ptr = ctx->data + offset + ENTRY_HEADER_LENGTH;
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Turns the committed bytes of a reserved region into entries. A single
+ * record, the common case, stays where it was encoded and only gets its
+ * entry header. Anything else is copied out and stored like a regular write
+ * since the headers of the entries would overwrite the records following
+ * them.
+ */
+static sdlog_error_t ring_commit(sdlog_ostream_t* stream, size_t length)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    uint8_t copy[MAX_RESERVED_LENGTH];
+    const uint8_t* data;
+    size_t written;
+
+    if (length == 0) {
+        return SDLOG_SUCCESS;
+    }
+
+    assert(length <= MAX_RESERVED_LENGTH);
+
+    data = ctx->data + (ctx->head + ctx->used) % ctx->capacity + ENTRY_HEADER_LENGTH;
+    if (length >= SDLOG_I_RECORD_HEADER_LENGTH && data[0] == 0xA3 && data[1] == 0x95
+        && sdlog_i_framer_get_length(&ctx->framer, data[2]) == length) {
+        return sdlog_i_framer_feed(&ctx->framer, data, length, store_record_in_place, ctx);
+    }
+
+    memcpy(copy, data, length);
+    return ring_write(stream, copy, length, &written);
+}
+
+/**
+ * Stores a complete record in the ring, overwriting the oldest records as
+ * needed. Records are always overwritten as a whole.
+ */
+static sdlog_error_t store_record(void* arg, const uint8_t* record, size_t length)
+{
+    context_t* ctx = (context_t*)arg;
+    size_t entry_length = ENTRY_HEADER_LENGTH + length;
+    size_t offset;
+
+    if (entry_length > ctx->capacity) {
+        ctx->records_dropped++;
+        return SDLOG_SUCCESS;
+    }
+
+    while (ctx->capacity - ctx->used < entry_length) {
+        evict_oldest(ctx);
+    }
+
+    offset = (ctx->head + ctx->used) % ctx->capacity;
+    write_entry_header(ctx, offset, length);
+    copy_in(ctx, (offset + ENTRY_HEADER_LENGTH) % ctx->capacity, record, length);
+    ctx->used += entry_length;
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Completes the entry of a record that was encoded straight into the region
+ * reserved by \ref ring_reserve().
+ */
+static sdlog_error_t store_record_in_place(void* arg, const uint8_t* record, size_t length)
+{
+    context_t* ctx = (context_t*)arg;
+    size_t offset = (ctx->head + ctx->used) % ctx->capacity;
+
+    assert(record == ctx->data + offset + ENTRY_HEADER_LENGTH);
+
+    write_entry_header(ctx, offset, length);
+    ctx->used += ENTRY_HEADER_LENGTH + length;
+
+    return SDLOG_SUCCESS;
+}
+
+/** Writes the header of an entry, stamped with the current time */
+static void write_entry_header(context_t* ctx, size_t offset, size_t length)
+{
+    uint8_t header[ENTRY_HEADER_LENGTH];
+    uint64_t timestamp = sdlog_i_clock_now_us();
+
+    header[0] = (uint8_t)length;
+    memcpy(header + 1, &timestamp, sizeof(timestamp));
+    copy_in(ctx, offset, header, ENTRY_HEADER_LENGTH);
+}
+
+/**
+ * Removes the oldest entry from the ring. FMT records are moved to the table
+ * of base formats so the remaining records can still be decoded.
+ */
+static void evict_oldest(context_t* ctx)
+{
+    uint8_t record[SDLOG_MAX_MESSAGE_LENGTH];
+    size_t length;
+
+    assert(ctx->used > 0);
+
+    copy_out(ctx, ctx->head, record, 1);
+    length = record[0];
+
+    copy_out(ctx, (ctx->head + ENTRY_HEADER_LENGTH) % ctx->capacity, record, length);
+    sdlog_i_format_table_remember(ctx->base_formats, record, length);
+
+    ctx->head = (ctx->head + ENTRY_HEADER_LENGTH + length) % ctx->capacity;
+    ctx->used -= ENTRY_HEADER_LENGTH + length;
+}
+
+/** Copies bytes into the storage area, wrapping around at the end */
+static void copy_in(context_t* ctx, size_t offset, const uint8_t* src, size_t length)
+{
+    size_t first = ctx->capacity - offset;
+
+    if (first >= length) {
+        memcpy(ctx->data + offset, src, length);
+    } else {
+        memcpy(ctx->data + offset, src, first);
+        memcpy(ctx->data, src + first, length - first);
+    }
+}
+
+/** Copies bytes out of the storage area, wrapping around at the end */
+static void copy_out(const context_t* ctx, size_t offset, uint8_t* dest, size_t length)
+{
+    size_t first = ctx->capacity - offset;
+
+    if (first >= length) {
+        memcpy(dest, ctx->data + offset, length);
+    } else {
+        memcpy(dest, ctx->data + offset, first);
+        memcpy(dest + first, ctx->data, length - first);
+    }
+}
@@ -0,0 +1,585 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sdlog/memory.h>
+#include <sdlog/streams.h>
+
+#include "clock.h"
+#include "config.h"
+#include "framer.h"
+#include "segment_path.h"
+#include "stream_base.h"
+
+#if HAVE_UNISTD_H
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+/* Longest path generated from the path template */
+#define MAX_PATH_LENGTH 4096
+
+#if HAVE_UNISTD_H
+
+typedef struct segment_s {
+    /** The file descriptor of the segment; owned by the segment */
+    int fd;
+
+    /** The index and the path of the segment */
+    uint32_t index;
+    char path[MAX_PATH_LENGTH];
+
+    /** The stream writing to the file descriptor */
+    sdlog_ostream_t stream;
+
+    /** The next segment in the queue of segments to close */
+    struct segment_s* next;
+} segment_t;
+
+typedef struct {
+    /** Template of the paths of the segments */
+    char* path_template;
+
+    /** Limits of the segments; zero means no limit */
+    uint64_t max_size;
+    uint64_t max_duration;
+
+    /** Options of the streams writing to the segments */
+    sdlog_fd_ostream_options_t fd_options;
+
+    /** The segment being written */
+    segment_t* current;
+
+    /** Number of bytes written to the current segment, and the number of
+     * bytes of FMT records repeated at its start */
+    uint64_t segment_bytes;
+    uint64_t header_bytes;
+
+    /** Time when the current segment was started, in microseconds */
+    uint64_t segment_start;
+
+    /** Index of the next segment to open */
+    uint32_t next_index;
+
+    /** Framer that finds the record boundaries in the written data */
+    sdlog_i_framer_t framer;
+
+    /** FMT records seen so far, repeated at the start of each segment */
+    sdlog_i_format_table_t formats;
+
+    /** Error of an earlier background operation, not reported yet */
+    sdlog_error_t error;
+
+#if HAVE_PTHREAD
+    /** Background thread that opens the next segment ahead of time and
+     * closes the segments that were written */
+    pthread_t thread;
+    bool has_thread;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t ready;
+    pthread_cond_t idle;
+
+    /** Segment opened ahead of time, NULL if none */
+    segment_t* prepared;
+
+    /** Queue of segments to close */
+    segment_t* closing_head;
+    segment_t* closing_tail;
+
+    /** Whether the background thread is closing a segment */
+    bool busy;
+
+    /** Whether the background thread failed to open the next segment */
+    bool prepare_failed;
+
+    bool stopping;
+#endif
+} context_t;
+
+static void rotating_destroy(sdlog_ostream_t* stream);
+static sdlog_error_t rotating_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written);
+static sdlog_error_t rotating_flush(sdlog_ostream_t* stream);
+
+static sdlog_error_t write_record(void* arg, const uint8_t* record, size_t length);
+static bool should_rotate(context_t* ctx, size_t length);
+static sdlog_error_t rotate(context_t* ctx);
+static sdlog_error_t take_next_segment(context_t* ctx, segment_t** result);
+static void retire_segment(context_t* ctx, segment_t* segment);
+static sdlog_error_t open_segment(context_t* ctx, uint32_t index, segment_t** result);
+static sdlog_error_t close_segment(segment_t* segment);
+static void discard_segment(segment_t* segment);
+static sdlog_error_t take_error(context_t* ctx);
+
+#if HAVE_PTHREAD
+static void* rotating_worker(void* arg);
+static void stop_worker(context_t* ctx);
+#endif
+
+const sdlog_ostream_spec_t sdlog_ostream_rotating_methods = {
+    .destroy = rotating_destroy,
+    .write = rotating_write,
+    .flush = rotating_flush,
+    .end = rotating_flush,
+};
+
+sdlog_error_t sdlog_ostream_init_rotating(
+    sdlog_ostream_t* stream, const char* path_template,
+    const sdlog_rotating_ostream_options_t* options)
+{
+    context_t* ctx;
+    sdlog_error_t retval;
+
+    if (!sdlog_i_segment_path_is_valid(path_template)) {
+        return SDLOG_EINVAL;
+    }
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(context_t)));
+    memset(ctx, 0, sizeof(context_t));
+
+    ctx->path_template = sdlog_malloc(strlen(path_template) + 1);
+    if (ctx->path_template == NULL) {
+        sdlog_free(ctx);
+        return SDLOG_ENOMEM;
+    }
+    strcpy(ctx->path_template, path_template);
+
+    if (options) {
+        ctx->max_size = options->max_size;
+        ctx->max_duration = options->max_duration_us;
+        if (options->fd_options) {
+            ctx->fd_options = *options->fd_options;
+        }
+    }
+
+    sdlog_i_framer_init(&ctx->framer);
+
+    /* The first segment is opened right away so invalid paths are detected
+     * early */
+    retval = open_segment(ctx, ctx->next_index++, &ctx->current);
+    if (retval != SDLOG_SUCCESS) {
+        sdlog_free(ctx->path_template);
+        sdlog_free(ctx);
+        return retval;
+    }
+    ctx->segment_start = sdlog_i_clock_now_us();
+
+#if HAVE_PTHREAD
+    pthread_mutex_init(&ctx->mutex, NULL);
+    pthread_cond_init(&ctx->wake, NULL);
+    pthread_cond_init(&ctx->ready, NULL);
+    pthread_cond_init(&ctx->idle, NULL);
+
+    /* Without the thread, segments are opened and closed synchronously */
+    ctx->has_thread = pthread_create(&ctx->thread, NULL, rotating_worker, ctx) == 0;
+#endif
+
+    return sdlog_ostream_init(stream, &sdlog_ostream_rotating_methods, ctx);
+}
+
+uint32_t sdlog_ostream_rotating_get_segment_index(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    return ctx->current->index;
+}
+
+static void rotating_destroy(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+#if HAVE_PTHREAD
+    stop_worker(ctx);
+#endif
+
+    close_segment(ctx->current);
+
+    sdlog_free(ctx->path_template);
+    memset(ctx, 0, sizeof(context_t));
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t rotating_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    SDLOG_CHECK(take_error(ctx));
+
+    /* Partial records are kept by the framer until they are complete, so
+     * segments are always cut at record boundaries */
+    SDLOG_CHECK(sdlog_i_framer_feed(&ctx->framer, data, length, write_record, ctx));
+    *written = length;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t rotating_flush(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+#if HAVE_PTHREAD
+    /* Segments waiting to be closed may still hold buffered data */
+    if (ctx->has_thread) {
+        pthread_mutex_lock(&ctx->mutex);
+        while (ctx->closing_head || ctx->busy) {
+            pthread_cond_wait(&ctx->idle, &ctx->mutex);
+        }
+        pthread_mutex_unlock(&ctx->mutex);
+    }
+#endif
+
+    SDLOG_CHECK(take_error(ctx));
+    return sdlog_ostream_flush(&ctx->current->stream);
+}
+
+static sdlog_error_t write_record(void* arg, const uint8_t* record, size_t length)
+{
+    context_t* ctx = (context_t*)arg;
+
+    if (should_rotate(ctx, length)) {
+        SDLOG_CHECK(rotate(ctx));
+    }
+
+    sdlog_i_format_table_remember(&ctx->formats, record, length);
+
+    SDLOG_CHECK(sdlog_ostream_write_all(&ctx->current->stream, record, length));
+    ctx->segment_bytes += length;
+
+    return SDLOG_SUCCESS;
+}
+
+static bool should_rotate(context_t* ctx, size_t length)
+{
+    /* Segments hold at least one record after the repeated FMT records, even
+     * if that makes them larger than the limit */
+    if (ctx->segment_bytes == ctx->header_bytes) {
+        return false;
+    }
+
+    if (ctx->max_size > 0 && ctx->segment_bytes + length > ctx->max_size) {
+        return true;
+    }
+
+    return ctx->max_duration > 0 && sdlog_i_clock_now_us() - ctx->segment_start >= ctx->max_duration;
+}
+
+static sdlog_error_t rotate(context_t* ctx)
+{
+    segment_t* segment;
+    size_t i;
+
+    SDLOG_CHECK(take_next_segment(ctx, &segment));
+    retire_segment(ctx, ctx->current);
+
+    ctx->current = segment;
+    ctx->segment_bytes = 0;
+    ctx->segment_start = sdlog_i_clock_now_us();
+
+    /* Each segment starts with all the formats seen so far so it can be
+     * parsed on its own */
+    for (i = 0; i < SDLOG_NUM_MESSAGE_FORMATS; i++) {
+        if (ctx->formats.present[i]) {
+            SDLOG_CHECK(sdlog_ostream_write_all(
+                &segment->stream, ctx->formats.records[i], SDLOG_I_FMT_RECORD_LENGTH));
+            ctx->segment_bytes += SDLOG_I_FMT_RECORD_LENGTH;
+        }
+    }
+    ctx->header_bytes = ctx->segment_bytes;
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Returns the segment to continue with, preferably the one that the
+ * background thread opened ahead of time.
+ */
+static sdlog_error_t take_next_segment(context_t* ctx, segment_t** result)
+{
+    uint32_t index;
+
+#if HAVE_PTHREAD
+    if (ctx->has_thread) {
+        pthread_mutex_lock(&ctx->mutex);
+
+        /* The background thread opens the next segment as soon as the
+         * previous one was taken, so waiting here is rare */
+        while (ctx->prepared == NULL && !ctx->prepare_failed) {
+            pthread_cond_wait(&ctx->ready, &ctx->mutex);
+        }
+
+        if (ctx->prepared) {
+            *result = ctx->prepared;
+            ctx->prepared = NULL;
+            pthread_cond_signal(&ctx->wake);
+            pthread_mutex_unlock(&ctx->mutex);
+            return SDLOG_SUCCESS;
+        }
+
+        /* The background thread failed to open it; try again here so the
+         * error is reported to the writer */
+        index = ctx->next_index++;
+        ctx->prepare_failed = false;
+        pthread_cond_signal(&ctx->wake);
+        pthread_mutex_unlock(&ctx->mutex);
+        return open_segment(ctx, index, result);
+    }
+#endif
+
+    index = ctx->next_index++;
+    return open_segment(ctx, index, result);
+}
+
+/**
+ * Closes a segment that was written completely, in the background if
+ * possible.
+ */
+static void retire_segment(context_t* ctx, segment_t* segment)
+{
+    sdlog_error_t retval;
+
+#if HAVE_PTHREAD
+    if (ctx->has_thread) {
+        pthread_mutex_lock(&ctx->mutex);
+        segment->next = NULL;
+        if (ctx->closing_tail) {
+            ctx->closing_tail->next = segment;
+        } else {
+            ctx->closing_head = segment;
+        }
+        ctx->closing_tail = segment;
+        pthread_cond_signal(&ctx->wake);
+        pthread_mutex_unlock(&ctx->mutex);
+        return;
+    }
+#endif
+
+    retval = close_segment(segment);
+    if (retval != SDLOG_SUCCESS && ctx->error == SDLOG_SUCCESS) {
+        ctx->error = retval;
+    }
+}
+
+static sdlog_error_t open_segment(context_t* ctx, uint32_t index, segment_t** result)
+{
+    segment_t* segment;
+    sdlog_error_t retval;
+
+    SDLOG_CHECK_OOM(segment = sdlog_malloc(sizeof(segment_t)));
+    memset(segment, 0, sizeof(segment_t));
+    segment->index = index;
+
+    retval = sdlog_i_segment_path_format(segment->path, sizeof(segment->path), ctx->path_template, index);
+    if (retval != SDLOG_SUCCESS) {
+        sdlog_free(segment);
+        return retval;
+    }
+
+    segment->fd = open(segment->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (segment->fd < 0) {
+        sdlog_free(segment);
+        return SDLOG_EIO;
+    }
+
+    retval = sdlog_ostream_init_fd(&segment->stream, segment->fd, &ctx->fd_options);
+    if (retval == SDLOG_SUCCESS) {
+        retval = sdlog_ostream_begin_session(&segment->stream);
+        if (retval != SDLOG_SUCCESS) {
+            sdlog_ostream_destroy(&segment->stream);
+        }
+    }
+
+    if (retval != SDLOG_SUCCESS) {
+        close(segment->fd);
+        unlink(segment->path);
+        sdlog_free(segment);
+        return retval;
+    }
+
+    *result = segment;
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t close_segment(segment_t* segment)
+{
+    sdlog_error_t retval;
+
+    retval = sdlog_ostream_end_session(&segment->stream);
+    sdlog_ostream_destroy(&segment->stream);
+    if (close(segment->fd) < 0 && retval == SDLOG_SUCCESS) {
+        retval = SDLOG_EIO;
+    }
+
+    sdlog_free(segment);
+    return retval;
+}
+
+/**
+ * Closes and removes a segment that was opened ahead of time but never used.
+ */
+static void discard_segment(segment_t* segment)
+{
+    sdlog_ostream_destroy(&segment->stream);
+    close(segment->fd);
+    unlink(segment->path);
+    sdlog_free(segment);
+}
+
+static sdlog_error_t take_error(context_t* ctx)
+{
+    sdlog_error_t retval;
+
+#if HAVE_PTHREAD
+    if (ctx->has_thread) {
+        pthread_mutex_lock(&ctx->mutex);
+    }
+#endif
+
+    retval = ctx->error;
+    ctx->error = SDLOG_SUCCESS;
+
+#if HAVE_PTHREAD
+    if (ctx->has_thread) {
+        pthread_mutex_unlock(&ctx->mutex);
+    }
+#endif
+
+    return retval;
+}
+
+#if HAVE_PTHREAD
+
+static void* rotating_worker(void* arg)
+{
+    context_t* ctx = (context_t*)arg;
+    segment_t* segment;
+    sdlog_error_t retval;
+    uint32_t index;
+
+    pthread_mutex_lock(&ctx->mutex);
+
+    while (1) {
+        /* Opening the next segment comes first; the writer may be waiting
+         * for it */
+        if (!ctx->stopping && ctx->prepared == NULL && !ctx->prepare_failed) {
+            index = ctx->next_index++;
+            pthread_mutex_unlock(&ctx->mutex);
+
+            retval = open_segment(ctx, index, &segment);
+
+            pthread_mutex_lock(&ctx->mutex);
+            if (retval == SDLOG_SUCCESS) {
+                ctx->prepared = segment;
+            } else {
+                /* The writer retries with the same index when it needs the
+                 * segment */
+                ctx->next_index--;
+                ctx->prepare_failed = true;
+            }
+            pthread_cond_broadcast(&ctx->ready);
+            continue;
+        }
+
+        if (ctx->closing_head) {
+            segment = ctx->closing_head;
+            ctx->closing_head = segment->next;
+            if (ctx->closing_head == NULL) {
+                ctx->closing_tail = NULL;
+            }
+            ctx->busy = true;
+            pthread_mutex_unlock(&ctx->mutex);
+
+            retval = close_segment(segment);
+
+            pthread_mutex_lock(&ctx->mutex);
+            if (retval != SDLOG_SUCCESS && ctx->error == SDLOG_SUCCESS) {
+                ctx->error = retval;
+            }
+            ctx->busy = false;
+            pthread_cond_broadcast(&ctx->idle);
+            continue;
+        }
+
+        if (ctx->stopping) {
+            break;
+        }
+
+        pthread_cond_wait(&ctx->wake, &ctx->mutex);
+    }
+
+    pthread_mutex_unlock(&ctx->mutex);
+
+    return NULL;
+}
+
+static void stop_worker(context_t* ctx)
+{
+    if (ctx->has_thread) {
+        pthread_mutex_lock(&ctx->mutex);
+        ctx->stopping = true;
+        pthread_cond_signal(&ctx->wake);
+        pthread_mutex_unlock(&ctx->mutex);
+
+        pthread_join(ctx->thread, NULL);
+    }
+
+    if (ctx->prepared) {
+        discard_segment(ctx->prepared);
+        ctx->prepared = NULL;
+    }
+
+    pthread_cond_destroy(&ctx->idle);
+    pthread_cond_destroy(&ctx->ready);
+    pthread_cond_destroy(&ctx->wake);
+    pthread_mutex_destroy(&ctx->mutex);
+}
+
+#endif
+
+#else
+
+const sdlog_ostream_spec_t sdlog_ostream_rotating_methods = { 0 };
+
+sdlog_error_t sdlog_ostream_init_rotating(
+    sdlog_ostream_t* stream, const char* path_template,
+    const sdlog_rotating_ostream_options_t* options)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+uint32_t sdlog_ostream_rotating_get_segment_index(sdlog_ostream_t* stream)
+{
+    return 0;
+}
+
+#endif
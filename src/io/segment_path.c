@@ -0,0 +1,65 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+
+#include "segment_path.h"
+
+bool sdlog_i_segment_path_is_valid(const char* path_template)
+{
+    const char* p;
+    int num_conversions = 0;
+
+    for (p = path_template; *p; p++) {
+        if (*p != '%') {
+            continue;
+        }
+
+        p++;
+        if (*p == '%') {
+            continue;
+        }
+
+        while (*p == '0' || *p == '-') {
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+        if (*p != 'u') {
+            return false;
+        }
+
+        num_conversions++;
+    }
+
+    return num_conversions == 1;
+}
+
+sdlog_error_t sdlog_i_segment_path_format(
+    char* path, size_t size, const char* path_template, uint32_t index)
+{
+    int length = snprintf(path, size, path_template, index);
+    return length < 0 || (size_t)length >= size ? SDLOG_EINVAL : SDLOG_SUCCESS;
+}
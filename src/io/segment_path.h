@@ -0,0 +1,57 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SDLOG_SEGMENT_PATH_H
+#define SDLOG_SEGMENT_PATH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sdlog/decls.h>
+#include <sdlog/error.h>
+
+/**
+ * @file segment_path.h
+ * @brief Internal helpers for the path templates of log segments
+ */
+
+__BEGIN_DECLS
+
+/**
+ * Checks that the template contains exactly one conversion, which formats an
+ * unsigned integer, optionally with flags and a field width.
+ */
+bool sdlog_i_segment_path_is_valid(const char* path_template);
+
+/**
+ * Formats the path of the segment with the given index into the given
+ * buffer. Returns \c SDLOG_EINVAL if the path does not fit.
+ */
+sdlog_error_t sdlog_i_segment_path_format(
+    char* path, size_t size, const char* path_template, uint32_t index);
+
+__END_DECLS
+
+#endif
@@ -0,0 +1,614 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sdlog/memory.h>
+#include <sdlog/streams.h>
+
+#include "config.h"
+#include "framer.h"
+#include "stream_base.h"
+
+#if HAVE_SHM_OPEN && HAVE_UNISTD_H && defined(__GNUC__)
+#define SHM_SUPPORTED 1
+#else
+#define SHM_SUPPORTED 0
+#endif
+
+#if SHM_SUPPORTED
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#if HAVE_LINUX_FUTEX_H
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#if SHM_SUPPORTED
+
+#define SHM_MAGIC 0x524c4453 /* "SDLR" */
+#define SHM_VERSION 2
+
+/** How long the consumer sleeps at most before checking the producer again */
+#define WAIT_TIMEOUT_NS 100000000
+
+/**
+ * Header of the shared memory segment, followed by the data area of the
+ * ring. Positions are byte counts since the creation of the ring; they are
+ * taken modulo the capacity to index the data area. Fields written by the
+ * producer and by the consumer live on separate cache lines.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;
+
+    /** Number of bytes dropped by the producer because the ring was full */
+    uint64_t bytes_dropped;
+
+    /** Nonzero when the producer ended its session; the consumer reaches the
+     * end of the stream once it read everything */
+    uint32_t closed;
+
+    /** Incremented whenever a producer attaches to the ring */
+    uint32_t producer_epoch;
+
+    uint8_t padding1[32];
+
+    /** Position up to which the producer has written; owned by the producer */
+    uint64_t write_pos;
+
+    /** Futex word incremented by the producer after each write */
+    uint32_t write_seq;
+
+    /** Nonzero while the consumer is waiting for the futex */
+    uint32_t consumer_waiting;
+
+    uint8_t padding2[48];
+
+    /** Position up to which the consumer has read; owned by the consumer */
+    uint64_t read_pos;
+
+    uint8_t padding3[56];
+} shm_header_t;
+
+typedef struct {
+    /** The mapped shared memory segment */
+    shm_header_t* header;
+
+    /** Start of the data area of the ring */
+    uint8_t* data;
+
+    /** Size of the data area */
+    uint64_t capacity;
+
+    /** Size of the whole mapping */
+    size_t map_length;
+
+    /** Framer that tracks the FMT records written by the producer */
+    sdlog_i_framer_t framer;
+
+    /** FMT records written so far; re-sent after writes were dropped */
+    sdlog_i_format_table_t* formats;
+
+    /** Whether writes were dropped since the FMT records were last sent */
+    bool needs_resync;
+
+    /** Bytes of the record that is not complete yet; they are published
+     * together with the rest of the record */
+    uint8_t carry[SDLOG_MAX_MESSAGE_LENGTH];
+
+    /** Number of bytes in \c carry */
+    size_t carry_length;
+
+    /** Producer epoch last seen by the consumer */
+    uint32_t epoch;
+} context_t;
+
+static void shm_destroy_o(sdlog_ostream_t* stream);
+static sdlog_error_t shm_begin(sdlog_ostream_t* stream);
+static sdlog_error_t shm_end(sdlog_ostream_t* stream);
+static sdlog_error_t shm_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written);
+static sdlog_error_t shm_writev(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt, size_t* written);
+static void shm_destroy_i(sdlog_istream_t* stream);
+static sdlog_error_t shm_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read);
+
+static sdlog_error_t produce(context_t* ctx, const sdlog_iovec_t* iov, size_t iovcnt);
+static void publish(context_t* ctx);
+static sdlog_error_t track_formats(void* arg, const uint8_t* record, size_t length);
+static void copy_in(context_t* ctx, uint64_t pos, const uint8_t* src, size_t length);
+static void copy_out(const context_t* ctx, uint64_t pos, uint8_t* dest, size_t length);
+static sdlog_error_t map_segment(context_t* ctx, int fd, size_t length);
+static void wait_for_producer(context_t* ctx, uint32_t seq);
+static void wake_consumer(context_t* ctx);
+
+const sdlog_ostream_spec_t sdlog_ostream_shm_methods = {
+    .destroy = shm_destroy_o,
+    .begin = shm_begin,
+    .end = shm_end,
+    .write = shm_write,
+    .writev = shm_writev,
+};
+
+const sdlog_istream_spec_t sdlog_istream_shm_methods = {
+    .destroy = shm_destroy_i,
+    .read = shm_read,
+};
+
+sdlog_error_t sdlog_ostream_init_shm(sdlog_ostream_t* stream, const char* name, size_t capacity)
+{
+    context_t* ctx;
+    shm_header_t* header;
+    struct stat st;
+    size_t length = sizeof(shm_header_t) + capacity;
+    sdlog_error_t retval;
+    int fd;
+
+    if (capacity < SDLOG_MAX_MESSAGE_LENGTH || capacity > SIZE_MAX - sizeof(shm_header_t)) {
+        return SDLOG_EINVAL;
+    }
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(context_t)));
+    memset(ctx, 0, sizeof(context_t));
+    sdlog_i_framer_init(&ctx->framer);
+
+    ctx->formats = sdlog_malloc(sizeof(sdlog_i_format_table_t));
+    if (ctx->formats == NULL) {
+        sdlog_free(ctx);
+        return SDLOG_ENOMEM;
+    }
+    memset(ctx->formats, 0, sizeof(sdlog_i_format_table_t));
+
+    fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        retval = SDLOG_EIO;
+        goto fail;
+    }
+
+    /* A segment of a different size cannot hold a ring of this capacity */
+    if ((size_t)st.st_size != length && ftruncate(fd, length) < 0) {
+        retval = SDLOG_EIO;
+        goto fail;
+    }
+
+    retval = map_segment(ctx, fd, length);
+    if (retval != SDLOG_SUCCESS) {
+        goto fail;
+    }
+
+    close(fd);
+    fd = -1;
+
+    header = ctx->header;
+    if (header->magic != SHM_MAGIC || header->version != SHM_VERSION || header->capacity != capacity) {
+        /* New ring, or one left behind by an incompatible producer. The
+         * epoch keeps growing so consumers of the old ring notice. */
+        uint32_t epoch = header->magic == SHM_MAGIC ? header->producer_epoch : 0;
+
+        memset(header, 0, sizeof(shm_header_t));
+        header->version = SHM_VERSION;
+        header->capacity = capacity;
+        header->producer_epoch = epoch;
+        __atomic_store_n(&header->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+    }
+
+    /* A restarted producer continues where the previous one stopped; the
+     * consumer keeps its position. The ring holds complete records only, so
+     * the new data starts on a record boundary. */
+    ctx->capacity = capacity;
+    ctx->data = (uint8_t*)(header + 1);
+    __atomic_add_fetch(&header->producer_epoch, 1, __ATOMIC_SEQ_CST);
+    publish(ctx);
+
+    return sdlog_ostream_init(stream, &sdlog_ostream_shm_methods, ctx);
+
+fail:
+    if (fd >= 0) {
+        close(fd);
+    }
+    sdlog_free(ctx->formats);
+    sdlog_free(ctx);
+    return retval;
+}
+
+sdlog_error_t sdlog_istream_init_shm(sdlog_istream_t* stream, const char* name)
+{
+    context_t* ctx;
+    struct stat st;
+    sdlog_error_t retval;
+    int fd;
+
+    fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return SDLOG_EIO;
+    }
+
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(shm_header_t)) {
+        close(fd);
+        return SDLOG_EREAD;
+    }
+
+    ctx = sdlog_malloc(sizeof(context_t));
+    if (ctx == NULL) {
+        close(fd);
+        return SDLOG_ENOMEM;
+    }
+    memset(ctx, 0, sizeof(context_t));
+
+    retval = map_segment(ctx, fd, st.st_size);
+    close(fd);
+    if (retval != SDLOG_SUCCESS) {
+        sdlog_free(ctx);
+        return retval;
+    }
+
+    if (__atomic_load_n(&ctx->header->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC
+        || ctx->header->version != SHM_VERSION
+        || ctx->header->capacity != st.st_size - sizeof(shm_header_t)) {
+        munmap(ctx->header, ctx->map_length);
+        sdlog_free(ctx);
+        return SDLOG_EREAD;
+    }
+
+    ctx->capacity = ctx->header->capacity;
+    ctx->data = (uint8_t*)(ctx->header + 1);
+    ctx->epoch = __atomic_load_n(&ctx->header->producer_epoch, __ATOMIC_SEQ_CST);
+
+    return sdlog_istream_init(stream, &sdlog_istream_shm_methods, ctx);
+}
+
+uint64_t sdlog_ostream_shm_get_bytes_dropped(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    return __atomic_load_n(&ctx->header->bytes_dropped, __ATOMIC_RELAXED);
+}
+
+static void shm_destroy_o(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    /* The record that is not complete yet is lost. The consumer keeps
+     * waiting for a new producer unless the session was ended. */
+    munmap(ctx->header, ctx->map_length);
+    sdlog_free(ctx->formats);
+    memset(ctx, 0, sizeof(context_t));
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t shm_begin(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    __atomic_store_n(&ctx->header->closed, 0, __ATOMIC_SEQ_CST);
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t shm_end(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    /* A record left incomplete at the end of the session is not going to be
+     * completed. Publishing it would tear the record, so it is dropped. */
+    if (ctx->carry_length > 0) {
+        __atomic_add_fetch(&ctx->header->bytes_dropped, ctx->carry_length, __ATOMIC_RELAXED);
+        ctx->carry_length = 0;
+        ctx->framer.partial_length = 0;
+    }
+
+    /* Let the consumer know that no more data is coming */
+    __atomic_store_n(&ctx->header->closed, 1, __ATOMIC_SEQ_CST);
+    publish(ctx);
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t shm_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    sdlog_iovec_t iov;
+
+    iov.data = data;
+    iov.length = length;
+
+    return shm_writev(stream, &iov, 1, written);
+}
+
+static sdlog_error_t shm_writev(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt, size_t* written)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    sdlog_iovec_t stack_parts[8];
+    sdlog_iovec_t* parts = stack_parts;
+    uint64_t fed = ctx->framer.position;
+    size_t i, n;
+    sdlog_error_t retval;
+
+    if (iovcnt >= sizeof(stack_parts) / sizeof(stack_parts[0])) {
+        SDLOG_CHECK_OOM(parts = sdlog_malloc((iovcnt + 1) * sizeof(sdlog_iovec_t)));
+    }
+
+    /* Only complete records are published so that drops never tear records
+     * and a new producer can continue after a detached one */
+    *written = 0;
+    for (i = 0; i < iovcnt; i++) {
+        *written += iov[i].length;
+        sdlog_i_framer_feed(&ctx->framer, iov[i].data, iov[i].length, track_formats, ctx);
+    }
+
+    n = sdlog_i_framer_get_complete(&ctx->framer, fed, ctx->carry, ctx->carry_length, iov, iovcnt, parts);
+    retval = n > 0 ? produce(ctx, parts, n) : SDLOG_SUCCESS;
+    sdlog_i_framer_keep_incomplete(&ctx->framer, fed, ctx->carry, &ctx->carry_length, iov, iovcnt);
+
+    if (parts != stack_parts) {
+        sdlog_free(parts);
+    }
+
+    /* Dropped writes are reported as written; the producer never waits */
+    return retval;
+}
+
+static void shm_destroy_i(sdlog_istream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+    munmap(ctx->header, ctx->map_length);
+    memset(ctx, 0, sizeof(context_t));
+    sdlog_free(ctx);
+}
+
+static sdlog_error_t shm_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    shm_header_t* header = ctx->header;
+    uint64_t read_pos, write_pos;
+    uint32_t seq, epoch;
+
+    while (1) {
+        /* A new producer continues the same ring unless it had to
+         * reinitialize it with a different capacity; the mapping of this
+         * stream is useless then */
+        epoch = __atomic_load_n(&header->producer_epoch, __ATOMIC_SEQ_CST);
+        if (epoch != ctx->epoch) {
+            if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC
+                || header->capacity != ctx->capacity) {
+                *read = 0;
+                return SDLOG_EREAD;
+            }
+            ctx->epoch = epoch;
+        }
+
+        seq = __atomic_load_n(&header->write_seq, __ATOMIC_SEQ_CST);
+        read_pos = header->read_pos;
+        write_pos = __atomic_load_n(&header->write_pos, __ATOMIC_ACQUIRE);
+        if (write_pos != read_pos) {
+            break;
+        }
+
+        if (__atomic_load_n(&header->closed, __ATOMIC_SEQ_CST)) {
+            /* Check once more; the producer may have written right before
+             * it ended the session */
+            if (__atomic_load_n(&header->write_pos, __ATOMIC_ACQUIRE) == read_pos) {
+                *read = 0;
+                return SDLOG_EOF;
+            }
+            continue;
+        }
+
+        /* The producer is either busy or gone without ending its session;
+         * in the latter case we wait for a new one to attach */
+        wait_for_producer(ctx, seq);
+    }
+
+    if (length > write_pos - read_pos) {
+        length = write_pos - read_pos;
+    }
+
+    copy_out(ctx, read_pos, data, length);
+    __atomic_store_n(&header->read_pos, read_pos + length, __ATOMIC_RELEASE);
+    *read = length;
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Publishes the given buffers in the ring as a single unit, or drops all of
+ * them if they do not fit. After a drop, the known FMT records are sent again
+ * in front of the next write so that the consumer can decode what follows.
+ */
+static sdlog_error_t produce(context_t* ctx, const sdlog_iovec_t* iov, size_t iovcnt)
+{
+    shm_header_t* header = ctx->header;
+    uint64_t write_pos = header->write_pos;
+    uint64_t free_space, needed = 0, resync = 0;
+    size_t i;
+
+    for (i = 0; i < iovcnt; i++) {
+        needed += iov[i].length;
+    }
+
+    if (ctx->needs_resync) {
+        for (i = 0; i < SDLOG_NUM_MESSAGE_FORMATS; i++) {
+            if (ctx->formats->present[i]) {
+                resync += SDLOG_I_FMT_RECORD_LENGTH;
+            }
+        }
+    }
+
+    free_space = ctx->capacity - (write_pos - __atomic_load_n(&header->read_pos, __ATOMIC_ACQUIRE));
+    if (needed + resync > free_space) {
+        __atomic_add_fetch(&header->bytes_dropped, needed, __ATOMIC_RELAXED);
+        ctx->needs_resync = true;
+        return SDLOG_SUCCESS;
+    }
+
+    if (resync > 0) {
+        for (i = 0; i < SDLOG_NUM_MESSAGE_FORMATS; i++) {
+            if (ctx->formats->present[i]) {
+                copy_in(ctx, write_pos, ctx->formats->records[i], SDLOG_I_FMT_RECORD_LENGTH);
+                write_pos += SDLOG_I_FMT_RECORD_LENGTH;
+            }
+        }
+    }
+    ctx->needs_resync = false;
+
+    for (i = 0; i < iovcnt; i++) {
+        copy_in(ctx, write_pos, iov[i].data, iov[i].length);
+        write_pos += iov[i].length;
+    }
+
+    __atomic_store_n(&header->write_pos, write_pos, __ATOMIC_RELEASE);
+    publish(ctx);
+
+    return SDLOG_SUCCESS;
+}
+
+/** Notifies the consumer about a change in the header of the ring */
+static void publish(context_t* ctx)
+{
+    __atomic_add_fetch(&ctx->header->write_seq, 1, __ATOMIC_SEQ_CST);
+    wake_consumer(ctx);
+}
+
+static sdlog_error_t track_formats(void* arg, const uint8_t* record, size_t length)
+{
+    context_t* ctx = (context_t*)arg;
+    sdlog_i_format_table_remember(ctx->formats, record, length);
+    return SDLOG_SUCCESS;
+}
+
+/** Copies bytes into the data area at the given position, wrapping around */
+static void copy_in(context_t* ctx, uint64_t pos, const uint8_t* src, size_t length)
+{
+    size_t offset = pos % ctx->capacity;
+    size_t first = ctx->capacity - offset;
+
+    if (first >= length) {
+        memcpy(ctx->data + offset, src, length);
+    } else {
+        memcpy(ctx->data + offset, src, first);
+        memcpy(ctx->data, src + first, length - first);
+    }
+}
+
+/** Copies bytes out of the data area at the given position, wrapping around */
+static void copy_out(const context_t* ctx, uint64_t pos, uint8_t* dest, size_t length)
+{
+    size_t offset = pos % ctx->capacity;
+    size_t first = ctx->capacity - offset;
+
+    if (first >= length) {
+        memcpy(dest, ctx->data + offset, length);
+    } else {
+        memcpy(dest, ctx->data + offset, first);
+        memcpy(dest + first, ctx->data, length - first);
+    }
+}
+
+static sdlog_error_t map_segment(context_t* ctx, int fd, size_t length)
+{
+    void* map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (map == MAP_FAILED) {
+        return SDLOG_EIO;
+    }
+
+    ctx->header = map;
+    ctx->map_length = length;
+
+    return SDLOG_SUCCESS;
+}
+
+/**
+ * Blocks the consumer until the producer changes the ring after the given
+ * futex sequence number, or until a timeout expires.
+ */
+static void wait_for_producer(context_t* ctx, uint32_t seq)
+{
+    shm_header_t* header = ctx->header;
+    struct timespec timeout;
+
+    timeout.tv_sec = 0;
+    timeout.tv_nsec = WAIT_TIMEOUT_NS;
+
+    __atomic_store_n(&header->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+
+    /* The producer may have written between reading the sequence number and
+     * announcing that we are waiting */
+    if (__atomic_load_n(&header->write_seq, __ATOMIC_SEQ_CST) == seq) {
+#if HAVE_LINUX_FUTEX_H
+        syscall(SYS_futex, &header->write_seq, FUTEX_WAIT, seq, &timeout, NULL, 0);
+#else
+        timeout.tv_nsec = 1000000;
+        nanosleep(&timeout, NULL);
+#endif
+    }
+
+    __atomic_store_n(&header->consumer_waiting, 0, __ATOMIC_SEQ_CST);
+}
+
+/** Wakes up the consumer if it is waiting; no system call otherwise */
+static void wake_consumer(context_t* ctx)
+{
+    if (__atomic_load_n(&ctx->header->consumer_waiting, __ATOMIC_SEQ_CST)) {
+#if HAVE_LINUX_FUTEX_H
+        syscall(SYS_futex, &ctx->header->write_seq, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+    }
+}
+
+#else
+
+const sdlog_ostream_spec_t sdlog_ostream_shm_methods = { 0 };
+const sdlog_istream_spec_t sdlog_istream_shm_methods = { 0 };
+
+sdlog_error_t sdlog_ostream_init_shm(sdlog_ostream_t* stream, const char* name, size_t capacity)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+sdlog_error_t sdlog_istream_init_shm(sdlog_istream_t* stream, const char* name)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+uint64_t sdlog_ostream_shm_get_bytes_dropped(sdlog_ostream_t* stream)
+{
+    return 0;
+}
+
+#endif
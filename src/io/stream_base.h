@@ -29,10 +29,31 @@
 #include <sdlog/error.h>
 #include <sdlog/streams.h>
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 __BEGIN_DECLS
 
 #define CONTEXT_AS(type) ((type*)stream->context)
 
+/**
+ * Waits until the given file descriptor of a stream that made no progress
+ * becomes readable or writable. Hangups and errors end the wait as well;
+ * the next read or write reports them. Returns immediately if the platform
+ * cannot wait for file descriptors.
+ */
+sdlog_error_t sdlog_i_wait_for_fd(int fd, bool writable);
+
+/**
+ * Reads from the given offset of a file descriptor without changing its file
+ * offset, retrying interrupted reads. Returns \c SDLOG_EOF at the end of the
+ * file and \c SDLOG_UNIMPLEMENTED if the file descriptor is not seekable.
+ * Only available on platforms with file descriptors.
+ */
+sdlog_error_t sdlog_i_fd_read_at(
+    int fd, uint64_t offset, uint8_t* data, size_t length, size_t* bytes_read);
+
 __END_DECLS
 
 #endif
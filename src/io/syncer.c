@@ -0,0 +1,435 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sdlog/memory.h>
+
+#include "clock.h"
+#include "config.h"
+#include "syncer.h"
+
+#if HAVE_UNISTD_H
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#if HAVE_PTHREAD
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#if HAVE_UNISTD_H
+
+struct sdlog_i_syncer_s {
+    /** The file descriptor to sync; not owned by the syncer */
+    int fd;
+
+    /** The durability policy */
+    sdlog_durability_t policy;
+
+    /** Offset of the end of the data in the last sync request, and the time
+     * of the request; used by the writer thread only */
+    uint64_t requested;
+    uint64_t requested_at;
+
+    /** Time when the writer last handed data to the operating system; used
+     * by the writer thread only */
+    uint64_t handed_over_at;
+
+    /** Offset of the end of the data handed to the operating system */
+    uint64_t written;
+
+    /** Offset up to which a sync was requested */
+    uint64_t target;
+
+    /** Offset up to which the data is known to be durable */
+    uint64_t durable;
+
+    /** Error of an earlier sync; once set, no more syncs are attempted
+     * because the kernel may have dropped the data that failed to sync */
+    sdlog_error_t error;
+
+#if HAVE_PTHREAD
+    /** Background thread that runs the syncs */
+    pthread_t thread;
+    bool has_thread;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t synced;
+
+    bool stopping;
+#endif
+};
+
+static sdlog_error_t sync_fd(int fd);
+
+#if HAVE_PTHREAD
+static void* syncer_worker(void* arg);
+static void deadline_after(struct timespec* ts, uint32_t ms);
+#endif
+
+sdlog_error_t sdlog_i_syncer_create(
+    sdlog_i_syncer_t** syncer, int fd, const sdlog_durability_t* policy, uint64_t offset)
+{
+    sdlog_i_syncer_t* s;
+
+#if HAVE_PTHREAD
+    pthread_condattr_t attr;
+#endif
+
+    switch (policy->mode) {
+    case SDLOG_DURABILITY_BYTES:
+        if (policy->bytes == 0) {
+            return SDLOG_EINVAL;
+        }
+        break;
+
+    case SDLOG_DURABILITY_INTERVAL:
+        if (policy->interval_ms == 0) {
+            return SDLOG_EINVAL;
+        }
+        break;
+
+    case SDLOG_DURABILITY_FLUSH:
+        break;
+
+    default:
+        return SDLOG_EINVAL;
+    }
+
+    SDLOG_CHECK_OOM(s = sdlog_malloc(sizeof(sdlog_i_syncer_t)));
+    memset(s, 0, sizeof(sdlog_i_syncer_t));
+
+    s->fd = fd;
+    s->policy = *policy;
+    s->requested = s->written = s->target = s->durable = offset;
+    s->requested_at = s->handed_over_at = sdlog_i_clock_now_us();
+
+#if HAVE_PTHREAD
+    pthread_mutex_init(&s->mutex, NULL);
+    pthread_cond_init(&s->synced, NULL);
+
+    /* Periodic syncs are timed with the same clock as the rest of the library */
+    pthread_condattr_init(&attr);
+#if HAVE_CLOCK_GETTIME
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+    pthread_cond_init(&s->wake, &attr);
+    pthread_condattr_destroy(&attr);
+
+    /* Without the thread, the writer syncs synchronously */
+    s->has_thread = pthread_create(&s->thread, NULL, syncer_worker, s) == 0;
+#endif
+
+    *syncer = s;
+
+    return SDLOG_SUCCESS;
+}
+
+void sdlog_i_syncer_destroy(sdlog_i_syncer_t* syncer)
+{
+    if (syncer == NULL) {
+        return;
+    }
+
+    sdlog_i_syncer_wait(syncer);
+
+#if HAVE_PTHREAD
+    if (syncer->has_thread) {
+        pthread_mutex_lock(&syncer->mutex);
+        syncer->stopping = true;
+        pthread_cond_signal(&syncer->wake);
+        pthread_mutex_unlock(&syncer->mutex);
+
+        pthread_join(syncer->thread, NULL);
+    }
+
+    pthread_cond_destroy(&syncer->synced);
+    pthread_cond_destroy(&syncer->wake);
+    pthread_mutex_destroy(&syncer->mutex);
+#endif
+
+    memset(syncer, 0, sizeof(sdlog_i_syncer_t));
+    sdlog_free(syncer);
+}
+
+bool sdlog_i_syncer_is_due(sdlog_i_syncer_t* syncer, uint64_t end)
+{
+    switch (syncer->policy.mode) {
+    case SDLOG_DURABILITY_BYTES:
+        return end - syncer->requested >= syncer->policy.bytes;
+
+    case SDLOG_DURABILITY_INTERVAL:
+        /* Data that the writer still holds cannot be synced, so it is handed
+         * over by the first write after an interval without a hand-over.
+         * Nothing calls this while the writer is quiet, so its buffered data
+         * waits for the next write or flush */
+        return end > syncer->written
+            && sdlog_i_clock_now_us() - syncer->handed_over_at >= (uint64_t)syncer->policy.interval_ms * 1000;
+
+    default:
+        return false;
+    }
+}
+
+sdlog_error_t sdlog_i_syncer_written(sdlog_i_syncer_t* syncer, uint64_t offset, bool flush)
+{
+    uint64_t now = sdlog_i_clock_now_us();
+    bool request;
+
+#if HAVE_PTHREAD
+    sdlog_error_t retval;
+#endif
+
+    switch (syncer->policy.mode) {
+    case SDLOG_DURABILITY_BYTES:
+        request = offset - syncer->requested >= syncer->policy.bytes;
+        break;
+
+    case SDLOG_DURABILITY_INTERVAL:
+        request = now - syncer->requested_at >= (uint64_t)syncer->policy.interval_ms * 1000;
+        break;
+
+    case SDLOG_DURABILITY_FLUSH:
+        request = flush;
+        break;
+
+    default:
+        request = false;
+        break;
+    }
+
+    syncer->handed_over_at = now;
+    if (request) {
+        syncer->requested = offset;
+        syncer->requested_at = now;
+    }
+
+#if HAVE_PTHREAD
+    if (syncer->has_thread) {
+        pthread_mutex_lock(&syncer->mutex);
+
+        syncer->written = offset;
+        if (request && offset > syncer->target) {
+            syncer->target = offset;
+            pthread_cond_signal(&syncer->wake);
+        }
+
+        retval = syncer->error;
+
+        pthread_mutex_unlock(&syncer->mutex);
+
+        return retval;
+    }
+#endif
+
+    syncer->written = offset;
+    if (request && syncer->error == SDLOG_SUCCESS && offset > syncer->durable) {
+        syncer->error = sync_fd(syncer->fd);
+        if (syncer->error == SDLOG_SUCCESS) {
+            syncer->durable = offset;
+        }
+    }
+
+    return syncer->error;
+}
+
+sdlog_error_t sdlog_i_syncer_wait(sdlog_i_syncer_t* syncer)
+{
+#if HAVE_PTHREAD
+    sdlog_error_t retval;
+
+    if (syncer->has_thread) {
+        pthread_mutex_lock(&syncer->mutex);
+
+        if (syncer->written > syncer->target) {
+            syncer->target = syncer->written;
+            pthread_cond_signal(&syncer->wake);
+        }
+
+        while (syncer->durable < syncer->target && syncer->error == SDLOG_SUCCESS) {
+            pthread_cond_wait(&syncer->synced, &syncer->mutex);
+        }
+
+        retval = syncer->error;
+
+        pthread_mutex_unlock(&syncer->mutex);
+
+        return retval;
+    }
+#endif
+
+    if (syncer->error == SDLOG_SUCCESS && syncer->written > syncer->durable) {
+        syncer->error = sync_fd(syncer->fd);
+        if (syncer->error == SDLOG_SUCCESS) {
+            syncer->durable = syncer->written;
+        }
+    }
+
+    return syncer->error;
+}
+
+uint64_t sdlog_i_syncer_get_durable_offset(sdlog_i_syncer_t* syncer)
+{
+    uint64_t result;
+
+#if HAVE_PTHREAD
+    pthread_mutex_lock(&syncer->mutex);
+#endif
+
+    result = syncer->durable;
+
+#if HAVE_PTHREAD
+    pthread_mutex_unlock(&syncer->mutex);
+#endif
+
+    return result;
+}
+
+/** Flushes the data of the file to the disk, retrying interrupted calls */
+static sdlog_error_t sync_fd(int fd)
+{
+    int result;
+
+    do {
+#if HAVE_FDATASYNC
+        result = fdatasync(fd);
+#else
+        result = fsync(fd);
+#endif
+    } while (result < 0 && errno == EINTR);
+
+    return result < 0 ? SDLOG_EIO : SDLOG_SUCCESS;
+}
+
+#if HAVE_PTHREAD
+/**
+ * Body of the background thread. Each sync covers all the data handed to the
+ * operating system by the time the sync starts, so requests that arrive
+ * during a sync are served together by the next one.
+ */
+static void* syncer_worker(void* arg)
+{
+    sdlog_i_syncer_t* syncer = (sdlog_i_syncer_t*)arg;
+    struct timespec deadline;
+    sdlog_error_t result;
+    uint64_t offset;
+
+    pthread_mutex_lock(&syncer->mutex);
+
+    while (true) {
+        if (syncer->target > syncer->durable && syncer->error == SDLOG_SUCCESS) {
+            offset = syncer->written;
+
+            pthread_mutex_unlock(&syncer->mutex);
+            result = sync_fd(syncer->fd);
+            pthread_mutex_lock(&syncer->mutex);
+
+            if (result != SDLOG_SUCCESS) {
+                syncer->error = result;
+            } else if (offset > syncer->durable) {
+                syncer->durable = offset;
+            }
+
+            pthread_cond_broadcast(&syncer->synced);
+            continue;
+        }
+
+        if (syncer->stopping) {
+            break;
+        }
+
+        if (syncer->policy.mode == SDLOG_DURABILITY_INTERVAL) {
+            /* Data handed over by a writer that went quiet is synced too */
+            deadline_after(&deadline, syncer->policy.interval_ms);
+            if (pthread_cond_timedwait(&syncer->wake, &syncer->mutex, &deadline) == ETIMEDOUT
+                && syncer->written > syncer->target) {
+                syncer->target = syncer->written;
+            }
+        } else {
+            pthread_cond_wait(&syncer->wake, &syncer->mutex);
+        }
+    }
+
+    pthread_mutex_unlock(&syncer->mutex);
+
+    return NULL;
+}
+
+/** Returns the time after the given number of milliseconds for timed waits */
+static void deadline_after(struct timespec* ts, uint32_t ms)
+{
+#if HAVE_CLOCK_GETTIME
+    clock_gettime(CLOCK_MONOTONIC, ts);
+#else
+    ts->tv_sec = time(NULL);
+    ts->tv_nsec = 0;
+#endif
+
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+#endif
+
+#else
+
+sdlog_error_t sdlog_i_syncer_create(
+    sdlog_i_syncer_t** syncer, int fd, const sdlog_durability_t* policy, uint64_t offset)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+void sdlog_i_syncer_destroy(sdlog_i_syncer_t* syncer)
+{
+}
+
+bool sdlog_i_syncer_is_due(sdlog_i_syncer_t* syncer, uint64_t end)
+{
+    return false;
+}
+
+sdlog_error_t sdlog_i_syncer_written(sdlog_i_syncer_t* syncer, uint64_t offset, bool flush)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+sdlog_error_t sdlog_i_syncer_wait(sdlog_i_syncer_t* syncer)
+{
+    return SDLOG_UNIMPLEMENTED;
+}
+
+uint64_t sdlog_i_syncer_get_durable_offset(sdlog_i_syncer_t* syncer)
+{
+    return 0;
+}
+
+#endif
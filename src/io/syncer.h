@@ -0,0 +1,103 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SDLOG_SYNCER_H
+#define SDLOG_SYNCER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <sdlog/decls.h>
+#include <sdlog/error.h>
+#include <sdlog/streams.h>
+
+/**
+ * @file syncer.h
+ * @brief Internal helper that makes the data written to a file descriptor
+ * durable according to a durability policy
+ *
+ * Streams that write to a file report the end of the data that they handed
+ * to the operating system to the syncer. The syncer decides when the data
+ * has to be synced according to the policy, and syncs it on a background
+ * thread so the writer never waits for the disk. Sync requests that arrive
+ * while a sync is running are merged into the next sync (group commit).
+ * Without threads, the data is synced synchronously instead.
+ */
+
+__BEGIN_DECLS
+
+typedef struct sdlog_i_syncer_s sdlog_i_syncer_t;
+
+/**
+ * Creates a syncer for the given file descriptor.
+ *
+ * @param syncer  the syncer is returned here
+ * @param fd      the file descriptor to sync
+ * @param policy  the durability policy to follow; must not be
+ *        \c SDLOG_DURABILITY_NEVER
+ * @param offset  offset in the file up to which the data is considered
+ *        durable already
+ */
+sdlog_error_t sdlog_i_syncer_create(
+    sdlog_i_syncer_t** syncer, int fd, const sdlog_durability_t* policy, uint64_t offset);
+
+/**
+ * Syncs all the data reported to the syncer so far and destroys the syncer.
+ */
+void sdlog_i_syncer_destroy(sdlog_i_syncer_t* syncer);
+
+/**
+ * Returns whether the writer should hand its buffered data to the operating
+ * system now so it can be synced, given the offset of the end of the data
+ * that the writer holds. Called from the writer thread only; does not lock.
+ */
+bool sdlog_i_syncer_is_due(sdlog_i_syncer_t* syncer, uint64_t end);
+
+/**
+ * Reports that the data up to the given offset was handed to the operating
+ * system, and requests a sync if the policy says so.
+ *
+ * @param syncer  the syncer
+ * @param offset  offset of the end of the data handed to the operating system
+ * @param flush   whether the data was handed over because the stream was
+ *        flushed
+ * @return the error of an earlier sync that was not reported yet
+ */
+sdlog_error_t sdlog_i_syncer_written(sdlog_i_syncer_t* syncer, uint64_t offset, bool flush);
+
+/**
+ * Syncs all the data reported to the syncer so far and waits until it is
+ * durable.
+ */
+sdlog_error_t sdlog_i_syncer_wait(sdlog_i_syncer_t* syncer);
+
+/**
+ * Returns the offset in the file up to which the data is known to be
+ * durable. May be called from any thread.
+ */
+uint64_t sdlog_i_syncer_get_durable_offset(sdlog_i_syncer_t* syncer);
+
+__END_DECLS
+
+#endif
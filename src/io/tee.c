@@ -0,0 +1,730 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <sdlog/memory.h>
+#include <sdlog/streams.h>
+
+#include "config.h"
+#include "framer.h"
+#include "stream_base.h"
+
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+typedef enum {
+    COMMAND_BEGIN,
+    COMMAND_WRITE,
+    COMMAND_FLUSH,
+    COMMAND_END
+} command_t;
+
+#if HAVE_PTHREAD
+
+/* Each entry in the queue of an asynchronous child starts with a one-byte
+ * command code and a 32-bit payload length, followed by the payload */
+#define ENTRY_HEADER_SIZE 5
+
+/* Longest sequence of pending commands after coalescing; see add_pending() */
+#define MAX_PENDING_COMMANDS 2
+
+typedef struct {
+    sdlog_ostream_t* stream;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t has_data;
+
+    uint8_t* data;
+    size_t capacity;
+    size_t head;
+    size_t tail;
+    size_t used;
+
+    size_t bytes_dropped;
+    sdlog_error_t error;
+    bool stopping;
+
+    /** Commands that did not fit in the queue, in order. They follow all the
+     * entries in the queue, and writes are dropped while there are any, so
+     * the worker runs them once it has emptied the queue. */
+    command_t pending[MAX_PENDING_COMMANDS];
+    size_t num_pending;
+
+    /** Whether writes were dropped since the FMT records were last sent;
+     * accessed by the producer only */
+    bool needs_resync;
+} queue_t;
+
+#endif
+
+typedef struct {
+    sdlog_ostream_t* stream;
+    sdlog_error_t error;
+#if HAVE_PTHREAD
+    /** Queue of pending commands; NULL for synchronous children */
+    queue_t* queue;
+#endif
+} child_t;
+
+typedef struct {
+    size_t num_children;
+    child_t* children;
+
+#if HAVE_PTHREAD
+    /** Framer that finds the record boundaries in the data sent to
+     * asynchronous children, so that drops never tear records */
+    sdlog_i_framer_t framer;
+
+    /** FMT records written so far; re-sent to asynchronous children after
+     * writes were dropped. NULL if there are no asynchronous children */
+    sdlog_i_format_table_t* formats;
+
+    /** Bytes of the record that is not complete yet; they are sent to the
+     * asynchronous children together with the rest of the record */
+    uint8_t carry[SDLOG_MAX_MESSAGE_LENGTH];
+
+    /** Number of bytes in \c carry */
+    size_t carry_length;
+#endif
+} context_t;
+
+static void tee_destroy(sdlog_ostream_t* stream);
+static sdlog_error_t tee_begin(sdlog_ostream_t* stream);
+static sdlog_error_t tee_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written);
+static sdlog_error_t tee_writev(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt, size_t* written);
+static sdlog_error_t tee_flush(sdlog_ostream_t* stream);
+static sdlog_error_t tee_end(sdlog_ostream_t* stream);
+static sdlog_error_t tee_get_fd(sdlog_ostream_t* stream, int* fd);
+
+#if HAVE_PTHREAD
+static void push_complete_records(
+    context_t* ctx, const sdlog_iovec_t* iov, size_t iovcnt, uint64_t fed,
+    sdlog_iovec_t* parts);
+static sdlog_error_t track_formats(void* arg, const uint8_t* record, size_t length);
+static sdlog_error_t queue_create(queue_t** result, sdlog_ostream_t* stream, size_t capacity);
+static void queue_destroy(queue_t* queue);
+static void queue_push(
+    queue_t* queue, command_t command, const sdlog_iovec_t* iov, size_t iovcnt,
+    const sdlog_i_format_table_t* formats);
+static void add_pending(queue_t* queue, command_t command);
+static sdlog_error_t run_command(sdlog_ostream_t* stream, command_t command);
+static void* queue_worker(void* arg);
+#endif
+
+const sdlog_ostream_spec_t sdlog_ostream_tee_methods = {
+    .destroy = tee_destroy,
+    .begin = tee_begin,
+    .write = tee_write,
+    .writev = tee_writev,
+    .flush = tee_flush,
+    .end = tee_end,
+    .get_fd = tee_get_fd,
+};
+
+sdlog_error_t sdlog_ostream_init_tee(
+    sdlog_ostream_t* stream, sdlog_ostream_t* const* children, size_t num_children)
+{
+    context_t* ctx;
+    size_t i;
+
+    SDLOG_CHECK_OOM(ctx = sdlog_malloc(sizeof(context_t)));
+    memset(ctx, 0, sizeof(context_t));
+
+    /* Allocate at least one slot so a NULL pointer always means OOM */
+    ctx->children = sdlog_malloc((num_children > 0 ? num_children : 1) * sizeof(child_t));
+    if (ctx->children == NULL) {
+        sdlog_free(ctx);
+        return SDLOG_ENOMEM;
+    }
+
+    memset(ctx->children, 0, (num_children > 0 ? num_children : 1) * sizeof(child_t));
+    ctx->num_children = num_children;
+    for (i = 0; i < num_children; i++) {
+        ctx->children[i].stream = children[i];
+    }
+
+    return sdlog_ostream_init(stream, &sdlog_ostream_tee_methods, ctx);
+}
+
+sdlog_error_t sdlog_ostream_tee_set_async(
+    sdlog_ostream_t* stream, size_t index, size_t queue_size)
+{
+#if HAVE_PTHREAD
+    context_t* ctx = CONTEXT_AS(context_t);
+    child_t* child;
+
+    if (index >= ctx->num_children || queue_size <= ENTRY_HEADER_SIZE) {
+        return SDLOG_EINVAL;
+    }
+
+    child = &ctx->children[index];
+    if (child->queue) {
+        return SDLOG_EINVAL;
+    }
+
+    if (ctx->formats == NULL) {
+        SDLOG_CHECK_OOM(ctx->formats = sdlog_malloc(sizeof(sdlog_i_format_table_t)));
+        memset(ctx->formats, 0, sizeof(sdlog_i_format_table_t));
+        sdlog_i_framer_init(&ctx->framer);
+    }
+
+    return queue_create(&child->queue, child->stream, queue_size);
+#else
+    return SDLOG_UNIMPLEMENTED;
+#endif
+}
+
+sdlog_error_t sdlog_ostream_tee_get_child_status(
+    sdlog_ostream_t* stream, size_t index, size_t* bytes_dropped)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    child_t* child;
+    sdlog_error_t retval;
+
+    if (index >= ctx->num_children) {
+        return SDLOG_EINVAL;
+    }
+
+    child = &ctx->children[index];
+    retval = child->error;
+    if (bytes_dropped) {
+        *bytes_dropped = 0;
+    }
+
+#if HAVE_PTHREAD
+    if (child->queue) {
+        pthread_mutex_lock(&child->queue->mutex);
+        retval = child->queue->error;
+        if (bytes_dropped) {
+            *bytes_dropped = child->queue->bytes_dropped;
+        }
+        pthread_mutex_unlock(&child->queue->mutex);
+    }
+#endif
+
+    return retval;
+}
+
+static void tee_destroy(sdlog_ostream_t* stream)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+
+#if HAVE_PTHREAD
+    size_t i;
+
+    for (i = 0; i < ctx->num_children; i++) {
+        if (ctx->children[i].queue) {
+            queue_destroy(ctx->children[i].queue);
+        }
+    }
+
+    sdlog_free(ctx->formats);
+#endif
+
+    sdlog_free(ctx->children);
+    memset(ctx, 0, sizeof(context_t));
+    sdlog_free(ctx);
+}
+
+/**
+ * Forwards a command to all children. Synchronous children are served in the
+ * calling thread; the first error of a synchronous child is returned after
+ * all the other children were served. Asynchronous children receive the
+ * command via their queues.
+ */
+static sdlog_error_t forward(
+    sdlog_ostream_t* stream, command_t command, const sdlog_iovec_t* iov, size_t iovcnt)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    sdlog_error_t retval = SDLOG_SUCCESS, child_retval;
+    size_t i;
+
+    for (i = 0; i < ctx->num_children; i++) {
+        child_t* child = &ctx->children[i];
+
+#if HAVE_PTHREAD
+        if (child->queue) {
+            /* Writes reach the queues in record-aligned units, see below */
+            if (command != COMMAND_WRITE) {
+                queue_push(child->queue, command, NULL, 0, NULL);
+            }
+            continue;
+        }
+#endif
+
+        switch (command) {
+        case COMMAND_BEGIN:
+            child_retval = sdlog_ostream_begin_session(child->stream);
+            break;
+
+        case COMMAND_WRITE:
+            /* Each child takes care of its own partial writes, directly from
+             * the caller's buffer */
+            child_retval = sdlog_ostream_writev_all(child->stream, iov, iovcnt);
+            break;
+
+        case COMMAND_FLUSH:
+            child_retval = sdlog_ostream_flush(child->stream);
+            break;
+
+        default:
+            child_retval = sdlog_ostream_end_session(child->stream);
+            break;
+        }
+
+        if (child_retval != SDLOG_SUCCESS) {
+            child->error = child_retval;
+            if (retval == SDLOG_SUCCESS) {
+                retval = child_retval;
+            }
+        }
+    }
+
+    return retval;
+}
+
+static sdlog_error_t tee_begin(sdlog_ostream_t* stream)
+{
+    return forward(stream, COMMAND_BEGIN, NULL, 0);
+}
+
+static sdlog_error_t tee_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    sdlog_iovec_t iov;
+
+    iov.data = data;
+    iov.length = length;
+
+    return tee_writev(stream, &iov, 1, written);
+}
+
+static sdlog_error_t tee_writev(
+    sdlog_ostream_t* stream, const sdlog_iovec_t* iov, size_t iovcnt, size_t* written)
+{
+    size_t i, total = 0;
+
+    for (i = 0; i < iovcnt; i++) {
+        total += iov[i].length;
+    }
+
+    /* Queue entries store the length of their payload on 32 bits */
+    if (total > UINT32_MAX) {
+        *written = 0;
+        return SDLOG_ELIMIT;
+    }
+
+#if HAVE_PTHREAD
+    {
+        context_t* ctx = CONTEXT_AS(context_t);
+        sdlog_iovec_t stack_parts[8];
+        sdlog_iovec_t* parts = stack_parts;
+        uint64_t fed;
+
+        if (ctx->formats) {
+            if (iovcnt >= sizeof(stack_parts) / sizeof(stack_parts[0])) {
+                SDLOG_CHECK_OOM(parts = sdlog_malloc((iovcnt + 1) * sizeof(sdlog_iovec_t)));
+            }
+
+            fed = ctx->framer.position;
+            for (i = 0; i < iovcnt; i++) {
+                sdlog_i_framer_feed(&ctx->framer, iov[i].data, iov[i].length, track_formats, ctx);
+            }
+            push_complete_records(ctx, iov, iovcnt, fed, parts);
+
+            if (parts != stack_parts) {
+                sdlog_free(parts);
+            }
+        }
+    }
+#endif
+
+    *written = total;
+    return forward(stream, COMMAND_WRITE, iov, iovcnt);
+}
+
+static sdlog_error_t tee_flush(sdlog_ostream_t* stream)
+{
+    return forward(stream, COMMAND_FLUSH, NULL, 0);
+}
+
+static sdlog_error_t tee_end(sdlog_ostream_t* stream)
+{
+#if HAVE_PTHREAD
+    context_t* ctx = CONTEXT_AS(context_t);
+    sdlog_iovec_t iov;
+    size_t i;
+
+    /* A record left incomplete at the end of the session is not going to be
+     * completed; send what we have */
+    if (ctx->carry_length > 0) {
+        iov.data = ctx->carry;
+        iov.length = ctx->carry_length;
+        for (i = 0; i < ctx->num_children; i++) {
+            if (ctx->children[i].queue) {
+                queue_push(ctx->children[i].queue, COMMAND_WRITE, &iov, 1, ctx->formats);
+            }
+        }
+        ctx->carry_length = 0;
+        ctx->framer.partial_length = 0;
+    }
+#endif
+
+    return forward(stream, COMMAND_END, NULL, 0);
+}
+
+static sdlog_error_t tee_get_fd(sdlog_ostream_t* stream, int* fd)
+{
+    context_t* ctx = CONTEXT_AS(context_t);
+    size_t i;
+
+    /* Only synchronous children can make the writer wait */
+    for (i = 0; i < ctx->num_children; i++) {
+#if HAVE_PTHREAD
+        if (ctx->children[i].queue) {
+            continue;
+        }
+#endif
+        if (sdlog_ostream_get_fd(ctx->children[i].stream, fd) == SDLOG_SUCCESS) {
+            return SDLOG_SUCCESS;
+        }
+    }
+
+    return SDLOG_UNIMPLEMENTED;
+}
+
+/* ************************************************************************** */
+
+#if HAVE_PTHREAD
+
+/**
+ * Sends the bytes written so far that end on a record boundary to the queues
+ * of the asynchronous children, as a single entry per child. \c fed is the
+ * number of bytes fed to the framer before \c iov. The bytes of a record
+ * that is not complete yet are kept in the carry buffer of the stream until
+ * the record is completed. \c parts must have room for <code>iovcnt + 1</code>
+ * items.
+ */
+static void push_complete_records(
+    context_t* ctx, const sdlog_iovec_t* iov, size_t iovcnt, uint64_t fed,
+    sdlog_iovec_t* parts)
+{
+    size_t i, n;
+
+    n = sdlog_i_framer_get_complete(&ctx->framer, fed, ctx->carry, ctx->carry_length, iov, iovcnt, parts);
+    for (i = 0; i < ctx->num_children; i++) {
+        if (ctx->children[i].queue) {
+            queue_push(ctx->children[i].queue, COMMAND_WRITE, parts, n, ctx->formats);
+        }
+    }
+
+    sdlog_i_framer_keep_incomplete(&ctx->framer, fed, ctx->carry, &ctx->carry_length, iov, iovcnt);
+}
+
+static sdlog_error_t track_formats(void* arg, const uint8_t* record, size_t length)
+{
+    context_t* ctx = (context_t*)arg;
+    sdlog_i_format_table_remember(ctx->formats, record, length);
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t queue_create(queue_t** result, sdlog_ostream_t* stream, size_t capacity)
+{
+    queue_t* queue;
+
+    SDLOG_CHECK_OOM(queue = sdlog_malloc(sizeof(queue_t)));
+    memset(queue, 0, sizeof(queue_t));
+
+    queue->data = sdlog_malloc(capacity * sizeof(uint8_t));
+    if (queue->data == NULL) {
+        sdlog_free(queue);
+        return SDLOG_ENOMEM;
+    }
+
+    queue->stream = stream;
+    queue->capacity = capacity;
+    queue->error = SDLOG_SUCCESS;
+
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->has_data, NULL);
+
+    if (pthread_create(&queue->thread, NULL, queue_worker, queue)) {
+        pthread_cond_destroy(&queue->has_data);
+        pthread_mutex_destroy(&queue->mutex);
+        sdlog_free(queue->data);
+        sdlog_free(queue);
+        return SDLOG_FAILURE;
+    }
+
+    *result = queue;
+
+    return SDLOG_SUCCESS;
+}
+
+static void queue_destroy(queue_t* queue)
+{
+    /* The worker drains the queue before it exits */
+    pthread_mutex_lock(&queue->mutex);
+    queue->stopping = true;
+    pthread_cond_signal(&queue->has_data);
+    pthread_mutex_unlock(&queue->mutex);
+
+    pthread_join(queue->thread, NULL);
+
+    pthread_cond_destroy(&queue->has_data);
+    pthread_mutex_destroy(&queue->mutex);
+    sdlog_free(queue->data);
+    sdlog_free(queue);
+}
+
+/** Copies bytes into the ring buffer of the queue, wrapping around if needed */
+static void queue_copy_in(queue_t* queue, const uint8_t* data, size_t length)
+{
+    size_t chunk = queue->capacity - queue->head;
+
+    if (length == 0) {
+        return;
+    }
+
+    if (chunk > length) {
+        chunk = length;
+    }
+
+    memcpy(queue->data + queue->head, data, chunk);
+    memcpy(queue->data, data + chunk, length - chunk);
+    queue->head = (queue->head + length) % queue->capacity;
+}
+
+/** Copies bytes out of the ring buffer of the queue from a given position */
+static void queue_copy_out(queue_t* queue, size_t pos, uint8_t* data, size_t length)
+{
+    size_t chunk = queue->capacity - pos;
+
+    if (chunk > length) {
+        chunk = length;
+    }
+
+    memcpy(data, queue->data + pos, chunk);
+    memcpy(data + chunk, queue->data, length - chunk);
+}
+
+/**
+ * Adds a command to the queue. The buffers of a write form a single entry.
+ * The writer thread is never blocked by a slow child: writes that do not fit
+ * are dropped as a whole, and other commands that do not fit are kept aside
+ * for the worker since they must not be lost. After a drop, the known FMT
+ * records are sent again in front of the next write so that the child can
+ * decode what follows.
+ */
+static void queue_push(
+    queue_t* queue, command_t command, const sdlog_iovec_t* iov, size_t iovcnt,
+    const sdlog_i_format_table_t* formats)
+{
+    uint8_t header[ENTRY_HEADER_SIZE];
+    size_t i, length = 0, resync = 0, needed;
+    uint32_t length32;
+
+    for (i = 0; i < iovcnt; i++) {
+        length += iov[i].length;
+    }
+
+    if (command == COMMAND_WRITE && length == 0) {
+        return;
+    }
+
+    if (command == COMMAND_WRITE && queue->needs_resync) {
+        for (i = 0; i < SDLOG_NUM_MESSAGE_FORMATS; i++) {
+            if (formats->present[i]) {
+                resync += SDLOG_I_FMT_RECORD_LENGTH;
+            }
+        }
+    }
+
+    needed = ENTRY_HEADER_SIZE + resync + length;
+    length32 = (uint32_t)(resync + length);
+    header[0] = (uint8_t)command;
+    memcpy(header + 1, &length32, sizeof(length32));
+
+    pthread_mutex_lock(&queue->mutex);
+
+    if (command == COMMAND_WRITE
+        && (queue->num_pending > 0 || needed > queue->capacity - queue->used || resync + length > UINT32_MAX)) {
+        queue->bytes_dropped += length;
+        queue->needs_resync = true;
+    } else if (queue->num_pending > 0 || needed > queue->capacity - queue->used) {
+        add_pending(queue, command);
+        pthread_cond_signal(&queue->has_data);
+    } else {
+        queue_copy_in(queue, header, ENTRY_HEADER_SIZE);
+        if (resync > 0) {
+            for (i = 0; i < SDLOG_NUM_MESSAGE_FORMATS; i++) {
+                if (formats->present[i]) {
+                    queue_copy_in(queue, formats->records[i], SDLOG_I_FMT_RECORD_LENGTH);
+                }
+            }
+        }
+        for (i = 0; i < iovcnt; i++) {
+            queue_copy_in(queue, iov[i].data, iov[i].length);
+        }
+
+        queue->needs_resync = false;
+        queue->used += needed;
+        pthread_cond_signal(&queue->has_data);
+    }
+
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+/**
+ * Appends a command that did not fit in the queue to the pending commands.
+ * No writes come between pending commands, so flushes right after session
+ * starts or other flushes are no-ops, a flush before a session end is part of
+ * the end, and a session that is started and ended is empty. This keeps at
+ * most a session end and a session start pending. Must be called with the
+ * mutex held.
+ */
+static void add_pending(queue_t* queue, command_t command)
+{
+    command_t last = queue->num_pending > 0 ? queue->pending[queue->num_pending - 1] : COMMAND_WRITE;
+
+    switch (command) {
+    case COMMAND_FLUSH:
+        if (last == COMMAND_BEGIN || last == COMMAND_FLUSH) {
+            return;
+        }
+        break;
+
+    case COMMAND_END:
+        if (last == COMMAND_FLUSH) {
+            queue->num_pending--;
+            add_pending(queue, command);
+            return;
+        } else if (last == COMMAND_BEGIN) {
+            queue->num_pending--;
+            return;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    if (queue->num_pending < MAX_PENDING_COMMANDS) {
+        queue->pending[queue->num_pending++] = command;
+    }
+}
+
+/** Runs a command other than a write on the stream of a queue */
+static sdlog_error_t run_command(sdlog_ostream_t* stream, command_t command)
+{
+    switch (command) {
+    case COMMAND_BEGIN:
+        return sdlog_ostream_begin_session(stream);
+
+    case COMMAND_FLUSH:
+        return sdlog_ostream_flush(stream);
+
+    default:
+        return sdlog_ostream_end_session(stream);
+    }
+}
+
+static void* queue_worker(void* arg)
+{
+    queue_t* queue = arg;
+    uint8_t header[ENTRY_HEADER_SIZE];
+    uint32_t length;
+    size_t pos, chunk;
+    sdlog_error_t retval;
+
+    pthread_mutex_lock(&queue->mutex);
+
+    while (true) {
+        while (queue->used == 0 && queue->num_pending == 0 && !queue->stopping) {
+            pthread_cond_wait(&queue->has_data, &queue->mutex);
+        }
+
+        if (queue->used == 0 && queue->num_pending == 0) {
+            break;
+        }
+
+        if (queue->used == 0) {
+            /* Pending commands come after all the queued entries */
+            header[0] = (uint8_t)queue->pending[0];
+            queue->num_pending--;
+            memmove(queue->pending, queue->pending + 1, queue->num_pending * sizeof(command_t));
+            retval = queue->error;
+
+            pthread_mutex_unlock(&queue->mutex);
+
+            if (retval == SDLOG_SUCCESS) {
+                retval = run_command(queue->stream, (command_t)header[0]);
+            }
+
+            pthread_mutex_lock(&queue->mutex);
+            queue->error = retval;
+            continue;
+        }
+
+        queue_copy_out(queue, queue->tail, header, ENTRY_HEADER_SIZE);
+        memcpy(&length, header + 1, sizeof(length));
+        pos = (queue->tail + ENTRY_HEADER_SIZE) % queue->capacity;
+        retval = queue->error;
+
+        /* The producer never overwrites entries that are not consumed yet, so
+         * the payload can be written straight from the ring buffer */
+        pthread_mutex_unlock(&queue->mutex);
+
+        if (retval == SDLOG_SUCCESS && header[0] == COMMAND_WRITE) {
+            chunk = queue->capacity - pos;
+            if (chunk > length) {
+                chunk = length;
+            }
+            retval = sdlog_ostream_write_all(queue->stream, queue->data + pos, chunk);
+            if (retval == SDLOG_SUCCESS) {
+                retval = sdlog_ostream_write_all(queue->stream, queue->data, length - chunk);
+            }
+        } else if (retval == SDLOG_SUCCESS) {
+            retval = run_command(queue->stream, (command_t)header[0]);
+        }
+
+        pthread_mutex_lock(&queue->mutex);
+
+        queue->error = retval;
+        queue->tail = (pos + length) % queue->capacity;
+        queue->used -= ENTRY_HEADER_SIZE + length;
+    }
+
+    pthread_mutex_unlock(&queue->mutex);
+
+    return NULL;
+}
+
+#endif
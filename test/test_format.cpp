@@ -0,0 +1,134 @@
+/*
+ * This file is part of libsdlog.
+ *
+ * Copyright 2023-2025 Tamas Nepusz.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <sdlog/encoder.h>
+#include <sdlog/format.hpp>
+#include <sdlog/writer.h>
+
+#include "unity.h"
+#include "utils.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_format_size(void)
+{
+    using IntFormat = sdlog::BasicFormat<'b', 'B', 'h', 'H', 'i', 'I', 'q', 'Q'>;
+    using StrFormat = sdlog::BasicFormat<'n', 'N', 'Z'>;
+
+    static_assert(IntFormat::column_count == 8);
+    static_assert(IntFormat::body_size == 30);
+    static_assert(IntFormat::size == 33);
+    static_assert(StrFormat::size == 87);
+
+    IntFormat format(1, "INT", "s8,u8,s16,u16,s32,u32,s64,u64");
+    TEST_ASSERT_EQUAL(1, format.id());
+    TEST_ASSERT_EQUAL(IntFormat::body_size, sdlog_message_format_get_size(format.get()));
+}
+
+void test_format_encode(void)
+{
+    sdlog_message_format_t format;
+    uint8_t expected[SDLOG_MAX_MESSAGE_LENGTH];
+    uint8_t buf[SDLOG_MAX_MESSAGE_LENGTH];
+    size_t written;
+
+    sdlog::BasicFormat<'Q', 'f', 'd', 'h', 'N'> imu(0x20, "IMU", "TimeUS,GyrX,GyrY,Hlth,Name", "sEE--");
+
+    TEST_CHECK(sdlog_message_format_init(&format, 0x20, "IMU"));
+    TEST_CHECK(sdlog_message_format_add_columns(
+        &format, "TimeUS,GyrX,GyrY,Hlth,Name", "QfdhN", "sEE--"));
+    TEST_CHECK(sdlog_message_format_encode(
+        &format, expected, &written, 0x0badcafedeadbeefULL, 0.125, -0.25, -3, "gyro"));
+    sdlog_message_format_destroy(&format);
+
+    TEST_ASSERT_EQUAL(imu.size, written);
+    TEST_ASSERT_EQUAL(imu.size, imu.encode(buf, 0x0badcafedeadbeefULL, 0.125f, -0.25, -3, "gyro"));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, buf, written);
+}
+
+void test_format_invalid(void)
+{
+    bool thrown = false;
+
+    try {
+        sdlog::BasicFormat<'B'> format(1, "TOOLONG", "x");
+    } catch (const sdlog::error& ex) {
+        thrown = true;
+        TEST_ASSERT_EQUAL(SDLOG_EINVAL, ex.code());
+    }
+
+    TEST_ASSERT_TRUE(thrown);
+}
+
+void test_format_write(void)
+{
+    sdlog_writer_t writer;
+    sdlog_ostream_t stream;
+    sdlog_message_format_t format;
+    uint8_t expected[SDLOG_MAX_MESSAGE_LENGTH];
+    const uint8_t* buf;
+    size_t size, written;
+
+#if defined(__cpp_nontype_template_args) && __cpp_nontype_template_args >= 201911L
+    sdlog::Format<"FLT", 'f', 'd'> flt(2, "float,double");
+#else
+    sdlog::BasicFormat<'f', 'd'> flt(2, "FLT", "float,double");
+#endif
+
+    TEST_CHECK(sdlog_message_format_init(&format, 2, "FLT"));
+    TEST_CHECK(sdlog_message_format_add_columns(&format, "float,double", "fd", "--"));
+    TEST_CHECK(sdlog_message_format_encode(&format, expected, &written, 0.125, 0.25));
+    sdlog_message_format_destroy(&format);
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&stream));
+    TEST_CHECK(sdlog_writer_init(&writer, &stream));
+    TEST_CHECK(flt.write(&writer, 0.125f, 0.25));
+    sdlog_writer_destroy(&writer);
+
+    /* FMT record followed by the record itself */
+    buf = sdlog_ostream_buffer_get(&stream, &size);
+    TEST_ASSERT_EQUAL(89 + written, size);
+    TEST_ASSERT_EQUAL(2, buf[3]);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, buf + 89, written);
+
+    sdlog_ostream_destroy(&stream);
+}
+
+int main(int argc, char* argv[])
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_format_size);
+    RUN_TEST(test_format_encode);
+    RUN_TEST(test_format_invalid);
+    RUN_TEST(test_format_write);
+
+    return UNITY_END();
+}
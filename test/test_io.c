@@ -22,11 +22,27 @@
  * SOFTWARE.
  */
 
+#include <sdlog/byteorder.h>
+#include <sdlog/encoder.h>
 #include <sdlog/streams.h>
+#include <sdlog/writer.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "config.h"
 
+#if HAVE_UNISTD_H
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#if HAVE_SHM_OPEN
+#include <sys/mman.h>
+#endif
+
 #include "unity.h"
 #include "utils.h"
 
@@ -117,6 +133,200 @@ void test_istream_buffer(void)
     sdlog_istream_destroy(&stream);
 }
 
+/* Input filter that counts the reads that reach the stream below it */
+static sdlog_error_t counted_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read)
+{
+    (*(size_t*)sdlog_istream_filter_get_context(stream))++;
+    return sdlog_istream_read(sdlog_istream_filter_get_inner(stream), data, length, read);
+}
+
+static const sdlog_istream_spec_t counted_methods = {
+    .read = counted_read,
+};
+
+void test_istream_buffered(void)
+{
+    unsigned char buf[] = "1234567890abcdefghijklmnopqrstABCDEFGHIJ";
+    sdlog_istream_t source, counted, stream;
+    const uint8_t* ptr;
+    uint8_t inbuf[40];
+    size_t available, read, reads = 0;
+    int fd;
+
+    TEST_CHECK(sdlog_istream_init_buffer(&source, buf, sizeof(buf) - 1));
+    TEST_CHECK(sdlog_istream_init_filter(&counted, &source, &counted_methods, &reads));
+    TEST_CHECK(sdlog_istream_init_buffered(&stream, &counted, 16));
+    TEST_ERROR(SDLOG_UNIMPLEMENTED, sdlog_istream_get_fd(&stream, &fd));
+
+    /* Small reads are served from the buffer */
+    TEST_CHECK(sdlog_istream_buffered_read_exactly(&stream, inbuf, 3));
+    TEST_ASSERT_EQUAL_STRING_LEN("123", inbuf, 3);
+    TEST_ASSERT_EQUAL(1, reads);
+    TEST_CHECK(sdlog_istream_buffered_read_exactly(&stream, inbuf, 7));
+    TEST_ASSERT_EQUAL_STRING_LEN("4567890", inbuf, 7);
+    TEST_CHECK(sdlog_istream_read(&stream, inbuf, 10, &read));
+    TEST_ASSERT_EQUAL(6, read);
+    TEST_ASSERT_EQUAL_STRING_LEN("abcdef", inbuf, 6);
+    TEST_ASSERT_EQUAL(1, reads);
+
+    /* Peeking keeps the unread bytes and tops them up */
+    TEST_CHECK(sdlog_istream_buffered_peek(&stream, 0, &ptr, &available));
+    TEST_ASSERT_EQUAL(0, available);
+    TEST_CHECK(sdlog_istream_buffered_peek(&stream, 4, &ptr, &available));
+    TEST_ASSERT_EQUAL(16, available);
+    TEST_ASSERT_EQUAL_STRING_LEN("ghijklmnopqrstAB", ptr, 16);
+    TEST_CHECK(sdlog_istream_buffered_consume(&stream, 4));
+    TEST_ERROR(SDLOG_EINVAL, sdlog_istream_buffered_consume(&stream, 13));
+    TEST_CHECK(sdlog_istream_buffered_read_exactly(&stream, inbuf, 2));
+    TEST_ASSERT_EQUAL_STRING_LEN("kl", inbuf, 2);
+    TEST_CHECK(sdlog_istream_buffered_peek(&stream, 16, &ptr, &available));
+    TEST_ASSERT_EQUAL_STRING_LEN("mnopqrstABCDEFGH", ptr, 16);
+    TEST_ERROR(SDLOG_ELIMIT, sdlog_istream_buffered_peek(&stream, 17, &ptr, &available));
+    TEST_ASSERT_EQUAL(3, reads);
+
+    /* Reads that cross the end of the buffer */
+    TEST_CHECK(sdlog_istream_buffered_read_exactly(&stream, inbuf, 18));
+    TEST_ASSERT_EQUAL_STRING_LEN("mnopqrstABCDEFGHIJ", inbuf, 18);
+
+    /* The end of the stream */
+    TEST_ERROR(SDLOG_EOF, sdlog_istream_buffered_peek(&stream, 1, &ptr, &available));
+    TEST_ASSERT_EQUAL(0, available);
+    TEST_ERROR(SDLOG_EOF, sdlog_istream_read(&stream, inbuf, 1, &read));
+    TEST_ASSERT_EQUAL(0, read);
+    sdlog_istream_destroy(&stream);
+    sdlog_istream_destroy(&counted);
+    sdlog_istream_destroy(&source);
+
+    /* Large reads bypass the empty buffer; peeking near the end returns
+     * what is left */
+    reads = 0;
+    TEST_CHECK(sdlog_istream_init_buffer(&source, buf, sizeof(buf) - 1));
+    TEST_CHECK(sdlog_istream_init_filter(&counted, &source, &counted_methods, &reads));
+    TEST_CHECK(sdlog_istream_init_buffered(&stream, &counted, 16));
+    TEST_CHECK(sdlog_istream_read(&stream, inbuf, 30, &read));
+    TEST_ASSERT_EQUAL(30, read);
+    TEST_ASSERT_EQUAL(1, reads);
+    TEST_ERROR(SDLOG_EOF, sdlog_istream_buffered_peek(&stream, 16, &ptr, &available));
+    TEST_ASSERT_EQUAL(10, available);
+    TEST_ASSERT_EQUAL_STRING_LEN("ABCDEFGHIJ", ptr, 10);
+    sdlog_istream_destroy(&stream);
+    sdlog_istream_destroy(&counted);
+    sdlog_istream_destroy(&source);
+}
+
+void test_istream_seek(void)
+{
+    unsigned char buf[] = "1234567890abcdefghij";
+    sdlog_istream_t source, stream;
+    uint8_t inbuf[20];
+    uint64_t offset;
+    size_t read;
+#if HAVE_UNISTD_H || HAVE_FMEMOPEN
+    FILE* fp;
+#endif
+#if HAVE_UNISTD_H
+    char path[] = "/tmp/sdlog-test-XXXXXX";
+    int fd, fds[2];
+#endif
+
+    /* Buffers */
+    TEST_CHECK(sdlog_istream_init_buffer(&source, buf, 20));
+    TEST_CHECK(sdlog_istream_seek(&source, 10));
+    TEST_CHECK(sdlog_istream_tell(&source, &offset));
+    TEST_ASSERT_EQUAL(10, offset);
+    TEST_CHECK(sdlog_istream_read_exactly(&source, inbuf, 3));
+    TEST_ASSERT_EQUAL_STRING_LEN("abc", inbuf, 3);
+    TEST_ERROR(SDLOG_EINVAL, sdlog_istream_seek(&source, 21));
+    TEST_CHECK(sdlog_istream_read_at(&source, 2, inbuf, 4, &read));
+    TEST_ASSERT_EQUAL(4, read);
+    TEST_ASSERT_EQUAL_STRING_LEN("3456", inbuf, 4);
+    TEST_CHECK(sdlog_istream_read_at(&source, 18, inbuf, 4, &read));
+    TEST_ASSERT_EQUAL(2, read);
+    TEST_ASSERT_EQUAL_STRING_LEN("ij", inbuf, 2);
+    TEST_ERROR(SDLOG_EOF, sdlog_istream_read_at(&source, 20, inbuf, 4, &read));
+    TEST_ASSERT_EQUAL(0, read);
+
+    /* Positional reads leave the read position alone */
+    TEST_CHECK(sdlog_istream_tell(&source, &offset));
+    TEST_ASSERT_EQUAL(13, offset);
+
+    /* Buffered streams report the position of the reader, not the source */
+    TEST_CHECK(sdlog_istream_seek(&source, 0));
+    TEST_CHECK(sdlog_istream_init_buffered(&stream, &source, 8));
+    TEST_CHECK(sdlog_istream_buffered_read_exactly(&stream, inbuf, 3));
+    TEST_CHECK(sdlog_istream_tell(&stream, &offset));
+    TEST_ASSERT_EQUAL(3, offset);
+    TEST_CHECK(sdlog_istream_seek(&stream, 15));
+    TEST_CHECK(sdlog_istream_buffered_read_exactly(&stream, inbuf, 5));
+    TEST_ASSERT_EQUAL_STRING_LEN("fghij", inbuf, 5);
+    TEST_CHECK(sdlog_istream_read_at(&stream, 0, inbuf, 2, &read));
+    TEST_ASSERT_EQUAL_STRING_LEN("12", inbuf, 2);
+    sdlog_istream_destroy(&stream);
+    sdlog_istream_destroy(&source);
+
+#if HAVE_UNISTD_H
+    fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL(20, write(fd, buf, 20));
+
+    /* File descriptors */
+    TEST_CHECK(sdlog_istream_init_fd(&stream, fd));
+    TEST_CHECK(sdlog_istream_tell(&stream, &offset));
+    TEST_ASSERT_EQUAL(20, offset);
+    TEST_CHECK(sdlog_istream_read_at(&stream, 8, inbuf, 20, &read));
+    TEST_ASSERT_EQUAL(12, read);
+    TEST_ASSERT_EQUAL_STRING_LEN("90abcdefghij", inbuf, 12);
+    TEST_ERROR(SDLOG_EOF, sdlog_istream_read_at(&stream, 20, inbuf, 1, &read));
+    TEST_CHECK(sdlog_istream_seek(&stream, 5));
+    TEST_CHECK(sdlog_istream_read_exactly(&stream, inbuf, 3));
+    TEST_ASSERT_EQUAL_STRING_LEN("678", inbuf, 3);
+    sdlog_istream_destroy(&stream);
+
+    /* Files */
+    fp = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(fp);
+    TEST_CHECK(sdlog_istream_init_file(&stream, fp));
+    TEST_CHECK(sdlog_istream_read_exactly(&stream, inbuf, 2));
+    TEST_CHECK(sdlog_istream_read_at(&stream, 10, inbuf, 3, &read));
+    TEST_ASSERT_EQUAL(3, read);
+    TEST_ASSERT_EQUAL_STRING_LEN("abc", inbuf, 3);
+    TEST_CHECK(sdlog_istream_tell(&stream, &offset));
+    TEST_ASSERT_EQUAL(2, offset);
+    TEST_CHECK(sdlog_istream_seek(&stream, 17));
+    TEST_CHECK(sdlog_istream_read_exactly(&stream, inbuf, 3));
+    TEST_ASSERT_EQUAL_STRING_LEN("hij", inbuf, 3);
+    sdlog_istream_destroy(&stream);
+    fclose(fp);
+
+    close(fd);
+    unlink(path);
+
+    /* Pipes cannot seek */
+    TEST_ASSERT_EQUAL(0, pipe(fds));
+    TEST_CHECK(sdlog_istream_init_fd(&stream, fds[0]));
+    TEST_ERROR(SDLOG_UNIMPLEMENTED, sdlog_istream_seek(&stream, 0));
+    TEST_ERROR(SDLOG_UNIMPLEMENTED, sdlog_istream_tell(&stream, &offset));
+    TEST_ERROR(SDLOG_UNIMPLEMENTED, sdlog_istream_read_at(&stream, 0, inbuf, 1, &read));
+    sdlog_istream_destroy(&stream);
+    close(fds[0]);
+    close(fds[1]);
+#endif
+
+#if HAVE_FMEMOPEN
+    /* Memory-backed files have no file descriptor for positional reads */
+    fp = fmemopen(buf, 20, "rb");
+    TEST_ASSERT_NOT_NULL(fp);
+    TEST_CHECK(sdlog_istream_init_file(&stream, fp));
+    TEST_CHECK(sdlog_istream_seek(&stream, 4));
+    TEST_CHECK(sdlog_istream_read_exactly(&stream, inbuf, 2));
+    TEST_ASSERT_EQUAL_STRING_LEN("56", inbuf, 2);
+    TEST_ERROR(SDLOG_UNIMPLEMENTED, sdlog_istream_read_at(&stream, 0, inbuf, 1, &read));
+    sdlog_istream_destroy(&stream);
+    fclose(fp);
+#endif
+}
+
 void test_ostream_file(void)
 {
 #if HAVE_FMEMOPEN
@@ -152,6 +362,65 @@ void test_ostream_null(void)
     sdlog_ostream_destroy(&stream);
 }
 
+void test_ostream_counting(void)
+{
+    unsigned char template[] = "12345678901234567890";
+    sdlog_counting_ostream_options_t options;
+    sdlog_counting_ostream_stats_t stats;
+    sdlog_iovec_t iov[2];
+    sdlog_ostream_t stream;
+    uint8_t* ptr;
+    int i;
+
+    TEST_CHECK(sdlog_ostream_init_counting(&stream, NULL));
+    TEST_CHECK(sdlog_ostream_begin_session(&stream));
+    TEST_CHECK(sdlog_ostream_write_all(&stream, template, 20));
+    iov[0].data = template;
+    iov[0].length = 7;
+    iov[1].data = template + 7;
+    iov[1].length = 13;
+    TEST_CHECK(sdlog_ostream_writev_all(&stream, iov, 2));
+    TEST_CHECK(sdlog_ostream_reserve(&stream, 100, &ptr));
+    memset(ptr, 0, 100);
+    TEST_CHECK(sdlog_ostream_commit(&stream, 50));
+    TEST_CHECK(sdlog_ostream_flush(&stream));
+    TEST_CHECK(sdlog_ostream_end_session(&stream));
+
+    sdlog_ostream_counting_get_stats(&stream, &stats);
+    TEST_ASSERT_EQUAL(90, stats.bytes);
+    TEST_ASSERT_EQUAL(3, stats.writes);
+    TEST_ASSERT_EQUAL(1, stats.flushes);
+    TEST_ASSERT_EQUAL(1, stats.sessions);
+    TEST_ASSERT_EQUAL(0, stats.delay_us);
+
+    sdlog_ostream_counting_reset_stats(&stream);
+    sdlog_ostream_counting_get_stats(&stream, &stats);
+    TEST_ASSERT_EQUAL(0, stats.bytes);
+    TEST_ASSERT_EQUAL(0, stats.writes);
+    sdlog_ostream_destroy(&stream);
+
+#if HAVE_UNISTD_H
+    /* Each 4 KB write takes 1 ms latency plus 4 ms at 1 MB/s. The writer
+     * may oversleep, which shortens the next delay, so only the first delay
+     * is exact. */
+    memset(&options, 0, sizeof(options));
+    options.latency_us = 1000;
+    options.bandwidth = 1000000;
+    TEST_CHECK(sdlog_ostream_init_counting(&stream, &options));
+    for (i = 0; i < 5; i++) {
+        TEST_CHECK(sdlog_ostream_reserve(&stream, 4000, &ptr));
+        TEST_CHECK(sdlog_ostream_commit(&stream, 4000));
+    }
+    sdlog_ostream_counting_get_stats(&stream, &stats);
+    TEST_ASSERT_EQUAL(20000, stats.bytes);
+    TEST_ASSERT_TRUE(stats.delay_us >= 5000);
+    sdlog_ostream_destroy(&stream);
+#else
+    (void)options;
+    (void)i;
+#endif
+}
+
 void test_ostream_buffer(void)
 {
     unsigned char template[] = "12345678901234567890";
@@ -177,7 +446,2262 @@ void test_ostream_buffer(void)
         "123456789012345678901234567890123456789012345678901234567890",
         buf, length);
 
+    /* Reserved capacity is used without moving the buffer */
+    TEST_CHECK(sdlog_ostream_buffer_ensure_capacity(&stream, 1000));
+    TEST_CHECK(sdlog_ostream_buffer_ensure_capacity(&stream, 100));
+    buf = sdlog_ostream_buffer_get(&stream, NULL);
+    for (length = 60; length < 1000; length += 20) {
+        TEST_CHECK(sdlog_ostream_write_all(&stream, template, 20));
+    }
+    TEST_ASSERT_EQUAL_PTR(buf, sdlog_ostream_buffer_get(&stream, &length));
+    TEST_ASSERT_EQUAL(1000, length);
+
+    /* Growing the buffer beyond the address space fails cleanly */
+    TEST_ERROR(SDLOG_ELIMIT, sdlog_ostream_write(&stream, template, SIZE_MAX - 500, &length));
+    sdlog_ostream_buffer_get(&stream, &length);
+    TEST_ASSERT_EQUAL(1000, length);
+
+    sdlog_ostream_destroy(&stream);
+}
+
+void test_ostream_reserve(void)
+{
+    sdlog_ostream_t stream;
+    const uint8_t* buf;
+    uint8_t* ptr;
+    size_t length;
+    int i;
+
+    TEST_CHECK(sdlog_ostream_init_null(&stream));
+    TEST_ASSERT_EQUAL(SDLOG_UNIMPLEMENTED, sdlog_ostream_reserve(&stream, 16, &ptr));
+    sdlog_ostream_destroy(&stream);
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&stream));
+    TEST_ASSERT_EQUAL(SDLOG_EINVAL, sdlog_ostream_reserve(&stream, 0, &ptr));
+
+    /* Reservations larger than the current allocation grow the buffer */
+    for (i = 0; i < 10; i++) {
+        TEST_CHECK(sdlog_ostream_reserve(&stream, 40, &ptr));
+        memcpy(ptr, "1234567890", 10);
+        TEST_CHECK(sdlog_ostream_commit(&stream, 10));
+    }
+
+    /* Zero-length commits cancel the reservation */
+    TEST_CHECK(sdlog_ostream_reserve(&stream, 40, &ptr));
+    memcpy(ptr, "ABCDEFGHIJ", 10);
+    TEST_CHECK(sdlog_ostream_commit(&stream, 0));
+
+    buf = sdlog_ostream_buffer_get(&stream, &length);
+    TEST_ASSERT_EQUAL(100, length);
+    for (i = 0; i < 100; i += 10) {
+        TEST_ASSERT_EQUAL_STRING_LEN("1234567890", buf + i, 10);
+    }
+
+    sdlog_ostream_destroy(&stream);
+}
+
+void test_ostream_mmap(void)
+{
+#if HAVE_UNISTD_H && HAVE_SYS_MMAN_H
+    unsigned char template[] = "12345678901234567890";
+    unsigned char inbuf[16384];
+    char path[] = "/tmp/sdlog-test-XXXXXX";
+    sdlog_ostream_t stream;
+    struct stat st;
+    uint8_t* ptr;
+    int fd, i;
+
+    fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+
+    /* Small windows so that the stream has to remap several times */
+    TEST_CHECK(sdlog_ostream_init_mmap(&stream, path, 4096));
+
+    TEST_CHECK(sdlog_ostream_begin_session(&stream));
+    for (i = 0; i < 300; i++) {
+        TEST_CHECK(sdlog_ostream_write_all(&stream, template, 20));
+    }
+
+    /* Mapped writes are visible to readers even before flushing */
+    TEST_CHECK(sdlog_ostream_flush(&stream));
+    TEST_ASSERT_EQUAL(0, fstat(fd, &st));
+    TEST_ASSERT_TRUE(st.st_size >= 6000);
+    TEST_ASSERT_EQUAL(20, pread(fd, inbuf, 20, 5980));
+    TEST_ASSERT_EQUAL_STRING_LEN(template, inbuf, 20);
+
+    for (i = 0; i < 300; i++) {
+        TEST_CHECK(sdlog_ostream_reserve(&stream, 20, &ptr));
+        memcpy(ptr, template, 20);
+        TEST_CHECK(sdlog_ostream_commit(&stream, 20));
+    }
+
+    /* Writes larger than the window get a larger window */
+    TEST_CHECK(sdlog_ostream_reserve(&stream, 6000, &ptr));
+    for (i = 0; i < 300; i++) {
+        memcpy(ptr + i * 20, template, 20);
+    }
+    TEST_CHECK(sdlog_ostream_commit(&stream, 6000));
+    TEST_CHECK(sdlog_ostream_end_session(&stream));
+
+    TEST_ASSERT_EQUAL(0, fstat(fd, &st));
+    TEST_ASSERT_EQUAL(18000, st.st_size);
+    TEST_ASSERT_EQUAL(16384, pread(fd, inbuf, sizeof(inbuf), 0));
+    for (i = 0; i < 16380; i += 20) {
+        TEST_ASSERT_EQUAL_STRING_LEN(template, inbuf + i, 20);
+    }
+
+    /* A new session continues where the last one ended */
+    TEST_CHECK(sdlog_ostream_begin_session(&stream));
+    TEST_CHECK(sdlog_ostream_write_all(&stream, template, 20));
+    sdlog_ostream_destroy(&stream);
+
+    TEST_ASSERT_EQUAL(0, fstat(fd, &st));
+    TEST_ASSERT_EQUAL(18020, st.st_size);
+
+    close(fd);
+    unlink(path);
+#else
+    TEST_IGNORE();
+#endif
+}
+
+/* Checks that the given log consists of FMT records followed by consecutive
+ * records with a single 64-bit column, ending with the given value. Returns
+ * the number of records after the FMT records. */
+static int check_ring_dump(const uint8_t* buf, size_t length, uint64_t last)
+{
+    size_t i = 0;
+    int num_fmt = 0, num_records = 0;
+    uint64_t value, expected = 0;
+    int j;
+
+    while (i < length && buf[i + 2] == SDLOG_ID_FMT) {
+        TEST_ASSERT_EQUAL_HEX8(0xA3, buf[i]);
+        TEST_ASSERT_EQUAL_HEX8(0x95, buf[i + 1]);
+        i += 89;
+        num_fmt++;
+    }
+    TEST_ASSERT_EQUAL(1, num_fmt);
+
+    TEST_ASSERT_EQUAL(0, (length - i) % 11);
+    for (; i < length; i += 11) {
+        TEST_ASSERT_EQUAL_HEX8(0xA3, buf[i]);
+        TEST_ASSERT_EQUAL_HEX8(0x95, buf[i + 1]);
+        TEST_ASSERT_EQUAL(42, buf[i + 2]);
+        for (value = 0, j = 7; j >= 0; j--) {
+            value = (value << 8) | buf[i + 3 + j];
+        }
+        if (num_records > 0) {
+            TEST_ASSERT_EQUAL(expected, value);
+        }
+        expected = value + 1;
+        num_records++;
+    }
+
+    TEST_ASSERT_EQUAL(last + 1, expected);
+
+    return num_records;
+}
+
+void test_ostream_ring(void)
+{
+    sdlog_ostream_t stream, dump;
+    sdlog_message_format_t format;
+    sdlog_writer_t writer;
+    const uint8_t* buf;
+    uint8_t record[SDLOG_MAX_MESSAGE_LENGTH];
+    size_t length;
+    uint64_t i;
+    int num_records;
+
+    TEST_ASSERT_EQUAL(SDLOG_EINVAL, sdlog_ostream_init_ring(&stream, 16));
+
+    TEST_CHECK(sdlog_message_format_init(&format, 42, "SEQ"));
+    TEST_CHECK(sdlog_message_format_add_columns(&format, "Value", "Q", "-"));
+
+    TEST_CHECK(sdlog_ostream_init_ring(&stream, 1000));
+    TEST_CHECK(sdlog_writer_init(&writer, &stream));
+
+    /* Write much more than what fits in the ring; the FMT record of the
+     * format is overwritten early */
+    for (i = 0; i < 200; i++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &format, i));
+    }
+    TEST_CHECK(sdlog_writer_flush(&writer));
+
+    /* Junk is skipped and records split across writes are reassembled */
+    TEST_CHECK(sdlog_message_format_encode(&format, record, &length, (uint64_t)200));
+    TEST_CHECK(sdlog_ostream_write_all(&stream, (const uint8_t*)"\xA3\x00\xA3\x95\x07", 5));
+    for (i = 0; i < length; i++) {
+        TEST_CHECK(sdlog_ostream_write_all(&stream, record + i, 1));
+    }
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    TEST_CHECK(sdlog_ostream_ring_dump(&stream, &dump, 0));
+    buf = sdlog_ostream_buffer_get(&dump, &length);
+    num_records = check_ring_dump(buf, length, 200);
+    TEST_ASSERT_EQUAL(1000 / 20, num_records);
+    sdlog_ostream_destroy(&dump);
+
+#if HAVE_UNISTD_H
+    /* Only the recent records are dumped when an age limit is given */
+    usleep(300000);
+    for (i = 201; i < 211; i++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &format, i));
+    }
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    TEST_CHECK(sdlog_ostream_ring_dump(&stream, &dump, 150000));
+    buf = sdlog_ostream_buffer_get(&dump, &length);
+    num_records = check_ring_dump(buf, length, 210);
+    TEST_ASSERT_EQUAL(10, num_records);
+    sdlog_ostream_destroy(&dump);
+#endif
+
+    TEST_ASSERT_EQUAL(0, sdlog_ostream_ring_get_records_dropped(&stream));
+
+    sdlog_writer_destroy(&writer);
+    sdlog_message_format_destroy(&format);
+    sdlog_ostream_destroy(&stream);
+}
+
+void test_ostream_ring_reserve(void)
+{
+    sdlog_ostream_t stream, dump;
+    sdlog_message_format_t format;
+    sdlog_writer_t writer;
+    const uint8_t* buf;
+    uint8_t* ptr;
+    size_t length;
+    uint64_t i;
+    int num_records;
+
+    TEST_CHECK(sdlog_message_format_init(&format, 42, "SEQ"));
+    TEST_CHECK(sdlog_message_format_add_columns(&format, "Value", "Q", "-"));
+
+    /* The writer encodes records straight into the ring. The capacity is not
+     * a multiple of the entry size, so some records are written at the end of
+     * the storage area where they do not fit without wrapping around. */
+    TEST_CHECK(sdlog_ostream_init_ring(&stream, 1013));
+    TEST_CHECK(sdlog_writer_init(&writer, &stream));
+    for (i = 0; i < 500; i++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &format, i));
+    }
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    TEST_CHECK(sdlog_ostream_ring_dump(&stream, &dump, 0));
+    buf = sdlog_ostream_buffer_get(&dump, &length);
+    num_records = check_ring_dump(buf, length, 499);
+    TEST_ASSERT_EQUAL(1013 / 20, num_records);
+    sdlog_ostream_destroy(&dump);
+
+    /* Committing nothing leaves the ring intact */
+    TEST_CHECK(sdlog_ostream_reserve(&stream, 11, &ptr));
+    memset(ptr, 0xff, 11);
+    TEST_CHECK(sdlog_ostream_commit(&stream, 0));
+    TEST_CHECK(sdlog_writer_write(&writer, &format, (uint64_t)500));
+
+    /* Nothing can be reserved while a record is incomplete */
+    TEST_CHECK(sdlog_ostream_write_all(&stream, (const uint8_t*)"\xA3\x95\x2a", 3));
+    TEST_ERROR(SDLOG_ELIMIT, sdlog_ostream_reserve(&stream, 11, &ptr));
+    TEST_CHECK(sdlog_ostream_write_all(&stream, (const uint8_t*)"\xf5\x01\0\0\0\0\0\0", 8));
+    TEST_ERROR(SDLOG_ELIMIT, sdlog_ostream_reserve(&stream, 2000, &ptr));
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    TEST_CHECK(sdlog_ostream_ring_dump(&stream, &dump, 0));
+    buf = sdlog_ostream_buffer_get(&dump, &length);
+    check_ring_dump(buf, length, 501);
+    sdlog_ostream_destroy(&dump);
+
+    TEST_ASSERT_EQUAL(0, sdlog_ostream_ring_get_records_dropped(&stream));
+
+    sdlog_writer_destroy(&writer);
+    sdlog_message_format_destroy(&format);
+    sdlog_ostream_destroy(&stream);
+}
+
+/* Reads an entire input stream into a buffer stream */
+static void read_all(sdlog_istream_t* stream, sdlog_ostream_t* dump)
+{
+    uint8_t buf[100];
+    size_t length;
+    sdlog_error_t retval;
+
+    do {
+        retval = sdlog_istream_read(stream, buf, sizeof(buf), &length);
+        TEST_CHECK(sdlog_ostream_write_all(dump, buf, length));
+    } while (retval == SDLOG_SUCCESS);
+
+    TEST_ASSERT_EQUAL(SDLOG_EOF, retval);
+}
+
+/* Checks that the given log consists of records with a single 64-bit
+ * column holding consecutive values that end with the given value, with FMT
+ * records interspersed. Returns the number of records with values. */
+static int check_consecutive_records(const uint8_t* buf, size_t length, uint64_t last)
+{
+    size_t i = 0;
+    int num_records = 0;
+    uint64_t value, expected = 0;
+    int j;
+
+    while (i < length) {
+        TEST_ASSERT_EQUAL_HEX8(0xA3, buf[i]);
+        TEST_ASSERT_EQUAL_HEX8(0x95, buf[i + 1]);
+        if (buf[i + 2] == SDLOG_ID_FMT) {
+            TEST_ASSERT_EQUAL(42, buf[i + 3]);
+            i += 89;
+            continue;
+        }
+
+        TEST_ASSERT_EQUAL(42, buf[i + 2]);
+        for (value = 0, j = 7; j >= 0; j--) {
+            value = (value << 8) | buf[i + 3 + j];
+        }
+        if (num_records > 0) {
+            TEST_ASSERT_EQUAL(expected, value);
+        }
+        expected = value + 1;
+        num_records++;
+        i += 11;
+    }
+
+    TEST_ASSERT_EQUAL(length, i);
+    TEST_ASSERT_EQUAL(last + 1, expected);
+
+    return num_records;
+}
+
+void test_ostream_chunked(void)
+{
+    uint8_t data[1000];
+    sdlog_ostream_t stream, target;
+    sdlog_iovec_t iov[8];
+    sdlog_message_format_t format;
+    sdlog_writer_t writer;
+    const uint8_t *buf, *first_chunk;
+    uint8_t* ptr;
+    size_t i, length, offset;
+
+    for (i = 0; i < sizeof(data); i++) {
+        data[i] = i & 0xff;
+    }
+
+    TEST_CHECK(sdlog_ostream_init_chunked(&stream, 256));
+    TEST_ASSERT_EQUAL(0, sdlog_ostream_chunked_get_size(&stream));
+    TEST_ASSERT_EQUAL(0, sdlog_ostream_chunked_get_iovec(&stream, NULL, 0));
+
+    /* Writes are split across chunks; earlier chunks never move */
+    TEST_CHECK(sdlog_ostream_write_all(&stream, data, 100));
+    TEST_ASSERT_EQUAL(1, sdlog_ostream_chunked_get_iovec(&stream, iov, 8));
+    first_chunk = iov[0].data;
+    TEST_CHECK(sdlog_ostream_write_all(&stream, data + 100, 900));
+    TEST_ASSERT_EQUAL(1000, sdlog_ostream_chunked_get_size(&stream));
+    TEST_ASSERT_EQUAL(4, sdlog_ostream_chunked_get_iovec(&stream, iov, 2));
+    TEST_ASSERT_EQUAL_PTR(first_chunk, iov[0].data);
+    TEST_ASSERT_EQUAL(256, iov[0].length);
+    TEST_ASSERT_EQUAL(256, iov[1].length);
+
+    /* Reserved regions do not span chunks and must fit in one */
+    TEST_ASSERT_EQUAL(SDLOG_ELIMIT, sdlog_ostream_reserve(&stream, 257, &ptr));
+    TEST_CHECK(sdlog_ostream_reserve(&stream, 100, &ptr));
+    memcpy(ptr, data, 50);
+    TEST_CHECK(sdlog_ostream_commit(&stream, 50));
+    TEST_ASSERT_EQUAL(1050, sdlog_ostream_chunked_get_size(&stream));
+
+    TEST_ASSERT_EQUAL(5, sdlog_ostream_chunked_get_iovec(&stream, iov, 8));
+    TEST_ASSERT_EQUAL(1000 - 3 * 256, iov[3].length);
+    TEST_ASSERT_EQUAL(50, iov[4].length);
+    for (i = 0, offset = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_MEMORY(data + offset, iov[i].data, iov[i].length);
+        offset += iov[i].length;
+    }
+    TEST_ASSERT_EQUAL_MEMORY(data, iov[4].data, 50);
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&target));
+    TEST_CHECK(sdlog_ostream_chunked_write_to(&stream, &target));
+    buf = sdlog_ostream_buffer_get(&target, &length);
+    TEST_ASSERT_EQUAL(1050, length);
+    TEST_ASSERT_EQUAL_MEMORY(data, buf, 1000);
+    TEST_ASSERT_EQUAL_MEMORY(data, buf + 1000, 50);
+    sdlog_ostream_destroy(&target);
+    sdlog_ostream_destroy(&stream);
+
+    /* Writers encode records directly into the chunks */
+    TEST_CHECK(sdlog_message_format_init(&format, 42, "SEQ"));
+    TEST_CHECK(sdlog_message_format_add_columns(&format, "Value", "Q", "-"));
+    TEST_CHECK(sdlog_ostream_init_chunked(&stream, 0));
+    TEST_CHECK(sdlog_writer_init(&writer, &stream));
+    for (i = 0; i < 10000; i++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &format, (uint64_t)i));
+    }
+    sdlog_writer_destroy(&writer);
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&target));
+    TEST_CHECK(sdlog_ostream_chunked_write_to(&stream, &target));
+    buf = sdlog_ostream_buffer_get(&target, &length);
+    TEST_ASSERT_EQUAL(sdlog_ostream_chunked_get_size(&stream), length);
+    check_consecutive_records(buf, length, 9999);
+    sdlog_ostream_destroy(&target);
+    sdlog_ostream_destroy(&stream);
+    sdlog_message_format_destroy(&format);
+}
+
+void test_circular_file(void)
+{
+#if HAVE_UNISTD_H
+    char path[] = "/tmp/sdlog-test-XXXXXX";
+    sdlog_ostream_t stream, dump;
+    sdlog_istream_t input;
+    sdlog_message_format_t format;
+    sdlog_writer_t writer;
+    const uint8_t* buf;
+    sdlog_message_format_t other_format, third_format;
+    struct stat st;
+    size_t length;
+    uint64_t i, expected = 0;
+    int fd, num_records, num_fmts = 0;
+
+    fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+
+    TEST_ASSERT_EQUAL(SDLOG_EINVAL, sdlog_ostream_init_circular_file(&stream, path, 1024, 512));
+    TEST_ASSERT_EQUAL(SDLOG_EINVAL, sdlog_ostream_init_circular_file(&stream, path, 65536, 256));
+
+    /* Garbage in the file is not mistaken for valid blocks */
+    TEST_ASSERT_EQUAL(SDLOG_EREAD, sdlog_istream_init_circular_file(&input, path));
+
+    TEST_CHECK(sdlog_message_format_init(&format, 42, "SEQ"));
+    TEST_CHECK(sdlog_message_format_add_columns(&format, "Value", "Q", "-"));
+
+    /* Three data blocks of 512 bytes each, wrapped around multiple times */
+    TEST_CHECK(sdlog_ostream_init_circular_file(&stream, path, 2048, 512));
+    TEST_CHECK(sdlog_writer_init(&writer, &stream));
+    for (i = 0; i < 200; i++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &format, i));
+    }
+    sdlog_writer_destroy(&writer);
+    sdlog_ostream_destroy(&stream);
+
+    TEST_ASSERT_EQUAL(0, stat(path, &st));
+    TEST_ASSERT_EQUAL(2048, st.st_size);
+
+    TEST_CHECK(sdlog_istream_init_circular_file(&input, path));
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    read_all(&input, &dump);
+    buf = sdlog_ostream_buffer_get(&dump, &length);
+    num_records = check_consecutive_records(buf, length, 199);
+    TEST_ASSERT_TRUE(num_records > 60);
+    TEST_ASSERT_TRUE(num_records < 3 * 512 / 11);
+    sdlog_ostream_destroy(&dump);
+    sdlog_istream_destroy(&input);
+
+    /* Reopening continues after the newest block */
+    TEST_CHECK(sdlog_ostream_init_circular_file(&stream, path, 2048, 512));
+    TEST_CHECK(sdlog_writer_init(&writer, &stream));
+    for (i = 200; i < 210; i++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &format, i));
+    }
+    sdlog_writer_destroy(&writer);
+    sdlog_ostream_destroy(&stream);
+
+    TEST_CHECK(sdlog_istream_init_circular_file(&input, path));
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    read_all(&input, &dump);
+    buf = sdlog_ostream_buffer_get(&dump, &length);
+    check_consecutive_records(buf, length, 209);
+    sdlog_ostream_destroy(&dump);
+    sdlog_istream_destroy(&input);
+
+    TEST_ASSERT_EQUAL(0, stat(path, &st));
+    TEST_ASSERT_EQUAL(2048, st.st_size);
+
+    /* A 512-byte block holds the FMT records of two formats only; the third
+     * format is rejected without affecting the blocks written so far */
+    TEST_CHECK(sdlog_message_format_init(&other_format, 43, "OTH"));
+    TEST_CHECK(sdlog_message_format_add_columns(&other_format, "Value", "Q", "-"));
+    TEST_CHECK(sdlog_message_format_init(&third_format, 44, "THR"));
+    TEST_CHECK(sdlog_message_format_add_columns(&third_format, "Value", "Q", "-"));
+
+    unlink(path);
+    TEST_CHECK(sdlog_ostream_init_circular_file(&stream, path, 2048, 512));
+    TEST_CHECK(sdlog_writer_init(&writer, &stream));
+    TEST_CHECK(sdlog_writer_write(&writer, &other_format, (uint64_t)0));
+    for (i = 0; i < 100; i++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &format, i));
+        TEST_ASSERT_EQUAL(SDLOG_ELIMIT, sdlog_writer_write(&writer, &third_format, i));
+    }
+    sdlog_writer_destroy(&writer);
+    sdlog_ostream_destroy(&stream);
+
+    TEST_CHECK(sdlog_istream_init_circular_file(&input, path));
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    read_all(&input, &dump);
+    buf = sdlog_ostream_buffer_get(&dump, &length);
+    num_records = 0;
+
+    /* All three blocks start with both FMT records and the records of the
+     * first format follow each other without gaps up to the last one */
+    for (i = 0; i < length; i += buf[i + 2] == SDLOG_ID_FMT ? 89 : 11) {
+        if (buf[i + 2] == SDLOG_ID_FMT) {
+            TEST_ASSERT_TRUE(buf[i + 3] == 42 || buf[i + 3] == 43);
+            num_fmts++;
+        } else {
+            TEST_ASSERT_EQUAL(42, buf[i + 2]);
+            if (num_records > 0) {
+                TEST_ASSERT_EQUAL(expected, buf[i + 3]);
+            }
+            expected = buf[i + 3] + 1;
+            num_records++;
+        }
+    }
+    TEST_ASSERT_EQUAL(length, i);
+    TEST_ASSERT_EQUAL(6, num_fmts);
+    TEST_ASSERT_EQUAL(100, expected);
+    sdlog_ostream_destroy(&dump);
+    sdlog_istream_destroy(&input);
+
+    sdlog_message_format_destroy(&third_format);
+    sdlog_message_format_destroy(&other_format);
+    sdlog_message_format_destroy(&format);
+    unlink(path);
+#else
+    TEST_IGNORE();
+#endif
+}
+
+void test_ostream_rotating(void)
+{
+#if HAVE_UNISTD_H
+    char dir[] = "/tmp/sdlog-test-XXXXXX";
+    char path_template[64], path[64];
+    sdlog_rotating_ostream_options_t options = { 0 };
+    sdlog_ostream_t stream, dump;
+    sdlog_istream_t input;
+    sdlog_message_format_t format;
+    sdlog_writer_t writer;
+    const uint8_t* buf;
+    size_t length, all_length = 0;
+    uint32_t i, num_segments;
+    uint64_t j;
+    FILE* fp;
+
+    TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+    snprintf(path_template, sizeof(path_template), "%s/seg-%%03u.log", dir);
+
+    TEST_ASSERT_EQUAL(SDLOG_EINVAL, sdlog_ostream_init_rotating(&stream, "/tmp/seg.log", NULL));
+    TEST_ASSERT_EQUAL(SDLOG_EINVAL, sdlog_ostream_init_rotating(&stream, "/tmp/seg-%s.log", NULL));
+    TEST_ASSERT_EQUAL(SDLOG_EINVAL, sdlog_ostream_init_rotating(&stream, "/tmp/seg-%u-%u.log", NULL));
+    TEST_ASSERT_EQUAL(SDLOG_EIO, sdlog_ostream_init_rotating(&stream, "/nonexistent/seg-%u.log", NULL));
+
+    TEST_CHECK(sdlog_message_format_init(&format, 42, "SEQ"));
+    TEST_CHECK(sdlog_message_format_add_columns(&format, "Value", "Q", "-"));
+
+    options.max_size = 1000;
+    TEST_CHECK(sdlog_ostream_init_rotating(&stream, path_template, &options));
+    TEST_CHECK(sdlog_writer_init(&writer, &stream));
+    for (j = 0; j < 500; j++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &format, j));
+    }
+    TEST_CHECK(sdlog_writer_flush(&writer));
+    num_segments = sdlog_ostream_rotating_get_segment_index(&stream) + 1;
+    TEST_ASSERT_TRUE(num_segments > 5);
+    sdlog_writer_destroy(&writer);
+    sdlog_ostream_destroy(&stream);
+
+    /* Each segment holds complete records only, starts with the FMT record
+     * and respects the size limit; together they hold the entire log */
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    for (i = 0; i < num_segments; i++) {
+        snprintf(path, sizeof(path), path_template, i);
+        fp = fopen(path, "rb");
+        TEST_ASSERT_NOT_NULL(fp);
+        TEST_CHECK(sdlog_istream_init_file(&input, fp));
+        read_all(&input, &dump);
+        sdlog_istream_destroy(&input);
+        fclose(fp);
+
+        buf = sdlog_ostream_buffer_get(&dump, &length);
+        TEST_ASSERT_TRUE(length - all_length <= 1000);
+        TEST_ASSERT_EQUAL_HEX8(SDLOG_ID_FMT, buf[all_length + 2]);
+        all_length = length;
+    }
+    check_consecutive_records(buf, length, 499);
+    sdlog_ostream_destroy(&dump);
+
+    /* The segment opened ahead of time is removed */
+    snprintf(path, sizeof(path), path_template, num_segments);
+    TEST_ASSERT_EQUAL(-1, access(path, F_OK));
+
+    for (i = 0; i < num_segments; i++) {
+        snprintf(path, sizeof(path), path_template, i);
+        unlink(path);
+    }
+
+    /* The time limit starts a new segment too */
+    options.max_size = 0;
+    options.max_duration_us = 50000;
+    TEST_CHECK(sdlog_ostream_init_rotating(&stream, path_template, &options));
+    TEST_CHECK(sdlog_writer_init(&writer, &stream));
+    TEST_CHECK(sdlog_writer_write(&writer, &format, (uint64_t)0));
+    TEST_ASSERT_EQUAL(0, sdlog_ostream_rotating_get_segment_index(&stream));
+    usleep(60000);
+    TEST_CHECK(sdlog_writer_write(&writer, &format, (uint64_t)1));
+    TEST_ASSERT_EQUAL(1, sdlog_ostream_rotating_get_segment_index(&stream));
+    sdlog_writer_destroy(&writer);
     sdlog_ostream_destroy(&stream);
+
+    for (i = 0; i < 2; i++) {
+        snprintf(path, sizeof(path), path_template, i);
+        TEST_ASSERT_EQUAL(0, unlink(path));
+    }
+
+    sdlog_message_format_destroy(&format);
+    TEST_ASSERT_EQUAL(0, rmdir(dir));
+#else
+    TEST_IGNORE();
+#endif
+}
+
+typedef struct {
+    /** Contents of the segments */
+    const char* const* contents;
+
+    /** Number of segments that exist at the moment */
+    uint32_t available;
+
+    /** Number of times a segment was opened */
+    uint32_t calls;
+} segment_list_t;
+
+static sdlog_error_t open_listed_segment(void* arg, uint32_t index, sdlog_istream_t* segment)
+{
+    segment_list_t* list = (segment_list_t*)arg;
+
+    list->calls++;
+    if (index >= list->available) {
+        return SDLOG_EOF;
+    }
+
+    return sdlog_istream_init_buffer(
+        segment, (const uint8_t*)list->contents[index], strlen(list->contents[index]));
+}
+
+void test_concat(void)
+{
+    const char* const contents[] = { "abc", "", "defg", "hi" };
+    segment_list_t list = { contents, 1, 0 };
+    sdlog_istream_t stream;
+    uint8_t buf[16];
+    size_t read;
+
+#if HAVE_UNISTD_H
+    char dir[] = "/tmp/sdlog-test-XXXXXX";
+    char path_template[64], path[64];
+    sdlog_ostream_t dump;
+    const uint8_t* data;
+    size_t length;
+    uint32_t i;
+    FILE* fp;
+    int fd;
+#endif
+
+    /* Segments are opened one ahead; the segment after the first one does
+     * not exist yet when the first one is opened */
+    TEST_CHECK(sdlog_istream_init_concat(&stream, open_listed_segment, &list, 0));
+    TEST_ASSERT_EQUAL(2, list.calls);
+    TEST_ASSERT_EQUAL(0, sdlog_istream_concat_get_segment_index(&stream));
+    list.available = 3;
+
+    /* Reads do not cross segment boundaries, and empty segments are skipped */
+    TEST_CHECK(sdlog_istream_read(&stream, buf, sizeof(buf), &read));
+    TEST_ASSERT_EQUAL(3, read);
+    TEST_ASSERT_EQUAL_STRING_LEN("abc", buf, 3);
+    TEST_ASSERT_EQUAL(0, sdlog_istream_concat_get_segment_index(&stream));
+    TEST_CHECK(sdlog_istream_read(&stream, buf, 2, &read));
+    TEST_ASSERT_EQUAL(2, read);
+    TEST_ASSERT_EQUAL_STRING_LEN("de", buf, 2);
+    TEST_ASSERT_EQUAL(2, sdlog_istream_concat_get_segment_index(&stream));
+    TEST_CHECK(sdlog_istream_read(&stream, buf, sizeof(buf), &read));
+    TEST_ASSERT_EQUAL_STRING_LEN("fg", buf, 2);
+
+    /* The last segment ends the stream */
+    TEST_ERROR(SDLOG_EOF, sdlog_istream_read(&stream, buf, sizeof(buf), &read));
+    TEST_ASSERT_EQUAL(0, read);
+    TEST_ASSERT_EQUAL(3, sdlog_istream_concat_get_segment_index(&stream));
+    sdlog_istream_destroy(&stream);
+
+    /* Starting from a later segment */
+    list.available = 4;
+    TEST_CHECK(sdlog_istream_init_concat(&stream, open_listed_segment, &list, 2));
+    TEST_CHECK(sdlog_istream_read_exactly(&stream, buf, 6));
+    TEST_ASSERT_EQUAL_STRING_LEN("defghi", buf, 6);
+    TEST_ASSERT_EQUAL(3, sdlog_istream_concat_get_segment_index(&stream));
+    sdlog_istream_destroy(&stream);
+
+#if HAVE_UNISTD_H
+    TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+    snprintf(path_template, sizeof(path_template), "%s/part.%%02u", dir);
+
+    TEST_ERROR(SDLOG_EINVAL, sdlog_istream_init_concat_files(&stream, "/tmp/part", 0));
+
+    /* A missing first file is an empty stream */
+    TEST_CHECK(sdlog_istream_init_concat_files(&stream, path_template, 1));
+    TEST_ERROR(SDLOG_EOF, sdlog_istream_read(&stream, buf, sizeof(buf), &read));
+    sdlog_istream_destroy(&stream);
+
+    /* Files split from a single log are read as one stream */
+    for (i = 1; i <= 3; i++) {
+        snprintf(path, sizeof(path), path_template, i);
+        fp = fopen(path, "wb");
+        TEST_ASSERT_NOT_NULL(fp);
+        TEST_ASSERT_EQUAL(i, fwrite("1234567890", 1, i, fp));
+        fclose(fp);
+    }
+
+    TEST_CHECK(sdlog_istream_init_concat_files(&stream, path_template, 1));
+    TEST_ASSERT_EQUAL(SDLOG_UNIMPLEMENTED, sdlog_istream_get_fd(&stream, &fd));
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    read_all(&stream, &dump);
+    data = sdlog_ostream_buffer_get(&dump, &length);
+    TEST_ASSERT_EQUAL(6, length);
+    TEST_ASSERT_EQUAL_STRING_LEN("112123", data, 6);
+    TEST_ASSERT_EQUAL(4, sdlog_istream_concat_get_segment_index(&stream));
+    sdlog_ostream_destroy(&dump);
+    sdlog_istream_destroy(&stream);
+
+    for (i = 1; i <= 3; i++) {
+        snprintf(path, sizeof(path), path_template, i);
+        TEST_ASSERT_EQUAL(0, unlink(path));
+    }
+    TEST_ASSERT_EQUAL(0, rmdir(dir));
+#endif
+}
+
+void test_compressed(void)
+{
+    sdlog_compressed_ostream_options_t options = { 0 };
+    sdlog_ostream_t stream, container, plain, dump;
+    sdlog_istream_t input, source;
+    sdlog_message_format_t format;
+    sdlog_writer_t writer;
+    const uint8_t *buf, *expected, *index;
+    uint8_t random_data[5000], corrupted[256];
+    size_t length, expected_length, num_blocks;
+    uint64_t i;
+
+    options.block_size = (size_t)128 * 1024 * 1024;
+    TEST_ASSERT_EQUAL(SDLOG_EINVAL, sdlog_ostream_init_compressed(&stream, &container, &options));
+#if !HAVE_ZSTD
+    options.block_size = 0;
+    options.compression = SDLOG_COMPRESSION_ZSTD;
+    TEST_ASSERT_EQUAL(SDLOG_UNIMPLEMENTED, sdlog_ostream_init_compressed(&stream, &container, &options));
+#endif
+
+    TEST_CHECK(sdlog_message_format_init(&format, 42, "SEQ"));
+    TEST_CHECK(sdlog_message_format_add_columns(&format, "Value", "Q", "-"));
+
+    /* Write the same log compressed and uncompressed */
+    TEST_CHECK(sdlog_ostream_init_buffer(&plain));
+    TEST_CHECK(sdlog_writer_init(&writer, &plain));
+    for (i = 0; i < 2000; i++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &format, i));
+        if (i == 1000) {
+            TEST_CHECK(sdlog_writer_flush(&writer));
+        }
+    }
+    sdlog_writer_destroy(&writer);
+    expected = sdlog_ostream_buffer_get(&plain, &expected_length);
+
+    options.block_size = 1000;
+    options.compression = SDLOG_COMPRESSION_LZ;
+    TEST_CHECK(sdlog_ostream_init_buffer(&container));
+    TEST_CHECK(sdlog_ostream_init_compressed(&stream, &container, &options));
+    TEST_CHECK(sdlog_writer_init(&writer, &stream));
+    for (i = 0; i < 2000; i++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &format, i));
+        if (i == 1000) {
+            /* Flushing writes a partial block */
+            TEST_CHECK(sdlog_writer_flush(&writer));
+        }
+    }
+    sdlog_writer_destroy(&writer);
+    sdlog_ostream_destroy(&stream);
+
+    buf = sdlog_ostream_buffer_get(&container, &length);
+    TEST_ASSERT_TRUE(length < expected_length / 2);
+
+    /* The footer points at an index of all the blocks, and each block knows
+     * where its first record starts */
+    TEST_ASSERT_EQUAL_MEMORY("SDZE", buf + length - 4, 4);
+    index = buf + sdlog_load_u64_le(buf + length - 12);
+    TEST_ASSERT_EQUAL_MEMORY("SDZI", index, 4);
+    num_blocks = sdlog_load_u32_le(index + 4);
+    TEST_ASSERT_TRUE(num_blocks > expected_length / 1000);
+    TEST_ASSERT_EQUAL_PTR(index, buf + length - 12 - 16 - num_blocks * 32);
+    TEST_ASSERT_EQUAL_HEX64(UINT64_MAX, sdlog_load_u64_le(index + 8));
+    for (i = 0; i < num_blocks; i++) {
+        const uint8_t* entry = index + 16 + i * 32;
+        uint64_t offset = sdlog_load_u64_le(entry + 8) + sdlog_load_u32_le(entry + 24);
+        TEST_ASSERT_EQUAL_MEMORY("SDZB", buf + sdlog_load_u64_le(entry), 4);
+        if (i == num_blocks - 1) {
+            TEST_ASSERT_EQUAL(expected_length, sdlog_load_u64_le(entry + 8) + sdlog_load_u32_le(entry + 20));
+        }
+        TEST_ASSERT_EQUAL_HEX8(0xA3, expected[offset]);
+        TEST_ASSERT_EQUAL_HEX8(0x95, expected[offset + 1]);
+    }
+
+    TEST_CHECK(sdlog_istream_init_buffer(&source, buf, length));
+    TEST_CHECK(sdlog_istream_init_compressed(&input, &source));
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    read_all(&input, &dump);
+    buf = sdlog_ostream_buffer_get(&dump, &length);
+    TEST_ASSERT_EQUAL(expected_length, length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, buf, length);
+    check_consecutive_records(buf, length, 1999);
+    sdlog_ostream_destroy(&dump);
+    sdlog_istream_destroy(&input);
+    sdlog_istream_destroy(&source);
+
+#if HAVE_PTHREAD
+    /* Blocks decompressed in parallel are returned in order */
+    buf = sdlog_ostream_buffer_get(&container, &length);
+    TEST_CHECK(sdlog_istream_init_buffer(&source, buf, length));
+    TEST_CHECK(sdlog_istream_init_compressed(&input, &source));
+    TEST_CHECK(sdlog_istream_compressed_set_threads(&input, 3));
+    TEST_ASSERT_EQUAL(SDLOG_EINVAL, sdlog_istream_compressed_set_threads(&input, 3));
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    read_all(&input, &dump);
+    buf = sdlog_ostream_buffer_get(&dump, &length);
+    TEST_ASSERT_EQUAL(expected_length, length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, buf, length);
+    sdlog_ostream_destroy(&dump);
+    sdlog_istream_destroy(&input);
+    sdlog_istream_destroy(&source);
+
+    /* Streams may be destroyed while the workers are busy */
+    buf = sdlog_ostream_buffer_get(&container, &length);
+    TEST_CHECK(sdlog_istream_init_buffer(&source, buf, length));
+    TEST_CHECK(sdlog_istream_init_compressed(&input, &source));
+    TEST_CHECK(sdlog_istream_compressed_set_threads(&input, 0));
+    TEST_CHECK(sdlog_istream_read(&input, random_data, 100, &length));
+    TEST_ASSERT_EQUAL(100, length);
+    TEST_ASSERT_EQUAL(SDLOG_EINVAL, sdlog_istream_compressed_set_threads(&input, 2));
+    sdlog_istream_destroy(&input);
+    sdlog_istream_destroy(&source);
+#endif
+
+    /* Incompressible data is stored as it is and survives a round trip */
+    srand(42);
+    for (i = 0; i < sizeof(random_data); i++) {
+        random_data[i] = rand() & 0xff;
+    }
+
+    sdlog_ostream_destroy(&container);
+    TEST_CHECK(sdlog_ostream_init_buffer(&container));
+    TEST_CHECK(sdlog_ostream_init_compressed(&stream, &container, NULL));
+    TEST_CHECK(sdlog_ostream_write_all(&stream, random_data, sizeof(random_data)));
+    TEST_CHECK(sdlog_ostream_end_session(&stream));
+    sdlog_ostream_destroy(&stream);
+
+    buf = sdlog_ostream_buffer_get(&container, &length);
+    TEST_ASSERT_EQUAL(12 + 20 + sizeof(random_data) + 16 + 32 + 12, length);
+    TEST_ASSERT_EQUAL(0, buf[12 + 4]);
+
+    TEST_CHECK(sdlog_istream_init_buffer(&source, buf, length));
+    TEST_CHECK(sdlog_istream_init_compressed(&input, &source));
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    read_all(&input, &dump);
+    buf = sdlog_ostream_buffer_get(&dump, &length);
+    TEST_ASSERT_EQUAL(sizeof(random_data), length);
+    TEST_ASSERT_EQUAL_MEMORY(random_data, buf, length);
+    sdlog_ostream_destroy(&dump);
+    sdlog_istream_destroy(&input);
+    sdlog_istream_destroy(&source);
+
+    /* Corrupted blocks are rejected */
+    sdlog_ostream_destroy(&container);
+    TEST_CHECK(sdlog_ostream_init_buffer(&container));
+    TEST_CHECK(sdlog_ostream_init_compressed(&stream, &container, NULL));
+    TEST_CHECK(sdlog_ostream_write_all(&stream, expected, sizeof(corrupted)));
+    TEST_CHECK(sdlog_ostream_flush(&stream));
+    sdlog_ostream_destroy(&stream);
+
+    buf = sdlog_ostream_buffer_get(&container, &length);
+    TEST_ASSERT_TRUE(length < sizeof(corrupted));
+    memcpy(corrupted, buf, length);
+    corrupted[12 + 12]++;
+
+    TEST_CHECK(sdlog_istream_init_buffer(&source, corrupted, length));
+    TEST_CHECK(sdlog_istream_init_compressed(&input, &source));
+    TEST_ASSERT_EQUAL(SDLOG_EREAD, sdlog_istream_read(&input, corrupted, sizeof(corrupted), &length));
+    sdlog_istream_destroy(&input);
+    sdlog_istream_destroy(&source);
+
+    sdlog_ostream_destroy(&container);
+    sdlog_ostream_destroy(&plain);
+    sdlog_message_format_destroy(&format);
+}
+
+void test_compressed_seek(void)
+{
+    sdlog_compressed_ostream_options_t options = { 0 };
+    sdlog_ostream_t stream, container, plain;
+    sdlog_istream_t input, source;
+    sdlog_message_format_t format;
+    sdlog_writer_t writer;
+    const uint8_t *buf, *expected, *index;
+    uint8_t data[2000];
+    size_t length, expected_length, read, num_indices;
+    uint64_t i, offset, index_offset, next_offset;
+    const uint64_t offsets[] = { 0, 1, 999, 1000, 12345, 20000 };
+
+    TEST_CHECK(sdlog_message_format_init(&format, 42, "SEQ"));
+    TEST_CHECK(sdlog_message_format_add_columns(&format, "Value", "Q", "-"));
+
+    /* Write a container in three sessions */
+    options.block_size = 1000;
+    options.compression = SDLOG_COMPRESSION_LZ;
+    TEST_CHECK(sdlog_ostream_init_buffer(&container));
+    TEST_CHECK(sdlog_ostream_init_compressed(&stream, &container, &options));
+    for (i = 0; i < 3000; i++) {
+        if (i % 1000 == 0) {
+            TEST_CHECK(sdlog_writer_init(&writer, &stream));
+        }
+        TEST_CHECK(sdlog_writer_write(&writer, &format, i));
+        if (i % 1000 == 999) {
+            sdlog_writer_destroy(&writer);
+        }
+    }
+    sdlog_ostream_destroy(&stream);
+
+    buf = sdlog_ostream_buffer_get(&container, &length);
+    TEST_CHECK(sdlog_istream_init_buffer(&source, buf, length));
+    TEST_CHECK(sdlog_istream_init_compressed(&input, &source));
+    TEST_CHECK(sdlog_ostream_init_buffer(&plain));
+    read_all(&input, &plain);
+    expected = sdlog_ostream_buffer_get(&plain, &expected_length);
+    TEST_ASSERT_TRUE(expected_length > 30000);
+
+    /* Each session indexes only its own blocks and links to the index of
+     * the previous session, so the indices do not grow with the log */
+    num_indices = 0;
+    next_offset = expected_length;
+    index_offset = sdlog_load_u64_le(buf + length - 12);
+    while (index_offset != UINT64_MAX) {
+        index = buf + index_offset;
+        TEST_ASSERT_EQUAL_MEMORY("SDZI", index, 4);
+        TEST_ASSERT_TRUE(sdlog_load_u32_le(index + 4) < expected_length / 3 / 1000 + 2);
+        for (i = sdlog_load_u32_le(index + 4); i > 0; i--) {
+            const uint8_t* entry = index + 16 + (i - 1) * 32;
+            TEST_ASSERT_EQUAL(next_offset, sdlog_load_u64_le(entry + 8) + sdlog_load_u32_le(entry + 20));
+            next_offset = sdlog_load_u64_le(entry + 8);
+        }
+        index_offset = sdlog_load_u64_le(index + 8);
+        num_indices++;
+    }
+    TEST_ASSERT_EQUAL(3, num_indices);
+    TEST_ASSERT_EQUAL(0, next_offset);
+
+    /* Seeking decompresses the block holding the new position */
+    for (i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+        TEST_CHECK(sdlog_istream_seek(&input, offsets[i]));
+        TEST_CHECK(sdlog_istream_tell(&input, &offset));
+        TEST_ASSERT_EQUAL(offsets[i], offset);
+        TEST_CHECK(sdlog_istream_read_exactly(&input, data, sizeof(data)));
+        TEST_ASSERT_EQUAL_MEMORY(expected + offsets[i], data, sizeof(data));
+        TEST_CHECK(sdlog_istream_tell(&input, &offset));
+        TEST_ASSERT_EQUAL(offsets[i] + sizeof(data), offset);
+    }
+
+    TEST_CHECK(sdlog_istream_seek(&input, expected_length));
+    TEST_ASSERT_EQUAL(SDLOG_EOF, sdlog_istream_read(&input, data, sizeof(data), &read));
+    TEST_ASSERT_EQUAL(SDLOG_EINVAL, sdlog_istream_seek(&input, expected_length + 1));
+
+    /* Positional reads stop at the end of the block */
+    for (offset = 0; offset < expected_length; offset += read) {
+        TEST_CHECK(sdlog_istream_read_at(&input, offset, data, sizeof(data), &read));
+        TEST_ASSERT_TRUE(read > 0 && read <= 1000);
+        TEST_ASSERT_EQUAL_MEMORY(expected + offset, data, read);
+    }
+    TEST_CHECK(sdlog_istream_read_at(&input, 12345, data, 10, &read));
+    TEST_ASSERT_EQUAL(10, read);
+    TEST_ASSERT_EQUAL_MEMORY(expected + 12345, data, 10);
+    TEST_ASSERT_EQUAL(SDLOG_EOF, sdlog_istream_read_at(&input, expected_length, data, 10, &read));
+
+    sdlog_istream_destroy(&input);
+
+#if HAVE_PTHREAD
+    /* Blocks that were read ahead by the workers are discarded */
+    TEST_CHECK(sdlog_istream_seek(&source, 0));
+    TEST_CHECK(sdlog_istream_init_compressed(&input, &source));
+    TEST_CHECK(sdlog_istream_compressed_set_threads(&input, 2));
+    TEST_CHECK(sdlog_istream_read_exactly(&input, data, 100));
+    TEST_CHECK(sdlog_istream_seek(&input, 20000));
+    TEST_CHECK(sdlog_istream_read_exactly(&input, data, sizeof(data)));
+    TEST_ASSERT_EQUAL_MEMORY(expected + 20000, data, sizeof(data));
+    sdlog_istream_destroy(&input);
+#endif
+
+    sdlog_istream_destroy(&source);
+
+    /* Containers that were cut off can only be read sequentially */
+    TEST_CHECK(sdlog_istream_init_buffer(&source, buf, length - 1));
+    TEST_CHECK(sdlog_istream_init_compressed(&input, &source));
+    TEST_ASSERT_EQUAL(SDLOG_UNIMPLEMENTED, sdlog_istream_seek(&input, 0));
+    TEST_ASSERT_EQUAL(SDLOG_UNIMPLEMENTED, sdlog_istream_read_at(&input, 0, data, 10, &read));
+    TEST_CHECK(sdlog_istream_read_exactly(&input, data, sizeof(data)));
+    TEST_ASSERT_EQUAL_MEMORY(expected, data, sizeof(data));
+    sdlog_istream_destroy(&input);
+    sdlog_istream_destroy(&source);
+
+    sdlog_ostream_destroy(&plain);
+    sdlog_ostream_destroy(&container);
+    sdlog_message_format_destroy(&format);
+}
+
+/* Records the corrupt regions reported by a checksummed input stream */
+static void note_corrupt(void* arg, uint64_t offset, uint64_t length)
+{
+    uint64_t* regions = (uint64_t*)arg;
+
+    regions[2 * regions[0] + 1] = offset;
+    regions[2 * regions[0] + 2] = length;
+    regions[0]++;
+}
+
+void test_checksummed(void)
+{
+    sdlog_checksummed_istream_options_t options = { 0 };
+    sdlog_ostream_t stream, blocks, dump;
+    sdlog_istream_t input, source;
+    uint8_t data[10000], damaged[20000];
+    const uint8_t* buf;
+    size_t length, i;
+    uint64_t regions[9];
+
+    TEST_ASSERT_EQUAL(SDLOG_EINVAL, sdlog_ostream_init_checksummed(&stream, &blocks, 32 * 1024 * 1024));
+
+    /* The checksum is the standard CRC-32C */
+    TEST_CHECK(sdlog_ostream_init_buffer(&blocks));
+    TEST_CHECK(sdlog_ostream_init_checksummed(&stream, &blocks, 16));
+    TEST_CHECK(sdlog_ostream_write_all(&stream, (const uint8_t*)"123456789", 9));
+    TEST_CHECK(sdlog_ostream_flush(&stream));
+    buf = sdlog_ostream_buffer_get(&blocks, &length);
+    TEST_ASSERT_EQUAL(25, length);
+    TEST_ASSERT_EQUAL_MEMORY("SDCB", buf, 4);
+    TEST_ASSERT_EQUAL(9, sdlog_load_u32_le(buf + 4));
+    TEST_ASSERT_EQUAL_HEX32(0xE3069283, sdlog_load_u32_le(buf + 8));
+    sdlog_ostream_destroy(&stream);
+    sdlog_ostream_destroy(&blocks);
+
+    /* Small writes are collected into blocks, large ones are written
+     * directly, in ten blocks of 1000 bytes */
+    for (i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 7 + i / 256);
+    }
+    TEST_CHECK(sdlog_ostream_init_buffer(&blocks));
+    TEST_CHECK(sdlog_ostream_init_checksummed(&stream, &blocks, 1000));
+    TEST_CHECK(sdlog_ostream_begin_session(&stream));
+    for (i = 0; i < 5000; i += 50) {
+        TEST_CHECK(sdlog_ostream_write_all(&stream, data + i, 50));
+    }
+    TEST_CHECK(sdlog_ostream_write_all(&stream, data + 5000, 5000));
+    TEST_CHECK(sdlog_ostream_end_session(&stream));
+    sdlog_ostream_destroy(&stream);
+
+    buf = sdlog_ostream_buffer_get(&blocks, &length);
+    TEST_ASSERT_EQUAL(10 * 1016, length);
+
+    TEST_CHECK(sdlog_istream_init_buffer(&source, buf, length));
+    TEST_CHECK(sdlog_istream_init_checksummed(&input, &source, NULL));
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    read_all(&input, &dump);
+    TEST_ASSERT_EQUAL(0, sdlog_istream_checksummed_get_corrupt_blocks(&input));
+    TEST_ASSERT_EQUAL_MEMORY(data, sdlog_ostream_buffer_get(&dump, &length), sizeof(data));
+    TEST_ASSERT_EQUAL(sizeof(data), length);
+    sdlog_ostream_destroy(&dump);
+    sdlog_istream_destroy(&input);
+    sdlog_istream_destroy(&source);
+
+    /* Damage the payload of the third block, the header of the sixth block
+     * and cut off the last block. Intact blocks are still returned. */
+    buf = sdlog_ostream_buffer_get(&blocks, &length);
+    memcpy(damaged, buf, length);
+    damaged[2 * 1016 + 500] ^= 0x10;
+    damaged[5 * 1016 + 5]++;
+    length -= 10;
+
+    memset(regions, 0, sizeof(regions));
+    options.on_corrupt = note_corrupt;
+    options.arg = regions;
+    TEST_CHECK(sdlog_istream_init_buffer(&source, damaged, length));
+    TEST_CHECK(sdlog_istream_init_checksummed(&input, &source, &options));
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    read_all(&input, &dump);
+    TEST_ASSERT_EQUAL(3, sdlog_istream_checksummed_get_corrupt_blocks(&input));
+    TEST_ASSERT_EQUAL(3, regions[0]);
+    TEST_ASSERT_EQUAL(2 * 1016, regions[1]);
+    TEST_ASSERT_EQUAL(1016, regions[2]);
+    TEST_ASSERT_EQUAL(5 * 1016, regions[3]);
+    TEST_ASSERT_EQUAL(1016, regions[4]);
+    TEST_ASSERT_EQUAL(9 * 1016, regions[5]);
+    TEST_ASSERT_EQUAL(1006, regions[6]);
+
+    buf = sdlog_ostream_buffer_get(&dump, &length);
+    TEST_ASSERT_EQUAL(7000, length);
+    TEST_ASSERT_EQUAL_MEMORY(data, buf, 2000);
+    TEST_ASSERT_EQUAL_MEMORY(data + 3000, buf + 2000, 2000);
+    TEST_ASSERT_EQUAL_MEMORY(data + 6000, buf + 4000, 3000);
+    sdlog_ostream_destroy(&dump);
+    sdlog_istream_destroy(&input);
+    sdlog_istream_destroy(&source);
+
+    /* In strict mode, corrupt blocks are errors, but reading may continue */
+    options.strict = true;
+    options.on_corrupt = NULL;
+    TEST_CHECK(sdlog_istream_init_buffer(&source, damaged, length));
+    TEST_CHECK(sdlog_istream_init_checksummed(&input, &source, &options));
+    TEST_CHECK(sdlog_istream_read_exactly(&input, data, 2000));
+    TEST_ASSERT_EQUAL(SDLOG_EREAD, sdlog_istream_read(&input, data, 100, &length));
+    TEST_CHECK(sdlog_istream_read(&input, data, 100, &length));
+    TEST_ASSERT_EQUAL(100, length);
+    sdlog_istream_destroy(&input);
+    sdlog_istream_destroy(&source);
+
+    sdlog_ostream_destroy(&blocks);
+}
+
+void test_shm_ring(void)
+{
+#if HAVE_SHM_OPEN && HAVE_UNISTD_H
+    char name[64];
+    uint8_t buf[1024];
+    sdlog_ostream_t stream, dump;
+    sdlog_istream_t input;
+    sdlog_message_format_t format;
+    sdlog_writer_t writer;
+    const uint8_t* data;
+    size_t length;
+    uint64_t i;
+    pid_t pid;
+    int status;
+
+    snprintf(name, sizeof(name), "/sdlog-test-%d", (int)getpid());
+    shm_unlink(name);
+
+    TEST_CHECK(sdlog_message_format_init(&format, 42, "SEQ"));
+    TEST_CHECK(sdlog_message_format_add_columns(&format, "Value", "Q", "-"));
+
+    TEST_ASSERT_EQUAL(SDLOG_EIO, sdlog_istream_init_shm(&input, name));
+    TEST_ASSERT_EQUAL(SDLOG_EINVAL, sdlog_ostream_init_shm(&stream, name, 16));
+
+    TEST_CHECK(sdlog_ostream_init_shm(&stream, name, 512));
+    TEST_CHECK(sdlog_istream_init_shm(&input, name));
+    TEST_CHECK(sdlog_writer_init(&writer, &stream));
+
+    for (i = 0; i < 10; i++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &format, i));
+    }
+    TEST_CHECK(sdlog_istream_read_exactly(&input, buf, 89 + 10 * 11));
+    check_consecutive_records(buf, 89 + 10 * 11, 9);
+
+    /* The producer drops whole records when the consumer lags behind, then
+     * repeats the FMT records before the next record that fits */
+    for (i = 10; i < 100; i++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &format, i));
+    }
+    TEST_ASSERT_EQUAL((100 - 10 - 512 / 11) * 11, sdlog_ostream_shm_get_bytes_dropped(&stream));
+    TEST_CHECK(sdlog_istream_read_exactly(&input, buf, 512 / 11 * 11));
+    check_consecutive_records(buf, 512 / 11 * 11, 10 + 512 / 11 - 1);
+
+    TEST_CHECK(sdlog_writer_write(&writer, &format, (uint64_t)500));
+    TEST_CHECK(sdlog_istream_read_exactly(&input, buf, 89 + 11));
+    check_consecutive_records(buf, 89 + 11, 500);
+
+    /* The consumer sees the end of the stream when the producer ends its
+     * session; a record that is incomplete at that point is dropped */
+    TEST_CHECK(sdlog_ostream_write_all(&stream, buf + 89, 5));
+    sdlog_writer_destroy(&writer);
+    TEST_ASSERT_EQUAL((100 - 10 - 512 / 11) * 11 + 5, sdlog_ostream_shm_get_bytes_dropped(&stream));
+    sdlog_ostream_destroy(&stream);
+    TEST_ASSERT_EQUAL(SDLOG_EOF, sdlog_istream_read(&input, buf, sizeof(buf), &length));
+
+    /* A producer in another process attaches to a ring large enough for
+     * all its records; the consumer is woken up as data arrives and sees the
+     * end of the stream when the producer ends its session */
+    TEST_CHECK(sdlog_ostream_init_shm(&stream, name, 65536));
+    sdlog_istream_destroy(&input);
+    TEST_CHECK(sdlog_istream_init_shm(&input, name));
+
+    pid = fork();
+    TEST_ASSERT_TRUE(pid >= 0);
+    if (pid == 0) {
+        sdlog_ostream_t child_stream;
+
+        if (sdlog_ostream_init_shm(&child_stream, name, 65536)
+            || sdlog_writer_init(&writer, &child_stream)) {
+            _exit(1);
+        }
+        for (i = 0; i < 2000; i++) {
+            if (sdlog_writer_write(&writer, &format, i)) {
+                _exit(1);
+            }
+            if (i % 100 == 0) {
+                usleep(1000);
+            }
+        }
+        sdlog_writer_destroy(&writer);
+        sdlog_ostream_destroy(&child_stream);
+        _exit(0);
+    }
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    read_all(&input, &dump);
+    TEST_ASSERT_EQUAL(pid, waitpid(pid, &status, 0));
+    TEST_ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    TEST_ASSERT_EQUAL(0, sdlog_ostream_shm_get_bytes_dropped(&stream));
+    sdlog_ostream_destroy(&stream);
+
+    data = sdlog_ostream_buffer_get(&dump, &length);
+    check_consecutive_records(data, length, 1999);
+
+    sdlog_ostream_destroy(&dump);
+    sdlog_istream_destroy(&input);
+    sdlog_message_format_destroy(&format);
+    shm_unlink(name);
+#else
+    TEST_IGNORE();
+#endif
+}
+
+void test_shm_ring_reattach(void)
+{
+#if HAVE_SHM_OPEN && HAVE_UNISTD_H
+    char name[64];
+    uint8_t buf[1024];
+    sdlog_ostream_t stream, log, dump;
+    sdlog_istream_t input;
+    sdlog_message_format_t format;
+    sdlog_writer_t writer;
+    const uint8_t* data;
+    size_t length;
+    uint64_t i;
+    pid_t pid;
+    int status;
+
+    snprintf(name, sizeof(name), "/sdlog-test-reattach-%d", (int)getpid());
+    shm_unlink(name);
+
+    TEST_CHECK(sdlog_message_format_init(&format, 42, "SEQ"));
+    TEST_CHECK(sdlog_message_format_add_columns(&format, "Value", "Q", "-"));
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&log));
+    TEST_CHECK(sdlog_writer_init(&writer, &log));
+    for (i = 0; i < 10; i++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &format, i));
+    }
+    sdlog_writer_destroy(&writer);
+    data = sdlog_ostream_buffer_get(&log, &length);
+
+    /* The first producer goes away in the middle of a record without ending
+     * its session. Only its complete records reach the ring. */
+    TEST_CHECK(sdlog_ostream_init_shm(&stream, name, 4096));
+    TEST_CHECK(sdlog_istream_init_shm(&input, name));
+    TEST_CHECK(sdlog_ostream_begin_session(&stream));
+    TEST_CHECK(sdlog_ostream_write_all(&stream, data, length - 5));
+    sdlog_ostream_destroy(&stream);
+
+    TEST_CHECK(sdlog_istream_read_exactly(&input, buf, length - 11));
+    check_consecutive_records(buf, length - 11, 8);
+
+    /* The consumer waits for a new producer instead of reaching the end of
+     * the stream, and reads on when it attaches */
+    pid = fork();
+    TEST_ASSERT_TRUE(pid >= 0);
+    if (pid == 0) {
+        sdlog_ostream_t child_stream;
+
+        usleep(200000);
+        if (sdlog_ostream_init_shm(&child_stream, name, 4096)
+            || sdlog_writer_init(&writer, &child_stream)) {
+            _exit(1);
+        }
+        for (i = 9; i < 20; i++) {
+            if (sdlog_writer_write(&writer, &format, i)) {
+                _exit(1);
+            }
+        }
+        sdlog_writer_destroy(&writer);
+        sdlog_ostream_destroy(&child_stream);
+        _exit(0);
+    }
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&dump));
+    read_all(&input, &dump);
+    TEST_ASSERT_EQUAL(pid, waitpid(pid, &status, 0));
+    TEST_ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    data = sdlog_ostream_buffer_get(&dump, &length);
+    TEST_ASSERT_EQUAL(89 + 11 * 11, length);
+    check_consecutive_records(data, length, 19);
+
+    /* The session was ended, so the end of the stream is reached again */
+    TEST_ASSERT_EQUAL(SDLOG_EOF, sdlog_istream_read(&input, buf, sizeof(buf), &length));
+
+    /* A producer that needs a ring of a different size reinitializes the
+     * segment; the consumer cannot continue with its mapping */
+    TEST_CHECK(sdlog_ostream_init_shm(&stream, name, 8192));
+    TEST_ASSERT_EQUAL(SDLOG_EREAD, sdlog_istream_read(&input, buf, sizeof(buf), &length));
+    sdlog_ostream_destroy(&stream);
+
+    sdlog_ostream_destroy(&dump);
+    sdlog_istream_destroy(&input);
+    sdlog_ostream_destroy(&log);
+    sdlog_message_format_destroy(&format);
+    shm_unlink(name);
+#else
+    TEST_IGNORE();
+#endif
+}
+
+/* Output stream without a vectored write method that accepts at most three
+ * bytes per write */
+static sdlog_error_t trickle_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    *written = length > 3 ? 3 : length;
+    return sdlog_ostream_write_all((sdlog_ostream_t*)stream->context, data, *written);
+}
+
+static const sdlog_ostream_spec_t trickle_methods = {
+    .write = trickle_write,
+};
+
+void test_ostream_writev(void)
+{
+    unsigned char template[] = "12345678901234567890";
+    sdlog_ostream_t stream, trickle;
+    sdlog_iovec_t iov[4];
+    const uint8_t* buf;
+    size_t length;
+
+    iov[0].data = template;
+    iov[0].length = 0;
+    iov[1].data = template;
+    iov[1].length = 5;
+    iov[2].data = template;
+    iov[2].length = 0;
+    iov[3].data = template + 5;
+    iov[3].length = 15;
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&stream));
+
+    /* Vectored write straight to the buffer; empty buffers are skipped */
+    TEST_CHECK(sdlog_ostream_writev(&stream, iov, 4, &length));
+    TEST_ASSERT_EQUAL(20, length);
+    TEST_CHECK(sdlog_ostream_writev(&stream, iov, 1, &length));
+    TEST_ASSERT_EQUAL(0, length);
+    TEST_CHECK(sdlog_ostream_writev(&stream, iov, 0, NULL));
+
+    /* Generic fallback with partial writes */
+    TEST_CHECK(sdlog_ostream_init(&trickle, &trickle_methods, &stream));
+    TEST_CHECK(sdlog_ostream_writev(&trickle, iov, 4, &length));
+    TEST_ASSERT_EQUAL(3, length);
+    TEST_CHECK(sdlog_ostream_writev_all(&trickle, iov + 1, 3));
+    TEST_CHECK(sdlog_ostream_writev_all(&trickle, iov, 4));
+    sdlog_ostream_destroy(&trickle);
+
+    buf = sdlog_ostream_buffer_get(&stream, &length);
+    TEST_ASSERT_EQUAL(63, length);
+    TEST_ASSERT_EQUAL_STRING_LEN(
+        "12345678901234567890123123456789012345678901234567890123456789"
+        "0",
+        buf, length);
+
+    sdlog_ostream_destroy(&stream);
+}
+
+/* Filter that counts the bytes passing through it unchanged */
+static sdlog_error_t metering_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    size_t* total = (size_t*)sdlog_ostream_filter_get_context(stream);
+
+    SDLOG_CHECK(sdlog_ostream_filter_write_inner(stream, data, length, written));
+    *total += *written;
+
+    return SDLOG_SUCCESS;
+}
+
+static const sdlog_ostream_spec_t metering_methods = {
+    .write = metering_write,
+};
+
+/* Filters that flip the case of ASCII letters */
+static sdlog_error_t flip_case_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    uint8_t buf[64];
+    size_t i;
+
+    if (length > sizeof(buf)) {
+        length = sizeof(buf);
+    }
+
+    for (i = 0; i < length; i++) {
+        buf[i] = data[i] ^ 0x20;
+    }
+
+    SDLOG_CHECK(sdlog_ostream_filter_write_inner(stream, buf, length, NULL));
+    *written = length;
+
+    return SDLOG_SUCCESS;
+}
+
+static sdlog_error_t flip_case_read(
+    sdlog_istream_t* stream, uint8_t* data, size_t length, size_t* read)
+{
+    size_t i;
+
+    SDLOG_CHECK(sdlog_istream_read(sdlog_istream_filter_get_inner(stream), data, length, read));
+    for (i = 0; i < *read; i++) {
+        data[i] ^= 0x20;
+    }
+
+    return SDLOG_SUCCESS;
+}
+
+static const sdlog_ostream_spec_t flip_case_ostream_methods = {
+    .write = flip_case_write,
+};
+
+static const sdlog_istream_spec_t flip_case_istream_methods = {
+    .read = flip_case_read,
+};
+
+void test_filter(void)
+{
+    unsigned char template[] = "abcdefghijklmnopqrst";
+    sdlog_counting_ostream_stats_t stats;
+    sdlog_ostream_t stream, inner, filter, trickle;
+    sdlog_istream_t source, input;
+    sdlog_iovec_t iov[2];
+    const uint8_t* buf;
+    uint8_t* ptr;
+    uint8_t data[20];
+    size_t length, total = 0;
+
+    /* Filters without methods forward everything, including sessions and
+     * reservations */
+    TEST_CHECK(sdlog_ostream_init_counting(&inner, NULL));
+    TEST_CHECK(sdlog_ostream_init_filter(&filter, &inner, NULL, NULL));
+    TEST_ASSERT_EQUAL_PTR(&inner, sdlog_ostream_filter_get_inner(&filter));
+    TEST_CHECK(sdlog_ostream_begin_session(&filter));
+    TEST_CHECK(sdlog_ostream_reserve(&filter, 20, &ptr));
+    TEST_CHECK(sdlog_ostream_commit(&filter, 20));
+    TEST_CHECK(sdlog_ostream_flush(&filter));
+    TEST_CHECK(sdlog_ostream_end_session(&filter));
+    sdlog_ostream_counting_get_stats(&inner, &stats);
+    TEST_ASSERT_EQUAL(20, stats.bytes);
+    TEST_ASSERT_EQUAL(1, stats.flushes);
+    TEST_ASSERT_EQUAL(1, stats.sessions);
+    sdlog_ostream_destroy(&filter);
+    sdlog_ostream_destroy(&inner);
+
+    /* Pass-through filters report partial writes of the inner stream */
+    TEST_CHECK(sdlog_ostream_init_buffer(&stream));
+    TEST_CHECK(sdlog_ostream_init(&trickle, &trickle_methods, &stream));
+    TEST_CHECK(sdlog_ostream_init_filter(&filter, &trickle, &metering_methods, &total));
+    TEST_ASSERT_EQUAL_PTR(&total, sdlog_ostream_filter_get_context(&filter));
+    TEST_CHECK(sdlog_ostream_write(&filter, template, 20, &length));
+    TEST_ASSERT_EQUAL(3, length);
+    TEST_CHECK(sdlog_ostream_write_all(&filter, template + 3, 17));
+    TEST_ASSERT_EQUAL(20, total);
+    sdlog_ostream_destroy(&filter);
+    sdlog_ostream_destroy(&trickle);
+
+    /* Transforming filters see vectored writes but no reservations */
+    TEST_CHECK(sdlog_ostream_init_filter(&filter, &stream, &flip_case_ostream_methods, NULL));
+    TEST_ASSERT_EQUAL(SDLOG_UNIMPLEMENTED, sdlog_ostream_reserve(&filter, 20, &ptr));
+    iov[0].data = template;
+    iov[0].length = 5;
+    iov[1].data = template + 5;
+    iov[1].length = 15;
+    TEST_CHECK(sdlog_ostream_writev_all(&filter, iov, 2));
+    sdlog_ostream_destroy(&filter);
+
+    buf = sdlog_ostream_buffer_get(&stream, &length);
+    TEST_ASSERT_EQUAL(40, length);
+    TEST_ASSERT_EQUAL_STRING_LEN("abcdefghijklmnopqrstABCDEFGHIJKLMNOPQRST", buf, 40);
+
+    /* Input filters */
+    TEST_CHECK(sdlog_istream_init_buffer(&source, buf + 20, 20));
+    TEST_CHECK(sdlog_istream_init_filter(&input, &source, &flip_case_istream_methods, NULL));
+    TEST_ASSERT_EQUAL_PTR(&source, sdlog_istream_filter_get_inner(&input));
+    TEST_CHECK(sdlog_istream_read_exactly(&input, data, 20));
+    TEST_ASSERT_EQUAL_STRING_LEN(template, data, 20);
+    TEST_ERROR(SDLOG_EOF, sdlog_istream_read(&input, data, 20, &length));
+    sdlog_istream_destroy(&input);
+    sdlog_istream_destroy(&source);
+
+    sdlog_ostream_destroy(&stream);
+}
+
+void test_ostream_tee(void)
+{
+    unsigned char template[] = "12345678901234567890";
+    sdlog_ostream_t children[2];
+    sdlog_ostream_t* child_ptrs[] = { &children[0], &children[1] };
+    sdlog_ostream_t stream;
+    sdlog_iovec_t iov[2];
+    const uint8_t* buf;
+    size_t length, dropped;
+    int i, fd, fds[2];
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&children[0]));
+    TEST_CHECK(sdlog_ostream_init_buffer(&children[1]));
+    TEST_CHECK(sdlog_ostream_init_tee(&stream, child_ptrs, 2));
+
+    TEST_CHECK(sdlog_ostream_begin_session(&stream));
+    TEST_CHECK(sdlog_ostream_write_all(&stream, template, 20));
+    TEST_CHECK(sdlog_ostream_flush(&stream));
+    TEST_CHECK(sdlog_ostream_write_all(&stream, template, 10));
+    TEST_CHECK(sdlog_ostream_end_session(&stream));
+
+    for (i = 0; i < 2; i++) {
+        buf = sdlog_ostream_buffer_get(&children[i], &length);
+        TEST_ASSERT_EQUAL(30, length);
+        TEST_ASSERT_EQUAL_STRING_LEN("123456789012345678901234567890", buf, length);
+        TEST_CHECK(sdlog_ostream_tee_get_child_status(&stream, i, &dropped));
+        TEST_ASSERT_EQUAL(0, dropped);
+    }
+
+    TEST_ERROR(SDLOG_EINVAL, sdlog_ostream_tee_get_child_status(&stream, 2, NULL));
+    TEST_ERROR(SDLOG_UNIMPLEMENTED, sdlog_ostream_get_fd(&stream, &fds[0]));
+
+#if SIZE_MAX > UINT32_MAX
+    /* Writes of 4 GiB or more are rejected without touching the data */
+    iov[0].data = template;
+    iov[0].length = (size_t)3 << 30;
+    iov[1] = iov[0];
+    TEST_ERROR(SDLOG_ELIMIT, sdlog_ostream_writev(&stream, iov, 2, &length));
+    TEST_ASSERT_EQUAL(0, length);
+#endif
+
+    sdlog_ostream_destroy(&stream);
+
+#if HAVE_UNISTD_H
+    /* The file descriptor is the one of the first child that has one */
+    sdlog_ostream_destroy(&children[1]);
+    TEST_ASSERT_EQUAL(0, pipe(fds));
+    TEST_CHECK(sdlog_ostream_init_fd(&children[1], fds[1], NULL));
+    TEST_CHECK(sdlog_ostream_init_tee(&stream, child_ptrs, 2));
+    TEST_CHECK(sdlog_ostream_get_fd(&stream, &fd));
+    TEST_ASSERT_EQUAL(fds[1], fd);
+    sdlog_ostream_destroy(&stream);
+    close(fds[0]);
+    close(fds[1]);
+#endif
+
+    sdlog_ostream_destroy(&children[1]);
+    sdlog_ostream_destroy(&children[0]);
+}
+
+void test_ostream_tee_async(void)
+{
+#if HAVE_PTHREAD
+    unsigned char template[] = "12345678901234567890";
+    sdlog_ostream_t children[2];
+    sdlog_ostream_t* child_ptrs[] = { &children[0], &children[1] };
+    sdlog_ostream_t stream;
+    const uint8_t* buf;
+    size_t length, dropped;
+    int i;
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&children[0]));
+    TEST_CHECK(sdlog_ostream_init_buffer(&children[1]));
+    TEST_CHECK(sdlog_ostream_init_tee(&stream, child_ptrs, 2));
+    TEST_CHECK(sdlog_ostream_tee_set_async(&stream, 1, 4096));
+    TEST_ERROR(SDLOG_EINVAL, sdlog_ostream_tee_set_async(&stream, 1, 4096));
+
+    TEST_CHECK(sdlog_ostream_begin_session(&stream));
+    for (i = 0; i < 100; i++) {
+        TEST_CHECK(sdlog_ostream_write_all(&stream, template, 20));
+    }
+    TEST_CHECK(sdlog_ostream_end_session(&stream));
+
+    /* Destroying the tee stream drains the queue of the asynchronous child */
+    TEST_CHECK(sdlog_ostream_tee_get_child_status(&stream, 1, &dropped));
+    sdlog_ostream_destroy(&stream);
+
+    buf = sdlog_ostream_buffer_get(&children[0], &length);
+    TEST_ASSERT_EQUAL(2000, length);
+
+    buf = sdlog_ostream_buffer_get(&children[1], &length);
+    TEST_ASSERT_EQUAL(0, length % 20);
+    TEST_ASSERT_LESS_OR_EQUAL(2000, length);
+    TEST_ASSERT_LESS_OR_EQUAL(2000 - length, dropped);
+    for (i = 0; i < (int)length; i += 20) {
+        TEST_ASSERT_EQUAL_STRING_LEN(template, buf + i, 20);
+    }
+
+    sdlog_ostream_destroy(&children[1]);
+    sdlog_ostream_destroy(&children[0]);
+#else
+    TEST_IGNORE();
+#endif
+}
+
+/* Output stream that is slower than the writer */
+static sdlog_error_t sluggish_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    usleep(1000);
+    return sdlog_ostream_write((sdlog_ostream_t*)stream->context, data, length, written);
+}
+
+static const sdlog_ostream_spec_t sluggish_methods = {
+    .write = sluggish_write,
+};
+
+void test_ostream_tee_async_drops_records(void)
+{
+#if HAVE_PTHREAD && HAVE_UNISTD_H
+    sdlog_ostream_t log, sluggish, children[2];
+    sdlog_ostream_t* child_ptrs[] = { &children[0], &sluggish };
+    sdlog_ostream_t stream;
+    sdlog_message_format_t format;
+    sdlog_writer_t writer;
+    const uint8_t *buf, *data;
+    size_t i, length, data_length, dropped, chunk;
+    uint64_t value, previous = 0;
+    bool after_fmt = false, seen_value = false;
+    int j;
+
+    /* Encode a log in advance and feed it to the tee stream in chunks that
+     * do not line up with the records */
+    TEST_CHECK(sdlog_message_format_init(&format, 42, "SEQ"));
+    TEST_CHECK(sdlog_message_format_add_columns(&format, "Value", "Q", "-"));
+    TEST_CHECK(sdlog_ostream_init_buffer(&log));
+    TEST_CHECK(sdlog_writer_init(&writer, &log));
+    for (value = 0; value < 500; value++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &format, value));
+    }
+    sdlog_writer_destroy(&writer);
+    data = sdlog_ostream_buffer_get(&log, &data_length);
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&children[0]));
+    TEST_CHECK(sdlog_ostream_init_buffer(&children[1]));
+    TEST_CHECK(sdlog_ostream_init(&sluggish, &sluggish_methods, &children[1]));
+    TEST_CHECK(sdlog_ostream_init_tee(&stream, child_ptrs, 2));
+    TEST_CHECK(sdlog_ostream_tee_set_async(&stream, 1, 256));
+
+    TEST_CHECK(sdlog_ostream_begin_session(&stream));
+    for (i = 0; i < data_length; i += chunk) {
+        chunk = data_length - i < 7 ? data_length - i : 7;
+        TEST_CHECK(sdlog_ostream_write_all(&stream, data + i, chunk));
+    }
+    TEST_CHECK(sdlog_ostream_end_session(&stream));
+
+    TEST_CHECK(sdlog_ostream_tee_get_child_status(&stream, 1, &dropped));
+    sdlog_ostream_destroy(&stream);
+
+    buf = sdlog_ostream_buffer_get(&children[0], &length);
+    TEST_ASSERT_EQUAL(data_length, length);
+    TEST_ASSERT_EQUAL_MEMORY(data, buf, length);
+
+    /* The slow child lost whole records only, and each gap is followed by
+     * the FMT record of the format so the log can still be decoded */
+    buf = sdlog_ostream_buffer_get(&children[1], &length);
+    TEST_ASSERT_TRUE(dropped > 0);
+    TEST_ASSERT_EQUAL(0, (length + dropped - data_length) % 89);
+    i = 0;
+    while (i < length) {
+        TEST_ASSERT_EQUAL_HEX8(0xA3, buf[i]);
+        TEST_ASSERT_EQUAL_HEX8(0x95, buf[i + 1]);
+        if (buf[i + 2] == SDLOG_ID_FMT) {
+            TEST_ASSERT_EQUAL(42, buf[i + 3]);
+            after_fmt = true;
+            i += 89;
+            continue;
+        }
+
+        TEST_ASSERT_EQUAL(42, buf[i + 2]);
+        for (value = 0, j = 7; j >= 0; j--) {
+            value = (value << 8) | buf[i + 3 + j];
+        }
+        if (seen_value && value != previous + 1) {
+            TEST_ASSERT_TRUE(value > previous);
+            TEST_ASSERT_TRUE(after_fmt);
+        }
+        previous = value;
+        seen_value = true;
+        after_fmt = false;
+        i += 11;
+    }
+    TEST_ASSERT_EQUAL(length, i);
+
+    sdlog_ostream_destroy(&sluggish);
+    sdlog_ostream_destroy(&children[1]);
+    sdlog_ostream_destroy(&children[0]);
+    sdlog_ostream_destroy(&log);
+    sdlog_message_format_destroy(&format);
+#else
+    TEST_IGNORE();
+#endif
+}
+
+/* Output stream that records its commands and starts sessions only when a
+ * byte arrives on a pipe */
+typedef struct {
+    int gate;
+    sdlog_ostream_t* inner;
+} stalled_t;
+
+static sdlog_error_t stalled_begin(sdlog_ostream_t* stream)
+{
+    stalled_t* ctx = (stalled_t*)stream->context;
+    uint8_t byte;
+
+    if (read(ctx->gate, &byte, 1) != 1) {
+        return SDLOG_EREAD;
+    }
+    return sdlog_ostream_write_all(ctx->inner, (const uint8_t*)"B", 1);
+}
+
+static sdlog_error_t stalled_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    return sdlog_ostream_write(((stalled_t*)stream->context)->inner, data, length, written);
+}
+
+static sdlog_error_t stalled_flush(sdlog_ostream_t* stream)
+{
+    return sdlog_ostream_write_all(((stalled_t*)stream->context)->inner, (const uint8_t*)"F", 1);
+}
+
+static sdlog_error_t stalled_end(sdlog_ostream_t* stream)
+{
+    return sdlog_ostream_write_all(((stalled_t*)stream->context)->inner, (const uint8_t*)"E", 1);
+}
+
+static const sdlog_ostream_spec_t stalled_methods = {
+    .begin = stalled_begin,
+    .write = stalled_write,
+    .flush = stalled_flush,
+    .end = stalled_end,
+};
+
+void test_ostream_tee_async_stalled_child(void)
+{
+#if HAVE_PTHREAD && HAVE_UNISTD_H
+    sdlog_ostream_t log, stalled, children[2];
+    sdlog_ostream_t* child_ptrs[] = { &children[0], &stalled };
+    sdlog_ostream_t stream;
+    sdlog_message_format_t format;
+    sdlog_writer_t writer;
+    stalled_t ctx;
+    const uint8_t *buf, *data;
+    size_t length, data_length, dropped;
+    uint64_t value;
+    int fds[2];
+
+    /* A FMT record and ten records of 11 bytes each */
+    TEST_CHECK(sdlog_message_format_init(&format, 42, "SEQ"));
+    TEST_CHECK(sdlog_message_format_add_columns(&format, "Value", "Q", "-"));
+    TEST_CHECK(sdlog_ostream_init_buffer(&log));
+    TEST_CHECK(sdlog_writer_init(&writer, &log));
+    for (value = 0; value < 10; value++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &format, value));
+    }
+    sdlog_writer_destroy(&writer);
+    data = sdlog_ostream_buffer_get(&log, &data_length);
+    TEST_ASSERT_EQUAL(89 + 110, data_length);
+
+    TEST_ASSERT_EQUAL(0, pipe(fds));
+    ctx.gate = fds[0];
+    ctx.inner = &children[1];
+    TEST_CHECK(sdlog_ostream_init_buffer(&children[0]));
+    TEST_CHECK(sdlog_ostream_init_buffer(&children[1]));
+    TEST_CHECK(sdlog_ostream_init(&stalled, &stalled_methods, &ctx));
+    TEST_CHECK(sdlog_ostream_init_tee(&stream, child_ptrs, 2));
+
+    /* The session start and the first write fill the queue while the child
+     * is stuck in starting the session */
+    TEST_CHECK(sdlog_ostream_tee_set_async(&stream, 1, 5 + 5 + 100));
+    TEST_CHECK(sdlog_ostream_begin_session(&stream));
+    TEST_CHECK(sdlog_ostream_write_all(&stream, data, 100));
+
+    /* Nothing else fits, but the writer is not blocked; the commands are
+     * coalesced until the queue is empty */
+    TEST_CHECK(sdlog_ostream_write_all(&stream, data + 100, data_length - 100));
+    TEST_CHECK(sdlog_ostream_flush(&stream));
+    TEST_CHECK(sdlog_ostream_flush(&stream));
+    TEST_CHECK(sdlog_ostream_end_session(&stream));
+    TEST_CHECK(sdlog_ostream_begin_session(&stream));
+    TEST_CHECK(sdlog_ostream_flush(&stream));
+    TEST_CHECK(sdlog_ostream_end_session(&stream));
+    TEST_CHECK(sdlog_ostream_tee_get_child_status(&stream, 1, &dropped));
+    TEST_ASSERT_EQUAL(data_length - 100, dropped);
+
+    buf = sdlog_ostream_buffer_get(&children[0], &length);
+    TEST_ASSERT_EQUAL(data_length, length);
+    TEST_ASSERT_EQUAL_MEMORY(data, buf, length);
+
+    TEST_ASSERT_EQUAL(1, write(fds[1], "x", 1));
+    sdlog_ostream_destroy(&stream);
+
+    buf = sdlog_ostream_buffer_get(&children[1], &length);
+    TEST_ASSERT_EQUAL(1 + 100 + 1, length);
+    TEST_ASSERT_EQUAL('B', buf[0]);
+    TEST_ASSERT_EQUAL_MEMORY(data, buf + 1, 100);
+    TEST_ASSERT_EQUAL('E', buf[101]);
+
+    close(fds[0]);
+    close(fds[1]);
+    sdlog_ostream_destroy(&stalled);
+    sdlog_ostream_destroy(&children[1]);
+    sdlog_ostream_destroy(&children[0]);
+    sdlog_ostream_destroy(&log);
+    sdlog_message_format_destroy(&format);
+#else
+    TEST_IGNORE();
+#endif
+}
+
+#if HAVE_UNISTD_H
+static void check_ostream_fd(const sdlog_fd_ostream_options_t* options)
+{
+    unsigned char template[] = "12345678901234567890";
+    unsigned char inbuf[8192];
+    sdlog_iovec_t iov[600];
+    uint8_t* ptr;
+    char path[] = "/tmp/sdlog-test-XXXXXX";
+    int fd, read_fd, i;
+    sdlog_ostream_t stream;
+    struct stat st;
+    sdlog_error_t retval;
+
+    /* The file is read back via a separate descriptor because reads on the
+     * one in direct mode would need aligned buffers */
+    fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    read_fd = open(path, O_RDONLY);
+    TEST_ASSERT_TRUE(read_fd >= 0);
+    unlink(path);
+
+    retval = sdlog_ostream_init_fd(&stream, fd, options);
+    if (retval != SDLOG_SUCCESS) {
+        close(read_fd);
+        close(fd);
+        TEST_IGNORE_MESSAGE("direct I/O is not supported here");
+    }
+
+    TEST_CHECK(sdlog_ostream_begin_session(&stream));
+    for (i = 0; i < 300; i++) {
+        if (i % 2) {
+            TEST_CHECK(sdlog_ostream_write_all(&stream, template, 20));
+        } else {
+            TEST_CHECK(sdlog_ostream_reserve(&stream, 20, &ptr));
+            memcpy(ptr, template, 20);
+            TEST_CHECK(sdlog_ostream_commit(&stream, 20));
+        }
+    }
+
+    /* Flushing makes all bytes visible; in direct mode they may be followed
+     * by padding until the session ends */
+    TEST_CHECK(sdlog_ostream_flush(&stream));
+    TEST_ASSERT_TRUE(pread(read_fd, inbuf, sizeof(inbuf), 0) >= 6000);
+    TEST_ASSERT_EQUAL_STRING_LEN(template, inbuf + 5980, 20);
+
+    /* The second half is written as a single vectored write that does not
+     * fit in the buffer */
+    for (i = 0; i < 300; i++) {
+        iov[2 * i].data = template;
+        iov[2 * i].length = 7;
+        iov[2 * i + 1].data = template + 7;
+        iov[2 * i + 1].length = 13;
+    }
+    TEST_CHECK(sdlog_ostream_writev_all(&stream, iov, 600));
+    TEST_CHECK(sdlog_ostream_end_session(&stream));
+
+    TEST_ASSERT_EQUAL(0, fstat(fd, &st));
+    TEST_ASSERT_EQUAL(12000, st.st_size);
+    TEST_ASSERT_EQUAL(12000, lseek(fd, 0, SEEK_CUR));
+    TEST_ASSERT_EQUAL(8192, pread(read_fd, inbuf, sizeof(inbuf), 0));
+    for (i = 0; i < 8180; i += 20) {
+        TEST_ASSERT_EQUAL_STRING_LEN(template, inbuf + i, 20);
+    }
+
+    sdlog_ostream_destroy(&stream);
+    close(read_fd);
+    close(fd);
+}
+#endif
+
+void test_ostream_fd(void)
+{
+#if HAVE_UNISTD_H
+    sdlog_fd_ostream_options_t options;
+
+    memset(&options, 0, sizeof(options));
+    options.buffer_size = 100;
+    options.preallocate = 65536;
+
+    check_ostream_fd(NULL);
+    check_ostream_fd(&options);
+#else
+    TEST_IGNORE();
+#endif
+}
+
+void test_ostream_fd_direct(void)
+{
+#if HAVE_UNISTD_H
+    sdlog_fd_ostream_options_t options;
+
+    memset(&options, 0, sizeof(options));
+    options.buffer_size = 8192;
+    options.direct = true;
+    options.preallocate = 65536;
+
+    check_ostream_fd(&options);
+#else
+    TEST_IGNORE();
+#endif
+}
+
+void test_ostream_fd_copy_range(void)
+{
+#if HAVE_UNISTD_H
+    char dir[] = "/tmp/sdlog-test-XXXXXX";
+    char path_template[64], path[64];
+    sdlog_ostream_t stream, blocks;
+    sdlog_istream_t source, input;
+    const uint8_t* buf;
+    uint8_t data[64];
+    size_t length;
+    FILE *in_fp, *blocks_fp, *out_fp, *fp;
+    uint32_t i;
+
+    in_fp = tmpfile();
+    blocks_fp = tmpfile();
+    out_fp = tmpfile();
+    TEST_ASSERT_NOT_NULL(in_fp);
+    TEST_ASSERT_NOT_NULL(blocks_fp);
+    TEST_ASSERT_NOT_NULL(out_fp);
+
+    /* Plain file descriptor streams are copied from in the kernel */
+    TEST_ASSERT_EQUAL(16, write(fileno(in_fp), "0123456789abcdef", 16));
+    TEST_CHECK(sdlog_ostream_init_fd(&stream, fileno(out_fp), NULL));
+    TEST_CHECK(sdlog_istream_init_fd(&source, fileno(in_fp)));
+    TEST_CHECK(sdlog_ostream_copy_range(&stream, &source, 2, 10));
+    TEST_CHECK(sdlog_ostream_flush(&stream));
+    TEST_ASSERT_EQUAL(10, pread(fileno(out_fp), data, sizeof(data), 0));
+    TEST_ASSERT_EQUAL_MEMORY("23456789ab", data, 10);
+    sdlog_istream_destroy(&source);
+    sdlog_ostream_destroy(&stream);
+
+    /* Offsets of checksummed streams are offsets in the payload, so the
+     * file under them is not copied as it is */
+    TEST_CHECK(sdlog_ostream_init_buffer(&blocks));
+    TEST_CHECK(sdlog_ostream_init_checksummed(&stream, &blocks, 16));
+    TEST_CHECK(sdlog_ostream_write_all(&stream, (const uint8_t*)"123456789", 9));
+    TEST_CHECK(sdlog_ostream_flush(&stream));
+    sdlog_ostream_destroy(&stream);
+    buf = sdlog_ostream_buffer_get(&blocks, &length);
+    TEST_ASSERT_EQUAL(length, write(fileno(blocks_fp), buf, length));
+    sdlog_ostream_destroy(&blocks);
+
+    TEST_CHECK(sdlog_ostream_init_fd(&stream, fileno(out_fp), NULL));
+    TEST_CHECK(sdlog_istream_init_fd(&source, fileno(blocks_fp)));
+    TEST_CHECK(sdlog_istream_seek(&source, 0));
+    TEST_CHECK(sdlog_istream_init_checksummed(&input, &source, NULL));
+    TEST_ASSERT_EQUAL(SDLOG_UNIMPLEMENTED, sdlog_ostream_copy_range(&stream, &input, 0, 9));
+    TEST_CHECK(sdlog_ostream_flush(&stream));
+    TEST_ASSERT_EQUAL(10, pread(fileno(out_fp), data, sizeof(data), 0));
+    sdlog_istream_destroy(&input);
+    sdlog_istream_destroy(&source);
+
+    /* Neither are concatenated files, where the offsets span the files */
+    TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+    snprintf(path_template, sizeof(path_template), "%s/part.%%02u", dir);
+    for (i = 0; i < 2; i++) {
+        snprintf(path, sizeof(path), path_template, i);
+        fp = fopen(path, "wb");
+        TEST_ASSERT_NOT_NULL(fp);
+        TEST_ASSERT_EQUAL(4, fwrite(i ? "efgh" : "abcd", 1, 4, fp));
+        fclose(fp);
+    }
+
+    TEST_CHECK(sdlog_istream_init_concat_files(&input, path_template, 0));
+    TEST_ASSERT_EQUAL(SDLOG_UNIMPLEMENTED, sdlog_ostream_copy_range(&stream, &input, 2, 4));
+    TEST_CHECK(sdlog_istream_read(&input, data, sizeof(data), &length));
+    TEST_ASSERT_EQUAL(SDLOG_UNIMPLEMENTED, sdlog_ostream_copy_range(&stream, &input, 5, 2));
+    TEST_CHECK(sdlog_ostream_flush(&stream));
+    TEST_ASSERT_EQUAL(10, pread(fileno(out_fp), data, sizeof(data), 0));
+    sdlog_istream_destroy(&input);
+
+    for (i = 0; i < 2; i++) {
+        snprintf(path, sizeof(path), path_template, i);
+        TEST_ASSERT_EQUAL(0, unlink(path));
+    }
+    TEST_ASSERT_EQUAL(0, rmdir(dir));
+
+    sdlog_ostream_destroy(&stream);
+    fclose(out_fp);
+    fclose(blocks_fp);
+    fclose(in_fp);
+#else
+    TEST_IGNORE();
+#endif
+}
+
+void test_ostream_durability(void)
+{
+#if HAVE_UNISTD_H
+    unsigned char template[] = "12345678901234567890";
+    sdlog_fd_ostream_options_t options;
+    sdlog_durability_t durability;
+    sdlog_ostream_t stream;
+    FILE* fp;
+    int fd, i;
+
+    memset(&options, 0, sizeof(options));
+    options.buffer_size = 100;
+
+    /* The usual checks pass with every policy */
+    options.durability.mode = SDLOG_DURABILITY_BYTES;
+    options.durability.bytes = 1000;
+    check_ostream_fd(&options);
+    options.durability.mode = SDLOG_DURABILITY_INTERVAL;
+    options.durability.interval_ms = 1;
+    check_ostream_fd(&options);
+    options.durability.mode = SDLOG_DURABILITY_FLUSH;
+    check_ostream_fd(&options);
+
+    /* Invalid policies are rejected */
+    fp = tmpfile();
+    TEST_ASSERT_NOT_NULL(fp);
+    fd = fileno(fp);
+    options.durability.mode = SDLOG_DURABILITY_BYTES;
+    options.durability.bytes = 0;
+    TEST_ASSERT_EQUAL(SDLOG_EINVAL, sdlog_ostream_init_fd(&stream, fd, &options));
+
+    /* The data is durable after flushing and ending the session */
+    options.durability.mode = SDLOG_DURABILITY_FLUSH;
+    TEST_CHECK(sdlog_ostream_init_fd(&stream, fd, &options));
+    TEST_CHECK(sdlog_ostream_begin_session(&stream));
+    for (i = 0; i < 10; i++) {
+        TEST_CHECK(sdlog_ostream_write_all(&stream, template, 20));
+    }
+    TEST_CHECK(sdlog_ostream_flush(&stream));
+    TEST_CHECK(sdlog_ostream_end_session(&stream));
+    TEST_ASSERT_EQUAL(200, sdlog_ostream_fd_get_durable_offset(&stream));
+    sdlog_ostream_destroy(&stream);
+
+    /* Durable offsets are absolute offsets in the file */
+    options.durability.mode = SDLOG_DURABILITY_BYTES;
+    options.durability.bytes = 50;
+    TEST_CHECK(sdlog_ostream_init_fd(&stream, fd, &options));
+    TEST_CHECK(sdlog_ostream_begin_session(&stream));
+    for (i = 0; i < 10; i++) {
+        TEST_CHECK(sdlog_ostream_write_all(&stream, template, 20));
+    }
+    TEST_CHECK(sdlog_ostream_end_session(&stream));
+    TEST_ASSERT_EQUAL(400, sdlog_ostream_fd_get_durable_offset(&stream));
+    sdlog_ostream_destroy(&stream);
+
+    fclose(fp);
+
+    /* File streams sync the data that left the stdio buffer */
+    fp = tmpfile();
+    TEST_ASSERT_NOT_NULL(fp);
+    TEST_CHECK(sdlog_ostream_init_file(&stream, fp));
+    durability.mode = SDLOG_DURABILITY_INTERVAL;
+    durability.bytes = 0;
+    durability.interval_ms = 5;
+    TEST_CHECK(sdlog_ostream_file_set_durability(&stream, &durability));
+    TEST_CHECK(sdlog_ostream_begin_session(&stream));
+    for (i = 0; i < 100; i++) {
+        TEST_CHECK(sdlog_ostream_write_all(&stream, template, 20));
+    }
+    TEST_CHECK(sdlog_ostream_end_session(&stream));
+    TEST_ASSERT_EQUAL(2000, sdlog_ostream_file_get_durable_offset(&stream));
+    TEST_ASSERT_EQUAL(2000, ftell(fp));
+    sdlog_ostream_destroy(&stream);
+    fclose(fp);
+
+#if HAVE_FMEMOPEN
+    /* Memory streams cannot be synced */
+    {
+        char buf[16];
+        fp = fmemopen(buf, sizeof(buf), "wb");
+        TEST_ASSERT_NOT_NULL(fp);
+        TEST_CHECK(sdlog_ostream_init_file(&stream, fp));
+        TEST_ASSERT_EQUAL(SDLOG_EINVAL, sdlog_ostream_file_set_durability(&stream, &durability));
+        sdlog_ostream_destroy(&stream);
+        fclose(fp);
+    }
+#endif
+#else
+    TEST_IGNORE();
+#endif
+}
+
+#if HAVE_UNISTD_H
+/* Reads from a blocking file descriptor until the end of the stream and
+ * checks that the bytes continue the pattern of test_poller() */
+static int read_pattern(int fd, size_t offset, size_t expected)
+{
+    uint8_t buf[4096];
+    ssize_t result;
+    size_t i;
+
+    while ((result = read(fd, buf, sizeof(buf))) > 0) {
+        for (i = 0; i < (size_t)result; i++, offset++) {
+            if (buf[i] != (uint8_t)offset) {
+                return 1;
+            }
+        }
+        expected -= result;
+    }
+
+    return result < 0 || expected != 0;
+}
+#endif
+
+void test_poller(void)
+{
+#if HAVE_UNISTD_H
+    uint8_t buf[4096], data[256];
+    sdlog_fd_ostream_options_t options;
+    sdlog_poll_event_t events[4];
+    sdlog_poller_t poller;
+    sdlog_istream_t input, other;
+    sdlog_ostream_t output;
+    size_t count, length, total;
+    pid_t pid;
+    int in[2], out[2], fd, status, i;
+
+    for (i = 0; i < sizeof(data); i++) {
+        data[i] = i;
+    }
+
+    TEST_ASSERT_EQUAL(0, pipe(in));
+    TEST_ASSERT_EQUAL(0, pipe(out));
+    fcntl(in[0], F_SETFL, O_NONBLOCK);
+    fcntl(out[1], F_SETFL, O_NONBLOCK);
+
+    memset(&options, 0, sizeof(options));
+    options.buffer_size = 4096;
+
+    TEST_CHECK(sdlog_istream_init_fd(&input, in[0]));
+    TEST_CHECK(sdlog_ostream_init_fd(&output, out[1], &options));
+
+    /* Streams report their file descriptors, also through filters */
+    TEST_CHECK(sdlog_ostream_get_fd(&output, &fd));
+    TEST_ASSERT_EQUAL(out[1], fd);
+    TEST_CHECK(sdlog_istream_init_filter(&other, &input, NULL, NULL));
+    TEST_CHECK(sdlog_istream_get_fd(&other, &fd));
+    TEST_ASSERT_EQUAL(in[0], fd);
+    sdlog_istream_destroy(&other);
+    TEST_CHECK(sdlog_istream_init_null(&other));
+    TEST_ERROR(SDLOG_UNIMPLEMENTED, sdlog_istream_get_fd(&other, &fd));
+
+    TEST_CHECK(sdlog_poller_init(&poller));
+    TEST_ERROR(SDLOG_UNIMPLEMENTED, sdlog_poller_add_istream(&poller, &other, NULL));
+    sdlog_istream_destroy(&other);
+
+    /* Nonblocking reads return no data instead of blocking */
+    TEST_CHECK(sdlog_istream_read(&input, buf, sizeof(buf), &length));
+    TEST_ASSERT_EQUAL(0, length);
+
+    TEST_CHECK(sdlog_poller_add_istream(&poller, &input, &in));
+    TEST_ERROR(SDLOG_EINVAL, sdlog_poller_add_istream(&poller, &input, NULL));
+    TEST_CHECK(sdlog_poller_wait(&poller, events, 4, 0, &count));
+    TEST_ASSERT_EQUAL(0, count);
+
+    TEST_ASSERT_EQUAL(10, write(in[1], data, 10));
+    TEST_CHECK(sdlog_poller_wait(&poller, events, 4, -1, &count));
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_EQUAL_PTR(&input, events[0].istream);
+    TEST_ASSERT_NULL(events[0].ostream);
+    TEST_ASSERT_EQUAL_PTR(&in, events[0].arg);
+    TEST_ASSERT_EQUAL(SDLOG_POLL_READABLE, events[0].flags);
+    TEST_CHECK(sdlog_istream_read(&input, buf, sizeof(buf), &length));
+    TEST_ASSERT_EQUAL(10, length);
+
+    /* Nonblocking writes stop when both the pipe and the buffer are full */
+    total = 0;
+    do {
+        TEST_CHECK(sdlog_ostream_write(&output, data, sizeof(data), &length));
+        total += length;
+    } while (length > 0);
+    TEST_ASSERT_TRUE(total > 8192);
+
+    TEST_CHECK(sdlog_poller_add_ostream(&poller, &output, &out));
+    TEST_CHECK(sdlog_poller_wait(&poller, events, 4, 0, &count));
+    TEST_ASSERT_EQUAL(0, count);
+
+    /* The pipe becomes writable when the other end reads from it */
+    TEST_ASSERT_EQUAL(4096, read(out[0], buf, 4096));
+    TEST_ASSERT_EQUAL(4096, read(out[0], buf, 4096));
+    TEST_ASSERT_EQUAL(0, buf[0]);
+    TEST_ASSERT_EQUAL(255, buf[4095]);
+    TEST_CHECK(sdlog_poller_wait(&poller, events, 4, -1, &count));
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_EQUAL_PTR(&output, events[0].ostream);
+    TEST_ASSERT_NULL(events[0].istream);
+    TEST_ASSERT_EQUAL_PTR(&out, events[0].arg);
+    TEST_ASSERT_EQUAL(SDLOG_POLL_WRITABLE, events[0].flags);
+    TEST_CHECK(sdlog_poller_remove_ostream(&poller, &output));
+    TEST_ERROR(SDLOG_EINVAL, sdlog_poller_remove_ostream(&poller, &output));
+
+    /* Flushing waits until the reader has taken all the data */
+    pid = fork();
+    TEST_ASSERT_TRUE(pid >= 0);
+    if (pid == 0) {
+        close(out[1]);
+        _exit(read_pattern(out[0], 8192, total - 8192));
+    }
+
+    TEST_CHECK(sdlog_ostream_flush(&output));
+    sdlog_ostream_destroy(&output);
+    close(out[1]);
+    TEST_ASSERT_EQUAL(pid, waitpid(pid, &status, 0));
+    TEST_ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    /* Reading an exact number of bytes waits for the data to arrive */
+    pid = fork();
+    TEST_ASSERT_TRUE(pid >= 0);
+    if (pid == 0) {
+        usleep(10000);
+        _exit(write(in[1], data, 100) != 100);
+    }
+
+    TEST_CHECK(sdlog_istream_read_exactly(&input, buf, 100));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, buf, 100);
+    TEST_ASSERT_EQUAL(pid, waitpid(pid, &status, 0));
+    TEST_ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    /* Closing the other end is reported as a hangup and the end of the stream */
+    close(in[1]);
+    TEST_CHECK(sdlog_poller_wait(&poller, events, 4, -1, &count));
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_TRUE(events[0].flags & SDLOG_POLL_HANGUP);
+    TEST_ERROR(SDLOG_EOF, sdlog_istream_read(&input, buf, sizeof(buf), &length));
+    TEST_CHECK(sdlog_poller_remove_istream(&poller, &input));
+
+    sdlog_poller_destroy(&poller);
+    sdlog_istream_destroy(&input);
+    close(in[0]);
+    close(out[0]);
+#else
+    TEST_IGNORE();
+#endif
 }
 
 int main(int argc, char* argv[])
@@ -187,10 +2711,37 @@ int main(int argc, char* argv[])
     RUN_TEST(test_istream_file);
     RUN_TEST(test_istream_null);
     RUN_TEST(test_istream_buffer);
+    RUN_TEST(test_istream_buffered);
+    RUN_TEST(test_istream_seek);
 
     RUN_TEST(test_ostream_file);
     RUN_TEST(test_ostream_null);
+    RUN_TEST(test_ostream_counting);
     RUN_TEST(test_ostream_buffer);
+    RUN_TEST(test_ostream_chunked);
+    RUN_TEST(test_ostream_writev);
+    RUN_TEST(test_ostream_reserve);
+    RUN_TEST(test_filter);
+    RUN_TEST(test_ostream_fd);
+    RUN_TEST(test_ostream_fd_direct);
+    RUN_TEST(test_ostream_fd_copy_range);
+    RUN_TEST(test_ostream_durability);
+    RUN_TEST(test_poller);
+    RUN_TEST(test_ostream_mmap);
+    RUN_TEST(test_ostream_ring);
+    RUN_TEST(test_ostream_ring_reserve);
+    RUN_TEST(test_circular_file);
+    RUN_TEST(test_ostream_rotating);
+    RUN_TEST(test_concat);
+    RUN_TEST(test_compressed);
+    RUN_TEST(test_compressed_seek);
+    RUN_TEST(test_checksummed);
+    RUN_TEST(test_shm_ring);
+    RUN_TEST(test_shm_ring_reattach);
+    RUN_TEST(test_ostream_tee);
+    RUN_TEST(test_ostream_tee_async);
+    RUN_TEST(test_ostream_tee_async_drops_records);
+    RUN_TEST(test_ostream_tee_async_stalled_child);
 
     return UNITY_END();
 }
@@ -25,11 +25,16 @@
 #include <sdlog/encoder.h>
 #include <sdlog/memory.h>
 #include <sdlog/model.h>
+#include <sdlog/static_format.h>
+#include <sdlog/symbols.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #include "unity.h"
 #include "utils.h"
 
+SDLOG_DEFINE_FORMAT(IMU, 0x20, (TimeUS, Q, s), (GyrX, f, E), (GyrY, f, E), (Hlth, b, -), (Name, N, -))
+
 void setUp(void)
 {
 }
@@ -129,6 +134,71 @@ void test_invalid_message_column_type(void)
     sdlog_message_format_destroy(&format);
 }
 
+void test_column_name_interning(void)
+{
+    sdlog_message_format_t gps_format, imu_format;
+    const char* symbol;
+    const char* symbols[300];
+    char name[16];
+    int i;
+
+    TEST_CHECK(sdlog_message_format_init(&gps_format, 1, "GPS"));
+    TEST_CHECK(sdlog_message_format_add_columns(&gps_format, "TimeUS,Lat,Lng", "QLL", "sDU"));
+    TEST_CHECK(sdlog_message_format_init(&imu_format, 2, "IMU"));
+    TEST_CHECK(sdlog_message_format_add_columns(&imu_format, "TimeUS,GyrX", "Qf", "sE"));
+
+    /* Columns of the same name share a single copy of the name */
+    symbol = sdlog_symbol_find("TimeUS");
+    TEST_ASSERT_NOT_NULL(symbol);
+    TEST_ASSERT_EQUAL_STRING("TimeUS", symbol);
+    TEST_ASSERT_EQUAL_PTR(symbol, sdlog_message_format_get_column(&gps_format, 0)->name);
+    TEST_ASSERT_EQUAL_PTR(symbol, sdlog_message_format_get_column(&imu_format, 0)->name);
+    TEST_ASSERT_EQUAL_PTR(symbol, sdlog_symbol_intern("TimeUS"));
+    TEST_ASSERT_NULL(sdlog_symbol_find("NoSuchColumnName"));
+
+    /* Names are shared as long as a column refers to them */
+    sdlog_message_format_destroy(&gps_format);
+    TEST_ASSERT_EQUAL_PTR(symbol, sdlog_symbol_find("TimeUS"));
+    TEST_ASSERT_NULL(sdlog_symbol_find("Lat"));
+
+    /* Lookup by name */
+    TEST_ASSERT_EQUAL(1, sdlog_message_format_find_column(&imu_format, "GyrX"));
+    TEST_ASSERT_EQUAL(0, sdlog_message_format_find_column(&imu_format, symbol));
+    TEST_ASSERT_EQUAL(-1, sdlog_message_format_find_column(&imu_format, "Lat"));
+    TEST_ASSERT_EQUAL(-1, sdlog_message_format_find_column(&imu_format, "GyrXY"));
+    TEST_ASSERT_EQUAL(-1, sdlog_message_format_find_column(&imu_format, "NoSuchColumnName"));
+    TEST_ASSERT_EQUAL(2, sdlog_message_format_find_column(&sdlog_IMU_format, "GyrY"));
+    TEST_ASSERT_EQUAL(-1, sdlog_message_format_find_column(&sdlog_IMU_format, "Lat"));
+
+    /* The last reference frees the name; the test took one above */
+    sdlog_message_format_destroy(&imu_format);
+    TEST_ASSERT_EQUAL_PTR(symbol, sdlog_symbol_find("TimeUS"));
+    sdlog_symbol_release(symbol);
+    TEST_ASSERT_NULL(sdlog_symbol_find("TimeUS"));
+
+    /* Names stay where they are when the table grows, and can be found
+     * after other names were removed */
+    for (i = 0; i < 300; i++) {
+        snprintf(name, sizeof(name), "Col%d", i);
+        TEST_ASSERT_NOT_NULL(symbols[i] = sdlog_symbol_intern(name));
+    }
+    for (i = 0; i < 300; i += 2) {
+        sdlog_symbol_release(symbols[i]);
+    }
+    for (i = 0; i < 300; i++) {
+        snprintf(name, sizeof(name), "Col%d", i);
+        if (i % 2) {
+            TEST_ASSERT_EQUAL_PTR(symbols[i], sdlog_symbol_find(name));
+        } else {
+            TEST_ASSERT_NULL(sdlog_symbol_find(name));
+        }
+    }
+    for (i = 1; i < 300; i += 2) {
+        sdlog_symbol_release(symbols[i]);
+    }
+    TEST_ASSERT_NULL(sdlog_symbol_find("Col1"));
+}
+
 void test_message_encoding(void)
 {
     sdlog_message_format_t format;
@@ -161,6 +231,72 @@ void test_message_encoding_invalid_format_code(void)
     sdlog_message_format_destroy(&format);
 }
 
+void test_static_message_format(void)
+{
+    const sdlog_message_column_format_t* col;
+    char* str;
+
+    TEST_ASSERT_EQUAL(0x20, sdlog_message_format_get_id(&sdlog_IMU_format));
+    TEST_ASSERT_EQUAL_STRING("IMU", sdlog_message_format_get_type(&sdlog_IMU_format));
+    TEST_ASSERT_EQUAL(5, sdlog_message_format_get_column_count(&sdlog_IMU_format));
+    TEST_ASSERT_EQUAL(33, sdlog_message_format_get_size(&sdlog_IMU_format));
+    TEST_ASSERT_EQUAL(36, SDLOG_IMU_LENGTH);
+
+    TEST_ASSERT_NOT_NULL(col = sdlog_message_format_get_column(&sdlog_IMU_format, 1));
+    TEST_ASSERT_EQUAL('f', col->type);
+    TEST_ASSERT_EQUAL('E', col->unit);
+    TEST_ASSERT_EQUAL_STRING("GyrX", col->name);
+
+    TEST_ASSERT_NOT_NULL(col = sdlog_message_format_get_column(&sdlog_IMU_format, 3));
+    TEST_ASSERT_EQUAL('b', col->type);
+    TEST_ASSERT_EQUAL('-', col->unit);
+
+    str = sdlog_message_format_get_format_string(&sdlog_IMU_format);
+    TEST_ASSERT_EQUAL_STRING("QffbN", str);
+    sdlog_free(str);
+
+    str = sdlog_message_format_get_column_names(&sdlog_IMU_format, ",");
+    TEST_ASSERT_EQUAL_STRING("TimeUS,GyrX,GyrY,Hlth,Name", str);
+    sdlog_free(str);
+}
+
+void test_static_message_encoding(void)
+{
+    sdlog_message_format_t format;
+    uint8_t expected[SDLOG_MAX_MESSAGE_LENGTH];
+    uint8_t buf[SDLOG_MAX_MESSAGE_LENGTH];
+    size_t written;
+
+    TEST_CHECK(sdlog_message_format_init(&format, 0x20, "IMU"));
+    TEST_CHECK(sdlog_message_format_add_columns(
+        &format, "TimeUS,GyrX,GyrY,Hlth,Name", "QffbN", "sEE--"));
+    TEST_CHECK(sdlog_message_format_encode(
+        &format, expected, &written, 0x0badcafedeadbeefULL, 0.125, -0.25, -3, "gyro"));
+    sdlog_message_format_destroy(&format);
+
+    TEST_ASSERT_EQUAL(SDLOG_IMU_LENGTH, written);
+    TEST_ASSERT_EQUAL(SDLOG_IMU_LENGTH, sdlog_IMU_encode(buf, 0x0badcafedeadbeefULL, 0.125f, -0.25f, -3, "gyro"));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, buf, SDLOG_IMU_LENGTH);
+}
+
+void test_static_message_format_fmt_record(void)
+{
+    sdlog_message_format_t fmt_format;
+    uint8_t expected[SDLOG_MAX_MESSAGE_LENGTH];
+    size_t written;
+
+    TEST_CHECK(sdlog_message_format_init(&fmt_format, SDLOG_ID_FMT, "FMT"));
+    TEST_CHECK(sdlog_message_format_add_columns(
+        &fmt_format, "Type,Length,Name,Format,Columns", "BBnNZ", "-----"));
+    TEST_CHECK(sdlog_message_format_encode(
+        &fmt_format, expected, &written, 0x20, SDLOG_IMU_LENGTH, "IMU", "QffbN",
+        "TimeUS,GyrX,GyrY,Hlth,Name"));
+    sdlog_message_format_destroy(&fmt_format);
+
+    TEST_ASSERT_EQUAL(written, sizeof(sdlog_IMU_fmt));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, (const uint8_t*)&sdlog_IMU_fmt, written);
+}
+
 int main(int argc, char* argv[])
 {
     UNITY_BEGIN();
@@ -170,8 +306,12 @@ int main(int argc, char* argv[])
     RUN_TEST(test_invalid_message_column_type);
     RUN_TEST(test_create_message_format_with_columns);
     RUN_TEST(test_create_message_format_with_columns_convenience);
+    RUN_TEST(test_column_name_interning);
     RUN_TEST(test_message_encoding);
     RUN_TEST(test_message_encoding_invalid_format_code);
+    RUN_TEST(test_static_message_format);
+    RUN_TEST(test_static_message_encoding);
+    RUN_TEST(test_static_message_format_fmt_record);
 
     return UNITY_END();
 }
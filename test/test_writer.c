@@ -22,12 +22,21 @@
  * SOFTWARE.
  */
 
+#include <sdlog/byteorder.h>
 #include <sdlog/encoder.h>
+#include <sdlog/record_builder.h>
+#include <sdlog/slicer.h>
 #include <sdlog/writer.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "config.h"
 
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 #include "unity.h"
 #include "utils.h"
 
@@ -188,6 +197,325 @@ void test_writer_write_encoded(void)
     sdlog_ostream_destroy(&stream);
 }
 
+/* Output stream that fails its first write and appends the rest to a
+ * buffer stream */
+typedef struct {
+    sdlog_ostream_t* target;
+    bool failed;
+} fail_once_t;
+
+static sdlog_error_t fail_once_write(
+    sdlog_ostream_t* stream, const uint8_t* data, size_t length, size_t* written)
+{
+    fail_once_t* ctx = (fail_once_t*)stream->context;
+
+    if (!ctx->failed) {
+        ctx->failed = true;
+        *written = 0;
+        return SDLOG_EWRITE;
+    }
+
+    return sdlog_ostream_write(ctx->target, data, length, written);
+}
+
+static const sdlog_ostream_spec_t fail_once_methods = {
+    .write = fail_once_write,
+};
+
+void test_writer_failed_record(void)
+{
+    sdlog_writer_t writer;
+    sdlog_ostream_t stream, failing;
+    fail_once_t fail_once = { &stream, false };
+    sdlog_message_format_t format;
+    uint8_t encoded[3 + 1 + 64] = { 0xA3, 0x95, 7, 42 };
+    const uint8_t* buf;
+    size_t size;
+
+    /* The first record cannot be encoded; the FMT record must be sent with
+     * the second one. Arrays are not supported by the encoder, but they can
+     * be written in pre-encoded form. */
+    TEST_CHECK(sdlog_message_format_init(&format, 7, "ARR"));
+    TEST_CHECK(sdlog_message_format_add_columns(&format, "Id,Values", "Ba", "--"));
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&stream));
+    TEST_CHECK(sdlog_writer_init(&writer, &stream));
+    TEST_ERROR(SDLOG_UNIMPLEMENTED, sdlog_writer_write(&writer, &format, 42, NULL));
+    TEST_ASSERT_NULL(writer.formats[7]);
+    TEST_CHECK(sdlog_writer_write_encoded(&writer, &format, encoded, sizeof(encoded)));
+    sdlog_writer_destroy(&writer);
+
+    buf = sdlog_ostream_buffer_get(&stream, &size);
+    TEST_ASSERT_EQUAL(89 + sizeof(encoded), size);
+    TEST_ASSERT_EQUAL_HEX8(0x80, buf[2]);
+    TEST_ASSERT_EQUAL(7, buf[3]);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(encoded, buf + 89, sizeof(encoded));
+    sdlog_ostream_destroy(&stream);
+
+    /* Same when the stream rejects the first record */
+    TEST_CHECK(sdlog_ostream_init_buffer(&stream));
+    TEST_CHECK(sdlog_ostream_init(&failing, &fail_once_methods, &fail_once));
+    TEST_CHECK(sdlog_writer_init(&writer, &failing));
+    TEST_ERROR(SDLOG_EWRITE, sdlog_writer_write_encoded(&writer, &format, encoded, sizeof(encoded)));
+    TEST_CHECK(sdlog_writer_write_encoded(&writer, &format, encoded, sizeof(encoded)));
+    sdlog_writer_destroy(&writer);
+    sdlog_ostream_destroy(&failing);
+
+    buf = sdlog_ostream_buffer_get(&stream, &size);
+    TEST_ASSERT_EQUAL(89 + sizeof(encoded), size);
+    TEST_ASSERT_EQUAL_HEX8(0x80, buf[2]);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(encoded, buf + 89, sizeof(encoded));
+    sdlog_ostream_destroy(&stream);
+
+    sdlog_message_format_destroy(&format);
+}
+
+void test_record_builder(void)
+{
+    sdlog_message_format_t format;
+    sdlog_record_builder_t builder;
+    uint8_t expected[SDLOG_MAX_MESSAGE_LENGTH];
+    const uint8_t* record;
+    size_t length, expected_length;
+
+    TEST_CHECK(sdlog_message_format_init(&format, 3, "MIX"));
+    TEST_CHECK(sdlog_message_format_add_columns(
+        &format, "s8,u16,s32,u64,float,double,name,unset", "bHiQfdNI", "--------"));
+
+    TEST_CHECK(sdlog_record_builder_init(&builder, &format));
+
+    TEST_CHECK(sdlog_record_builder_set_i8(&builder, 0, -2));
+    TEST_CHECK(sdlog_record_builder_set_u16(&builder, 1, 0xcafe));
+    TEST_CHECK(sdlog_record_builder_set_i32(&builder, 2, -123456));
+    TEST_CHECK(sdlog_record_builder_set_u64(&builder, 3, 0xdeadbeef0badcafeULL));
+    TEST_CHECK(sdlog_record_builder_set_f32(&builder, 4, 0.125f));
+    TEST_CHECK(sdlog_record_builder_set_f64(&builder, 5, 0.25));
+    TEST_CHECK(sdlog_record_builder_set_str(&builder, 6, "builder"));
+
+    /* Type and index mismatches */
+    TEST_ERROR(SDLOG_EINVAL, sdlog_record_builder_set_u32(&builder, 1, 1));
+    TEST_ERROR(SDLOG_EINVAL, sdlog_record_builder_set_u32(&builder, 4, 1));
+    TEST_ERROR(SDLOG_EINVAL, sdlog_record_builder_set_f64(&builder, 4, 1));
+    TEST_ERROR(SDLOG_EINVAL, sdlog_record_builder_set_str(&builder, 0, "x"));
+    TEST_ERROR(SDLOG_EINVAL, sdlog_record_builder_set_u8(&builder, 8, 1));
+
+    TEST_CHECK(sdlog_message_format_encode(
+        &format, expected, &expected_length,
+        -2, 0xcafe, -123456, 0xdeadbeef0badcafeULL, 0.125, 0.25, "builder", 0));
+
+    record = sdlog_record_builder_get(&builder, &length);
+    TEST_ASSERT_EQUAL(expected_length, length);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, record, length);
+
+    /* Resetting zeroes every column but keeps the header */
+    sdlog_record_builder_reset(&builder);
+    TEST_CHECK(sdlog_message_format_encode(
+        &format, expected, &expected_length, 0, 0, 0, 0ULL, 0.0, 0.0, "", 0));
+    record = sdlog_record_builder_get(&builder, NULL);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, record, expected_length);
+
+    sdlog_record_builder_destroy(&builder);
+    sdlog_message_format_destroy(&format);
+}
+
+void test_record_builder_commit(void)
+{
+    sdlog_writer_t writer;
+    sdlog_ostream_t stream;
+    sdlog_message_format_t int_format;
+    sdlog_record_builder_t builder;
+    uint8_t expected[SDLOG_MAX_MESSAGE_LENGTH];
+    size_t expected_length, size;
+    const uint8_t* buf;
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&stream));
+
+    TEST_CHECK(sdlog_message_format_init(&int_format, 1, "INT"));
+    TEST_CHECK(sdlog_message_format_add_columns(
+        &int_format,
+        "s8,u8,s16,u16,s32,u32,s64,u64",
+        "bBhHiIqQ",
+        "--------"));
+
+    TEST_CHECK(sdlog_message_format_encode(&int_format, expected, &expected_length,
+        0x0badcafe, 0xdeadbeef, 0x0badcafe, 0xdeadbeef,
+        0x0badcafe, 0xdeadbeef, 0x0badcafeLL, 0xdeadbeefULL));
+
+    TEST_CHECK(sdlog_writer_init(&writer, &stream));
+    TEST_CHECK(sdlog_record_builder_init(&builder, &int_format));
+
+    TEST_CHECK(sdlog_record_builder_set_i8(&builder, 0, (int8_t)0xfe));
+    TEST_CHECK(sdlog_record_builder_set_u8(&builder, 1, 0xef));
+    TEST_CHECK(sdlog_record_builder_set_i16(&builder, 2, (int16_t)0xcafe));
+    TEST_CHECK(sdlog_record_builder_set_u16(&builder, 3, 0xbeef));
+    TEST_CHECK(sdlog_record_builder_set_i32(&builder, 4, 0x0badcafe));
+    TEST_CHECK(sdlog_record_builder_set_u32(&builder, 5, 0xdeadbeef));
+    TEST_CHECK(sdlog_record_builder_set_i64(&builder, 6, 0x0badcafeLL));
+    TEST_CHECK(sdlog_record_builder_set_u64(&builder, 7, 0xdeadbeefULL));
+    TEST_CHECK(sdlog_record_builder_commit(&builder, &writer));
+
+    sdlog_record_builder_destroy(&builder);
+    sdlog_writer_destroy(&writer);
+    sdlog_message_format_destroy(&int_format);
+
+    /* FMT record followed by the record itself */
+    buf = sdlog_ostream_buffer_get(&stream, &size);
+    TEST_ASSERT_EQUAL(89 + expected_length, size);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, buf + 89, expected_length);
+
+    sdlog_ostream_destroy(&stream);
+}
+
+typedef struct {
+    uint32_t start, end, current;
+} window_t;
+
+/* Sample log: a SEQ record with each sequence number in the given range and
+ * a VAL record after every fourth one */
+static void write_sample_log(sdlog_ostream_t* stream, uint32_t start, uint32_t end)
+{
+    sdlog_writer_t writer;
+    sdlog_message_format_t seq_format, val_format;
+    uint32_t i;
+
+    TEST_CHECK(sdlog_message_format_init(&seq_format, 1, "SEQ"));
+    TEST_CHECK(sdlog_message_format_add_columns(&seq_format, "Seq", "I", "-"));
+    TEST_CHECK(sdlog_message_format_init(&val_format, 2, "VAL"));
+    TEST_CHECK(sdlog_message_format_add_columns(&val_format, "Value,Seq", "fI", "--"));
+
+    TEST_CHECK(sdlog_writer_init(&writer, stream));
+    for (i = start; i < end; i++) {
+        TEST_CHECK(sdlog_writer_write(&writer, &seq_format, i));
+        if (i % 4 == 1) {
+            TEST_CHECK(sdlog_writer_write(&writer, &val_format, 0.5 * i, i));
+        }
+    }
+    sdlog_writer_destroy(&writer);
+
+    sdlog_message_format_destroy(&val_format);
+    sdlog_message_format_destroy(&seq_format);
+}
+
+static sdlog_slice_decision_t window_filter(
+    void* arg, uint64_t offset, const uint8_t* record, size_t length)
+{
+    window_t* window = (window_t*)arg;
+
+    if (record[2] == 1) {
+        window->current = sdlog_load_u32_le(record + 3);
+        if (window->current >= window->end) {
+            return SDLOG_SLICE_STOP;
+        }
+    }
+
+    return window->current >= window->start ? SDLOG_SLICE_KEEP : SDLOG_SLICE_SKIP;
+}
+
+void test_slice(void)
+{
+    sdlog_istream_t input;
+    sdlog_ostream_t log, expected, output;
+    const uint8_t *log_buf, *expected_buf, *buf;
+    size_t log_length, expected_length, length;
+    window_t window = { 4, 8, 0 };
+    uint8_t garbage[] = { 0xA3, 0x95, 0x01, 0x00, 0x00, 0x00, 0x00 };
+#if HAVE_UNISTD_H
+    char in_path[] = "/tmp/sdlog-test-XXXXXX";
+    char out_path[] = "/tmp/sdlog-test-XXXXXX";
+    uint8_t inbuf[4096];
+    int in_fd, out_fd, fds[2];
+#endif
+
+    TEST_CHECK(sdlog_ostream_init_buffer(&log));
+    write_sample_log(&log, 0, 12);
+    log_buf = sdlog_ostream_buffer_get(&log, &log_length);
+
+    /* The slice is the same as a log written with the kept records only;
+     * the FMT record of VAL is written separately, the one of SEQ too */
+    TEST_CHECK(sdlog_ostream_init_buffer(&expected));
+    write_sample_log(&expected, 4, 8);
+    expected_buf = sdlog_ostream_buffer_get(&expected, &expected_length);
+
+    TEST_CHECK(sdlog_istream_init_buffer(&input, log_buf, log_length));
+    TEST_CHECK(sdlog_ostream_init_buffer(&output));
+    TEST_CHECK(sdlog_slice(&input, &output, window_filter, &window));
+    buf = sdlog_ostream_buffer_get(&output, &length);
+    TEST_ASSERT_EQUAL(expected_length, length);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_buf, buf, length);
+    sdlog_ostream_destroy(&output);
+    sdlog_istream_destroy(&input);
+    sdlog_ostream_destroy(&expected);
+
+    /* FMT records that follow kept records are copied along with them */
+    window.start = 1;
+    window.end = 100;
+    TEST_CHECK(sdlog_ostream_init_buffer(&expected));
+    write_sample_log(&expected, 1, 12);
+    expected_buf = sdlog_ostream_buffer_get(&expected, &expected_length);
+
+    TEST_CHECK(sdlog_istream_init_buffer(&input, log_buf, log_length));
+    TEST_CHECK(sdlog_ostream_init_buffer(&output));
+    TEST_CHECK(sdlog_slice(&input, &output, window_filter, &window));
+    buf = sdlog_ostream_buffer_get(&output, &length);
+    TEST_ASSERT_EQUAL(expected_length, length);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_buf, buf, length);
+    sdlog_ostream_destroy(&output);
+    sdlog_istream_destroy(&input);
+
+    /* A truncated last record ends the log */
+    TEST_CHECK(sdlog_istream_init_buffer(&input, log_buf, log_length - 2));
+    TEST_CHECK(sdlog_ostream_init_buffer(&output));
+    TEST_CHECK(sdlog_slice(&input, &output, window_filter, &window));
+    buf = sdlog_ostream_buffer_get(&output, &length);
+    TEST_ASSERT_EQUAL(expected_length - 7, length);
+    sdlog_ostream_destroy(&output);
+    sdlog_istream_destroy(&input);
+
+    /* Records of undefined formats */
+    TEST_CHECK(sdlog_istream_init_buffer(&input, garbage, sizeof(garbage)));
+    TEST_CHECK(sdlog_ostream_init_buffer(&output));
+    TEST_ERROR(SDLOG_EPARSE, sdlog_slice(&input, &output, window_filter, &window));
+    sdlog_ostream_destroy(&output);
+    sdlog_istream_destroy(&input);
+
+#if HAVE_UNISTD_H
+    /* Files are copied in the kernel */
+    in_fd = mkstemp(in_path);
+    TEST_ASSERT_TRUE(in_fd >= 0);
+    out_fd = mkstemp(out_path);
+    TEST_ASSERT_TRUE(out_fd >= 0);
+    TEST_ASSERT_EQUAL(log_length, write(in_fd, log_buf, log_length));
+
+    TEST_CHECK(sdlog_istream_init_fd(&input, in_fd));
+    TEST_CHECK(sdlog_istream_seek(&input, 0));
+    TEST_CHECK(sdlog_ostream_init_fd(&output, out_fd, NULL));
+    TEST_CHECK(sdlog_slice(&input, &output, window_filter, &window));
+    sdlog_ostream_destroy(&output);
+    TEST_ASSERT_EQUAL(expected_length, pread(out_fd, inbuf, sizeof(inbuf), 0));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_buf, inbuf, expected_length);
+
+    /* Pipes too */
+    TEST_CHECK(sdlog_istream_seek(&input, 0));
+    TEST_ASSERT_EQUAL(0, pipe(fds));
+    TEST_CHECK(sdlog_ostream_init_fd(&output, fds[1], NULL));
+    TEST_CHECK(sdlog_slice(&input, &output, window_filter, &window));
+    sdlog_ostream_destroy(&output);
+    close(fds[1]);
+    TEST_ASSERT_EQUAL(expected_length, read(fds[0], inbuf, sizeof(inbuf)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_buf, inbuf, expected_length);
+    close(fds[0]);
+
+    sdlog_istream_destroy(&input);
+    close(in_fd);
+    close(out_fd);
+    unlink(in_path);
+    unlink(out_path);
+#endif
+
+    sdlog_ostream_destroy(&expected);
+    sdlog_ostream_destroy(&log);
+}
+
 int main(int argc, char* argv[])
 {
     UNITY_BEGIN();
@@ -195,6 +523,10 @@ int main(int argc, char* argv[])
     RUN_TEST(test_writer_init_destroy);
     RUN_TEST(test_writer_formats);
     RUN_TEST(test_writer_write_encoded);
+    RUN_TEST(test_writer_failed_record);
+    RUN_TEST(test_record_builder);
+    RUN_TEST(test_record_builder_commit);
+    RUN_TEST(test_slice);
 
     return UNITY_END();
 }